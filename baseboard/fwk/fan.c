@@ -11,6 +11,7 @@
 #include "common.h"
 #include "console.h"
 #include "fan.h"
+#include "fan_pid.h"
 #include "gpio.h"
 #include "hooks.h"
 #include "host_command.h"
@@ -61,6 +62,9 @@ void fan_set_enabled(int ch, int enabled)
 			pwm_enable(ch, enabled);
 		} else {
 			integral_factor[ch] = 0;
+#ifdef CONFIG_FAN_PID
+			fan_pid_set_target(ch, 0);
+#endif
 		}
 	} else {
 		if (enabled) {
@@ -113,6 +117,13 @@ int fan_rpm_to_percent(int fan, int rpm)
 	return pct;
 }
 
+#ifdef CONFIG_FAN_PID
+__override int board_fan_pid_feedforward(int fan, int rpm)
+{
+	return fan_rpm_to_percent(fan, rpm);
+}
+#endif
+
 void fan_set_duty(int ch, int percent)
 {
 	if (ch < 0 || ch > MCHP_TACH_ID_MAX || ch > FAN_CH_COUNT)
@@ -188,6 +199,12 @@ void fan_set_rpm_target(int ch, int rpm)
 		rpm = 1200;
 	}
 
+#ifdef CONFIG_FAN_PID
+	/* The PID loop takes it from here, at its own rate */
+	fan_pid_set_target(ch, rpm);
+	return;
+#endif
+
 	pct = fan_rpm_to_percent(ch, rpm);
 	delta = rpm - fan_get_rpm_actual(ch);
 	/**
@@ -224,8 +241,13 @@ enum fan_status fan_get_status(int ch)
 	/* TODO */
 	if (fan_get_rpm_actual(ch) == 0)
 		return FAN_STATUS_STOPPED;
+#ifdef CONFIG_FAN_PID
+	if (fan_pid_saturated(ch))
+		return FAN_STATUS_FRUSTRATED;
+#else
 	if (ABS(integral_factor[ch]) >= FAN_PID_I_MAX)
 		return FAN_STATUS_FRUSTRATED;
+#endif
 	if (ABS(fan_get_rpm_actual(ch)-fan_get_rpm_target(ch)) > 200)
 		return FAN_STATUS_CHANGING;
 	return FAN_STATUS_LOCKED;
@@ -44,6 +44,7 @@
 
 /* The Fn key function not ready yet undefined it until the function finish */
 #define CONFIG_KEYBOARD_SCANCODE_CALLBACK
+#define CONFIG_KEYBOARD_SCANCODE_LOOKUP
 
 #define CONFIG_KEYBOARD_BACKLIGHT
 /*Assume we should move to CONFIG_PWM_KBLIGHT later*/
@@ -214,8 +215,18 @@
 /* #define CONFIG_HOSTCMD_PD_PANIC */
 #define CONFIG_I2C
 #define CONFIG_I2C_MASTER
+/*
+ * Run I2C transfers from the controller interrupt, see "i2cqueue".  Not
+ * validated on hardware yet, build it with "make BOARD=hx30 I2C_ASYNC=1".
+ */
+#ifdef I2C_ASYNC
+#define CONFIG_I2C_ASYNC
+#endif
 #define CONFIG_KEYBOARD_BOARD_CONFIG
 #define CONFIG_KEYBOARD_PROTOCOL_8042
+#define CONFIG_8042_OBE_REFILL
+#undef CONFIG_8042_TO_HOST_SIZE
+#define CONFIG_8042_TO_HOST_SIZE 64
 #define CONFIG_SIMULATE_KEYCODE
 
 /* i2c hid interface for HID mediakeys (brightness, airplane mode) */
@@ -242,8 +253,13 @@
 /*
  * Enable MCHP Low Power Idle support
  * and API to power down pins
- * #define CONFIG_LOW_POWER_IDLE
+ * Not validated on hx30 yet, build it with "make BOARD=hx30 LOW_POWER_IDLE=1",
+ * which also counts what wakes the EC, see "wakestats".
  */
+#ifdef LOW_POWER_IDLE
+#define CONFIG_LOW_POWER_IDLE
+#define CONFIG_WAKE_STATS
+#endif
 
 
 /* #define CONFIG_GPIO_POWER_DOWN */
@@ -324,6 +340,10 @@
 /* TODO FRAMEWORK 
 #define CONFIG_VBOOT_HASH
 */
+/* Per sector SHA-256 for "ectool flashwritedelta" */
+#define CONFIG_FLASH_SECTOR_HASH
+/* Double buffered "ectool flashwrite" */
+#define CONFIG_FLASH_WRITE_STREAM
 /*
  * MEC1701H loads firmware using QMSPI controller
  * CONFIG_SPI_FLASH_PORT is the index into
@@ -408,6 +428,7 @@
 #undef CONFIG_FAN_INIT_SPEED
 #define CONFIG_FAN_INIT_SPEED 15
 #define FAN_HARDARE_MAX 7100
+#define CONFIG_FAN_PID
 #define CONFIG_TEMP_SENSOR
 #define CONFIG_DPTF
 #define CONFIG_TEMP_SENSOR_F75303
@@ -415,6 +436,9 @@
 #define F75303_I2C_ADDR_FLAGS 0x4D
 #define CONFIG_CHIPSET_CAN_THROTTLE		/* Enable EC_PROCHOT_L control */
 
+/* Battery/thermal/fan snapshot for host monitoring, see ec_commands.h */
+#define CONFIG_MEMMAP_TELEMETRY
+
 #define CONFIG_THROTTLE_AP
 
 /* Factory mode support */
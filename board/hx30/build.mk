@@ -19,6 +19,15 @@ CHIP_SPI_SIZE_KB:=512
 
 BASEBOARD:=fwk
 
+# Drivers not validated on hardware yet, e.g. "make BOARD=hx30 I2C_ASYNC=1"
+ENV_VARS := I2C_ASYNC LOW_POWER_IDLE
+ifneq ($(I2C_ASYNC),)
+CPPFLAGS += -DI2C_ASYNC=$(EMPTY)
+endif
+ifneq ($(LOW_POWER_IDLE),)
+CPPFLAGS += -DLOW_POWER_IDLE=$(EMPTY)
+endif
+
 board-y=board.o led.o power_sequence.o cypress5525.o ucsi.o cpu_power.o
 board-$(CONFIG_KEYBOARD_CUSTOMIZATION)+=keyboard_customization.o
 board-$(CONFIG_POWER_BUTTON_CUSTOM) += power_button_x86.o
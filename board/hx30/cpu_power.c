@@ -7,6 +7,7 @@
 #include "chipset.h"
 #include "console.h"
 #include "extpower.h"
+#include "fan_pid.h"
 #include "hooks.h"
 #include "host_command.h"
 #include "peci.h"
@@ -20,6 +21,8 @@
 #define CPRINTF(format, args...) cprintf(CC_USBCHARGE, format, ## args)
 
 #define POWER_LIMIT_1_W	30
+/* Highest PL2 set on AC, taken as full load by the fan loop */
+#define POWER_LIMIT_2_MAX_W	64
 
 static int pl1_watt;
 static int pl2_watt;
@@ -33,6 +36,13 @@ void set_pl_limits(int pl1, int pl2, int pl4, int psys)
 		peci_update_PL2(pl2);
 		peci_update_PL4(pl4);
 		peci_update_PsysPL2(psys);
+#ifdef CONFIG_FAN_PID
+		/*
+		 * The package power is not read back from the SoC, so spin the
+		 * fan up ahead of the heat from the limits it may draw up to.
+		 */
+		fan_pid_set_load(pl2 * 100 / POWER_LIMIT_2_MAX_W);
+#endif
 }
 
 void update_soc_power_limit(bool force_update, bool force_no_adapter)
@@ -66,11 +76,11 @@ void update_soc_power_limit(bool force_update, bool force_no_adapter)
 	} else if (battery_percent < 30) {
 		/* ADP > 55W and Battery percentage < 30% */
 		pl4_watt = active_power - 15 - pps_power_budget;
-		pl2_watt = MIN((pl4_watt * 90) / 100, 64);
+		pl2_watt = MIN((pl4_watt * 90) / 100, POWER_LIMIT_2_MAX_W);
 		psys_watt = ((active_power * 95) / 100) - pps_power_budget;
 	} else {
 		/* ADP > 55W and Battery percentage >= 30% */
-		pl2_watt = 64;
+		pl2_watt = POWER_LIMIT_2_MAX_W;
 		pl4_watt = 140;
 		/* psys watt = adp watt * 0.95 + battery watt(55 W) * 0.7 - pps power budget */
 		psys_watt = ((active_power * 95) / 100) + 39 - pps_power_budget;
@@ -82,6 +92,9 @@ void update_soc_power_limit(bool force_update, bool force_no_adapter)
 		old_pl2_watt = pl2_watt;
 
 		pl1_watt = POWER_LIMIT_1_W;
+		/* Forced updates write the limits even if they did not change */
+		if (force_update)
+			peci_pl_cache_reset();
 		if (manual_ctl == false) {
 			CPRINTS("Updating SOC Power Limits: PL2 %d, PL4 %d, Psys %d, Adapter %d",
 				pl2_watt, pl4_watt, psys_watt, active_power);
@@ -120,6 +133,7 @@ static int cmd_cpupower(int argc, char **argv)
 
 	CPRINTF("SOC Power Limit: PL1 %d, PL2 %d, PL4 %d, Psys %d\n",
 		pl1_watt, pl2_watt, pl4_watt, psys_watt);
+	CPRINTF("Unchanged limits skipped: %d\n", peci_pl_cache_hits());
 	if (argc >= 2) {
 		if (!strncmp(argv[1], "auto", 4)) {
 			manual_ctl = false;
@@ -200,6 +200,8 @@ int cyp5525_reset(int controller)
 	 * and start at the boot-loader stage again
 	 * Note: need barrel AC or battery
 	 */
+	i2c_cache_invalidate(pd_chip_config[controller].i2c_port,
+			     pd_chip_config[controller].addr_flags);
 	return cypd_write_reg16(controller, CYP5525_RESET_REG, CYP5225_RESET_CMD);
 }
 
@@ -1219,6 +1221,8 @@ int cyp5525_device_int(int controller)
 		switch (data & 0xFF) {
 		case CYPD_RESPONSE_RESET_COMPLETE:
 					CPRINTS("PD%d Reset Complete", controller);
+			i2c_cache_invalidate(pd_chip_config[controller].i2c_port,
+					     pd_chip_config[controller].addr_flags);
 
 			pd_chip_config[controller].state = CYP5525_STATE_POWER_ON;
 			/* Run state handler to set up controller */
@@ -1460,7 +1464,8 @@ void cypd_interrupt_handler_task(void *p)
 		cypd_enque_evt(CYPD_EVT_STATE_CTRL_0<<i, 0);
 	}
 	while (1) {
-		evt = task_wait_event(10*MSEC);
+		/* The poll only backs up the interrupts, it need not be exact */
+		evt = task_wait_event_slack(10*MSEC, 5*MSEC);
 
 		if (firmware_update)
 			continue;
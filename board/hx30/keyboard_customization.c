@@ -49,10 +49,19 @@ uint16_t get_scancode_set2(uint8_t row, uint8_t col)
 	return 0;
 }
 
+#ifdef CONFIG_KEYBOARD_CUSTOMIZATION_COMBINATION_KEY
+static void kb_layers_rebuild(void);
+DECLARE_DEFERRED(kb_layers_rebuild);
+#endif
+
 void set_scancode_set2(uint8_t row, uint8_t col, uint16_t val)
 {
 	if (col < KEYBOARD_COLS_MAX && row < KEYBOARD_ROWS)
 		scancode_set2[col][row] = val;
+#ifdef CONFIG_KEYBOARD_CUSTOMIZATION_COMBINATION_KEY
+	/* Deferred, so a batch of updates only rebuilds the layers once */
+	hook_call_deferred(&kb_layers_rebuild_data, 0);
+#endif
 }
 
 // void board_keyboard_drive_col(int col)
@@ -220,33 +229,157 @@ void board_kblight_init(void)
 #define FN_PRESSED BIT(0)
 #define FN_LOCKED BIT(1)
 static uint8_t Fn_key;
-static uint32_t fn_key_table_media;
-static uint32_t fn_key_table;
 
-int fn_table_media_set(int8_t pressed, uint32_t fn_bit)
+/*
+ * Key events are resolved with a single load from a flat per-layer table,
+ * indexed by the Fn state. Without Fn lock the top row sends media keys and
+ * Fn gives F1-F12 and the navigation keys; Fn lock swaps the top row.
+ */
+enum kb_layer {
+	KB_LAYER_MEDIA = 0,
+	KB_LAYER_FN = FN_PRESSED,
+	KB_LAYER_LOCK = FN_LOCKED,
+	KB_LAYER_LOCK_FN = FN_PRESSED | FN_LOCKED,
+	KB_LAYER_COUNT
+};
+
+#define KB_KEYS (KEYBOARD_COLS_MAX * KEYBOARD_ROWS)
+
+/* Table entries for keys that do something else than send a scancode */
+#define KB_ACTION(n) (0xf000 | (n))
+#define KB_IS_ACTION(code) (((code) & 0xff00) == 0xf000)
+
+enum kb_action {
+	KB_ACT_FN = KB_ACTION(0),
+	KB_ACT_FN_LOCK,
+	KB_ACT_BRIGHTNESS_DN,
+	KB_ACT_BRIGHTNESS_UP,
+	KB_ACT_PROJECT,
+	KB_ACT_AIRPLANE,
+	KB_ACT_BREAK,
+	KB_ACT_PAUSE,
+	KB_ACT_BACKLIGHT,
+};
+
+struct kb_remap {
+	uint16_t from;
+	uint16_t to;
+};
+
+/* Top row in the media layers */
+static const struct kb_remap media_keys[] = {
+	{SCANCODE_F1, SCANCODE_VOLUME_MUTE},
+	{SCANCODE_F2, SCANCODE_VOLUME_DOWN},
+	{SCANCODE_F3, SCANCODE_VOLUME_UP},
+	{SCANCODE_F4, SCANCODE_PREV_TRACK},
+	{SCANCODE_F5, 0xe034},			/* PLAY_PAUSE */
+	{SCANCODE_F6, SCANCODE_NEXT_TRACK},
+	{SCANCODE_F7, KB_ACT_BRIGHTNESS_DN},
+	{SCANCODE_F8, KB_ACT_BRIGHTNESS_UP},
+	{SCANCODE_F9, KB_ACT_PROJECT},		/* EXTERNAL_DISPLAY */
+	{SCANCODE_F10, KB_ACT_AIRPLANE},
+	/*
+	 * TODO this might need an extra key combo of 0xE012 0xE07C to
+	 * simulate PRINT_SCREEN
+	 */
+	{SCANCODE_F11, 0xe07c},
+	{SCANCODE_F12, 0xe050},			/* FRAMEWORK: Media Select */
+};
+
+/* Keys combined with Fn */
+static const struct kb_remap fn_keys[] = {
+	{SCANCODE_DELETE, 0xe070},		/* INSERT */
+	{SCANCODE_K, SCANCODE_SCROLL_LOCK},
+	{SCANCODE_LEFT, 0xe06c},		/* HOME */
+	{SCANCODE_RIGHT, 0xe069},		/* END */
+	{SCANCODE_UP, 0xe07d},			/* PAGE_UP */
+	{SCANCODE_DOWN, 0xe07a},		/* PAGE_DOWN */
+	{SCANCODE_ESC, KB_ACT_FN_LOCK},
+	{SCANCODE_B, KB_ACT_BREAK},
+	{SCANCODE_P, KB_ACT_PAUSE},
+	{SCANCODE_SPACE, KB_ACT_BACKLIGHT},
+};
+
+/*
+ * The layer tables are derived from scancode_set2. When it changes they are
+ * rebuilt in the idle bank, which is then published with a single pointer
+ * store, so the keyboard task never sees a half-updated table.
+ */
+struct kb_layer_bank {
+	uint16_t code[KB_LAYER_COUNT][KB_KEYS];
+};
+static struct kb_layer_bank kb_banks[2];
+static struct kb_layer_bank *volatile kb_active;
+
+/* Layer each key was pressed in, so it is released in the same one */
+static uint8_t kb_key_layer[KB_KEYS];
+
+static uint16_t kb_remap(const struct kb_remap *map, int count, uint16_t code)
 {
-	if (pressed) {
-		fn_key_table_media |= fn_bit;
-		return true;
-	} else if (!pressed && (fn_key_table_media & fn_bit)) {
-		fn_key_table_media &= ~fn_bit;
-		return true;
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (map[i].from == code)
+			return map[i].to;
+	return code;
+}
+
+static void kb_layers_rebuild(void)
+{
+	struct kb_layer_bank *bank =
+		kb_active == &kb_banks[0] ? &kb_banks[1] : &kb_banks[0];
+	uint16_t code, media, fn;
+	int row, col, idx, layer;
+
+	for (col = 0; col < KEYBOARD_COLS_MAX; col++) {
+		for (row = 0; row < KEYBOARD_ROWS; row++) {
+			idx = col * KEYBOARD_ROWS + row;
+			code = scancode_set2[col][row];
+
+			if (code == SCANCODE_FN) {
+				for (layer = 0; layer < KB_LAYER_COUNT; layer++)
+					bank->code[layer][idx] = KB_ACT_FN;
+				continue;
+			}
+
+			media = kb_remap(media_keys, ARRAY_SIZE(media_keys),
+					 code);
+			fn = kb_remap(fn_keys, ARRAY_SIZE(fn_keys), code);
+			bank->code[KB_LAYER_MEDIA][idx] = media;
+			bank->code[KB_LAYER_FN][idx] = fn;
+			bank->code[KB_LAYER_LOCK][idx] = code;
+			bank->code[KB_LAYER_LOCK_FN][idx] =
+				fn != code ? fn : media;
+		}
 	}
 
-	return false;
+	kb_active = bank;
 }
+DECLARE_HOOK(HOOK_INIT, kb_layers_rebuild, HOOK_PRIO_FIRST);
 
-int fn_table_set(int8_t pressed, uint32_t fn_bit)
+uint16_t keyboard_scancode_lookup(uint8_t row, uint8_t col, int8_t pressed)
 {
-	if (pressed && (Fn_key & FN_PRESSED)) {
-		fn_key_table |= fn_bit;
-		return true;
-	} else if (!pressed && (fn_key_table & fn_bit)) {
-		fn_key_table &= ~fn_bit;
-		return true;
+	const struct kb_layer_bank *bank = kb_active;
+	int idx = col * KEYBOARD_ROWS + row;
+	uint8_t layer;
+
+	if (col >= KEYBOARD_COLS_MAX || row >= KEYBOARD_ROWS)
+		return 0;
+
+	/* Factory mode sends the raw matrix */
+	if (factory_status() || !bank)
+		return scancode_set2[col][row];
+
+	if (pressed) {
+		/* Before the OS is up, only Fn itself is handled */
+		layer = pos_get_state() ? Fn_key & (FN_PRESSED | FN_LOCKED) :
+					  KB_LAYER_LOCK;
+		kb_key_layer[idx] = layer;
+	} else {
+		layer = kb_key_layer[idx];
 	}
 
-	return false;
+	return bank->code[layer][idx];
 }
 
 void fnkey_shutdown(void) {
@@ -276,253 +409,93 @@ void fnkey_startup(void) {
 }
 DECLARE_HOOK(HOOK_CHIPSET_STARTUP, fnkey_startup, HOOK_PRIO_DEFAULT);
 
-int hotkey_F1_F12(uint16_t *key_code, uint16_t fn, int8_t pressed)
+static void kblight_step(void)
 {
-	const uint16_t prss_key = *key_code;
-
-	if (!(Fn_key & FN_LOCKED) &&
-		(fn & FN_PRESSED))
-		return EC_SUCCESS;
-	else if (Fn_key & FN_LOCKED &&
-		!(fn & FN_PRESSED) &&
-		!fn_key_table_media)
-		return EC_SUCCESS;
-	else if (!fn_key_table_media && !pressed)
-		return EC_SUCCESS;
+	uint8_t bl_brightness = kblight_get();
 
-	switch (prss_key) {
-	case SCANCODE_F1:  /* SPEAKER_MUTE */
-		if (fn_table_media_set(pressed, KB_FN_F1))
-			*key_code = SCANCODE_VOLUME_MUTE;
-		break;
-	case SCANCODE_F2:  /* VOLUME_DOWN */
-		if (fn_table_media_set(pressed, KB_FN_F2))
-			*key_code = SCANCODE_VOLUME_DOWN;
-		break;
-	case SCANCODE_F3:  /* VOLUME_UP */
-		if (fn_table_media_set(pressed, KB_FN_F3))
-			*key_code = SCANCODE_VOLUME_UP;
-		break;
-	case SCANCODE_F4:  /* PREVIOUS_TRACK */
-		if (fn_table_media_set(pressed, KB_FN_F4))
-			*key_code = SCANCODE_PREV_TRACK;
-		break;
-	case SCANCODE_F5:  /* PLAY_PAUSE */
-		if (fn_table_media_set(pressed, KB_FN_F5))
-			*key_code = 0xe034;
-		break;
-	case SCANCODE_F6:  /* NEXT_TRACK */
-		if (fn_table_media_set(pressed, KB_FN_F6))
-			*key_code = SCANCODE_NEXT_TRACK;
-		break;
-	case SCANCODE_F7:  /* TODO: DIM_SCREEN */
-		if (fn_table_media_set(pressed, KB_FN_F7)) {
-			update_hid_key(HID_KEY_DISPLAY_BRIGHTNESS_DN, pressed);
-			return EC_ERROR_UNIMPLEMENTED;
-		}
-		break;
-	case SCANCODE_F8:  /* TODO: BRIGHTEN_SCREEN */
-		if (fn_table_media_set(pressed, KB_FN_F8)) {
-			update_hid_key(HID_KEY_DISPLAY_BRIGHTNESS_UP, pressed);
-			return EC_ERROR_UNIMPLEMENTED;
-		}
-		break;
-	case SCANCODE_F9:  /* EXTERNAL_DISPLAY */
-		if (fn_table_media_set(pressed, KB_FN_F9)) {
-			if (pressed) {
-				simulate_keyboard(SCANCODE_LEFT_WIN, 1);
-				simulate_keyboard(SCANCODE_P, 1);
-			} else {
-				simulate_keyboard(SCANCODE_P, 0);
-				simulate_keyboard(SCANCODE_LEFT_WIN, 0);
-			}
-			return EC_ERROR_UNIMPLEMENTED;
-		}
+	switch (bl_brightness) {
+	case KEYBOARD_BL_BRIGHTNESS_LOW:
+		bl_brightness = KEYBOARD_BL_BRIGHTNESS_MED;
 		break;
-	case SCANCODE_F10:  /* FLIGHT_MODE */
-		if (fn_table_media_set(pressed, KB_FN_F10)) {
-			update_hid_key(HID_KEY_AIRPLANE_MODE, pressed);
-			return EC_ERROR_UNIMPLEMENTED;
-		}
-		break;
-	case SCANCODE_F11:
-			/*
-			 * TODO this might need an
-			 * extra key combo of:
-			 * 0xE012 0xE07C to simulate
-			 * PRINT_SCREEN
-			 */
-		if (fn_table_media_set(pressed, KB_FN_F11))
-			*key_code = 0xE07C;
+	case KEYBOARD_BL_BRIGHTNESS_MED:
+		bl_brightness = KEYBOARD_BL_BRIGHTNESS_HIGH;
 		break;
-	case SCANCODE_F12:  /* TODO: FRAMEWORK */
-		/* Media Select scan code */
-		if (fn_table_media_set(pressed, KB_FN_F12))
-			*key_code = 0xE050;
+	case KEYBOARD_BL_BRIGHTNESS_HIGH:
+		hx20_kblight_enable(0);
+		bl_brightness = KEYBOARD_BL_BRIGHTNESS_OFF;
 		break;
 	default:
-		return EC_SUCCESS;
+	case KEYBOARD_BL_BRIGHTNESS_OFF:
+		hx20_kblight_enable(1);
+		bl_brightness = KEYBOARD_BL_BRIGHTNESS_LOW;
+		break;
 	}
-	return EC_SUCCESS;
+	kblight_set(bl_brightness);
 }
 
-
-int hotkey_special_key(uint16_t *key_code, int8_t pressed)
+static void kb_run_action(uint16_t action, int8_t pressed)
 {
-	const uint16_t prss_key = *key_code;
-
-	switch (prss_key) {
-	case SCANCODE_DELETE:  /* TODO: INSERT */
-		if (fn_table_set(pressed, KB_FN_DELETE))
-			*key_code = 0xe070;
-		break;
-	case SCANCODE_K:  /* TODO: SCROLL_LOCK */
-		if (fn_table_set(pressed, KB_FN_K))
-			*key_code = SCANCODE_SCROLL_LOCK;
-		break;
-	case SCANCODE_S:  /* TODO: SYSRQ */
-		/*if (!fn_table_set(pressed, KB_FN_S))*/
-
-		break;
-	case SCANCODE_LEFT:  /* HOME */
-		if (fn_table_set(pressed, KB_FN_LEFT))
-			*key_code = 0xe06c;
+	switch (action) {
+	case KB_ACT_FN:
+		if (pressed)
+			Fn_key |= FN_PRESSED;
+		else
+			Fn_key &= ~FN_PRESSED;
 		break;
-	case SCANCODE_RIGHT:  /* END */
-		if (fn_table_set(pressed, KB_FN_RIGHT))
-			*key_code = 0xe069;
+	case KB_ACT_FN_LOCK:
+		if (pressed)
+			Fn_key ^= FN_LOCKED;
 		break;
-	case SCANCODE_UP:  /* PAGE_UP */
-		if (fn_table_set(pressed, KB_FN_UP))
-			*key_code = 0xe07d;
+	case KB_ACT_BRIGHTNESS_DN:
+		update_hid_key(HID_KEY_DISPLAY_BRIGHTNESS_DN, pressed);
 		break;
-	case SCANCODE_DOWN:  /* PAGE_DOWN */
-		if (fn_table_set(pressed, KB_FN_DOWN))
-			*key_code = 0xe07a;
+	case KB_ACT_BRIGHTNESS_UP:
+		update_hid_key(HID_KEY_DISPLAY_BRIGHTNESS_UP, pressed);
 		break;
-	default:
-		return EC_SUCCESS;
-	}
-
-	return EC_SUCCESS;
-}
-
-int functional_hotkey(uint16_t *key_code, int8_t pressed)
-{
-	const uint16_t prss_key = *key_code;
-	uint8_t bl_brightness = 0;
-
-	switch (prss_key) {
-	case SCANCODE_ESC: /* TODO: FUNCTION_LOCK */
-		if (fn_table_set(pressed, KB_FN_ESC)) {
-			if (pressed) {
-				if (Fn_key & FN_LOCKED)
-					Fn_key &= ~FN_LOCKED;
-				else
-					Fn_key |= FN_LOCKED;
-			}
-			return EC_ERROR_UNIMPLEMENTED;
+	case KB_ACT_PROJECT:
+		if (pressed) {
+			simulate_keyboard(SCANCODE_LEFT_WIN, 1);
+			simulate_keyboard(SCANCODE_P, 1);
+		} else {
+			simulate_keyboard(SCANCODE_P, 0);
+			simulate_keyboard(SCANCODE_LEFT_WIN, 0);
 		}
 		break;
-	case SCANCODE_B:
-		/* BREAK_KEY */
-		if (fn_table_set(pressed, KB_FN_B)) {
-			if (pressed) {
-				simulate_keyboard(0xe07e, 1);
-				simulate_keyboard(0xe0, 1);
-				simulate_keyboard(0x7e, 0);
-			}
-			return EC_ERROR_UNIMPLEMENTED;
-		}
+	case KB_ACT_AIRPLANE:
+		update_hid_key(HID_KEY_AIRPLANE_MODE, pressed);
 		break;
-	case SCANCODE_P:
-		/* PAUSE_KEY */
-		if (fn_table_set(pressed, KB_FN_P)) {
-			if (pressed) {
-				simulate_keyboard(0xe114, 1);
-				simulate_keyboard(0x77, 1);
-				simulate_keyboard(0xe1, 1);
-				simulate_keyboard(0x14, 0);
-				simulate_keyboard(0x77, 0);
-			}
-			return EC_ERROR_UNIMPLEMENTED;
+	case KB_ACT_BREAK:
+		if (pressed) {
+			simulate_keyboard(0xe07e, 1);
+			simulate_keyboard(0xe0, 1);
+			simulate_keyboard(0x7e, 0);
 		}
 		break;
-	case SCANCODE_SPACE:	/* TODO: TOGGLE_KEYBOARD_BACKLIGHT */
-		if (fn_table_set(pressed, KB_FN_SPACE)) {
-			if (pressed) {
-				bl_brightness = kblight_get();
-				switch (bl_brightness) {
-				case KEYBOARD_BL_BRIGHTNESS_LOW:
-					bl_brightness = KEYBOARD_BL_BRIGHTNESS_MED;
-					break;
-				case KEYBOARD_BL_BRIGHTNESS_MED:
-					bl_brightness = KEYBOARD_BL_BRIGHTNESS_HIGH;
-					break;
-				case KEYBOARD_BL_BRIGHTNESS_HIGH:
-					hx20_kblight_enable(0);
-					bl_brightness = KEYBOARD_BL_BRIGHTNESS_OFF;
-					break;
-				default:
-				case KEYBOARD_BL_BRIGHTNESS_OFF:
-					hx20_kblight_enable(1);
-					bl_brightness = KEYBOARD_BL_BRIGHTNESS_LOW;
-					break;
-				}
-				kblight_set(bl_brightness);
-			}
-			/* we dont want to pass the space key event to the OS */
-			return EC_ERROR_UNIMPLEMENTED;
+	case KB_ACT_PAUSE:
+		if (pressed) {
+			simulate_keyboard(0xe114, 1);
+			simulate_keyboard(0x77, 1);
+			simulate_keyboard(0xe1, 1);
+			simulate_keyboard(0x14, 0);
+			simulate_keyboard(0x77, 0);
 		}
 		break;
+	case KB_ACT_BACKLIGHT:
+		if (pressed)
+			kblight_step();
+		break;
 	}
-	return EC_SUCCESS;
 }
 
 enum ec_error_list keyboard_scancode_callback(uint16_t *make_code,
 					      int8_t pressed)
 {
-	const uint16_t pressed_key = *make_code;
-	int r = 0;
-
-	if (factory_status())
+	if (!KB_IS_ACTION(*make_code))
 		return EC_SUCCESS;
 
-	if (pressed_key == SCANCODE_FN && pressed) {
-		Fn_key |= FN_PRESSED;
-		return EC_ERROR_UNIMPLEMENTED;
-	} else if (pressed_key == SCANCODE_FN && !pressed) {
-		Fn_key &= ~FN_PRESSED;
-		return EC_ERROR_UNIMPLEMENTED;
-	}
-
-	/*
-	 * If the system still in preOS
-	 * then we pass through all events without modifying them
-	 */
-	if (!pos_get_state())
-		return EC_SUCCESS;
-
-	r = hotkey_F1_F12(make_code, Fn_key, pressed);
-	if (r != EC_SUCCESS)
-		return r;
-	/*
-	 * If the function key is not held then
-	 * we pass through all events without modifying them
-	 * but if last time have press FN still need keep that
-	 */
-	if (!(Fn_key & FN_PRESSED) && !fn_key_table)
-		return EC_SUCCESS;
-
-	r = hotkey_special_key(make_code, pressed);
-	if (r != EC_SUCCESS)
-		return r;
-
-	r = functional_hotkey(make_code, pressed);
-	if (r != EC_SUCCESS)
-		return r;
-
-	return EC_SUCCESS;
+	/* Actions are handled here and not sent to the host */
+	kb_run_action(*make_code, pressed);
+	return EC_ERROR_UNIMPLEMENTED;
 }
 #endif
 
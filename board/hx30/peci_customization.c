@@ -51,7 +51,14 @@ int peci_Rd_Pkg_Config(uint8_t index, uint16_t parameter, int rlen, uint8_t *in)
 	return EC_SUCCESS;
 }
 
-int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wlen)
+/* Transactions go over eSPI OOB once PECI over GPIO failed ten times */
+static int peci_use_oob(void)
+{
+	return peci_select_count >= 10 && !peci_select_flags;
+}
+
+static int peci_wr_pkg_config_cb(uint8_t index, uint16_t parameter,
+	uint32_t data, int wlen, void (*done)(const struct peci_oob_txn *txn))
 {
 	int rv;
 	int clen;
@@ -77,7 +84,7 @@ int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wle
 		out[clen] = ((data >> ((clen - 4) * 8)) & 0xFF);
 
 
-	if (peci_select_count < 10 || peci_select_flags) {
+	if (!peci_use_oob()) {
 		rv = peci_transaction(&peci);
 
 		if (rv != 0)
@@ -88,7 +95,15 @@ int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wle
 			peci_select_flags = 1;
 		}
 	} else {
-		rv = espi_oob_peci_transaction(&peci);
+		struct peci_oob_txn txn = {
+			.cmd_code = PECI_CMD_WR_PKG_CFG,
+			.w_len = wlen,
+			.r_len = PECI_WR_PKG_CONFIG_READ_LENGTH,
+			.done = done,
+		};
+
+		memcpy(txn.w_buf, out, sizeof(out));
+		rv = peci_oob_submit(&txn);
 	}
 
 	if (rv)
@@ -97,6 +112,29 @@ int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wle
 	return EC_SUCCESS;
 }
 
+int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wlen)
+{
+	return peci_wr_pkg_config_cb(index, parameter, data, wlen, NULL);
+}
+
+/* Convert the GetTemp response to K */
+static int peci_temp_from_raw(const uint8_t *r_buf, int *cpu_temp)
+{
+	/* Get relative raw data of temperature. */
+	*cpu_temp = (r_buf[1] << 8) | r_buf[0];
+
+	/* Convert relative raw data to degrees C. */
+	*cpu_temp = ((*cpu_temp ^ 0xFFFF) + 1) >> 6;
+
+	if (*cpu_temp >= CONFIG_PECI_TJMAX)
+		return EC_ERROR_INVAL;
+
+	/* temperature in K */
+	*cpu_temp = CONFIG_PECI_TJMAX - *cpu_temp + 273;
+
+	return EC_SUCCESS;
+}
+
 static int peci_over_espi_get_cpu_temp(int *cpu_temp)
 {
 	int rv;
@@ -112,41 +150,52 @@ static int peci_over_espi_get_cpu_temp(int *cpu_temp)
 		.timeout_us = PECI_GET_TEMP_TIMEOUT_US,
 	};
 
-	if (peci_select_count < 10 || peci_select_flags) {
-		rv = peci_transaction(&peci);
-
-		if (rv != 0)
-			peci_select_count++;
-		else if (!peci_select_flags && peci_select_count > 3) {
-			CPRINTS("FORCE GPIO PECI!");
-			peci_select_count = 0;
-			peci_select_flags = 1;
-		}
-	} else {
-		rv = espi_oob_peci_transaction(&peci);
+	rv = peci_transaction(&peci);
 
-		if (rv == EC_ERROR_TIMEOUT) {
-			CPRINTS("ESPI GET VALUE TIMEOUT!");
-			espi_oob_retry_receive_date(r_buf);
-		}
+	if (rv != 0)
+		peci_select_count++;
+	else if (!peci_select_flags && peci_select_count > 3) {
+		CPRINTS("FORCE GPIO PECI!");
+		peci_select_count = 0;
+		peci_select_flags = 1;
 	}
 
 	if (rv)
 		return rv;
 
-	/* Get relative raw data of temperature. */
-	*cpu_temp = (r_buf[1] << 8) | r_buf[0];
+	return peci_temp_from_raw(r_buf, cpu_temp);
+}
 
-	/* Convert relative raw data to degrees C. */
-	*cpu_temp = ((*cpu_temp ^ 0xFFFF) + 1) >> 6;
+static int peci_temp_pending;
 
-	if (*cpu_temp >= CONFIG_PECI_TJMAX)
-		return EC_ERROR_INVAL;
+static void peci_oob_temp_done(const struct peci_oob_txn *txn)
+{
+	int temp;
 
-	/* temperature in K */
-	*cpu_temp = CONFIG_PECI_TJMAX - *cpu_temp + 273;
+	if (txn->rv || peci_temp_from_raw(txn->r_buf, &temp))
+		peci_temp = 0xffff;
+	else
+		peci_temp = temp;
+	peci_temp_pending = 0;
+}
 
-	return EC_SUCCESS;
+/* Queue a GetTemp over eSPI OOB, peci_oob_temp_done() gets the result */
+static void peci_oob_get_cpu_temp(void)
+{
+	const struct peci_oob_txn txn = {
+		.cmd_code = PECI_CMD_GET_TEMP,
+		.w_len = PECI_GET_TEMP_WRITE_LENGTH,
+		.r_len = PECI_GET_TEMP_READ_LENGTH,
+		.done = peci_oob_temp_done,
+	};
+
+	if (peci_temp_pending)
+		return;
+
+	if (peci_oob_submit(&txn))
+		peci_temp = 0xffff;
+	else
+		peci_temp_pending = 1;
 }
 
 int check_system_power(void)
@@ -163,83 +212,106 @@ int check_system_power(void)
 /*****************************************************************************/
 /* External functions */
 
-int peci_update_PL1(int watt)
+enum peci_pl {
+	PECI_PL1,
+	PECI_PL2,
+	PECI_PL4,
+	PECI_PSYS_PL2,
+	PECI_PL_COUNT
+};
+
+static const uint8_t peci_pl_index[PECI_PL_COUNT] = {
+	[PECI_PL1] = PECI_INDEX_POWER_LIMITS_PL1,
+	[PECI_PL2] = PECI_INDEX_POWER_LIMITS_PL2,
+	[PECI_PL4] = PECI_INDEX_POWER_LIMITS_PL4,
+	[PECI_PSYS_PL2] = PECI_INDEX_POWER_LIMITS_PSYS_PL2,
+};
+
+/* Last value written to each power limit, valid if its bit is set */
+static uint32_t peci_pl_cache[PECI_PL_COUNT];
+static uint8_t peci_pl_cache_valid;
+static int peci_pl_skipped;
+
+static void peci_pl_write_done(const struct peci_oob_txn *txn)
 {
-	int rv;
-	uint32_t data;
+	int pl;
 
-	if (!chipset_in_state(CHIPSET_STATE_ON) || check_system_power())
-		return EC_ERROR_NOT_POWERED;
-
-	data = PECI_PL1_CONTROL_TIME_WINDOWS | PECI_PL1_POWER_LIMIT_ENABLE |
-		PECI_PL1_POWER_LIMIT(watt);
-
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PL1, PECI_PARAMS_POWER_LIMITS_PL1,
-		data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
-
-	if (rv)
-		return rv;
+	if (!txn->rv)
+		return;
 
-	return EC_SUCCESS;
+	/* Write it again next time */
+	for (pl = 0; pl < PECI_PL_COUNT; pl++)
+		if (peci_pl_index[pl] == txn->w_buf[1])
+			peci_pl_cache_valid &= ~BIT(pl);
 }
 
-int peci_update_PL2(int watt)
+static int peci_update_power_limit(enum peci_pl pl, uint16_t parameter,
+				   uint32_t data)
 {
 	int rv;
-	uint32_t data;
 
 	if (!chipset_in_state(CHIPSET_STATE_ON) || check_system_power())
 		return EC_ERROR_NOT_POWERED;
 
-	data = PECI_PL2_CONTROL_TIME_WINDOWS | PECI_PL2_POWER_LIMIT_ENABLE |
-		PECI_PL2_POWER_LIMIT(watt);
-
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PL2, PECI_PARAMS_POWER_LIMITS_PL2,
-		data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
+	if ((peci_pl_cache_valid & BIT(pl)) && peci_pl_cache[pl] == data) {
+		peci_pl_skipped++;
+		return EC_SUCCESS;
+	}
 
+	peci_pl_cache[pl] = data;
+	peci_pl_cache_valid |= BIT(pl);
+	rv = peci_wr_pkg_config_cb(peci_pl_index[pl], parameter, data,
+		PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD, peci_pl_write_done);
 	if (rv)
-		return rv;
+		peci_pl_cache_valid &= ~BIT(pl);
 
-	return EC_SUCCESS;
+	return rv;
 }
 
-int peci_update_PL4(int watt)
+/*
+ * Write every limit next time, even if it did not change.  The CPU starts over
+ * with its default limits after a reset, and the BIOS or OS may change them.
+ */
+void peci_pl_cache_reset(void)
 {
-	int rv;
-	uint32_t data;
-
-	if (!chipset_in_state(CHIPSET_STATE_ON) || check_system_power())
-		return EC_ERROR_NOT_POWERED;
+	peci_pl_cache_valid = 0;
+}
+DECLARE_HOOK(HOOK_CHIPSET_RESUME, peci_pl_cache_reset, HOOK_PRIO_FIRST);
+DECLARE_HOOK(HOOK_CHIPSET_RESET, peci_pl_cache_reset, HOOK_PRIO_FIRST);
+DECLARE_HOOK(HOOK_CHIPSET_SHUTDOWN, peci_pl_cache_reset, HOOK_PRIO_DEFAULT);
 
-	data = PECI_PL4_POWER_LIMIT(watt);
+int peci_pl_cache_hits(void)
+{
+	return peci_pl_skipped;
+}
 
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PL4, PECI_PARAMS_POWER_LIMITS_PL4,
-		data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
+int peci_update_PL1(int watt)
+{
+	return peci_update_power_limit(PECI_PL1, PECI_PARAMS_POWER_LIMITS_PL1,
+		PECI_PL1_CONTROL_TIME_WINDOWS | PECI_PL1_POWER_LIMIT_ENABLE |
+		PECI_PL1_POWER_LIMIT(watt));
+}
 
-	if (rv)
-		return rv;
+int peci_update_PL2(int watt)
+{
+	return peci_update_power_limit(PECI_PL2, PECI_PARAMS_POWER_LIMITS_PL2,
+		PECI_PL2_CONTROL_TIME_WINDOWS | PECI_PL2_POWER_LIMIT_ENABLE |
+		PECI_PL2_POWER_LIMIT(watt));
+}
 
-	return EC_SUCCESS;
+int peci_update_PL4(int watt)
+{
+	return peci_update_power_limit(PECI_PL4, PECI_PARAMS_POWER_LIMITS_PL4,
+		PECI_PL4_POWER_LIMIT(watt));
 }
 
 int peci_update_PsysPL2(int watt)
 {
-	int rv;
-	uint32_t data;
-
-	if (!chipset_in_state(CHIPSET_STATE_ON) || check_system_power())
-		return EC_ERROR_NOT_POWERED;
-
-	data = PECI_PSYS_PL2_CONTROL_TIME_WINDOWS | PECI_PSYS_PL2_POWER_LIMIT_ENABLE |
-		PECI_PSYS_PL2_POWER_LIMIT(watt);
-
-	rv = peci_Wr_Pkg_Config(PECI_INDEX_POWER_LIMITS_PSYS_PL2,
-		PECI_PARAMS_POWER_LIMITS_PSYS_PL2, data, PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD);
-
-	if (rv)
-		return rv;
-
-	return EC_SUCCESS;
+	return peci_update_power_limit(PECI_PSYS_PL2,
+		PECI_PARAMS_POWER_LIMITS_PSYS_PL2,
+		PECI_PSYS_PL2_CONTROL_TIME_WINDOWS |
+		PECI_PSYS_PL2_POWER_LIMIT_ENABLE |
+		PECI_PSYS_PL2_POWER_LIMIT(watt));
 }
 
 __override int stop_read_peci_temp(void)
@@ -297,6 +369,8 @@ void read_peci_over_espi_gettemp(void)
 
 	if (rv != EC_SUCCESS) {
 		peci_temp = 0xfffe;
+	} else if (peci_use_oob()) {
+		peci_oob_get_cpu_temp();
 	} else {
 		for (i = 0; i < 2; i++) {
 			rv = peci_over_espi_get_cpu_temp(&peci_temp);
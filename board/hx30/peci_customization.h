@@ -52,9 +52,38 @@
 
 
 int peci_Rd_Pkg_Config(uint8_t index, uint16_t parameter, int rlen, uint8_t *in);
+/* Over eSPI OOB, this only queues the write and returns */
 int peci_Wr_Pkg_Config(uint8_t index, uint16_t parameter, uint32_t data, int wlen);
 int espi_oob_retry_receive_date(uint8_t *readBuf);
-int espi_oob_peci_transaction(struct peci_data *peci);
+
+/* PECI transaction queued on the eSPI OOB channel */
+struct peci_oob_txn {
+	uint8_t cmd_code;
+	uint8_t w_len;
+	uint8_t r_len;
+	uint8_t retries;	/* Times the command was sent again */
+	uint8_t w_buf[PECI_WR_PKG_CONFIG_WRITE_LENGTH_DWORD];
+	uint8_t r_buf[PECI_RD_PKG_CONFIG_READ_LENGTH_DWORD];
+	int rv;			/* EC_SUCCESS or EC_ERROR_TIMEOUT once done */
+	uint32_t latency_us;	/* From the first send to the response */
+	/* Called from the hook task when the transaction is done */
+	void (*done)(const struct peci_oob_txn *txn);
+};
+
+/**
+ * Queue a PECI transaction on the eSPI OOB channel, and return right away.
+ * Queued transactions go out back to back, each one as soon as the previous
+ * response arrived.
+ *
+ * @param txn		Transaction to copy into the queue
+ * @return EC_SUCCESS, or EC_ERROR_BUSY if the queue is full.
+ */
+int peci_oob_submit(const struct peci_oob_txn *txn);
+
+/* Number of power limit writes skipped because the CPU already had the value */
+int peci_pl_cache_hits(void);
+/* Write each power limit on its next update, even if it did not change */
+void peci_pl_cache_reset(void);
 
 int peci_update_PL1(int watt);
 int peci_update_PL2(int watt);
@@ -5,8 +5,11 @@
 
 #include "console.h"
 #include "espi.h"
+#include "hooks.h"
 #include "peci.h"
 #include "peci_customization.h"
+#include "task.h"
+#include "timer.h"
 #include "util.h"
 
 #define CPRINTS(format, args...) cprints(CC_LPC, format, ## args)
@@ -15,12 +18,44 @@
 #define ESPI_OOB_SMB_SLAVE_DEST_ADDR_PMC_FW 0x20
 #define ESPI_OOB_PECI_CMD 0x01
 
+/* Asynchronous transactions */
+#define PECI_OOB_QUEUE_SIZE	8
+#define PECI_OOB_HISTORY	8
+#define PECI_OOB_RETRIES	2
+/* Time the PMC has to answer, same as the blocking transaction */
+#define PECI_OOB_TIMEOUT_US	(5 * MSEC)
+/* Poll in case the OOB RX interrupt does not come */
+#define PECI_OOB_POLL_US	MSEC
 
-int espi_oob_peci_transaction(struct peci_data *peci)
+BUILD_ASSERT(POWER_OF_TWO(PECI_OOB_QUEUE_SIZE));
+BUILD_ASSERT(POWER_OF_TWO(PECI_OOB_HISTORY));
+
+/*
+ * "oob_head" is the transaction on the bus or next to go, "oob_tail" where
+ * the next one is submitted. Both only ever increase.
+ */
+static struct peci_oob_txn oob_queue[PECI_OOB_QUEUE_SIZE];
+static uint32_t oob_head;
+static uint32_t oob_tail;
+static int oob_busy;
+static timestamp_t oob_deadline;
+static struct mutex oob_lock;
+
+/* Completed transactions, newest last */
+static struct peci_oob_txn oob_history[PECI_OOB_HISTORY];
+static uint32_t oob_history_count;
+
+static struct {
+	uint32_t completed;
+	uint32_t failed;
+	uint32_t retries;
+	uint32_t overflows;
+	uint32_t latency_max_us;
+} oob_stats;
+
+static int espi_oob_peci_msg(const struct peci_data *peci, uint8_t *espiOobMsg)
 {
-	uint8_t espiOobMsg[16];
 	uint8_t aw_FCS_calc;
-	uint8_t OobWrLen = peci->w_len + 4;
 
 	espiOobMsg[0] = peci->addr;
 	espiOobMsg[1] = peci->w_len + 1;
@@ -41,8 +76,143 @@ int espi_oob_peci_transaction(struct peci_data *peci)
 		espiOobMsg[12] = aw_FCS_calc;
 	}
 
+	return peci->w_len + 4;
+}
 
-	return espi_oob_build_peci_command(ESPI_OOB_SMB_SLAVE_SRC_ADDR_EC,
+static void peci_oob_start(struct peci_oob_txn *txn)
+{
+	uint8_t espiOobMsg[16];
+	struct peci_data peci = {
+		.cmd_code = txn->cmd_code,
+		.addr = PECI_TARGET_ADDRESS,
+		.w_len = txn->w_len,
+		.r_len = txn->r_len,
+		.w_buf = txn->w_buf,
+	};
+	uint8_t OobWrLen = espi_oob_peci_msg(&peci, espiOobMsg);
+
+	espi_oob_peci_send(ESPI_OOB_SMB_SLAVE_SRC_ADDR_EC,
 		ESPI_OOB_SMB_SLAVE_DEST_ADDR_PMC_FW, ESPI_OOB_PECI_CMD,
-		OobWrLen, espiOobMsg, peci->r_buf);
+		OobWrLen, espiOobMsg);
+	oob_deadline.val = get_time().val + PECI_OOB_TIMEOUT_US;
+	oob_busy = 1;
+}
+
+static void peci_oob_run(void);
+DECLARE_DEFERRED(peci_oob_run);
+
+/*
+ * Move the queue along: start the next transaction, or complete the one on
+ * the bus. Runs in the hook task, woken up by the OOB RX interrupt.
+ */
+static void peci_oob_run(void)
+{
+	struct peci_oob_txn *txn;
+	struct peci_oob_txn done;
+	int rv;
+
+	mutex_lock(&oob_lock);
+	while (oob_head != oob_tail) {
+		txn = &oob_queue[oob_head & (PECI_OOB_QUEUE_SIZE - 1)];
+
+		if (!oob_busy) {
+			/* Holds the start time until the transaction is done */
+			if (!txn->retries)
+				txn->latency_us = get_time().le.lo;
+			peci_oob_start(txn);
+		}
+
+		rv = espi_oob_peci_receive(txn->r_buf, sizeof(txn->r_buf));
+		if (rv == EC_ERROR_BUSY) {
+			if (!timestamp_expired(oob_deadline, NULL)) {
+				hook_call_deferred(&peci_oob_run_data,
+						   PECI_OOB_POLL_US);
+				break;
+			}
+
+			/* No answer, send it again */
+			oob_busy = 0;
+			if (txn->retries < PECI_OOB_RETRIES) {
+				txn->retries++;
+				oob_stats.retries++;
+				continue;
+			}
+			rv = EC_ERROR_TIMEOUT;
+		}
+
+		oob_busy = 0;
+		txn->rv = rv;
+		txn->latency_us = get_time().le.lo - txn->latency_us;
+		oob_stats.latency_max_us = MAX(oob_stats.latency_max_us,
+					       txn->latency_us);
+		if (rv)
+			oob_stats.failed++;
+		else
+			oob_stats.completed++;
+		oob_history[oob_history_count++ & (PECI_OOB_HISTORY - 1)] =
+			*txn;
+		done = *txn;
+		oob_head++;
+
+		/* The callback may queue more transactions */
+		if (done.done) {
+			mutex_unlock(&oob_lock);
+			done.done(&done);
+			mutex_lock(&oob_lock);
+		}
+	}
+	mutex_unlock(&oob_lock);
+}
+
+__override void espi_oob_rx_notify(void)
+{
+	if (oob_busy)
+		hook_call_deferred(&peci_oob_run_data, 0);
+}
+
+int peci_oob_submit(const struct peci_oob_txn *txn)
+{
+	struct peci_oob_txn *t;
+
+	mutex_lock(&oob_lock);
+	if (oob_tail - oob_head >= PECI_OOB_QUEUE_SIZE) {
+		oob_stats.overflows++;
+		mutex_unlock(&oob_lock);
+		return EC_ERROR_BUSY;
+	}
+
+	t = &oob_queue[oob_tail & (PECI_OOB_QUEUE_SIZE - 1)];
+	*t = *txn;
+	t->retries = 0;
+	t->rv = EC_ERROR_BUSY;
+	oob_tail++;
+	mutex_unlock(&oob_lock);
+
+	hook_call_deferred(&peci_oob_run_data, 0);
+
+	return EC_SUCCESS;
+}
+
+static int command_peciq(int argc, char **argv)
+{
+	int i;
+
+	ccprintf("queued %d, completed %d, failed %d, retries %d, full %d\n",
+		 oob_tail - oob_head, oob_stats.completed, oob_stats.failed,
+		 oob_stats.retries, oob_stats.overflows);
+	ccprintf("max latency %d us\n", oob_stats.latency_max_us);
+
+	ccprintf("CMD INDEX   RV RETRIES LATENCY\n");
+	for (i = MIN(oob_history_count, PECI_OOB_HISTORY); i > 0; i--) {
+		const struct peci_oob_txn *t = &oob_history[
+			(oob_history_count - i) & (PECI_OOB_HISTORY - 1)];
+
+		ccprintf("%02x  %02x    %4d %7d %7d\n", t->cmd_code,
+			 t->w_len > 1 ? t->w_buf[1] : 0, t->rv, t->retries,
+			 t->latency_us);
+	}
+
+	return EC_SUCCESS;
 }
+DECLARE_CONSOLE_COMMAND(peciq, command_peciq, NULL,
+			"Show the PECI over eSPI OOB transaction queue");
@@ -12,6 +12,11 @@ test_mockable int lpc_keyboard_has_char(void)
 	return 0;
 }
 
+test_mockable int lpc_aux_has_char(void)
+{
+	return 0;
+}
+
 test_mockable int lpc_keyboard_input_pending(void)
 {
 	return 0;
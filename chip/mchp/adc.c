@@ -31,6 +31,12 @@ struct mutex adc_lock;
  */
 static task_id_t task_waiting;
 
+#ifdef CONFIG_ADC_SCAN
+/* Results of the last scan, and the task reading them */
+static int scan_data[ADC_CH_COUNT];
+static task_id_t scan_task = TASK_ID_INVALID;
+#endif
+
 /*
  * Start ADC single-shot conversion.
  * 1. Disable ADC interrupt.
@@ -72,6 +78,11 @@ int adc_read_channel(enum adc_channel ch)
 	const struct adc_t *adc = adc_channels + ch;
 	int value;
 
+#ifdef CONFIG_ADC_SCAN
+	if (scan_task == task_get_current())
+		return scan_data[ch];
+#endif
+
 	mutex_lock(&adc_lock);
 
 	MCHP_ADC_SINGLE = 1 << adc->channel;
@@ -115,6 +126,22 @@ exit_all_channels:
 	return ret;
 }
 
+#ifdef CONFIG_ADC_SCAN
+int adc_scan_begin(void)
+{
+	int rv = adc_read_all_channels(scan_data);
+
+	if (rv == EC_SUCCESS)
+		scan_task = task_get_current();
+	return rv;
+}
+
+void adc_scan_end(void)
+{
+	scan_task = TASK_ID_INVALID;
+}
+#endif
+
 /*
  * Enable GPIO pins.
  * Using MEC17xx direct mode interrupts. Do not
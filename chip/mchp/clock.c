@@ -10,6 +10,7 @@
 #include "console.h"
 #include "cpu.h"
 #include "hooks.h"
+#include "host_command.h"
 #include "hwtimer.h"
 #include "pwm.h"
 #include "pwm_chip.h"
@@ -55,6 +56,172 @@ static uint32_t ecia_result[MCHP_INT_GIRQ_NUM];
 #define CONSOLE_IN_USE_ON_BOOT_TIME (15*SECOND)
 static int console_in_use_timeout_sec = 60;
 static timestamp_t console_expire_time;
+
+#ifdef CONFIG_WAKE_STATS
+#define WAKE_SOURCES_MAX	32
+
+/* Wake sources, in the order they were first seen */
+static struct ec_wake_source wake_sources[WAKE_SOURCES_MAX];
+static int wake_source_count;
+static uint32_t wake_other;
+static uint32_t wake_veto[EC_WAKE_VETO_COUNT];
+static uint16_t wake_veto_mask[16];
+static uint32_t wake_hist[EC_WAKE_HIST_BUCKETS];
+
+/* The wake being accounted, and when it happened */
+static struct ec_wake_source wake_cur;
+static uint32_t wake_time;
+/* First GPIO interrupt handled since the wake */
+static int wake_gpio = -1;
+
+void clock_wake_gpio(int signal)
+{
+	if (wake_gpio < 0)
+		wake_gpio = signal;
+}
+
+static void wake_stats_veto(enum ec_wake_veto veto)
+{
+	int bit;
+
+	wake_veto[veto]++;
+	if (veto != EC_WAKE_VETO_SLEEP_MASK)
+		return;
+
+	for (bit = 0; bit < ARRAY_SIZE(wake_veto_mask); bit++)
+		if ((sleep_mask & BIT(bit)) && wake_veto_mask[bit] < UINT16_MAX)
+			wake_veto_mask[bit]++;
+}
+
+/* Lowest enabled IRQ waiting to run, or -1 */
+static int wake_pending_irq(void)
+{
+	uint32_t pend;
+	int i;
+
+	for (i = 0; i < DIV_ROUND_UP(CONFIG_IRQ_COUNT, 32); i++) {
+		pend = CPU_NVIC_PEND(i) & CPU_NVIC_EN(i);
+		if (pend)
+			return i * 32 + __builtin_ctz(pend);
+	}
+
+	return -1;
+}
+
+/*
+ * Called with interrupts still disabled after WFI: note what woke the EC,
+ * before the interrupt handlers run.
+ */
+static void wake_stats_wake(uint32_t slept_us)
+{
+	const struct deferred_data *deferred;
+	timestamp_t deadline;
+	uint64_t until;
+	task_id_t task;
+	int irq = wake_pending_irq();
+	int bucket;
+
+	for (bucket = 0, slept_us >>= 6;
+	     slept_us && bucket < EC_WAKE_HIST_BUCKETS - 1; bucket++)
+		slept_us >>= 2;
+	wake_hist[bucket]++;
+
+	memset(&wake_cur, 0, sizeof(wake_cur));
+	if (irq < 0)
+		return;
+
+	wake_cur.type = EC_WAKE_SRC_IRQ;
+	wake_cur.id = irq;
+
+	switch (irq) {
+	case MCHP_IRQ_TIMER32_0:
+	case MCHP_IRQ_TIMER32_1:
+	case MCHP_IRQ_HTIMER0:
+		/* Charge the task the timer was running for */
+		task = timer_next_task(&deadline);
+		if (task == TASK_ID_INVALID)
+			break;
+		deferred = hook_next_deferred(&until);
+		if (task == TASK_ID_HOOKS && deferred &&
+		    until <= deadline.val) {
+			wake_cur.type = EC_WAKE_SRC_DEFERRED;
+			wake_cur.id = 0;
+			wake_cur.addr = (uint32_t)deferred->routine;
+		} else {
+			wake_cur.type = EC_WAKE_SRC_TIMER;
+			wake_cur.id = task;
+		}
+		break;
+	case MCHP_IRQ_GIRQ8:
+	case MCHP_IRQ_GIRQ9:
+	case MCHP_IRQ_GIRQ10:
+	case MCHP_IRQ_GIRQ11:
+	case MCHP_IRQ_GIRQ12:
+	case MCHP_IRQ_GIRQ26:
+		/* The signal is known once the GPIO interrupt has run */
+		wake_cur.type = EC_WAKE_SRC_GPIO;
+		wake_gpio = -1;
+		break;
+	}
+
+	wake_time = get_time().le.lo;
+}
+
+/* Back in idle: charge the time since the wake to its source */
+static void wake_stats_account(uint32_t now)
+{
+	struct ec_wake_source *src;
+	uint32_t awake_us = now - wake_time;
+	int i;
+
+	if (wake_cur.type == EC_WAKE_SRC_NONE)
+		return;
+
+	if (wake_cur.type == EC_WAKE_SRC_GPIO) {
+		if (wake_gpio >= 0)
+			wake_cur.id = wake_gpio;
+		else
+			wake_cur.type = EC_WAKE_SRC_IRQ;
+	}
+
+	for (i = 0; i < wake_source_count; i++) {
+		src = &wake_sources[i];
+		if (src->type == wake_cur.type && src->id == wake_cur.id &&
+		    src->addr == wake_cur.addr)
+			break;
+	}
+	if (i == wake_source_count) {
+		if (i == WAKE_SOURCES_MAX) {
+			wake_other++;
+			wake_cur.type = EC_WAKE_SRC_NONE;
+			return;
+		}
+		wake_sources[wake_source_count++] = wake_cur;
+	}
+
+	src = &wake_sources[i];
+	src->count++;
+	src->awake_us = awake_us > UINT32_MAX - src->awake_us ?
+			UINT32_MAX : src->awake_us + awake_us;
+	wake_cur.type = EC_WAKE_SRC_NONE;
+}
+
+static void wake_stats_clear(void)
+{
+	wake_source_count = 0;
+	wake_other = 0;
+	memset(wake_veto, 0, sizeof(wake_veto));
+	memset(wake_veto_mask, 0, sizeof(wake_veto_mask));
+	memset(wake_hist, 0, sizeof(wake_hist));
+	idle_sleep_cnt = 0;
+	idle_dsleep_cnt = 0;
+	total_idle_dsleep_time_us = 0;
+}
+#else
+static inline void wake_stats_veto(enum ec_wake_veto veto) {}
+static inline void wake_stats_wake(uint32_t slept_us) {}
+static inline void wake_stats_account(uint32_t now) {}
+#endif /* CONFIG_WAKE_STATS */
 #endif /*CONFIG_LOW_POWER_IDLE */
 
 static int freq = 48000000;
@@ -532,6 +699,7 @@ void __idle(void)
 		interrupt_disable();
 
 		t0 = get_time();  /* uSec */
+		wake_stats_account(t0.le.lo);
 
 		/* __hw_clock_event_get() is next programmed timer event */
 		next_delay = __hw_clock_event_get() - t0.le.lo;
@@ -615,6 +783,9 @@ void __idle(void)
 
 			} else {
 				idle_sleep_cnt++;
+				wake_stats_veto(LOW_SPEED_DEEP_SLEEP_ALLOWED ?
+						EC_WAKE_VETO_UART :
+						EC_WAKE_VETO_LOW_SPEED);
 			}
 
 			/* Wait for interrupt: goes into deep sleep. */
@@ -661,11 +832,15 @@ void __idle(void)
 		} else { /* CPU 'Sleep' mode */
 
 			idle_sleep_cnt++;
+			wake_stats_veto(DEEP_SLEEP_ALLOWED ?
+					EC_WAKE_VETO_TIME :
+					EC_WAKE_VETO_SLEEP_MASK);
 
 			asm("wfi");
 
 		}
 
+		wake_stats_wake(get_time().le.lo - t0.le.lo);
 		interrupt_enable();
 	} /* while(1) */
 }
@@ -676,14 +851,14 @@ void __idle(void)
  */
 
 #ifdef CONFIG_MCHP_DEEP_SLP_DEBUG
-static void print_pcr_regs(void)
+static void print_saved_pcr_regs(void)
 {
 	int i;
 
 	ccprintf("PCR regs before WFI\n");
 	for (i = 0; i < 5; i++) {
-		ccprintf("PCR SLP_EN[%d]  = 0x%08X\n", pcr_slp_en[i]);
-		ccprintf("PCR CLK_REQ[%d] = 0x%08X\n", pcr_clk_req[i]);
+		ccprintf("PCR SLP_EN[%d]  = 0x%08X\n", i, pcr_slp_en[i]);
+		ccprintf("PCR CLK_REQ[%d] = 0x%08X\n", i, pcr_clk_req[i]);
 	}
 }
 #endif
@@ -703,7 +878,7 @@ static int command_idle_stats(int argc, char **argv)
 			ts.val);
 
 #ifdef CONFIG_MCHP_DEEP_SLP_DEBUG
-	print_pcr_regs();	/* debug */
+	print_saved_pcr_regs();	/* debug */
 #endif
 	return EC_SUCCESS;
 }
@@ -712,6 +887,92 @@ DECLARE_CONSOLE_COMMAND(idlestats, command_idle_stats,
 			"Print last idle stats");
 #endif /* defined(CONFIG_CMD_IDLE_STATS) */
 
+#ifdef CONFIG_WAKE_STATS
+static const char * const wake_veto_names[EC_WAKE_VETO_COUNT] = {
+	[EC_WAKE_VETO_TIME] = "time",
+	[EC_WAKE_VETO_SLEEP_MASK] = "sleep mask",
+	[EC_WAKE_VETO_LOW_SPEED] = "low speed",
+	[EC_WAKE_VETO_UART] = "uart",
+};
+
+static int command_wake_stats(int argc, char **argv)
+{
+	const struct ec_wake_source *src;
+	int i;
+
+	ccprintf("Light sleep vetoes:\n");
+	for (i = 0; i < EC_WAKE_VETO_COUNT; i++)
+		ccprintf("  %-10s %d\n", wake_veto_names[i], wake_veto[i]);
+	for (i = 0; i < ARRAY_SIZE(wake_veto_mask); i++)
+		if (wake_veto_mask[i])
+			ccprintf("  mask bit %-2d %d\n", i, wake_veto_mask[i]);
+
+	ccprintf("Sleep lengths:\n");
+	for (i = 0; i < EC_WAKE_HIST_BUCKETS - 1; i++)
+		ccprintf("  < %8d us %d\n", 64 << (2 * i), wake_hist[i]);
+	ccprintf("  >= %7d us %d\n", 64 << (2 * i), wake_hist[i]);
+
+	ccprintf("Wakes:  COUNT  AWAKE_US SOURCE\n");
+	for (i = 0; i < wake_source_count; i++) {
+		src = &wake_sources[i];
+		ccprintf("     %8d %9d ", src->count, src->awake_us);
+		switch (src->type) {
+		case EC_WAKE_SRC_TIMER:
+			ccprintf("timer %s\n", task_get_name(src->id));
+			break;
+		case EC_WAKE_SRC_DEFERRED:
+			ccprintf("deferred %pP\n", (void *)src->addr);
+			break;
+		case EC_WAKE_SRC_GPIO:
+			ccprintf("gpio %s\n", gpio_get_name(src->id));
+			break;
+		default:
+			ccprintf("irq %d\n", src->id);
+		}
+		cflush();
+	}
+	ccprintf("     %8d           other\n", wake_other);
+
+	if (argc > 1 && !strcasecmp(argv[1], "clear"))
+		wake_stats_clear();
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(wakestats, command_wake_stats, "[clear]",
+			"Print what woke the EC from idle");
+
+static enum ec_status hc_wake_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_wake_stats *p = args->params;
+	struct ec_response_wake_stats *r = args->response;
+	/* Params and response share the same buffer */
+	int flags = p->flags;
+	int offset = p->source_offset;
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	r->sleep_count = idle_sleep_cnt;
+	r->dsleep_count = idle_dsleep_cnt;
+	r->dsleep_ms = total_idle_dsleep_time_us / MSEC;
+	memcpy(r->veto, wake_veto, sizeof(r->veto));
+	memcpy(r->veto_mask, wake_veto_mask, sizeof(r->veto_mask));
+	memcpy(r->hist, wake_hist, sizeof(r->hist));
+	r->other = wake_other;
+	r->source_count = wake_source_count;
+	for (i = 0; i < EC_WAKE_STATS_PAGE &&
+		    offset + i < wake_source_count; i++)
+		r->sources[i] = wake_sources[offset + i];
+
+	if (flags & EC_WAKE_STATS_CLEAR)
+		wake_stats_clear();
+
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_WAKE_STATS, hc_wake_stats, EC_VER_MASK(0));
+#endif /* CONFIG_WAKE_STATS */
+
 /**
  * Configure deep sleep clock settings.
  */
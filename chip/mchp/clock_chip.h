@@ -14,4 +14,10 @@ void htimer_init(void);
 void system_set_htimer_alarm(uint32_t seconds,
 		uint32_t microseconds);
 
+/**
+ * Note a GPIO interrupt, so a wake from idle can be charged to its signal.
+ * Called from the GPIO interrupt handler when CONFIG_WAKE_STATS is enabled.
+ */
+void clock_wake_gpio(int signal);
+
 #endif /* __CROS_EC_I2C_CLOCK_H */
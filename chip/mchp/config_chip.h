@@ -131,6 +131,9 @@
 #define CONFIG_SPI
 #define CONFIG_SWITCH
 
+/* 16-bit basic timer 1 drives the PC profiler */
+#define CONFIG_PC_PROFILER_HW_TIMER
+
 /*
  * Enable configuration after ESPI_RESET# de-asserts
  */
@@ -147,6 +150,12 @@
  */
 #undef CONFIG_MCHP_ESPI_EC_CMD
 
+/*
+ * Measure the latency from the Master-to-Slave VWire interrupt to the start
+ * of each VWire handler, and add the "vwlat" console command to report it.
+ */
+#undef CONFIG_MCHP_ESPI_VW_LATENCY
+
 /*
  * Enable CPRINT debug messages in LPC module
  */
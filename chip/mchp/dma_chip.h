@@ -32,6 +32,10 @@ void dma_xfr_prepare_tx(const struct dma_option *option, uint32_t count,
 
 void dma_clr_chan(enum dma_channel ch);
 
+void dma_go_chan(enum dma_channel ch);
+
+int dma_bytes_done_chan(enum dma_channel ch, uint32_t orig_count);
+
 void dma_cfg_buffers(enum dma_channel ch, const void *membuf,
 			uint32_t nb, const void *pdev);
 
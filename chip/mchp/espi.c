@@ -10,6 +10,7 @@
 #include "console.h"
 #include "gpio.h"
 #include "hooks.h"
+#include "hwtimer.h"
 #include "host_command.h"
 #include "keyboard_protocol.h"
 #include "port80.h"
@@ -493,10 +494,12 @@ void espi_oob_init(void)
  */
 static void espi_send_boot_load_done(void)
 {
-	/* First set SLAVE_BOOT_LOAD_STATUS = 1 */
-	MCHP_ESPI_VW_S2M_SRC3(SMVW_H05) = 1;
-	/* Next set SLAVE_BOOT_LOAD_DONE = 1 */
-	MCHP_ESPI_VW_S2M_SRC0(SMVW_H05) = 1;
+	static const struct espi_vw_level btld[] = {
+		{ VW_SLAVE_BTLD_STATUS_DONE, 1 },
+	};
+
+	/* SLAVE_BOOT_LOAD_STATUS and SLAVE_BOOT_LOAD_DONE in one write */
+	espi_vw_set_wires(btld, ARRAY_SIZE(btld));
 
 	CPRINTS("eSPI Send SLAVE_BOOT_LOAD_STATUS/DONE = 1");
 	trace0(0, ESPI, 0, "VW SLAVE_BOOT_LOAD_STATUS/DONE = 1");
@@ -658,6 +661,74 @@ int espi_vw_set_wire(enum espi_vw_signal signal, uint8_t level)
 	return EC_SUCCESS;
 }
 
+/**
+ * Set several eSPI Virtual-Wire signals to Host at once
+ *
+ * Wires are grouped by Slave-to-Master register and each register
+ * is updated with one 32-bit write, so all the wires of a host index
+ * are sent in the same VW packet and ESPI_ALERT# asserts only once.
+ * All entries are checked first, nothing is written on error.
+ *
+ * @param wires  signals and levels to set
+ * @param count  number of entries in wires
+ * @return EC_SUCCESS, or non-zero if error.
+ */
+int espi_vw_set_wires(const struct espi_vw_level *wires, int count)
+{
+	uint32_t set[SMVW_MAX];
+	uint32_t mask[SMVW_MAX];
+	uint32_t bits, v;
+	int i, tidx;
+	uint8_t ridx;
+
+	memset(set, 0, sizeof(set));
+	memset(mask, 0, sizeof(mask));
+
+	for (i = 0; i < count; i++) {
+		tidx = espi_vw_get_signal_index(wires[i].signal);
+		if (tidx < 0)
+			return EC_ERROR_PARAM1;
+
+		if (0 == (vw_info_tbl[tidx].flags & (1u << 0)))
+			return EC_ERROR_PARAM1; /* signal is Master-to-Slave */
+
+		ridx = vw_info_tbl[tidx].reg_idx;
+		if (ridx >= SMVW_MAX)
+			return EC_ERROR_PARAM1;
+
+		/* Each SRC byte holds the wire state in bit[0] */
+		if (wires[i].signal == VW_SLAVE_BTLD_STATUS_DONE)
+			bits = BIT(0) | BIT(24); /* DONE (SRC0) | STATUS (SRC3) */
+		else
+			bits = BIT(8 * vw_info_tbl[tidx].src_num);
+
+		mask[ridx] |= bits;
+		if (wires[i].level)
+			set[ridx] |= bits;
+		else
+			set[ridx] &= ~bits;
+	}
+
+	/* Keep another writer from changing the register under us */
+	interrupt_disable();
+	for (ridx = 0; ridx < SMVW_MAX; ridx++) {
+		if (!mask[ridx])
+			continue;
+		v = MCHP_ESPI_VW_S2M_SRC_ALL(ridx);
+		MCHP_ESPI_VW_S2M_SRC_ALL(ridx) = (v & ~mask[ridx]) | set[ridx];
+	}
+	interrupt_enable();
+
+#ifdef CONFIG_MCHP_ESPI_DEBUG
+	for (i = 0; i < count; i++)
+		CPRINTS("eSPI VW Set Wire %s = %d",
+			espi_vw_get_wire_name(wires[i].signal),
+			wires[i].level ? 1 : 0);
+#endif
+
+	return EC_SUCCESS;
+}
+
 /*
  * Set Slave to Master virtual wire to level and wait for hardware
  * to process virtual wire.
@@ -1053,11 +1124,9 @@ int espi_oob_retry_receive_date(uint8_t *readBuf)
 	return EC_ERROR_UNKNOWN;
 }
 
-int espi_oob_build_peci_command(uint8_t srcAddr, uint8_t destAddr, uint8_t cmdCode,
-		uint8_t nWrite, uint8_t *writeBuf, uint8_t *readBuf)
+int espi_oob_peci_send(uint8_t srcAddr, uint8_t destAddr, uint8_t cmdCode,
+		uint8_t nWrite, uint8_t *writeBuf)
 {
-	int i;
-
 	/* Clear slave OOB Dn/Up buffers */
 	memset(espi_slave_oobDn, 0, sizeof(espi_slave_oobDn));
 	memset(espi_slave_oobUp, 0, sizeof(espi_slave_oobUp));
@@ -1121,22 +1190,44 @@ int espi_oob_build_peci_command(uint8_t srcAddr, uint8_t destAddr, uint8_t cmdCo
 	MCHP_ESPI_OOB_TX_STATUS = 0x2F;	/* Write clear register, reset status */
 	MCHP_ESPI_OOB_TX_CTL |= 0x01;	/* TRANSMIT_START */
 
+	return EC_SUCCESS;
+}
+
+int espi_oob_peci_receive(uint8_t *readBuf, int rlen)
+{
+	int i;
+
+	if (espi_slave_oobDn[0] == 0)
+		return EC_ERROR_BUSY;
+
+	if (espi_slave_oobDn[1] == 0x01) {
+		/* only process peci cmd */
+		for (i = 0; i < MIN(espi_slave_oobDn[2] - 2, rlen); i++)
+			readBuf[i] = espi_slave_oobDn[i+5];
+	}
+
+	return EC_SUCCESS;
+}
+
+int espi_oob_build_peci_command(uint8_t srcAddr, uint8_t destAddr, uint8_t cmdCode,
+		uint8_t nWrite, uint8_t *writeBuf, uint8_t *readBuf)
+{
+	espi_oob_peci_send(srcAddr, destAddr, cmdCode, nWrite, writeBuf);
+
 	/* wait eSPI Tx done */
 	msleep(5);
 
-	if (espi_slave_oobDn[0] != 0) {
-		if (espi_slave_oobDn[1] == 0x01) {
-			/* only process peci cmd */
-			for (i = 0; i < espi_slave_oobDn[2]-2; i++)
-				readBuf[i] = espi_slave_oobDn[i+5];
-		}
-	} else {
+	/* The caller sized readBuf for the command it sent */
+	if (espi_oob_peci_receive(readBuf, sizeof(espi_slave_oobDn)))
 		return EC_ERROR_TIMEOUT;
-	}
 
 	return EC_SUCCESS;
 }
 
+__overridable void espi_oob_rx_notify(void)
+{
+}
+
 /************************************************************************/
 /* Interrupt handlers */
 
@@ -1229,45 +1320,187 @@ const FPVW girq25_vw_handlers[MCHP_GIRQ25_NUM_M2S] = {
 	espi_vw_evt2_dflt,
 };
 
+/*
+ * M2S VWires whose handlers only log or do not have to meet a host
+ * deadline. Their handlers run from the HOOK task so the ISR stays
+ * short for SLP_Sx#, PLTRST# and the *_WARN wires the host waits
+ * an ACK for.
+ */
+#define MCHP_GIRQ24_VW_DEFERRED	(BIT(13) | BIT(15) | BIT(16) | BIT(17))
+#define MCHP_GIRQ25_VW_DEFERRED	BIT(0)
+
+static const FPVW * const vw_handlers[2] = {
+	girq24_vw_handlers, girq25_vw_handlers
+};
+
+static const uint32_t vw_deferred_mask[2] = {
+	MCHP_GIRQ24_VW_DEFERRED, MCHP_GIRQ25_VW_DEFERRED
+};
+
+/* Deferred wires not handled yet and their latest state, per GIRQ */
+static uint32_t vw_pending[2];
+static uint32_t vw_pending_state[2];
+
+#ifdef CONFIG_MCHP_ESPI_VW_LATENCY
+#define VW_LAT_NUM	(MCHP_GIRQ24_NUM_M2S + MCHP_GIRQ25_NUM_M2S)
+
+struct vw_latency {
+	uint32_t count;
+	uint32_t last_us;
+	uint32_t max_us;
+	uint32_t total_us;
+};
+
+static struct vw_latency vw_lat[VW_LAT_NUM];
+/* ISR entry time of the pending deferred wires */
+static uint32_t vw_lat_isr_us[VW_LAT_NUM];
+
+static inline int vw_lat_idx(int girq, uint32_t bpos)
+{
+	return girq ? MCHP_GIRQ24_NUM_M2S + bpos : bpos;
+}
+
+static void vw_lat_record(int idx, uint32_t isr_us)
+{
+	uint32_t us = __hw_clock_source_read() - isr_us;
+
+	vw_lat[idx].count++;
+	vw_lat[idx].last_us = us;
+	vw_lat[idx].total_us += us;
+	if (us > vw_lat[idx].max_us)
+		vw_lat[idx].max_us = us;
+}
+#endif
+
+static void espi_vw_deferred(void)
+{
+	uint32_t pending, state, bpos;
+	int girq;
+
+	for (girq = 0; girq < 2; girq++) {
+		interrupt_disable();
+		pending = vw_pending[girq];
+		state = vw_pending_state[girq];
+		vw_pending[girq] = 0;
+		interrupt_enable();
+
+		while (pending) {
+			bpos = __builtin_ctz(pending);
+#ifdef CONFIG_MCHP_ESPI_VW_LATENCY
+			vw_lat_record(vw_lat_idx(girq, bpos),
+				      vw_lat_isr_us[vw_lat_idx(girq, bpos)]);
+#endif
+			(vw_handlers[girq][bpos])((state >> bpos) & 0x01, bpos);
+			pending &= ~(1ul << bpos);
+		}
+	}
+}
+DECLARE_DEFERRED(espi_vw_deferred);
+
+/*
+ * Common M2S VWire dispatch. girq is 0 for GIRQ24 (MSVW00 - MSVW06)
+ * and 1 for GIRQ25 (MSVW07 - MSVW10). The wire state of source n of
+ * MSVWxx is bit[0] of byte (8 + n) of the 12 byte MSVWxx register.
+ */
+static void espi_vw_dispatch(int girq, uint32_t result)
+{
+	uint32_t d, bpos, base;
+	uint32_t deferred = 0;
+#ifdef CONFIG_MCHP_ESPI_VW_LATENCY
+	uint32_t isr_us = __hw_clock_source_read();
+#endif
+
+	base = MCHP_ESPI_MSVW_BASE + (girq ? (12 * 7) : 0) + 8;
+
+	while (result) {
+		bpos = __builtin_ctz(result); /* rbit, clz sequence */
+		d = *(uint8_t *)(base + (12 * (bpos >> 2)) +
+				(bpos & 0x03)) & 0x01;
+		if (vw_deferred_mask[girq] & (1ul << bpos)) {
+			vw_pending_state[girq] &= ~(1ul << bpos);
+			vw_pending_state[girq] |= d << bpos;
+			deferred |= 1ul << bpos;
+#ifdef CONFIG_MCHP_ESPI_VW_LATENCY
+			vw_lat_isr_us[vw_lat_idx(girq, bpos)] = isr_us;
+#endif
+		} else {
+#ifdef CONFIG_MCHP_ESPI_VW_LATENCY
+			vw_lat_record(vw_lat_idx(girq, bpos), isr_us);
+#endif
+			(vw_handlers[girq][bpos])(d, bpos);
+		}
+		result &= ~(1ul << bpos);
+	}
+
+	if (deferred) {
+		vw_pending[girq] |= deferred;
+		hook_call_deferred(&espi_vw_deferred_data, 0);
+	}
+}
+
 /* Interrupt handler for eSPI virtual wires in MSVW00 - MSVW01 */
 void espi_mswv1_interrupt(void)
 {
-	uint32_t d, girq24_result, bpos;
+	uint32_t girq24_result;
 
-	d = MCHP_INT_ENABLE(24);
 	girq24_result = MCHP_INT_RESULT(24);
 	MCHP_INT_SOURCE(24) = girq24_result;
 
-	while (girq24_result) {
-		bpos = __builtin_ctz(girq24_result); /* rbit, clz sequence */
-		d = *(uint8_t *)(MCHP_ESPI_MSVW_BASE + 8 +
-				(12 * (bpos >> 2)) + (bpos & 0x03)) & 0x01;
-		(girq24_vw_handlers[bpos])(d, bpos);
-		girq24_result &= ~(1ul << bpos);
-	}
+	espi_vw_dispatch(0, girq24_result);
 }
 DECLARE_IRQ(MCHP_IRQ_GIRQ24, espi_mswv1_interrupt, 2);
 
-
 /* Interrupt handler for eSPI virtual wires in MSVW07 - MSVW10 */
 void espi_msvw2_interrupt(void)
 {
-	uint32_t d, girq25_result, bpos;
+	uint32_t girq25_result;
 
-	d = MCHP_INT_ENABLE(25);
 	girq25_result = MCHP_INT_RESULT(25);
 	MCHP_INT_SOURCE(25) = girq25_result;
 
-	while (girq25_result) {
-		bpos = __builtin_ctz(girq25_result); /* rbit, clz sequence */
-		d = *(uint8_t *)(MCHP_ESPI_MSVW_BASE + (12 * 7) + 8 +
-				(12 * (bpos >> 2)) + (bpos & 0x03)) & 0x01;
-		(girq25_vw_handlers[bpos])(d, bpos);
-		girq25_result &= ~(1ul << bpos);
-	}
+	espi_vw_dispatch(1, girq25_result);
 }
 DECLARE_IRQ(MCHP_IRQ_GIRQ25, espi_msvw2_interrupt, 2);
 
+#ifdef CONFIG_MCHP_ESPI_VW_LATENCY
+static int command_vwlat(int argc, char **argv)
+{
+	int girq, bpos, idx;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		interrupt_disable();
+		memset(vw_lat, 0, sizeof(vw_lat));
+		interrupt_enable();
+		return EC_SUCCESS;
+	}
+
+	ccprintf("GIRQ BIT DEF     COUNT   LAST    MAX    AVG (us)\n");
+	for (idx = 0; idx < VW_LAT_NUM; idx++) {
+		struct vw_latency l;
+
+		interrupt_disable();
+		l = vw_lat[idx];
+		interrupt_enable();
+		if (!l.count)
+			continue;
+
+		girq = idx >= MCHP_GIRQ24_NUM_M2S;
+		bpos = girq ? idx - MCHP_GIRQ24_NUM_M2S : idx;
+		ccprintf("  %d  %3d  %c  %8d %6d %6d %6d\n", 24 + girq, bpos,
+			 (vw_deferred_mask[girq] & BIT(bpos)) ? 'y' : 'n',
+			 l.count, l.last_us, l.max_us,
+			 l.total_us / l.count);
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(vwlat, command_vwlat, "[clear]",
+			"Show M2S VWire interrupt to handler latency");
+#endif
+
 
 
 /*
@@ -1422,6 +1655,7 @@ void espi_oob_rx_isr(void)
 	/* Handle OOB Up transmit status: done and/or errors, if any */
 	CPRINTS("eSPI OOB_DN status = 0x%x", sts);
 	trace11(0, ESPI, 0, "eSPI OOB_RX Status = 0x%08x", sts);
+	espi_oob_rx_notify();
 }
 DECLARE_IRQ(MCHP_IRQ_ESPI_OOB_DN, espi_oob_rx_isr, 2);
 
@@ -5,6 +5,7 @@
 
 /* GPIO module for MCHP MEC */
 
+#include "clock_chip.h"
 #include "common.h"
 #include "gpio.h"
 #include "hooks.h"
@@ -412,6 +413,9 @@ static void gpio_interrupt(int girq, int port)
 				trace12(0, GPIO, 0,
 					"Bit[%d]: handler @ 0x%08x", bit,
 					(uint32_t)gpio_irq_handlers[i]);
+#ifdef CONFIG_WAKE_STATS
+				clock_wake_gpio(i);
+#endif
 				gpio_irq_handlers[i](i);
 			}
 			sts &= ~BIT(bit);
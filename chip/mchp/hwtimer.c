@@ -9,6 +9,7 @@
 #include "common.h"
 #include "hooks.h"
 #include "hwtimer.h"
+#include "pc_profiler.h"
 #include "registers.h"
 #include "task.h"
 #include "timer.h"
@@ -119,3 +120,78 @@ int __hw_clock_source_init(uint32_t start_t)
 	 */
 	return MCHP_IRQ_TIMER32_1;
 }
+
+#ifdef CONFIG_PC_PROFILER
+/* 16-bit basic timer 1 drives the PC profiler */
+int pc_profiler_timer_start(int rate_hz)
+{
+	uint32_t val;
+
+	/* 1 MHz count, with 16 bits of preload */
+	if (rate_hz < 16 || rate_hz > 10000)
+		return EC_ERROR_INVAL;
+
+	MCHP_PCR_SLP_DIS_DEV(MCHP_PCR_BTMR16_1);
+
+	/* Ensure timer is not running */
+	MCHP_TMR16_CTL(1) &= ~BIT(5);
+
+	/* Enable timer */
+	MCHP_TMR16_CTL(1) |= BIT(0);
+
+	val = MCHP_TMR16_CTL(1);
+
+	/* Pre-scale = 48 -> 1MHz, count down, auto restart from preload */
+	val = (val & 0xffff & ~BIT(2)) | BIT(3) | (47 << 16);
+
+	MCHP_TMR16_CTL(1) = val;
+	MCHP_TMR16_PRE(1) = 1000000 / rate_hz - 1;
+	MCHP_TMR16_CNT(1) = MCHP_TMR16_PRE(1);
+
+	/* Enable interrupt */
+	MCHP_TMR16_IEN(1) |= 1;
+	MCHP_INT_ENABLE(MCHP_TMR16_GIRQ) = MCHP_TMR16_GIRQ_BIT(1);
+	task_enable_irq(MCHP_IRQ_TIMER16_1);
+
+	/* Start counting */
+	MCHP_TMR16_CTL(1) |= BIT(5);
+
+	return EC_SUCCESS;
+}
+
+void pc_profiler_timer_stop(void)
+{
+	MCHP_TMR16_CTL(1) &= ~BIT(5);
+	task_disable_irq(MCHP_IRQ_TIMER16_1);
+	MCHP_INT_DISABLE(MCHP_TMR16_GIRQ) = MCHP_TMR16_GIRQ_BIT(1);
+	MCHP_TMR16_STS(1) |= 1;
+	MCHP_INT_SOURCE(MCHP_TMR16_GIRQ) = MCHP_TMR16_GIRQ_BIT(1);
+	MCHP_PCR_SLP_EN_DEV(MCHP_PCR_BTMR16_1);
+}
+
+void __keep pc_profiler_timer_irq(uint32_t excep_lr, uint32_t excep_sp)
+{
+	/* Clear timer and aggregator status */
+	MCHP_TMR16_STS(1) |= 1;
+	MCHP_INT_SOURCE(MCHP_TMR16_GIRQ) = MCHP_TMR16_GIRQ_BIT(1);
+
+	pc_profiler_sample(excep_lr, excep_sp);
+}
+
+void IRQ_HANDLER(MCHP_IRQ_TIMER16_1)(void) __keep __attribute__((naked));
+void IRQ_HANDLER(MCHP_IRQ_TIMER16_1)(void)
+{
+	/* Naked call so we can extract raw LR and SP */
+	asm volatile("mov r0, lr\n"
+		     "mov r1, sp\n"
+		     "push {r0, lr}\n"
+		     "bl pc_profiler_timer_irq\n"
+		     "pop {r0, lr}\n"
+		     "b task_resched_if_needed\n");
+}
+
+/* Highest priority, so the samples also land in other interrupts */
+const struct irq_priority __keep IRQ_PRIORITY(MCHP_IRQ_TIMER16_1)
+	__attribute__((section(".rodata.irqprio")))
+		= {MCHP_IRQ_TIMER16_1, 0};
+#endif /* CONFIG_PC_PROFILER */
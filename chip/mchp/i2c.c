@@ -7,15 +7,20 @@
  * TODO handle chip variants
  */
 
+#include "clock.h"
 #include "common.h"
 #include "console.h"
+#include "cpu.h"
+#include "dma.h"
 #include "gpio.h"
 #include "hooks.h"
 #include "i2c.h"
+#include "i2c_private.h"
 #include "registers.h"
 #include "task.h"
 #include "timer.h"
 #include "util.h"
+#include "dma_chip.h"
 #include "tfdp_chip.h"
 #include "i2c_slave.h"
 
@@ -67,8 +72,13 @@
 #define COMP_MCEN	BIT(3) /* enable master cumulative timeouts */
 #define COMP_SCEN	BIT(4) /* enable slave cumulative timeouts */
 #define COMP_BIDEN	BIT(5) /* enable Bus idle timeouts */
+#define COMP_DTO	BIT(8) /* device timeout */
+#define COMP_MCTO	BIT(9) /* master cumulative timeout */
+#define COMP_BER	BIT(13) /* bus error */
+#define COMP_LAB	BIT(14) /* lost arbitration */
 #define COMP_R_WR   BIT(21) /* completed repeat start write */
 #define COMP_R_RE   BIT(20) /* completed repeat start read */
+#define COMP_MNAKX	BIT(24) /* master got a NACK while writing */
 #define COMP_IDLE	BIT(29)  /* i2c bus is idle */
 #define COMP_SLAVE  BIT(31)
 #define COMP_RW_BITS_MASK 0x3C /* R/W bits mask */
@@ -427,6 +437,7 @@ static void reset_controller(int controller)
 		}
 }
 
+#ifndef CONFIG_I2C_ASYNC
 /*
  * !!! WARNING !!!
  * We have observed task_wait_event_mask() returning 0 if the I2C
@@ -518,6 +529,7 @@ static int wait_byte_done(int controller, uint8_t mask, uint8_t expected)
 		rv = EC_ERROR_UNKNOWN;
 	return rv;
 }
+#endif /* !CONFIG_I2C_ASYNC */
 
 /*
  * Select port on controller. If controller configured
@@ -596,6 +608,7 @@ static int i2c_check_recover(int port, int controller)
 	return EC_SUCCESS;
 }
 
+#ifndef CONFIG_I2C_ASYNC
 static inline void push_in_buf(uint8_t **in, uint8_t val, int skip)
 {
 	if (!skip) {
@@ -920,6 +933,722 @@ err_chip_i2c_xfer:
 	}
 	return EC_ERROR_UNKNOWN;
 }
+#else /* CONFIG_I2C_ASYNC */
+
+enum i2c_async_state {
+	ASYNC_TX,	/* Sending the address or data bytes */
+	ASYNC_RX_ADDR,	/* Sending the read address */
+	ASYNC_RX,	/* Receiving data bytes */
+	ASYNC_DMA_TX,	/* Network layer writing the addresses and out */
+	ASYNC_DMA_RX,	/* Network layer reading into in */
+	ASYNC_STOP,	/* Waiting for the bus to go idle after the STOP */
+};
+
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+#ifndef CHIP_FAMILY_MEC17XX
+#error "CONFIG_I2C_DMA_THRESHOLD needs the MEC17xx master buffer registers"
+#endif
+
+/* Most register address bytes a DMA read sends first */
+#define I2C_DMA_OUT_MAX 4
+
+/* Interrupts and CPU time of transfers, per mode */
+struct i2c_mode_stats {
+	uint32_t xfers;
+	uint32_t bytes;
+	uint32_t irqs;
+	uint64_t cycles;
+};
+
+/* Master DMA channels, by controller */
+static const enum dma_channel i2c_dma_channel[] = {
+	MCHP_DMAC_I2C0_MASTER,
+	MCHP_DMAC_I2C1_MASTER,
+	MCHP_DMAC_I2C2_MASTER,
+	MCHP_DMAC_I2C3_MASTER,
+};
+#endif
+
+/* Transfer queue of each controller */
+static struct {
+	struct i2c_async_queue q;
+	enum i2c_async_state state;
+	int pos;		/* Next byte of out or in */
+	uint8_t needs_recover;
+	uint8_t recovering;
+	/* Requests from tasks to the interrupt */
+	uint8_t abort;
+	uint8_t fail_queue;
+	uint32_t deadline;
+	uint32_t timeouts;
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	uint8_t dma;		/* Running transfer uses the network layer */
+	/* Addresses and out bytes of the write phase */
+	uint8_t dma_out[I2C_DMA_OUT_MAX + 2];
+	struct i2c_mode_stats mode[2];	/* Byte at a time, DMA */
+#endif
+} aq[I2C_CONTROLLER_COUNT];
+
+static uint64_t async_stats_start;
+
+static void i2c_async_service(void);
+DECLARE_DEFERRED(i2c_async_service);
+
+/* Critical section which may nest, the queue is used from everywhere */
+static inline uint32_t async_lock(void)
+{
+	uint32_t primask;
+
+	asm volatile("mrs %0, primask" : "=r"(primask));
+	interrupt_disable();
+	return primask;
+}
+
+static inline void async_unlock(uint32_t primask)
+{
+	if (!primask)
+		interrupt_enable();
+}
+
+/* Run async_interrupt() soon */
+static void async_kick(int ctrl)
+{
+	enable_controller_irq(ctrl);
+	task_trigger_irq(ctrl == 4 ? MCHP_IRQ_I2C_4 : MCHP_IRQ_I2C_0 + ctrl);
+}
+
+/*
+ * Spin as long as the blocking driver would before it sleeps.  Only from a
+ * task, or before tasks run, never with interrupts disabled.
+ */
+static void async_wait_idle(int ctrl)
+{
+	uint32_t start = get_time().le.lo;
+
+	while (!(MCHP_I2C_STATUS(ctrl) & STS_NBB))
+		if (get_time().le.lo - start > I2C_WAIT_BLOCKING_TIMEOUT_US)
+			return;
+}
+
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+/* Whether the network layer can run the whole transfer */
+static int async_dma_ok(int ctrl, const struct i2c_xfer_async *xfer)
+{
+	return ctrl < ARRAY_SIZE(i2c_dma_channel) &&
+	       (xfer->flags & I2C_XFER_SINGLE) == I2C_XFER_SINGLE &&
+	       cdata[ctrl].transaction_state == I2C_TRANSACTION_STOPPED &&
+	       xfer->in_size >= CONFIG_I2C_DMA_THRESHOLD &&
+	       xfer->in_size <= MCMD_RCNT_MASK0 &&
+	       xfer->out_size <= I2C_DMA_OUT_MAX;
+}
+
+/*
+ * Write the addresses and register bytes, then read in_size bytes and STOP,
+ * all from the network layer.  The channel feeds the master TX buffer until
+ * the write count runs out, then the controller holds the bus with MPROCEED
+ * clear so async_dma_step() can turn the channel around.
+ */
+static void async_dma_start(int ctrl)
+{
+	uint8_t *buf = aq[ctrl].dma_out;
+	struct dma_option option = {
+		i2c_dma_channel[ctrl],
+		(void *)&MCHP_I2C_MASTER_TX_BUF(ctrl),
+		MCHP_DMA_XFER_SIZE(1) + MCHP_DMA_INC_MEM
+	};
+	uint32_t cmd = MCMD_MRUN | MCMD_MPROCEED | MCMD_START0 | MCMD_STOP |
+		       MCMD_READM;
+	int n = 0;
+
+	if (cdata[ctrl].out_size) {
+		buf[n++] = cdata[ctrl].slv_addr_8bit;
+		memcpy(buf + n, cdata[ctrl].outp, cdata[ctrl].out_size);
+		n += cdata[ctrl].out_size;
+		cmd |= MCMD_STARTN;
+	}
+	buf[n++] = cdata[ctrl].slv_addr_8bit | 0x01;
+
+	aq[ctrl].dma = 1;
+	aq[ctrl].state = ASYNC_DMA_TX;
+
+	/* Drop status left by earlier transfers */
+	MCHP_I2C_COMPLETE(ctrl) = MCHP_I2C_COMPLETE(ctrl);
+	MCHP_I2C_CONFIG(ctrl) |= BIT(CFG_FLUSH_MXBUF) | BIT(CFG_FLUSH_MRBUF);
+	dma_xfr_prepare_tx(&option, n, buf, 1);
+	dma_go_chan(option.channel);
+
+	/* Only the network layer interrupts, once per phase */
+	MCHP_I2C_CTRL(ctrl) = CTRL_PIN | CTRL_ESO | CTRL_ACK;
+	MCHP_I2C_CONFIG(ctrl) |= CFG_ENMI;
+	MCHP_I2C_MASTER_CMD(ctrl) = cmd | (n << MCMD_WCNT_BITPOS) |
+				    (cdata[ctrl].in_size << MCMD_RCNT_BITPOS);
+}
+
+static void async_dma_stop(int ctrl)
+{
+	dma_disable(i2c_dma_channel[ctrl]);
+	dma_clear_isr(i2c_dma_channel[ctrl]);
+	MCHP_I2C_CONFIG(ctrl) &= ~CFG_ENMI;
+	MCHP_I2C_MASTER_CMD(ctrl) = 0;
+}
+#endif /* CONFIG_I2C_DMA_THRESHOLD */
+
+static void async_complete(int ctrl, int rv)
+{
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	const struct i2c_xfer_async *xfer = aq[ctrl].q.running;
+
+	if (aq[ctrl].dma)
+		async_dma_stop(ctrl);
+	if (!rv) {
+		aq[ctrl].mode[aq[ctrl].dma].xfers++;
+		aq[ctrl].mode[aq[ctrl].dma].bytes += xfer->out_size +
+						     xfer->in_size;
+	}
+	aq[ctrl].dma = 0;
+#endif
+	MCHP_I2C_CONFIG(ctrl) &= ~CFG_ENIDI;
+	i2c_async_complete(&aq[ctrl].q, rv);
+}
+
+/* Same as the error path of the blocking driver */
+static void async_error(int ctrl, int rv)
+{
+	cdata[ctrl].hwsts2 = MCHP_I2C_STATUS(ctrl);
+	MCHP_I2C_CTRL(ctrl) = CTRL_PIN | CTRL_ESO | CTRL_STO | CTRL_ACK;
+	cdata[ctrl].transaction_state = I2C_TRANSACTION_STOPPED;
+	cdata[ctrl].hwsts4 = MCHP_I2C_STATUS(ctrl);
+	cdata[ctrl].lines = (uint8_t)get_line_level(cdata[ctrl].port);
+	if (cdata[ctrl].hwsts2 & STS_BER)
+		reset_controller(ctrl);
+
+	async_complete(ctrl, rv);
+}
+
+static void async_run(int ctrl);
+
+/*
+ * Finish the running transfer once its STOP is out.  Until then the idle
+ * interrupt (NBB -> 1) brings us back here, which only the async driver
+ * enables: the blocking one saw lost task events with it.
+ */
+static void async_stop_done(int ctrl)
+{
+	uint8_t sts = MCHP_I2C_STATUS(ctrl);
+
+	if (!(sts & STS_NBB)) {
+		aq[ctrl].state = ASYNC_STOP;
+		/* Only a new idle status, not one left from before */
+		MCHP_I2C_COMPLETE(ctrl) = COMP_IDLE;
+		MCHP_I2C_CONFIG(ctrl) |= CFG_ENIDI;
+		/* The bus may have gone idle before the interrupt was on */
+		sts = MCHP_I2C_STATUS(ctrl);
+		if (!(sts & STS_NBB)) {
+			enable_controller_irq(ctrl);
+			return;
+		}
+	}
+
+	if (sts & (STS_LAB | STS_BER))
+		async_error(ctrl, EC_ERROR_UNKNOWN);
+	else
+		async_complete(ctrl, EC_SUCCESS);
+}
+
+static void async_done(int ctrl)
+{
+	if (!(cdata[ctrl].xflags & I2C_XFER_STOP)) {
+		async_complete(ctrl, EC_SUCCESS);
+		return;
+	}
+
+	cdata[ctrl].transaction_state = I2C_TRANSACTION_STOPPED;
+	async_stop_done(ctrl);
+}
+
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+/* Turn the channel around after the write phase, or finish the transfer */
+static void async_dma_step(int ctrl)
+{
+	uint32_t cmd = MCHP_I2C_MASTER_CMD(ctrl);
+	struct dma_option option = {
+		i2c_dma_channel[ctrl],
+		(void *)&MCHP_I2C_MASTER_RX_BUF(ctrl),
+		MCHP_DMA_XFER_SIZE(1) + MCHP_DMA_INC_MEM
+	};
+
+	if (cdata[ctrl].i2c_complete & (COMP_MNAKX | COMP_BER | COMP_LAB |
+					COMP_DTO | COMP_MCTO)) {
+		MCHP_I2C_MASTER_CMD(ctrl) = 0;
+		async_error(ctrl, EC_ERROR_UNKNOWN);
+		async_run(ctrl);
+		return;
+	}
+
+	if (cmd & MCMD_MRUN) {
+		if (aq[ctrl].state == ASYNC_DMA_TX &&
+		    !(cmd & MCMD_MPROCEED)) {
+			dma_xfr_start_rx(&option, 1, cdata[ctrl].in_size,
+					 cdata[ctrl].inp);
+			aq[ctrl].state = ASYNC_DMA_RX;
+			MCHP_I2C_MASTER_CMD(ctrl) = cmd | MCMD_MPROCEED;
+		}
+		enable_controller_irq(ctrl);
+		return;
+	}
+
+	/* Done, unless the controller gave up before the read */
+	if (aq[ctrl].state != ASYNC_DMA_RX ||
+	    dma_bytes_done_chan(option.channel, cdata[ctrl].in_size) !=
+	    cdata[ctrl].in_size) {
+		async_error(ctrl, EC_ERROR_UNKNOWN);
+		async_run(ctrl);
+		return;
+	}
+	async_done(ctrl);
+	async_run(ctrl);
+}
+#endif /* CONFIG_I2C_DMA_THRESHOLD */
+
+/*
+ * Move the running transfer on by one byte, once the controller is done with
+ * the last one.
+ */
+static void async_step(int ctrl)
+{
+	uint8_t sts = MCHP_I2C_STATUS(ctrl);
+	int left;
+
+	if (!aq[ctrl].q.running)
+		return;
+	if (aq[ctrl].state == ASYNC_STOP) {
+		async_stop_done(ctrl);
+		async_run(ctrl);
+		return;
+	}
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	if (aq[ctrl].dma) {
+		async_dma_step(ctrl);
+		return;
+	}
+#endif
+	if (sts & STS_PIN) {
+		enable_controller_irq(ctrl);
+		return;
+	}
+
+	/* NACK, bus error or lost arbitration */
+	cdata[ctrl].hwsts = sts;
+	if (sts) {
+		async_error(ctrl, EC_ERROR_UNKNOWN);
+		async_run(ctrl);
+		return;
+	}
+
+	switch (aq[ctrl].state) {
+	case ASYNC_TX:
+		if (aq[ctrl].pos < cdata[ctrl].out_size) {
+			MCHP_I2C_DATA(ctrl) = cdata[ctrl].outp[aq[ctrl].pos++];
+			break;
+		}
+		if (cdata[ctrl].in_size) {
+			/* Repeated-START then address */
+			MCHP_I2C_CTRL(ctrl) = CTRL_ESO | CTRL_ENI | CTRL_STA |
+					      CTRL_ACK;
+			MCHP_I2C_DATA(ctrl) = cdata[ctrl].slv_addr_8bit | 0x01;
+			aq[ctrl].state = ASYNC_RX_ADDR;
+			break;
+		}
+		if (cdata[ctrl].xflags & I2C_XFER_STOP)
+			MCHP_I2C_CTRL(ctrl) = CTRL_PIN | CTRL_ESO |
+					      CTRL_STO | CTRL_ACK;
+		async_done(ctrl);
+		async_run(ctrl);
+		return;
+	case ASYNC_RX_ADDR:
+		/* NACK the last byte, then read the address to clock it */
+		if ((cdata[ctrl].xflags & I2C_XFER_STOP) &&
+		    cdata[ctrl].in_size < 2)
+			MCHP_I2C_CTRL(ctrl) = CTRL_ESO | CTRL_ENI;
+		(void)MCHP_I2C_DATA(ctrl);
+		aq[ctrl].state = ASYNC_RX;
+		aq[ctrl].pos = 0;
+		break;
+	case ASYNC_RX:
+		left = cdata[ctrl].in_size - aq[ctrl].pos;
+		if (cdata[ctrl].xflags & I2C_XFER_STOP) {
+			if (left == 2)
+				MCHP_I2C_CTRL(ctrl) = CTRL_ESO | CTRL_ENI;
+			else if (left == 1)
+				MCHP_I2C_CTRL(ctrl) = CTRL_PIN | CTRL_ESO |
+						      CTRL_STO | CTRL_ACK;
+		}
+		cdata[ctrl].inp[aq[ctrl].pos++] = MCHP_I2C_DATA(ctrl);
+		if (left == 1) {
+			async_done(ctrl);
+			async_run(ctrl);
+			return;
+		}
+		break;
+	case ASYNC_DMA_TX:
+	case ASYNC_DMA_RX:
+	case ASYNC_STOP:
+		/* The network layer runs these, the STOP is handled above */
+		break;
+	}
+
+	enable_controller_irq(ctrl);
+}
+
+/*
+ * Check the bus the way i2c_check_recover() does, without fixing it.  A bus
+ * still busy is left to async_recover() as well, which waits for it.
+ */
+static int async_bus_ok(int ctrl)
+{
+	uint8_t reg = MCHP_I2C_STATUS(ctrl);
+
+	return (reg & STS_NBB) && !(reg & (STS_BER | STS_LAB)) &&
+	       get_line_level(cdata[ctrl].port) == I2C_LINE_IDLE;
+}
+
+/* Start the transfer set as running, return non-zero if the bus is bad */
+static int async_start(int ctrl)
+{
+	struct i2c_xfer_async *xfer = aq[ctrl].q.running;
+	int start = xfer->flags & I2C_XFER_START;
+
+	disable_controller_irq(ctrl);
+	select_port(xfer->port, ctrl);
+
+	cdata[ctrl].flags = 0;
+	cdata[ctrl].i2c_complete = 0;
+	cdata[ctrl].hwsts = 0;
+	cdata[ctrl].hwsts2 = 0;
+	cdata[ctrl].hwsts3 = 0;
+	cdata[ctrl].hwsts4 = 0;
+	cdata[ctrl].port = xfer->port & 0xff;
+	cdata[ctrl].slv_addr_8bit = I2C_GET_ADDR(xfer->slave_addr_flags) << 1;
+	cdata[ctrl].out_size = xfer->out_size;
+	cdata[ctrl].outp = xfer->out;
+	cdata[ctrl].in_size = xfer->in_size;
+	cdata[ctrl].inp = xfer->in;
+	cdata[ctrl].xflags = xfer->flags;
+
+	if (start && cdata[ctrl].transaction_state == I2C_TRANSACTION_STOPPED &&
+	    !async_bus_ok(ctrl))
+		return EC_ERROR_BUSY;
+
+	aq[ctrl].deadline = get_time().le.lo + cdata[ctrl].timeout_us;
+	aq[ctrl].pos = 0;
+
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	if (async_dma_ok(ctrl, xfer)) {
+		async_dma_start(ctrl);
+	} else
+#endif
+	if (xfer->out_size) {
+		aq[ctrl].state = ASYNC_TX;
+		if (start) {
+			MCHP_I2C_DATA(ctrl) = cdata[ctrl].slv_addr_8bit;
+			/* Clock out the slave address, sending START bit */
+			MCHP_I2C_CTRL(ctrl) = CTRL_PIN | CTRL_ESO | CTRL_ENI |
+					      CTRL_ACK | CTRL_STA;
+		}
+	} else if (start) {
+		aq[ctrl].state = ASYNC_RX_ADDR;
+		if (cdata[ctrl].transaction_state == I2C_TRANSACTION_OPEN) {
+			/* Repeated-START then address */
+			MCHP_I2C_CTRL(ctrl) = CTRL_ESO | CTRL_ENI | CTRL_STA |
+					      CTRL_ACK;
+			MCHP_I2C_DATA(ctrl) = cdata[ctrl].slv_addr_8bit | 0x01;
+		} else {
+			/* address then START */
+			MCHP_I2C_DATA(ctrl) = cdata[ctrl].slv_addr_8bit | 0x01;
+			MCHP_I2C_CTRL(ctrl) = CTRL_ESO | CTRL_ENI | CTRL_STA |
+					      CTRL_ACK | CTRL_PIN;
+		}
+	} else {
+		/* Reading on, the last read clocked in the next byte */
+		aq[ctrl].state = ASYNC_RX;
+	}
+	cdata[ctrl].transaction_state = I2C_TRANSACTION_OPEN;
+
+	/* The blocking driver resets and retries here, which takes a while */
+	if (start && (MCHP_I2C_STATUS(ctrl) & STS_LAB))
+		return EC_ERROR_BUSY;
+
+	hook_call_deferred(&i2c_async_service_data, cdata[ctrl].timeout_us);
+	/* Without a START the controller may already be done */
+	async_kick(ctrl);
+	return EC_SUCCESS;
+}
+
+/* Start queued transfers until one runs */
+static void async_run(int ctrl)
+{
+	while (!aq[ctrl].q.running && !aq[ctrl].needs_recover &&
+	       !aq[ctrl].recovering) {
+		if (!i2c_async_next(&aq[ctrl].q))
+			break;
+		if (async_start(ctrl)) {
+			/* Put it back, and fix the bus from a task */
+			i2c_async_requeue(&aq[ctrl].q);
+			aq[ctrl].needs_recover = 1;
+			cdata[ctrl].transaction_state = I2C_TRANSACTION_STOPPED;
+			if (aq[ctrl].q.queue->task != TASK_ID_INVALID)
+				task_set_event(aq[ctrl].q.queue->task,
+					       TASK_EVENT_I2C_DONE, 0);
+			hook_call_deferred(&i2c_async_service_data, 0);
+		}
+	}
+
+	i2c_async_set_busy(ctrl, aq[ctrl].q.running || aq[ctrl].q.queue);
+}
+
+/* Unwedge and reset the bus, in task context */
+static void async_recover(int ctrl)
+{
+	uint32_t primask;
+	int rv;
+
+	primask = async_lock();
+	if (aq[ctrl].q.running || aq[ctrl].recovering || !aq[ctrl].q.queue) {
+		aq[ctrl].needs_recover = 0;
+		async_unlock(primask);
+		return;
+	}
+	aq[ctrl].recovering = 1;
+	aq[ctrl].needs_recover = 0;
+	async_unlock(primask);
+
+	select_port(aq[ctrl].q.queue->port, ctrl);
+	async_wait_idle(ctrl);
+	rv = i2c_check_recover(aq[ctrl].q.queue->port, ctrl);
+
+	primask = async_lock();
+	aq[ctrl].recovering = 0;
+	/* Give up on what is queued, rather than try again forever */
+	if (rv)
+		aq[ctrl].fail_queue = 1;
+	async_unlock(primask);
+	async_kick(ctrl);
+}
+
+/*
+ * Handle what async_recover() and i2c_async_service() asked for, then move the
+ * queue on.  From the controller interrupt, or before tasks run.
+ */
+static void async_interrupt(int ctrl)
+{
+	uint32_t primask = async_lock();
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	struct i2c_mode_stats *mode = aq[ctrl].q.running ?
+				      &aq[ctrl].mode[aq[ctrl].dma] : NULL;
+	uint32_t cycles = CPU_DWT_CYCCNT;
+#endif
+
+	if (aq[ctrl].abort && aq[ctrl].q.running) {
+		aq[ctrl].timeouts++;
+		async_error(ctrl, EC_ERROR_TIMEOUT);
+		reset_controller(ctrl);
+	}
+	aq[ctrl].abort = 0;
+
+	if (aq[ctrl].fail_queue && !aq[ctrl].q.running)
+		i2c_async_fail_queued(&aq[ctrl].q, EC_ERROR_BUSY);
+	aq[ctrl].fail_queue = 0;
+
+	if (aq[ctrl].q.running)
+		async_step(ctrl);
+	else
+		async_run(ctrl);
+
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	if (mode) {
+		mode->irqs++;
+		mode->cycles += CPU_DWT_CYCCNT - cycles;
+	}
+#endif
+	async_unlock(primask);
+}
+
+/* Time out stuck transfers and fix bad buses, in task context */
+static void i2c_async_service(void)
+{
+	uint32_t now, next = 0;
+	uint32_t primask;
+	int ctrl;
+
+	for (ctrl = 0; ctrl < I2C_CONTROLLER_COUNT; ctrl++) {
+		if (aq[ctrl].needs_recover)
+			async_recover(ctrl);
+
+		primask = async_lock();
+		now = get_time().le.lo;
+		if (aq[ctrl].q.running &&
+		    (int32_t)(now - aq[ctrl].deadline) >= 0) {
+			aq[ctrl].abort = 1;
+			async_kick(ctrl);
+		} else if (aq[ctrl].q.running &&
+			   (!next || aq[ctrl].deadline - now < next)) {
+			next = aq[ctrl].deadline - now;
+		}
+		async_unlock(primask);
+	}
+
+	if (next)
+		hook_call_deferred(&i2c_async_service_data, next);
+}
+
+int i2c_xfer_async(struct i2c_xfer_async *xfer)
+{
+	int ctrl = i2c_port_to_controller(xfer->port);
+	uint32_t primask;
+
+	if (ctrl < 0 || (!xfer->out_size && !xfer->in_size))
+		return EC_ERROR_INVAL;
+
+	/* Only the interrupt starts transfers, it may signal tasks */
+	primask = async_lock();
+	i2c_async_push(&aq[ctrl].q, xfer);
+	i2c_async_set_busy(ctrl, 1);
+	if (!aq[ctrl].q.running)
+		async_kick(ctrl);
+	async_unlock(primask);
+
+	return EC_SUCCESS;
+}
+
+/*
+ * Called from common/i2c_master
+ * Queue the transfer and wait for it.
+ */
+int chip_i2c_xfer(int port, uint16_t slave_addr_flags,
+		  const uint8_t *out, int out_size,
+		  uint8_t *in, int in_size, int flags)
+{
+	struct i2c_xfer_async xfer = {
+		.port = port,
+		.slave_addr_flags = slave_addr_flags,
+		.out = out,
+		.out_size = out_size,
+		.in = in,
+		.in_size = in_size,
+		.flags = flags,
+		.task = task_start_called() ? task_get_current() :
+					      TASK_ID_INVALID,
+	};
+	int ctrl;
+	int rv;
+
+	if (out_size == 0 && in_size == 0)
+		return EC_SUCCESS;
+
+	ctrl = i2c_port_to_controller(port);
+	if (ctrl < 0)
+		return EC_ERROR_INVAL;
+
+	rv = i2c_xfer_async(&xfer);
+	if (rv)
+		return rv;
+
+	while (xfer.busy) {
+		if (aq[ctrl].needs_recover) {
+			async_recover(ctrl);
+		} else if (!task_start_called()) {
+			/* No interrupts yet, so move the transfer on here */
+			async_interrupt(ctrl);
+			if ((int32_t)(get_time().le.lo - aq[ctrl].deadline) >= 0)
+				i2c_async_service();
+		} else if (task_wait_event_mask(TASK_EVENT_I2C_DONE,
+						cdata[ctrl].timeout_us) &
+			   TASK_EVENT_TIMER) {
+			i2c_async_service();
+		}
+	}
+
+	return xfer.rv;
+}
+
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+/*
+ * Interrupts and CPU time per transfer, byte at a time and with DMA.  The time
+ * saved is what the DMA bytes would have cost at the byte mode rate.
+ */
+static void async_print_modes(void)
+{
+	const struct i2c_mode_stats *m;
+	uint32_t mhz = clock_get_freq() / SECOND;
+	uint64_t byte_cycles, dma_cycles;
+	int ctrl, i;
+
+	ccprintf("Ctrl  Mode      Xfers   Bytes  Irq/xfer  us/xfer\n");
+	for (ctrl = 0; ctrl < I2C_CONTROLLER_COUNT; ctrl++) {
+		for (i = 0; i < ARRAY_SIZE(aq[ctrl].mode); i++) {
+			m = &aq[ctrl].mode[i];
+			if (!m->xfers)
+				continue;
+			ccprintf("%4d  %-4s  %8d  %6d  %4d.%02d  %7d\n", ctrl,
+				 i ? "dma" : "byte", m->xfers, m->bytes,
+				 m->irqs / m->xfers,
+				 (int)((uint64_t)m->irqs * 100 / m->xfers % 100),
+				 (int)(m->cycles / m->xfers / mhz));
+		}
+
+		m = aq[ctrl].mode;
+		if (!m[0].bytes || !m[1].bytes)
+			continue;
+		byte_cycles = m[0].cycles * m[1].bytes / m[0].bytes;
+		dma_cycles = m[1].cycles;
+		if (byte_cycles > dma_cycles)
+			ccprintf("%4d  DMA saved about %lld us of CPU time\n", ctrl,
+				 (byte_cycles - dma_cycles) / mhz);
+	}
+}
+#endif /* CONFIG_I2C_DMA_THRESHOLD */
+
+static int command_i2c_queue(int argc, char **argv)
+{
+	uint64_t window = get_time().val - async_stats_start;
+	int ctrl;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		for (ctrl = 0; ctrl < I2C_CONTROLLER_COUNT; ctrl++) {
+			interrupt_disable();
+			aq[ctrl].q.queued = 0;
+			aq[ctrl].q.done = 0;
+			aq[ctrl].q.errors = 0;
+			aq[ctrl].timeouts = 0;
+			aq[ctrl].q.max_depth = aq[ctrl].q.depth;
+			aq[ctrl].q.busy_us = 0;
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+			memset(aq[ctrl].mode, 0, sizeof(aq[ctrl].mode));
+#endif
+			interrupt_enable();
+		}
+		async_stats_start = get_time().val;
+		return EC_SUCCESS;
+	}
+
+	ccprintf("Ctrl  Depth  Max    Queued      Done  Errors  Timeouts  Busy\n");
+	for (ctrl = 0; ctrl < I2C_CONTROLLER_COUNT; ctrl++)
+		ccprintf("%4d  %5d  %3d  %8d  %8d  %6d  %8d  %3d%%\n", ctrl,
+			 aq[ctrl].q.depth, aq[ctrl].q.max_depth, aq[ctrl].q.queued,
+			 aq[ctrl].q.done, aq[ctrl].q.errors, aq[ctrl].timeouts,
+			 window ? (int)(aq[ctrl].q.busy_us * 100 / window) : 0);
+	ccprintf("Over %lld ms\n", window / MSEC);
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	async_print_modes();
+#endif
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(i2cqueue, command_i2c_queue,
+			"[clear]",
+			"Print I2C transfer queue depth and utilization");
+#endif /* CONFIG_I2C_ASYNC */
 /*
  * A safe method of reading port's SCL pin level.
  */
@@ -1033,6 +1762,17 @@ void i2c_init(void)
 		/* Use default timeout. */
 		i2c_set_timeout(i2c_ports[i].port, 0);
 	}
+
+#ifdef CONFIG_I2C_ASYNC
+	for (i = 0; i < I2C_CONTROLLER_COUNT; i++)
+		i2c_async_queue_init(&aq[i].q);
+	async_stats_start = get_time().val;
+#endif
+#ifdef CONFIG_I2C_DMA_THRESHOLD
+	/* Cycle counter for the interrupt cost of each mode */
+	CPU_SCB_DEMCR |= CPU_SCB_DEMCR_TRCENA;
+	CPU_DWT_CTRL |= CPU_DWT_CTRL_CYCCNTENA;
+#endif
 }
 
 /*
@@ -1045,7 +1785,9 @@ static void handle_interrupt(int controller)
 {
 	uint32_t r;
 	int slave_idx;
+#ifndef CONFIG_I2C_ASYNC
 	int id = cdata[controller].task_waiting;
+#endif
 
 #ifdef CONFIG_I2C_SLAVE
 	if (cdata[controller].slave_mode) {
@@ -1117,9 +1859,13 @@ static void handle_interrupt(int controller)
 	cdata[controller].i2c_complete = r;
 	MCHP_INT_SOURCE(MCHP_I2C_GIRQ) = MCHP_I2C_GIRQ_BIT(controller);
 
+#ifdef CONFIG_I2C_ASYNC
+	async_interrupt(controller);
+#else
 	/* Wake up the task which was waiting on the I2C interrupt, if any. */
 	if (id != TASK_ID_INVALID)
 		task_set_event(id, TASK_EVENT_I2C_IDLE, 0);
+#endif
 }
 
 void i2c0_interrupt(void) { handle_interrupt(0); }
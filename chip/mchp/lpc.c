@@ -939,6 +939,11 @@ DECLARE_IRQ(MCHP_IRQ_8042EM_IBF, kb_ibf_interrupt, 1);
 void kb_obe_interrupt(void)
 {
 	MCHP_INT_SOURCE(MCHP_8042_GIRQ) = MCHP_8042_OBE_GIRQ_BIT;
+#ifdef CONFIG_8042_OBE_REFILL
+	/* Load the next byte right away, without a trip through the task */
+	if (keyboard_host_read_done())
+		return;
+#endif
 	task_wake(TASK_ID_KEYPROTO);
 }
 DECLARE_IRQ(MCHP_IRQ_8042EM_OBE, kb_obe_interrupt, 1);
@@ -2001,7 +2001,7 @@ enum MCHP_i2c_port {
 	REG8(MCHP_ESPI_VW_BASE + 0x206 + ((id) << 3))
 
 #define MCHP_ESPI_VW_S2M_SRC3(id) \
-	REG8(MCHP_ESPI_VW_BASE + 0x206 + ((id) << 3))
+	REG8(MCHP_ESPI_VW_BASE + 0x207 + ((id) << 3))
 
 /*
  * Access specified source bit as byte read/write.
@@ -11,6 +11,7 @@
 #include "hooks.h"
 #include "host_command.h"
 #include "temp_sensor.h"
+#include "timer.h"
 #include "util.h"
 
 /* Console output macros */
@@ -124,18 +125,33 @@ test_mockable_static void smi_sensor_failure_warning(void)
 	host_set_single_event(EC_HOST_EVENT_THERMAL);
 }
 
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+/* Runs once a second, share the pass with the thermal loop */
+#define DPTF_MAX_AGE_US		(500 * MSEC)
+#endif
+
 static void thermal_control_dptf(void)
 {
 	int i, t, rv;
 	int dptf_tripped;
 	int num_sensors_read;
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+	struct temp_sensor_snapshot snap;
+
+	temp_sensor_get_snapshot(&snap, DPTF_MAX_AGE_US);
+#endif
 
 	dptf_tripped = 0;
 	num_sensors_read = 0;
 
 	/* go through all the sensors */
 	for (i = 0; i < TEMP_SENSOR_COUNT; ++i) {
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+		rv = snap.rv[i];
+		t = snap.temp[i];
+#else
 		rv = temp_sensor_read(i, &t);
+#endif
 		if (rv != EC_SUCCESS)
 			continue;
 		else
@@ -6,6 +6,7 @@
 #include "common.h"
 #include "console.h"
 #include "event_log.h"
+#include "event_store.h"
 #include "hooks.h"
 #include "task.h"
 #include "timer.h"
@@ -87,6 +88,12 @@ void log_add_event(uint8_t type, uint8_t size, uint16_t data,
 	/* mark the entry available in the queue if nobody is behind us */
 	if (current_tail == log_tail)
 		log_tail = log_tail_next;
+
+	if (IS_ENABLED(CONFIG_EVENT_STORE))
+		event_store_add(EVENT_STORE_EVENT_LOG,
+				data | (uint32_t)type << 16 |
+				(uint32_t)(size & ~EVENT_LOG_SIZE_MASK) << 24,
+				payload, payload_size);
 }
 
 int log_dequeue_event(struct event_log_entry *r)
@@ -0,0 +1,312 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Compact structured event store */
+
+#include "common.h"
+#include "console.h"
+#include "event_store.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "link_defs.h"
+#include "system.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+#define STORE_SIZE CONFIG_EVENT_STORE_SIZE
+#define STORE_MASK (STORE_SIZE - 1)
+BUILD_ASSERT(POWER_OF_TWO(STORE_SIZE));
+BUILD_ASSERT(STORE_SIZE >= 4 * EVENT_STORE_RECORD_MAX);
+
+#define STORE_MAGIC 0x45565354 /* "EVST" */
+
+/*
+ * "es_head" is the offset of the oldest record, "es_tail" the offset past the
+ * newest one. Both only ever increase, and are masked when indexing es_buf.
+ * When a new record does not fit, the oldest records are discarded.
+ *
+ * Writers can run in interrupt context, so all the accesses to the ring are
+ * done with interrupts disabled. Records are small, so this stays short.
+ */
+static uint8_t es_buf[STORE_SIZE] __preserved_logs(es_buf);
+static uint32_t es_head __preserved_logs(es_head);
+static uint32_t es_tail __preserved_logs(es_tail);
+static uint32_t es_checksum __preserved_logs(es_checksum);
+/* Time preceding the oldest record, so its delta can be made absolute */
+static uint32_t es_base_time __preserved_logs(es_base_time);
+
+/* Time of the newest record, in EVENT_STORE_TIME_SHIFT units */
+static uint32_t es_last_time;
+static int es_ready;
+
+static uint32_t es_calc_checksum(void)
+{
+	return es_head ^ es_tail ^ es_base_time ^ STORE_MAGIC;
+}
+
+static void es_copy_out(uint32_t offset, uint8_t *buf, int len)
+{
+	int first = MIN(len, STORE_SIZE - (offset & STORE_MASK));
+
+	memcpy(buf, es_buf + (offset & STORE_MASK), first);
+	memcpy(buf + first, es_buf, len - first);
+}
+
+static void es_copy_in(uint32_t offset, const uint8_t *buf, int len)
+{
+	int first = MIN(len, STORE_SIZE - (offset & STORE_MASK));
+
+	memcpy(es_buf + (offset & STORE_MASK), buf, first);
+	memcpy(es_buf, buf + first, len - first);
+}
+
+/* Decode the record at offset, returns its length or 0 if it is invalid. */
+static int es_record_get(uint32_t offset, struct event_store_record *r)
+{
+	uint8_t raw[EVENT_STORE_RECORD_MAX];
+	int len = MIN(es_tail - offset, sizeof(raw));
+
+	es_copy_out(offset, raw, len);
+	return event_store_decode(raw, len, r);
+}
+
+static int varint_put(uint8_t *buf, uint32_t v)
+{
+	int n = 0;
+
+	while (v >= 0x80) {
+		buf[n++] = v | 0x80;
+		v >>= 7;
+	}
+	buf[n++] = v;
+
+	return n;
+}
+
+static int varint_get(const uint8_t *buf, int len, uint32_t *v)
+{
+	uint32_t r = 0;
+	int n;
+
+	for (n = 0; n < MIN(len, EVENT_STORE_VARINT_MAX); n++) {
+		r |= (uint32_t)(buf[n] & 0x7f) << (7 * n);
+		if (!(buf[n] & 0x80)) {
+			*v = r;
+			return n + 1;
+		}
+	}
+
+	return 0;
+}
+
+int event_store_decode(const uint8_t *buf, int len,
+		       struct event_store_record *r)
+{
+	int pos = 2;
+	int n;
+
+	if (len < pos)
+		return 0;
+
+	r->type = buf[0];
+	r->size = buf[1];
+	if (r->size > EVENT_STORE_MAX_PAYLOAD)
+		return 0;
+
+	n = varint_get(buf + pos, len - pos, &r->delta);
+	if (!n)
+		return 0;
+	pos += n;
+
+	n = varint_get(buf + pos, len - pos, &r->data);
+	if (!n)
+		return 0;
+	pos += n;
+
+	if (len - pos < r->size)
+		return 0;
+	memcpy(r->payload, buf + pos, r->size);
+
+	return pos + r->size;
+}
+
+void event_store_add(uint8_t type, uint32_t data, const void *payload,
+		     int size)
+{
+	uint8_t rec[EVENT_STORE_RECORD_MAX];
+	uint32_t now;
+	int len;
+
+	if (!es_ready)
+		return;
+
+	size = MIN(size, EVENT_STORE_MAX_PAYLOAD);
+
+	/* --- critical section : encode and append the record --- */
+	interrupt_disable();
+	now = get_time().val >> EVENT_STORE_TIME_SHIFT;
+
+	rec[0] = type;
+	rec[1] = size;
+	len = 2;
+	len += varint_put(rec + len, now - es_last_time);
+	len += varint_put(rec + len, data);
+	if (size)
+		memcpy(rec + len, payload, size);
+	len += size;
+
+	/* Out of space : discard the oldest records */
+	while (STORE_SIZE - (es_tail - es_head) < len) {
+		struct event_store_record r;
+		int oldest = es_record_get(es_head, &r);
+
+		if (!oldest) {
+			es_head = es_tail;
+			es_base_time = es_last_time;
+			break;
+		}
+		es_head += oldest;
+		if (r.type == EVENT_STORE_BOOT)
+			es_base_time = 0;
+		es_base_time += r.delta;
+	}
+
+	es_copy_in(es_tail, rec, len);
+	es_tail += len;
+	es_last_time = now;
+	es_checksum = es_calc_checksum();
+	interrupt_enable();
+	/* --- end of critical section --- */
+}
+
+int event_store_read(uint32_t *offset, uint8_t *buf, int len, uint32_t *end,
+		     uint32_t *base_time)
+{
+	int n;
+
+	interrupt_disable();
+	if ((int32_t)(*offset - es_head) < 0 ||
+	    (int32_t)(es_tail - *offset) < 0)
+		*offset = es_head;
+
+	n = MIN(len, es_tail - *offset);
+	es_copy_out(*offset, buf, n);
+	if (end)
+		*end = es_tail;
+	if (base_time)
+		*base_time = es_base_time;
+	interrupt_enable();
+
+	return n;
+}
+
+void event_store_clear(void)
+{
+	interrupt_disable();
+	es_head = es_tail;
+	es_base_time = es_last_time;
+	es_checksum = es_calc_checksum();
+	interrupt_enable();
+}
+
+static void event_store_init(void)
+{
+	uint8_t boot[2];
+	uint32_t offset;
+
+	/* Keep the records from before the reset or jump if they look sane */
+	if (es_checksum != es_calc_checksum() ||
+	    es_tail - es_head > STORE_SIZE) {
+		es_head = 0;
+		es_tail = 0;
+		es_base_time = 0;
+	} else {
+		for (offset = es_head; offset != es_tail;) {
+			struct event_store_record r;
+			int len = es_record_get(offset, &r);
+
+			if (!len) {
+				es_head = es_tail;
+				break;
+			}
+			offset += len;
+		}
+	}
+	es_checksum = es_calc_checksum();
+	es_ready = 1;
+
+	boot[0] = system_get_image_copy();
+	boot[1] = system_jumped_to_this_image();
+	event_store_add(EVENT_STORE_BOOT, system_get_reset_flags(),
+			boot, sizeof(boot));
+}
+DECLARE_HOOK(HOOK_INIT, event_store_init, HOOK_PRIO_FIRST);
+
+static enum ec_status
+event_store_cmd_read(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_event_store_read *p = args->params;
+	struct ec_response_event_store_read *r = args->response;
+	uint32_t offset = p->offset;
+	uint32_t end, base_time;
+	int n;
+
+	if (args->response_max < sizeof(*r))
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	/* Params and response may share the same buffer */
+	n = event_store_read(&offset, r->data,
+			     args->response_max - sizeof(*r), &end, &base_time);
+	r->offset = offset;
+	r->end = end;
+	r->base_time = base_time;
+	args->response_size = sizeof(*r) + n;
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_EVENT_STORE_READ,
+		     event_store_cmd_read,
+		     EC_VER_MASK(0));
+
+static int command_evstore(int argc, char **argv)
+{
+	uint8_t raw[EVENT_STORE_RECORD_MAX];
+	struct event_store_record r;
+	uint32_t offset = 0;
+	uint32_t end;
+	uint32_t time;
+	int n, i;
+
+	if (argc > 1) {
+		if (!strcasecmp(argv[1], "clear")) {
+			event_store_clear();
+			return EC_SUCCESS;
+		}
+		return EC_ERROR_PARAM1;
+	}
+
+	ccprintf("      TIME | TYPE |       DATA | PAYLOAD\n");
+	event_store_read(&offset, raw, 0, &end, &time);
+	while (offset != end) {
+		n = event_store_read(&offset, raw, sizeof(raw), &end, NULL);
+		n = event_store_decode(raw, n, &r);
+		if (!n)
+			break;
+		offset += n;
+
+		time = r.type == EVENT_STORE_BOOT ? r.delta : time + r.delta;
+		ccprintf("%10d   %4d   0x%08x   ", time, r.type, r.data);
+		for (i = 0; i < r.size; i++)
+			ccprintf("%02x", r.payload[i]);
+		ccprintf("\n");
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(evstore, command_evstore,
+			"[clear]",
+			"Display/clear the event store");
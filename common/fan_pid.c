@@ -0,0 +1,234 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Fixed-point PID fan speed control */
+
+#include "common.h"
+#include "console.h"
+#include "fan.h"
+#include "fan_pid.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+#define CPRINTS(format, args...) cprints(CC_THERMAL, format, ## args)
+
+#define DUTY_MAX (100 << FAN_PID_Q)
+
+const struct ec_fan_pid_params fan_pid_defaults = {
+	.kp = 1966,		/* 0.03 % per RPM */
+	.ki = 328,		/* 0.005 % per RPM * s */
+	.kd = 0,
+	.kff_load = 13107,	/* 0.2 % per % of load */
+	.slew_up = 1000,
+	.slew_down = 500,
+	.i_max = 40,
+};
+
+void fan_pid_init(struct fan_pid *pid)
+{
+	memset(pid, 0, sizeof(*pid));
+	pid->params = fan_pid_defaults;
+}
+
+int fan_pid_params_valid(const struct ec_fan_pid_params *p)
+{
+	return p->kp >= 0 && p->kp <= FAN_PID_GAIN_MAX &&
+	       p->ki >= 0 && p->ki <= FAN_PID_GAIN_MAX &&
+	       p->kd >= 0 && p->kd <= FAN_PID_GAIN_MAX &&
+	       p->kff_load >= 0 && p->kff_load <= FAN_PID_GAIN_MAX &&
+	       p->i_max <= 100;
+}
+
+int fan_pid_slew(struct fan_pid *pid, int target, int rpm, int dt_ms)
+{
+	const struct ec_fan_pid_params *p = &pid->params;
+	int sp = pid->setpoint;
+	int step;
+
+	/*
+	 * Off means off, as before the loop. Spinning up from off is loud
+	 * anyway, do not drag it out either.
+	 */
+	if (!sp || !target) {
+		pid->setpoint = target;
+		return target;
+	}
+
+	if (target > sp) {
+		sp = MAX(sp, MIN(rpm, target));
+		step = p->slew_up ? MAX(p->slew_up * dt_ms / 1000, 1) : target;
+		sp = MIN(target, sp + step);
+	} else if (target < sp) {
+		sp = MIN(sp, MAX(rpm, target));
+		step = p->slew_down ? MAX(p->slew_down * dt_ms / 1000, 1) : sp;
+		sp = MAX(target, sp - step);
+	}
+
+	pid->setpoint = sp;
+	return sp;
+}
+
+int fan_pid_update(struct fan_pid *pid, int rpm, int ff, int dt_ms)
+{
+	const struct ec_fan_pid_params *p = &pid->params;
+	int32_t i_max = p->i_max << FAN_PID_Q;
+	int err = pid->setpoint - rpm;
+	int64_t out, i_step;
+
+	if (!pid->setpoint) {
+		pid->integ = 0;
+		pid->saturated = 0;
+		pid->prev_rpm = rpm;
+		return 0;
+	}
+
+	/* Derivative on the measurement, so setpoint steps do not kick */
+	out = ((int64_t)ff << FAN_PID_Q) + (int64_t)p->kp * err + pid->integ -
+	      (int64_t)p->kd * (rpm - pid->prev_rpm) * 1000 / dt_ms;
+	pid->prev_rpm = rpm;
+
+	/* Do not wind up while the output is clipped */
+	i_step = (int64_t)p->ki * err * dt_ms / 1000;
+	pid->saturated = (out >= DUTY_MAX && i_step > 0) ||
+			 (out <= 0 && i_step < 0);
+	if (!pid->saturated) {
+		pid->integ = MIN(MAX(pid->integ + i_step, -i_max), i_max);
+		out += i_step;
+	}
+
+	out = MIN(MAX(out, 0), DUTY_MAX);
+	return (out + BIT(FAN_PID_Q - 1)) >> FAN_PID_Q;
+}
+
+#ifdef CONFIG_FANS
+static struct mutex fan_pid_lock;
+static struct fan_pid fan_pids[CONFIG_FANS];
+static int fan_pid_target[CONFIG_FANS];
+static int fan_pid_load;
+static int fan_pid_running;
+
+__overridable int board_fan_pid_feedforward(int fan, int rpm)
+{
+	return rpm * 100 / fans[fan].rpm->rpm_max;
+}
+
+static void fan_pid_loop(void);
+DECLARE_DEFERRED(fan_pid_loop);
+
+static void fan_pid_loop(void)
+{
+	int fan, rpm, sp, ff, duty;
+	int running = 0;
+
+	mutex_lock(&fan_pid_lock);
+	for (fan = 0; fan < fan_get_count(); fan++) {
+		struct fan_pid *pid = &fan_pids[fan];
+
+		/* The duty cycle was set by hand, leave it alone */
+		if (!fan_get_rpm_mode(FAN_CH(fan))) {
+			fan_pid_target[fan] = 0;
+			pid->setpoint = 0;
+			pid->integ = 0;
+			continue;
+		}
+
+		rpm = fan_get_rpm_actual(FAN_CH(fan));
+		sp = fan_pid_slew(pid, fan_pid_target[fan], rpm,
+				  CONFIG_FAN_PID_PERIOD_MS);
+		ff = 0;
+		if (sp)
+			ff = board_fan_pid_feedforward(fan, sp) +
+			     ((pid->params.kff_load * fan_pid_load) >>
+			      FAN_PID_Q);
+		duty = fan_pid_update(pid, rpm, ff, CONFIG_FAN_PID_PERIOD_MS);
+		fan_set_duty(FAN_CH(fan), duty);
+
+		running |= sp != 0;
+	}
+	fan_pid_running = running;
+	mutex_unlock(&fan_pid_lock);
+
+	if (running)
+		hook_call_deferred(&fan_pid_loop_data,
+				   CONFIG_FAN_PID_PERIOD_MS * MSEC);
+}
+
+void fan_pid_set_target(int fan, int rpm)
+{
+	if (fan < 0 || fan >= fan_get_count())
+		return;
+
+	mutex_lock(&fan_pid_lock);
+	fan_pid_target[fan] = rpm;
+	if (rpm && !fan_pid_running) {
+		fan_pid_running = 1;
+		hook_call_deferred(&fan_pid_loop_data, 0);
+	}
+	mutex_unlock(&fan_pid_lock);
+}
+
+void fan_pid_set_load(int load)
+{
+	fan_pid_load = MIN(MAX(load, 0), 100);
+}
+
+int fan_pid_saturated(int fan)
+{
+	if (fan < 0 || fan >= fan_get_count())
+		return 0;
+
+	return fan_pids[fan].saturated;
+}
+
+static void fan_pid_init_all(void)
+{
+	int fan;
+
+	for (fan = 0; fan < CONFIG_FANS; fan++)
+		fan_pid_init(&fan_pids[fan]);
+}
+DECLARE_HOOK(HOOK_INIT, fan_pid_init_all, HOOK_PRIO_INIT_FAN - 1);
+
+static enum ec_status hc_fan_pid(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_fan_pid *p = args->params;
+	struct ec_response_fan_pid *r = args->response;
+	struct ec_params_fan_pid params = *p;
+	struct fan_pid *pid;
+	int32_t i_max;
+
+	if (params.fan >= fan_get_count())
+		return EC_RES_INVALID_PARAM;
+	if ((params.flags & EC_FAN_PID_SET) &&
+	    !fan_pid_params_valid(&params.params))
+		return EC_RES_INVALID_PARAM;
+	pid = &fan_pids[params.fan];
+
+	/* Params and response share the same buffer */
+	mutex_lock(&fan_pid_lock);
+	if (params.flags & EC_FAN_PID_SET) {
+		pid->params = params.params;
+		i_max = pid->params.i_max << FAN_PID_Q;
+		pid->integ = MIN(MAX(pid->integ, -i_max), i_max);
+		CPRINTS("Fan %d PID kp %d ki %d kd %d", params.fan,
+			pid->params.kp, pid->params.ki, pid->params.kd);
+	}
+	r->params = pid->params;
+	r->target_rpm = fan_pid_target[params.fan];
+	r->setpoint_rpm = pid->setpoint;
+	mutex_unlock(&fan_pid_lock);
+
+	r->rpm = MAX(fan_get_rpm_actual(FAN_CH(params.fan)), 0);
+	r->duty = MAX(fan_get_duty(FAN_CH(params.fan)), 0);
+	r->load = fan_pid_load;
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FAN_PID, hc_fan_pid, EC_VER_MASK(0));
+#endif /* CONFIG_FANS */
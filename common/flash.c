@@ -13,8 +13,10 @@
 #include "host_command.h"
 #include "otp.h"
 #include "rwsig.h"
+#include "sha256.h"
 #include "shared_mem.h"
 #include "system.h"
+#include "timer.h"
 #include "util.h"
 #include "vboot_hash.h"
 
@@ -971,6 +973,74 @@ static void flash_erase_deferred(void)
 DECLARE_DEFERRED(flash_erase_deferred);
 #endif
 
+#ifdef CONFIG_FLASH_WRITE_STREAM
+/* Largest chunk that fits in a LPC host packet, in whole write blocks */
+#define STREAM_CHUNK_MAX ((EC_LPC_HOST_PACKET_SIZE - \
+			   sizeof(struct ec_host_request) - \
+			   sizeof(struct ec_params_flash_write_stream)) & \
+			  ~(CONFIG_FLASH_WRITE_SIZE - 1))
+#define STREAM_BUFS 2
+/* Bytes programmed per deferred call, so other hooks run in between */
+#define STREAM_STEP MAX(64, CONFIG_FLASH_WRITE_SIZE)
+
+/*
+ * The host command task fills stream_buf[stream_accepted % STREAM_BUFS] and
+ * the HOOK task programs stream_buf[stream_written % STREAM_BUFS]; each side
+ * only moves its own counter.
+ */
+static struct flash_stream_buf {
+	uint32_t offset;
+	uint32_t size;
+	uint8_t data[STREAM_CHUNK_MAX];
+} stream_buf[STREAM_BUFS];
+static volatile uint32_t stream_accepted;
+static volatile uint32_t stream_written;
+static volatile enum ec_status stream_rc = EC_RES_SUCCESS;
+static int stream_active;
+static struct sha256_ctx stream_ctx;
+/* Bytes of the oldest buffer already programmed */
+static uint32_t stream_pos;
+
+static void flash_stream_deferred(void);
+DECLARE_DEFERRED(flash_stream_deferred);
+
+/*
+ * Program STREAM_STEP bytes of the oldest buffer, then give the hook task back
+ * and carry on from a new deferred call.
+ */
+static void flash_stream_deferred(void)
+{
+	const struct flash_stream_buf *b;
+	uint8_t buf[STREAM_STEP];
+	uint32_t offset;
+	int n;
+
+	if (stream_written == stream_accepted)
+		return;
+
+	b = &stream_buf[stream_written % STREAM_BUFS];
+	offset = b->offset + stream_pos;
+	n = MIN(STREAM_STEP, b->size - stream_pos);
+
+	/* Hash what actually made it to flash */
+	if (stream_rc == EC_RES_SUCCESS &&
+	    (flash_write(offset, n, (const char *)b->data + stream_pos) ||
+	     flash_read(offset, n, (char *)buf)))
+		stream_rc = EC_RES_ERROR;
+	if (stream_rc == EC_RES_SUCCESS)
+		SHA256_update(&stream_ctx, buf, n);
+
+	stream_pos += n;
+	if (stream_pos >= b->size || stream_rc != EC_RES_SUCCESS) {
+		stream_pos = 0;
+		stream_written++;
+	}
+
+	if (stream_written != stream_accepted)
+		hook_call_deferred(&flash_stream_deferred_data, 0);
+}
+#endif
+
 /*****************************************************************************/
 /* Console commands */
 
@@ -1447,6 +1517,157 @@ DECLARE_HOST_COMMAND(EC_CMD_FLASH_ERASE, flash_command_erase,
 #endif
 		);
 
+#ifdef CONFIG_FLASH_WRITE_STREAM
+static enum ec_status flash_stream_queue(uint32_t offset, uint32_t size,
+					 const uint8_t *data)
+{
+	struct flash_stream_buf *b;
+
+	if (flash_get_protect() & EC_FLASH_PROTECT_ALL_NOW)
+		return EC_RES_ACCESS_DENIED;
+
+#ifdef CONFIG_INTERNAL_STORAGE
+	if (system_unsafe_to_overwrite(offset, size))
+		return EC_RES_ACCESS_DENIED;
+#endif
+
+	/*
+	 * Both buffers busy: do not hold up the host command task while the
+	 * oldest one is programmed, the host sends the same chunk again.
+	 */
+	if (stream_accepted - stream_written >= STREAM_BUFS)
+		return EC_RES_BUSY;
+
+	if (stream_rc != EC_RES_SUCCESS)
+		return stream_rc;
+
+	b = &stream_buf[stream_accepted % STREAM_BUFS];
+	b->offset = offset;
+	b->size = size;
+	memcpy(b->data, data, size);
+	stream_accepted++;
+	hook_call_deferred(&flash_stream_deferred_data, 0);
+
+	return EC_RES_SUCCESS;
+}
+
+static enum ec_status
+flash_command_write_stream(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_write_stream *p = args->params;
+	struct ec_response_flash_write_stream *r = args->response;
+	enum ec_status rc = EC_RES_SUCCESS;
+	uint8_t cmd = p->cmd;
+	uint32_t seq = p->seq;
+
+	if (args->params_size < sizeof(*p) ||
+	    p->size + sizeof(*p) > args->params_size ||
+	    args->response_max < sizeof(*r))
+		return EC_RES_INVALID_PARAM;
+
+	switch (cmd) {
+	case FLASH_WRITE_STREAM_START:
+		if (stream_written != stream_accepted)
+			return EC_RES_BUSY;
+		stream_accepted = 0;
+		stream_written = 0;
+		stream_rc = EC_RES_SUCCESS;
+		SHA256_init(&stream_ctx);
+		stream_active = 1;
+		break;
+	case FLASH_WRITE_STREAM_DATA:
+		if (!stream_active || seq > stream_accepted ||
+		    p->size > STREAM_CHUNK_MAX)
+			return EC_RES_INVALID_PARAM;
+		/* Resent after a lost response, already queued */
+		if (seq < stream_accepted)
+			break;
+		rc = flash_stream_queue(p->offset + EC_FLASH_REGION_START,
+					p->size, (const uint8_t *)(p + 1));
+		if (rc != EC_RES_SUCCESS)
+			return rc;
+		break;
+	case FLASH_WRITE_STREAM_FINISH:
+		if (!stream_active)
+			return EC_RES_INVALID_PARAM;
+		if (stream_written != stream_accepted)
+			return EC_RES_BUSY;
+		if (stream_rc == EC_RES_SUCCESS)
+			memcpy(r->sha256, SHA256_final(&stream_ctx),
+			       sizeof(r->sha256));
+		else
+			rc = stream_rc;
+		stream_active = 0;
+		break;
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+
+	/* Params and response share the same buffer, p is not valid below */
+	r->seq_accepted = stream_accepted;
+	r->seq_written = stream_written;
+	r->chunk_max = STREAM_CHUNK_MAX;
+	args->response_size = sizeof(*r);
+
+	return rc;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_WRITE_STREAM,
+		     flash_command_write_stream,
+		     EC_VER_MASK(0));
+#endif /* CONFIG_FLASH_WRITE_STREAM */
+
+#ifdef CONFIG_FLASH_SECTOR_HASH
+BUILD_ASSERT(EC_FLASH_SECTOR_HASH_SIZE == SHA256_DIGEST_SIZE);
+
+static enum ec_status
+flash_command_sector_hash(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_sector_hash *p = args->params;
+	struct ec_response_flash_sector_hash *r = args->response;
+	struct sha256_ctx ctx;
+	uint8_t buf[64];
+	uint32_t offset = p->offset;
+	uint32_t count = p->count;
+	int i, pos, n;
+
+	if (args->response_max < sizeof(*r))
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	if (offset % CONFIG_FLASH_ERASE_SIZE ||
+	    offset > CONFIG_FLASH_SIZE)
+		return EC_RES_INVALID_PARAM;
+
+	/* Params and response share the same buffer, p is not valid below */
+	count = MIN(count, (CONFIG_FLASH_SIZE - offset) /
+			   CONFIG_FLASH_ERASE_SIZE);
+	count = MIN(count, (args->response_max - sizeof(*r)) /
+			   SHA256_DIGEST_SIZE);
+	offset += EC_FLASH_REGION_START;
+
+	for (i = 0; i < count; i++) {
+		SHA256_init(&ctx);
+		for (pos = 0; pos < CONFIG_FLASH_ERASE_SIZE; pos += n) {
+			n = MIN(sizeof(buf), CONFIG_FLASH_ERASE_SIZE - pos);
+			if (flash_read(offset + pos, n, (char *)buf))
+				return EC_RES_ERROR;
+			SHA256_update(&ctx, buf, n);
+		}
+		memcpy(r->hash + i * SHA256_DIGEST_SIZE, SHA256_final(&ctx),
+		       SHA256_DIGEST_SIZE);
+		offset += CONFIG_FLASH_ERASE_SIZE;
+	}
+
+	r->sector_size = CONFIG_FLASH_ERASE_SIZE;
+	r->count = count;
+	args->response_size = sizeof(*r) + count * SHA256_DIGEST_SIZE;
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_SECTOR_HASH,
+		     flash_command_sector_hash,
+		     EC_VER_MASK(0));
+#endif /* CONFIG_FLASH_SECTOR_HASH */
+
 static enum ec_status flash_command_protect(struct host_cmd_handler_args *args)
 {
 	const struct ec_params_flash_protect *p = args->params;
@@ -67,6 +67,8 @@ static const struct hook_ptrs hook_list[] = {
 /* Times for deferrable functions */
 static int defer_new_call;
 static int hook_task_started;
+/* Deferred calls which ran early to share a wakeup */
+static uint32_t deferred_coalesced;
 
 #ifdef CONFIG_HOOK_DEBUG
 /* Stats for hooks */
@@ -144,7 +146,8 @@ void hook_notify(enum hook_type type)
 #endif
 }
 
-int hook_call_deferred(const struct deferred_data *data, int us)
+int hook_call_deferred_slack(const struct deferred_data *data, int us,
+			     int slack_us)
 {
 	int i = data - __deferred_funcs;
 
@@ -154,8 +157,10 @@ int hook_call_deferred(const struct deferred_data *data, int us)
 	if (us == -1) {
 		/* Cancel */
 		__deferred_until[i] = 0;
+		__deferred_slack[i] = 0;
 	} else {
 		/* Set alarm */
+		__deferred_slack[i] = MAX(slack_us, 0);
 		__deferred_until[i] = get_time().val + us;
 		/*
 		 * Flag that hook_call_deferred() has been called.  If the hook
@@ -172,6 +177,35 @@ int hook_call_deferred(const struct deferred_data *data, int us)
 	return EC_SUCCESS;
 }
 
+int hook_call_deferred(const struct deferred_data *data, int us)
+{
+	return hook_call_deferred_slack(data, us, 0);
+}
+
+uint32_t hook_deferred_coalesced(void)
+{
+	return deferred_coalesced;
+}
+
+const struct deferred_data *hook_next_deferred(uint64_t *until)
+{
+	int next = -1;
+	int i;
+
+	for (i = 0; i < DEFERRED_FUNCS_COUNT; i++) {
+		if (!__deferred_until[i])
+			continue;
+		if (next < 0 || __deferred_until[i] < __deferred_until[next])
+			next = i;
+	}
+
+	if (next < 0)
+		return NULL;
+	if (until)
+		*until = __deferred_until[next];
+	return __deferred_funcs + next;
+}
+
 void hook_task(void *u)
 {
 	/* Periodic hooks will be called first time through the loop */
@@ -189,6 +223,7 @@ void hook_task(void *u)
 	while (1) {
 		uint64_t t = get_time().val;
 		int next = 0;
+		int latest;
 		int i;
 
 		/* Handle deferred routines */
@@ -196,6 +231,10 @@ void hook_task(void *u)
 			if (__deferred_until[i] && __deferred_until[i] < t) {
 				CPRINTS("hook call deferred 0x%pP",
 					__deferred_funcs[i].routine);
+				/* Still within its slack, not its own wakeup */
+				if (t < __deferred_until[i] +
+					__deferred_slack[i])
+					deferred_coalesced++;
 				/*
 				 * Call deferred function.  Clear timer first,
 				 * so it can request itself be called later.
@@ -229,18 +268,30 @@ void hook_task(void *u)
 		t = get_time().val;
 		if (last_tick + HOOK_TICK_INTERVAL > t)
 			next = last_tick + HOOK_TICK_INTERVAL - t;
+		latest = next;
 
-		/* Wake earlier if needed by a deferred routine */
+		/*
+		 * Wake earlier if needed by a deferred routine. Any time from
+		 * the first routine being due until the first one runs out of
+		 * slack will do, and all the routines due by then run in the
+		 * same pass.
+		 */
 		defer_new_call = 0;
 
 		for (i = 0; i < DEFERRED_FUNCS_COUNT && next > 0; i++) {
 			if (!__deferred_until[i])
 				continue;
 
-			if (__deferred_until[i] < t)
+			if (__deferred_until[i] < t) {
 				next = 0;
-			else if (__deferred_until[i] - t < next)
+				continue;
+			}
+			if (__deferred_until[i] - t < next)
 				next = __deferred_until[i] - t;
+			if (__deferred_until[i] + __deferred_slack[i] - t <
+			    latest)
+				latest = __deferred_until[i] +
+					 __deferred_slack[i] - t;
 		}
 
 		/*
@@ -249,7 +300,7 @@ void hook_task(void *u)
 		 * until the next event.
 		 */
 		if (next > 0 && !defer_new_call)
-			task_wait_event(next);
+			task_wait_event_slack(next, latest - next);
 	}
 }
 
@@ -284,6 +335,9 @@ static int command_stats(int argc, char **argv)
 			 (uint32_t)max_hook_run_time[i],
 			 (uint32_t)avg_hook_run_time[i]);
 
+	ccprintf("Deferred wakeups saved by slack: %d\n",
+		 deferred_coalesced);
+
 	return EC_SUCCESS;
 }
 DECLARE_CONSOLE_COMMAND(hookstats, command_stats,
@@ -514,7 +514,7 @@ static enum ec_status host_command_read_test(struct host_cmd_handler_args *args)
 	int size = p->size / sizeof(uint32_t);
 	int i;
 
-	if (size > ARRAY_SIZE(r->data) || p->size > args->response_size)
+	if (size > ARRAY_SIZE(r->data) || p->size > args->response_max)
 		return EC_RES_ERROR;
 
 	for (i = 0; i < size; i++)
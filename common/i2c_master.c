@@ -47,6 +47,8 @@ static struct mutex port_mutex[I2C_CONTROLLER_COUNT + I2C_BITBANG_PORT_COUNT];
 /* A bitmap of the controllers which are currently servicing a request. */
 static uint32_t i2c_port_active_list;
 BUILD_ASSERT(ARRAY_SIZE(port_mutex) < 32);
+/* A bitmap of the controllers which have queued transfers. */
+static uint32_t i2c_async_busy_list;
 static uint8_t port_protected[I2C_PORT_COUNT + I2C_BITBANG_PORT_COUNT];
 
 /**
@@ -157,21 +159,195 @@ static int i2c_xfer_no_retry(const int port,
 }
 #endif /* CONFIG_I2C_XFER_LARGE_READ */
 
-int i2c_xfer_unlocked(const int port,
-		      const uint16_t slave_addr_flags,
-		      const uint8_t *out, int out_size,
-		      uint8_t *in, int in_size, int flags)
+#ifdef CONFIG_I2C_CACHE
+BUILD_ASSERT(CONFIG_I2C_CACHE_MAX_SIZE <= UINT8_MAX);
+
+static int i2c_cache_reg_bytes(const struct i2c_cache_reg *c)
+{
+	return (c->flags & I2C_CACHE_OFFSET16) ? 2 : 1;
+}
+
+/* Register at the start of out, addressed the way the device of c is */
+static int i2c_cache_reg_at(const struct i2c_cache_reg *c, const uint8_t *out)
+{
+	if (!(c->flags & I2C_CACHE_OFFSET16))
+		return out[0];
+	if (I2C_IS_ADDR16_LITTLE_ENDIAN(c->slave_addr_flags))
+		return out[0] | (out[1] << 8);
+	return (out[0] << 8) | out[1];
+}
+
+static int i2c_cache_is_device(const struct i2c_cache_reg *c, int port,
+			       uint16_t slave_addr_flags)
+{
+	return c->port == port &&
+	       I2C_GET_ADDR(c->slave_addr_flags) ==
+	       I2C_GET_ADDR(slave_addr_flags);
+}
+
+/* Entry for a register read of in_size bytes, or NULL */
+static struct i2c_cache_reg *i2c_cache_find(int port,
+					    uint16_t slave_addr_flags,
+					    const uint8_t *out, int out_size,
+					    int in_size)
+{
+	struct i2c_cache_reg *c;
+
+	for (c = i2c_cache_regs; c < i2c_cache_regs + i2c_cache_regs_used;
+	     c++)
+		if (i2c_cache_is_device(c, port, slave_addr_flags) &&
+		    out_size == i2c_cache_reg_bytes(c) &&
+		    in_size == c->size &&
+		    i2c_cache_reg_at(c, out) == c->reg)
+			return c;
+	return NULL;
+}
+
+/*
+ * Copy the value of c into in if it is still good.  On a miss, return the
+ * generation to give i2c_cache_fill() with the value read from the bus.
+ */
+static int i2c_cache_get(struct i2c_cache_reg *c, uint8_t *in, uint8_t *gen)
+{
+	int hit;
+
+	interrupt_disable();
+	hit = c->valid && (!c->ttl_us ||
+			   get_time().val - c->read_time < c->ttl_us);
+	if (hit) {
+		memcpy(in, c->data, c->size);
+		c->hits++;
+	} else {
+		c->misses++;
+		*gen = c->gen;
+	}
+	interrupt_enable();
+
+	return hit;
+}
+
+static void i2c_cache_fill(struct i2c_cache_reg *c, const uint8_t *data,
+			   uint8_t gen)
+{
+	interrupt_disable();
+	/* A write since the read may have changed the register */
+	if (c->gen == gen) {
+		memcpy(c->data, data, c->size);
+		c->read_time = get_time().val;
+		c->valid = 1;
+	}
+	interrupt_enable();
+}
+
+/*
+ * Answer a read from the cache.  On a miss, set c to the register to fill with
+ * the value read from the bus, if it is cached.
+ */
+static int i2c_cache_read(int port, uint16_t slave_addr_flags,
+			  const uint8_t *out, int out_size,
+			  uint8_t *in, int in_size,
+			  struct i2c_cache_reg **c, uint8_t *gen)
+{
+	*c = NULL;
+	if (!in_size || I2C_USE_PEC(slave_addr_flags))
+		return 0;
+
+	*c = i2c_cache_find(port, slave_addr_flags, out, out_size, in_size);
+	return *c && i2c_cache_get(*c, in, gen);
+}
+
+/*
+ * Keep what a write of the whole register put there, drop any other cached
+ * register the write touched.
+ */
+static void i2c_cache_write(int port, uint16_t slave_addr_flags,
+			    const uint8_t *out, int out_size, int flags, int rv)
+{
+	struct i2c_cache_reg *c;
+	int reg, len;
+
+	for (c = i2c_cache_regs; c < i2c_cache_regs + i2c_cache_regs_used;
+	     c++) {
+		if (!i2c_cache_is_device(c, port, slave_addr_flags) ||
+		    out_size <= i2c_cache_reg_bytes(c))
+			continue;
+		reg = i2c_cache_reg_at(c, out);
+		len = out_size - i2c_cache_reg_bytes(c);
+		if (reg + len <= c->reg || c->reg + c->size <= reg)
+			continue;
+
+		interrupt_disable();
+		c->gen++;
+		if (!rv && reg == c->reg && len == c->size &&
+		    (flags & I2C_XFER_STOP) &&
+		    !(c->flags & I2C_CACHE_WRITE_DROP)) {
+			memcpy(c->data, out + i2c_cache_reg_bytes(c), c->size);
+			c->read_time = get_time().val;
+			c->valid = 1;
+		} else {
+			c->valid = 0;
+		}
+		interrupt_enable();
+	}
+}
+
+void i2c_cache_invalidate(int port, uint16_t slave_addr_flags)
+{
+	struct i2c_cache_reg *c;
+
+	interrupt_disable();
+	for (c = i2c_cache_regs; c < i2c_cache_regs + i2c_cache_regs_used;
+	     c++) {
+		if (!i2c_cache_is_device(c, port, slave_addr_flags))
+			continue;
+		c->gen++;
+		c->valid = 0;
+	}
+	interrupt_enable();
+}
+
+static int command_i2c_cache(int argc, char **argv)
+{
+	struct i2c_cache_reg *c;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		interrupt_disable();
+		for (c = i2c_cache_regs;
+		     c < i2c_cache_regs + i2c_cache_regs_used; c++) {
+			c->hits = 0;
+			c->misses = 0;
+		}
+		interrupt_enable();
+		return EC_SUCCESS;
+	}
+
+	ccprintf("Port  Addr  Reg     Size  TTL ms  Valid      Hits    Misses\n");
+	for (c = i2c_cache_regs; c < i2c_cache_regs + i2c_cache_regs_used;
+	     c++)
+		ccprintf("%4d  0x%02x  0x%04x  %4d  %6d  %5d  %8d  %8d\n",
+			 c->port, I2C_GET_ADDR(c->slave_addr_flags), c->reg,
+			 c->size, c->ttl_us / MSEC, c->valid, c->hits,
+			 c->misses);
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(i2ccache, command_i2c_cache,
+			"[clear]",
+			"Print I2C register cache hits and misses");
+#endif /* CONFIG_I2C_CACHE */
+
+/* Transfer on the bus, with the port locked */
+static int i2c_xfer_bus(const int port,
+			const uint16_t slave_addr_flags,
+			const uint8_t *out, int out_size,
+			uint8_t *in, int in_size, int flags)
 {
 	int i;
 	int ret = EC_SUCCESS;
 
 	uint16_t addr_flags = slave_addr_flags & ~I2C_FLAG_PEC;
 
-	if (!i2c_port_is_locked(port)) {
-		CPUTS("Access I2C without lock!");
-		return EC_ERROR_INVAL;
-	}
-
 	for (i = 0; i <= CONFIG_I2C_NACK_RETRY_COUNT; i++) {
 #ifdef CONFIG_I2C_XFER_LARGE_READ
 		ret = i2c_xfer_no_retry(port, addr_flags,
@@ -185,22 +361,74 @@ int i2c_xfer_unlocked(const int port,
 		if (ret != EC_ERROR_BUSY)
 			break;
 	}
+
+#ifdef CONFIG_I2C_CACHE
+	/* A write starts with the register, then has the data */
+	if ((flags & I2C_XFER_START) && out_size && !in_size)
+		i2c_cache_write(port, addr_flags, out, out_size, flags, ret);
+#endif
 	return ret;
 }
 
+int i2c_xfer_unlocked(const int port,
+		      const uint16_t slave_addr_flags,
+		      const uint8_t *out, int out_size,
+		      uint8_t *in, int in_size, int flags)
+{
+	int rv;
+#ifdef CONFIG_I2C_CACHE
+	struct i2c_cache_reg *c = NULL;
+	uint8_t gen = 0;
+#endif
+
+	if (!i2c_port_is_locked(port)) {
+		CPUTS("Access I2C without lock!");
+		return EC_ERROR_INVAL;
+	}
+
+#ifdef CONFIG_I2C_CACHE
+	/* Parts of a split transfer never come from the cache */
+	if ((flags & I2C_XFER_SINGLE) == I2C_XFER_SINGLE &&
+	    i2c_cache_read(port, slave_addr_flags, out, out_size, in, in_size,
+			   &c, &gen))
+		return EC_SUCCESS;
+#endif
+
+	rv = i2c_xfer_bus(port, slave_addr_flags, out, out_size, in, in_size,
+			  flags);
+
+#ifdef CONFIG_I2C_CACHE
+	if (c && !rv)
+		i2c_cache_fill(c, in, gen);
+#endif
+	return rv;
+}
+
 int i2c_xfer(const int port,
 	     const uint16_t slave_addr_flags,
 	     const uint8_t *out, int out_size,
 	     uint8_t *in, int in_size)
 {
 	int rv;
+#ifdef CONFIG_I2C_CACHE
+	struct i2c_cache_reg *c = NULL;
+	uint8_t gen = 0;
+
+	/* A hit does not wait for the port lock */
+	if (i2c_cache_read(port, slave_addr_flags, out, out_size, in, in_size,
+			   &c, &gen))
+		return EC_SUCCESS;
+#endif
 
 	i2c_lock(port, 1);
-	rv = i2c_xfer_unlocked(port, slave_addr_flags,
-			       out, out_size, in, in_size,
-			       I2C_XFER_SINGLE);
+	rv = i2c_xfer_bus(port, slave_addr_flags, out, out_size, in, in_size,
+			  I2C_XFER_SINGLE);
 	i2c_lock(port, 0);
 
+#ifdef CONFIG_I2C_CACHE
+	if (c && !rv)
+		i2c_cache_fill(c, in, gen);
+#endif
 	return rv;
 }
 
@@ -229,7 +457,7 @@ void i2c_lock(int port, int lock)
 
 		i2c_port_active_list &= ~BIT(port);
 		/* Once there is no i2c port active, enable sleep bit of i2c. */
-		if (!i2c_port_active_list)
+		if (!i2c_port_active_list && !i2c_async_busy_list)
 			enable_sleep(SLEEP_MASK_I2C_MASTER);
 
 		interrupt_enable();
@@ -238,6 +466,107 @@ void i2c_lock(int port, int lock)
 	}
 }
 
+#ifdef CONFIG_I2C_ASYNC
+void i2c_async_set_busy(int controller, int busy)
+{
+	if (busy) {
+		i2c_async_busy_list |= BIT(controller);
+		disable_sleep(SLEEP_MASK_I2C_MASTER);
+	} else {
+		i2c_async_busy_list &= ~BIT(controller);
+		if (!i2c_port_active_list && !i2c_async_busy_list)
+			enable_sleep(SLEEP_MASK_I2C_MASTER);
+	}
+}
+
+void i2c_async_queue_init(struct i2c_async_queue *q)
+{
+	memset(q, 0, sizeof(*q));
+	q->open_task = TASK_ID_INVALID;
+}
+
+void i2c_async_push(struct i2c_async_queue *q, struct i2c_xfer_async *xfer)
+{
+	struct i2c_xfer_async **p;
+
+	xfer->busy = 1;
+	xfer->rv = EC_ERROR_BUSY;
+	xfer->next = NULL;
+
+	for (p = &q->queue; *p; p = &(*p)->next)
+		;
+	*p = xfer;
+	q->queued++;
+	q->depth++;
+	q->max_depth = MAX(q->max_depth, q->depth);
+}
+
+struct i2c_xfer_async *i2c_async_next(struct i2c_async_queue *q)
+{
+	struct i2c_xfer_async **p;
+	struct i2c_xfer_async *xfer;
+
+	for (p = &q->queue; *p; p = &(*p)->next) {
+		xfer = *p;
+		if (q->open_task != TASK_ID_INVALID &&
+		    xfer->task != q->open_task)
+			continue;
+		*p = xfer->next;
+		xfer->next = NULL;
+		q->running = xfer;
+		q->start_time = get_time().le.lo;
+		return xfer;
+	}
+	return NULL;
+}
+
+void i2c_async_requeue(struct i2c_async_queue *q)
+{
+	q->running->next = q->queue;
+	q->queue = q->running;
+	q->running = NULL;
+}
+
+void i2c_async_complete(struct i2c_async_queue *q, int rv)
+{
+	struct i2c_xfer_async *xfer = q->running;
+	void (*done)(struct i2c_xfer_async *xfer) = xfer->done;
+	int task = xfer->task;
+
+	q->running = NULL;
+	q->depth--;
+	q->done++;
+	q->busy_us += get_time().le.lo - q->start_time;
+	if (rv)
+		q->errors++;
+
+	if (rv || (xfer->flags & I2C_XFER_STOP))
+		q->open_task = TASK_ID_INVALID;
+	else
+		q->open_task = xfer->task;
+
+	/* The owner may reuse the descriptor from here on */
+	xfer->rv = rv;
+	xfer->busy = 0;
+	if (done)
+		done(xfer);
+	else if (task != TASK_ID_INVALID)
+		task_set_event(task, TASK_EVENT_I2C_DONE, 0);
+}
+
+void i2c_async_fail_queued(struct i2c_async_queue *q, int rv)
+{
+	/* Callbacks may queue more, those fail too */
+	while (q->queue) {
+		q->running = q->queue;
+		q->queue = q->running->next;
+		q->running->next = NULL;
+		q->start_time = get_time().le.lo;
+		i2c_async_complete(q, rv);
+	}
+}
+#endif
+
 void i2c_prepare_sysjump(void)
 {
 	int i;
@@ -67,8 +67,9 @@ enum scancode_set_list {
 #define KB_TO_HOST_RETRIES 5
 
 /*
- * Mutex to control write access to the to-host buffer head.  Don't need to
- * mutex the tail because reads are only done in one place.
+ * Mutex to control write access to the to-host buffer tail.  The head is
+ * advanced by the protocol task and, with CONFIG_8042_OBE_REFILL, by the
+ * output buffer empty interrupt; see i8042_put_next().
  */
 static struct mutex to_host_mutex;
 
@@ -83,7 +84,12 @@ struct data_byte {
 	uint8_t byte;
 };
 
-static struct queue const to_host = QUEUE_NULL(16, struct data_byte);
+BUILD_ASSERT(POWER_OF_TWO(CONFIG_8042_TO_HOST_SIZE));
+static struct queue const to_host = QUEUE_NULL(CONFIG_8042_TO_HOST_SIZE,
+					       struct data_byte);
+
+/* to_host statistics, updated with to_host_mutex held except isr_refills */
+static struct kb_to_host_stats to_host_stats;
 
 /* Queue command/data from the host */
 enum {
@@ -282,6 +288,10 @@ static void i8042_send_to_host(int len, const uint8_t *bytes,
 			data.byte = bytes[i];
 			queue_add_unit(&to_host, &data);
 		}
+		to_host_stats.high_water = MAX(to_host_stats.high_water,
+					       queue_count(&to_host));
+	} else {
+		to_host_stats.dropped += len;
 	}
 	mutex_unlock(&to_host_mutex);
 
@@ -357,7 +367,11 @@ static enum ec_error_list matrix_callback(int8_t row, int8_t col,
 	if (row >= KEYBOARD_ROWS || col >= keyboard_cols)
 		return EC_ERROR_INVAL;
 
+#ifdef CONFIG_KEYBOARD_SCANCODE_LOOKUP
+	make_code = keyboard_scancode_lookup(row, col, pressed);
+#else
 	make_code = get_scancode_set2(row, col);
+#endif
 
 #ifdef CONFIG_KEYBOARD_SCANCODE_CALLBACK
 	{
@@ -406,7 +420,9 @@ void keyboard_clear_buffer(void)
 	CPRINTS("KB Clear Buffer");
 	mutex_lock(&to_host_mutex);
 	kblog_put('x', queue_count(&to_host));
+	interrupt_disable();
 	queue_init(&to_host);
+	interrupt_enable();
 	mutex_unlock(&to_host_mutex);
 	lpc_keyboard_clear_buffer();
 }
@@ -892,6 +908,59 @@ static void i8042_handle_from_host(void)
 	}
 }
 
+/**
+ * Write the next queued byte to the host, if the host read the previous one.
+ *
+ * The protocol task and the output buffer empty interrupt may both call this,
+ * so the queue head is only moved with interrupts disabled.
+ *
+ * @param entry		Filled with the byte sent
+ * @return 1 if a byte was sent, 0 if there was nothing to send or the output
+ * buffer is still full.
+ */
+static int i8042_put_next(struct data_byte *entry)
+{
+	int sent = 0;
+
+	interrupt_disable();
+	if (!lpc_keyboard_has_char() && queue_remove_unit(&to_host, entry)) {
+		if (entry->chan == CHAN_AUX && IS_ENABLED(CONFIG_8042_AUX))
+			lpc_aux_put_char(entry->byte, i8042_aux_irq_enabled);
+		else
+			lpc_keyboard_put_char(entry->byte,
+					      i8042_keyboard_irq_enabled);
+		sent = 1;
+	}
+	interrupt_enable();
+
+	return sent;
+}
+
+#ifdef CONFIG_8042_OBE_REFILL
+int keyboard_host_read_done(void)
+{
+	struct data_byte entry;
+
+	/* kblog is not interrupt safe, count the refills instead */
+	if (i8042_put_next(&entry)) {
+		to_host_stats.isr_refills++;
+		return 1;
+	}
+
+	/* Nothing left for the task to do once the queue is drained */
+	return queue_is_empty(&to_host);
+}
+#endif
+
+void keyboard_get_to_host_stats(struct kb_to_host_stats *stats, int clear)
+{
+	mutex_lock(&to_host_mutex);
+	*stats = to_host_stats;
+	if (clear)
+		memset(&to_host_stats, 0, sizeof(to_host_stats));
+	mutex_unlock(&to_host_mutex);
+}
+
 void keyboard_protocol_task(void *u)
 {
 	int wait = -1;
@@ -958,21 +1027,11 @@ void keyboard_protocol_task(void *u)
 				break;
 			}
 
-			/* Get a char from buffer. */
+			/* Move a char from buffer to host. */
 			kblog_put('n', to_host.state->head);
-			queue_remove_unit(&to_host, &entry);
-
-			/* Write to host. */
-			if (entry.chan == CHAN_AUX &&
-			    IS_ENABLED(CONFIG_8042_AUX)) {
-				kblog_put('A', entry.byte);
-				lpc_aux_put_char(entry.byte,
-						 i8042_aux_irq_enabled);
-			} else {
-				kblog_put('K', entry.byte);
-				lpc_keyboard_put_char(
-					entry.byte, i8042_keyboard_irq_enabled);
-			}
+			if (i8042_put_next(&entry))
+				kblog_put(entry.chan == CHAN_AUX ? 'A' : 'K',
+					  entry.byte);
 			retries = 0;
 		}
 	}
@@ -1258,6 +1317,9 @@ static int command_8042_internal(int argc, char **argv)
 	}
 	ccprintf("}\n");
 
+	ccprintf("to_host: size=%d high_water=%d dropped=%d isr_refills=%d\n",
+		 CONFIG_8042_TO_HOST_SIZE, to_host_stats.high_water,
+		 to_host_stats.dropped, to_host_stats.isr_refills);
 	ccprintf("to_host[]={");
 	for (i = 0; i < queue_count(&to_host); ++i) {
 		struct data_byte entry;
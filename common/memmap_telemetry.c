@@ -0,0 +1,301 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Telemetry snapshot at EC_MEMMAP_TELEMETRY */
+
+#include "battery.h"
+#include "charge_manager.h"
+#include "charge_state.h"
+#include "common.h"
+#include "ec_commands.h"
+#include "extpower.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "memmap_telemetry.h"
+#include "mkbp_event.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+BUILD_ASSERT(EC_MEMMAP_TELEMETRY + sizeof(struct ec_memmap_telemetry) <=
+	     EC_MEMMAP_NO_ACPI);
+BUILD_ASSERT(EC_TELEMETRY_TEMP_ENTRIES <= EC_TEMP_SENSOR_ENTRIES);
+
+/* Keep the compiler from moving memory accesses across the seq updates */
+#define telemetry_barrier() __asm__ __volatile__("" : : : "memory")
+
+__maybe_unused static uint16_t clamp_u16(int v)
+{
+	return MIN(MAX(v, 0), UINT16_MAX);
+}
+
+static void telemetry_fill(struct ec_memmap_telemetry *t)
+{
+#if defined(CONFIG_BATTERY) && defined(CONFIG_CHARGER)
+	const struct batt_params *batt = charger_current_battery_params();
+#endif
+
+	memset(t, 0, sizeof(*t));
+	t->version = EC_MEMMAP_TELEMETRY_VERSION;
+
+#ifdef CONFIG_EXTPOWER
+	if (extpower_is_present())
+		t->flags |= EC_TELEMETRY_AC_PRESENT;
+#endif
+
+#if defined(CONFIG_BATTERY) && defined(CONFIG_CHARGER)
+	if (batt->is_present == BP_YES)
+		t->flags |= EC_TELEMETRY_BATT_PRESENT;
+	if (batt->flags & BATT_FLAG_BAD_ANY)
+		t->flags |= EC_TELEMETRY_BATT_STALE;
+	t->batt_voltage = clamp_u16(batt->voltage);
+	t->batt_current = MIN(MAX(batt->current, INT16_MIN), INT16_MAX);
+	t->batt_remaining = clamp_u16(batt->remaining_capacity);
+	t->batt_full = clamp_u16(batt->full_capacity);
+	t->batt_temp = clamp_u16(batt->temperature);
+	t->batt_soc = MIN(MAX(batt->state_of_charge, 0), 100);
+	t->chg_voltage = clamp_u16(batt->desired_voltage);
+	t->chg_current = clamp_u16(batt->desired_current);
+#endif
+
+#ifdef CONFIG_CHARGE_MANAGER
+	/* Uninitialized values are negative and reported as 0 */
+	t->input_voltage = clamp_u16(charge_manager_get_charger_voltage());
+	t->input_current = clamp_u16(charge_manager_get_charger_current());
+#endif
+
+	/* Mirror the legacy areas, they are kept up to date by their owners */
+	memcpy(t->temp, host_get_memmap(EC_MEMMAP_TEMP_SENSOR),
+	       sizeof(t->temp));
+	memcpy(t->fan_rpm, host_get_memmap(EC_MEMMAP_FAN),
+	       sizeof(t->fan_rpm));
+
+	t->update_ms = get_time().val / MSEC;
+}
+
+#ifdef CONFIG_MEMMAP_TELEMETRY_EVENT
+/* Thresholds used when the host leaves them at 0 */
+static const struct ec_telemetry_subscription sub_default = {
+	.current_delta = 500,
+	.input_delta = 1000,
+	.fan_delta = 500,
+	.soc_delta = 1,
+	.temp_band = 5,
+};
+
+static struct mutex ev_lock;
+static struct ec_telemetry_subscription sub;
+/* Values of each field as of its last reported change */
+static struct ec_memmap_telemetry ev_base;
+static int ev_base_valid;
+/* Pending event, fields accumulate until the host fetches it */
+static struct ec_telemetry_event ev;
+static int ev_queued;
+static uint32_t ev_last_ms;
+
+static int delta(int a, int b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static int input_mw(const struct ec_memmap_telemetry *t)
+{
+	return (uint32_t)t->input_voltage * t->input_current / 1000;
+}
+
+/*
+ * Return the subscribed fields that moved past their threshold since they
+ * were last reported, and make their current values the new reference.
+ */
+static uint16_t telemetry_take_changes(const struct ec_memmap_telemetry *t)
+{
+	struct ec_memmap_telemetry *b = &ev_base;
+	uint16_t changed = 0;
+	int band = sub.temp_band;
+	int i;
+
+	if ((t->flags ^ b->flags) &
+	    (EC_TELEMETRY_AC_PRESENT | EC_TELEMETRY_BATT_PRESENT)) {
+		changed |= EC_TELEMETRY_EVENT_POWER;
+		b->flags = t->flags;
+	}
+	if (delta(t->batt_soc, b->batt_soc) >= sub.soc_delta) {
+		changed |= EC_TELEMETRY_EVENT_SOC;
+		b->batt_soc = t->batt_soc;
+	}
+	if (delta(t->batt_current, b->batt_current) >= sub.current_delta) {
+		changed |= EC_TELEMETRY_EVENT_BATT_CURRENT;
+		b->batt_current = t->batt_current;
+	}
+	if (delta(input_mw(t), input_mw(b)) >= sub.input_delta) {
+		changed |= EC_TELEMETRY_EVENT_INPUT;
+		b->input_voltage = t->input_voltage;
+		b->input_current = t->input_current;
+	}
+
+	for (i = 0; i < EC_TELEMETRY_TEMP_ENTRIES; i++) {
+		int now = t->temp[i], last = b->temp[i];
+
+		/* Going to or from an error value is always a change */
+		if (now >= EC_TEMP_SENSOR_NOT_CALIBRATED ||
+		    last >= EC_TEMP_SENSOR_NOT_CALIBRATED ?
+		    now != last :
+		    (now + EC_TEMP_SENSOR_OFFSET) / band !=
+		    (last + EC_TEMP_SENSOR_OFFSET) / band) {
+			changed |= EC_TELEMETRY_EVENT_TEMP;
+			b->temp[i] = now;
+		}
+	}
+
+	for (i = 0; i < EC_TELEMETRY_FAN_ENTRIES; i++) {
+		int now = t->fan_rpm[i], last = b->fan_rpm[i];
+
+		if (now >= EC_FAN_SPEED_STALLED || last >= EC_FAN_SPEED_STALLED ?
+		    now != last : delta(now, last) >= sub.fan_delta) {
+			changed |= EC_TELEMETRY_EVENT_FAN;
+			b->fan_rpm[i] = now;
+		}
+	}
+
+	return changed & sub.fields;
+}
+
+static void telemetry_event_fill(const struct ec_memmap_telemetry *t)
+{
+	int i;
+
+	ev.seq = t->seq;
+	ev.flags = t->flags;
+	ev.batt_soc = t->batt_soc;
+	ev.batt_current = t->batt_current;
+	ev.input_power = input_mw(t) / 100;
+
+	ev.temp_max = EC_TEMP_SENSOR_NOT_PRESENT;
+	ev.temp_max_id = 0xff;
+	for (i = 0; i < EC_TELEMETRY_TEMP_ENTRIES; i++) {
+		if (t->temp[i] >= EC_TEMP_SENSOR_NOT_CALIBRATED)
+			continue;
+		if (ev.temp_max_id == 0xff || t->temp[i] > ev.temp_max) {
+			ev.temp_max = t->temp[i];
+			ev.temp_max_id = i;
+		}
+	}
+
+	ev.fan_rpm_max = 0;
+	for (i = 0; i < EC_TELEMETRY_FAN_ENTRIES; i++)
+		if (t->fan_rpm[i] < EC_FAN_SPEED_STALLED)
+			ev.fan_rpm_max = MAX(ev.fan_rpm_max, t->fan_rpm[i]);
+}
+
+static void telemetry_check_events(const struct ec_memmap_telemetry *t)
+{
+	int send = 0;
+
+	mutex_lock(&ev_lock);
+	if (!sub.fields) {
+		mutex_unlock(&ev_lock);
+		return;
+	}
+
+	/* The first update after subscribing sets the reference values */
+	if (!ev_base_valid) {
+		ev_base = *t;
+		ev_base_valid = 1;
+	}
+
+	ev.fields |= telemetry_take_changes(t);
+	if (ev.fields) {
+		/* A queued event always carries the latest values */
+		telemetry_event_fill(t);
+		if (!ev_queued &&
+		    t->update_ms - ev_last_ms >= sub.min_interval_ms) {
+			ev_queued = 1;
+			ev_last_ms = t->update_ms;
+			send = 1;
+		}
+	}
+	mutex_unlock(&ev_lock);
+
+	if (send)
+		mkbp_send_event(EC_MKBP_EVENT_TELEMETRY);
+}
+
+static int telemetry_get_event(uint8_t *data)
+{
+	mutex_lock(&ev_lock);
+	memcpy(data, &ev, sizeof(ev));
+	ev.fields = 0;
+	ev_queued = 0;
+	mutex_unlock(&ev_lock);
+
+	return sizeof(ev);
+}
+DECLARE_EVENT_SOURCE(EC_MKBP_EVENT_TELEMETRY, telemetry_get_event);
+
+static enum ec_status
+telemetry_subscribe(struct host_cmd_handler_args *args)
+{
+	const struct ec_telemetry_subscription *p = args->params;
+	struct ec_telemetry_subscription *r = args->response;
+	struct ec_telemetry_subscription s = *p;
+
+	/* Fill in the defaults */
+	if (!s.current_delta)
+		s.current_delta = sub_default.current_delta;
+	if (!s.input_delta)
+		s.input_delta = sub_default.input_delta;
+	if (!s.fan_delta)
+		s.fan_delta = sub_default.fan_delta;
+	if (!s.soc_delta)
+		s.soc_delta = sub_default.soc_delta;
+	if (!s.temp_band)
+		s.temp_band = sub_default.temp_band;
+
+	mutex_lock(&ev_lock);
+	sub = s;
+	ev_base_valid = 0;
+	ev.fields = 0;
+	/* Earlier events do not hold back the first one */
+	ev_last_ms = get_time().val / MSEC - s.min_interval_ms;
+	mutex_unlock(&ev_lock);
+
+	/* Params and response share the same buffer */
+	*r = s;
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TELEMETRY_SUBSCRIBE, telemetry_subscribe,
+		     EC_VER_MASK(0));
+#endif /* CONFIG_MEMMAP_TELEMETRY_EVENT */
+
+void memmap_telemetry_update(void)
+{
+	struct ec_memmap_telemetry *t = (struct ec_memmap_telemetry *)
+		host_get_memmap(EC_MEMMAP_TELEMETRY);
+	volatile uint16_t *seq = &t->seq;
+	struct ec_memmap_telemetry snap;
+	uint16_t next = (*seq + 1) | 1;
+
+	/* Gather everything first so seq stays odd as briefly as possible */
+	telemetry_fill(&snap);
+
+	*seq = next;
+	telemetry_barrier();
+	memcpy((uint8_t *)t + sizeof(t->seq),
+	       (uint8_t *)&snap + sizeof(snap.seq),
+	       sizeof(snap) - sizeof(snap.seq));
+	telemetry_barrier();
+	*seq = next + 1;
+
+#ifdef CONFIG_MEMMAP_TELEMETRY_EVENT
+	snap.seq = next + 1;
+	telemetry_check_events(&snap);
+#endif
+}
+DECLARE_HOOK(HOOK_SECOND, memmap_telemetry_update,
+	     HOOK_PRIO_TEMP_SENSOR_DONE + 1);
+/* Report AC changes right away rather than on the next second */
+DECLARE_HOOK(HOOK_AC_CHANGE, memmap_telemetry_update, HOOK_PRIO_LAST);
@@ -42,6 +42,65 @@ static int ge_mod(const struct rsa_public_key *key, const uint32_t *a)
 	return 1;  /* equal */
 }
 
+#ifdef CONFIG_RSA_OPTIMIZED
+/**
+ * {hi, lo} = a * b + lo + hi
+ *
+ * The result always fits in 64 bits. On cores with the DSP extension this is
+ * a single UMAAL instruction, which keeps both carries in registers.
+ */
+static inline void umaal32(uint32_t *lo, uint32_t *hi,
+			   const uint32_t a, const uint32_t b)
+{
+#ifdef __ARM_FEATURE_DSP
+	__asm__ ("umaal %0, %1, %2, %3"
+		 : "+r" (*lo), "+r" (*hi)
+		 : "r" (a), "r" (b));
+#else
+	uint64_t r = (uint64_t)a * b + *lo + *hi;
+
+	*lo = (uint32_t)r;
+	*hi = (uint32_t)(r >> 32);
+#endif
+}
+
+/**
+ * Montgomery c[] += a * b[] / R % mod
+ *
+ * Same algorithm as the reference implementation below, with the two 64-bit
+ * accumulators split into 32-bit carries so that each step of the inner loop
+ * is a single multiply-accumulate-accumulate.
+ */
+static void mont_mul_add(const struct rsa_public_key *key,
+			 uint32_t *c,
+			 const uint32_t a,
+			 const uint32_t *b)
+{
+	uint32_t acarry = 0;
+	uint32_t bcarry = 0;
+	uint32_t d0;
+	uint32_t t;
+	uint32_t i;
+
+	t = c[0];
+	umaal32(&t, &acarry, a, b[0]);
+	d0 = t * key->n0inv;
+	umaal32(&t, &bcarry, d0, key->n[0]);
+
+	for (i = 1; i < RSANUMWORDS; ++i) {
+		t = c[i];
+		umaal32(&t, &acarry, a, b[i]);
+		umaal32(&t, &bcarry, d0, key->n[i]);
+		c[i - 1] = t;
+	}
+
+	t = acarry + bcarry;
+	c[i - 1] = t;
+
+	if (t < acarry)
+		sub_mod(key, c);
+}
+#else
 /**
  * Montgomery c[] += a * b[] / R % mod
  */
@@ -68,6 +127,7 @@ static void mont_mul_add(const struct rsa_public_key *key,
 	if (A >> 32)
 		sub_mod(key, c);
 }
+#endif /* CONFIG_RSA_OPTIMIZED */
 
 #ifdef CONFIG_RSA_EXPONENT_3
 /**
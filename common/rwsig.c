@@ -10,6 +10,7 @@
 #include "console.h"
 #include "ec_commands.h"
 #include "flash.h"
+#include "hooks.h"
 #include "host_command.h"
 #include "rollback.h"
 #include "rsa.h"
@@ -18,6 +19,7 @@
 #include "shared_mem.h"
 #include "system.h"
 #include "task.h"
+#include "timer.h"
 #include "usb_pd.h"
 #include "util.h"
 #include "vb21_struct.h"
@@ -36,6 +38,11 @@
 static uint32_t * const rw_rst =
 	(uint32_t *)(CONFIG_PROGRAM_MEMORY_BASE + CONFIG_RW_MEM_OFF + 4);
 
+/* Timing of the last verification, carried over from RO to RW */
+static struct ec_response_rwsig_verify_time verify_time;
+
+#define RWSIG_SYSJUMP_TAG 0x5256 /* "RV" */
+#define RWSIG_HOOK_VERSION 1
 
 void rwsig_jump_now(void)
 {
@@ -102,6 +109,8 @@ int rwsig_check_signature(void)
 	const uint8_t *rwdata = (uint8_t *)CONFIG_PROGRAM_MEMORY_BASE
 					+ CONFIG_RW_MEM_OFF;
 	int good = 0;
+	uint32_t start = get_time().le.lo;
+	uint32_t t;
 
 	unsigned int rwlen;
 #ifdef CONFIG_RWSIG_TYPE_RWSIG
@@ -113,6 +122,10 @@ int rwsig_check_signature(void)
 	int32_t min_rollback_version;
 #endif
 
+	/* Steps skipped by an early exit must not report the last run */
+	verify_time.hash_us = 0;
+	verify_time.rsa_us = 0;
+
 	/* Check if we have a RW firmware flashed */
 	if (*rw_rst == 0xffffffff)
 		goto out;
@@ -186,11 +199,15 @@ int rwsig_check_signature(void)
 	}
 
 	/* SHA-256 Hash of the RW firmware */
+	t = get_time().le.lo;
 	SHA256_init(&ctx);
 	SHA256_update(&ctx, rwdata, rwlen);
 	hash = SHA256_final(&ctx);
+	verify_time.hash_us = get_time().le.lo - t;
 
+	t = get_time().le.lo;
 	good = rsa_verify(key, sig, hash, rsa_workbuf);
+	verify_time.rsa_us = get_time().le.lo - t;
 	if (!good)
 		goto out;
 
@@ -227,7 +244,12 @@ int rwsig_check_signature(void)
 	}
 #endif
 out:
-	CPRINTS("RW verify %s", good ? "OK" : "FAILED");
+	verify_time.end_us = get_time().le.lo;
+	verify_time.total_us = verify_time.end_us - start;
+	verify_time.flags = EC_RWSIG_VERIFY_TIME_VALID |
+		(good ? EC_RWSIG_VERIFY_TIME_GOOD : 0);
+	CPRINTS("RW verify %s (%u us)", good ? "OK" : "FAILED",
+		verify_time.total_us);
 
 	if (!good) {
 		pd_log_event(PD_EVENT_ACC_RW_FAIL, 0, 0, NULL);
@@ -241,6 +263,41 @@ out:
 	return good;
 }
 
+static void rwsig_preserve_verify_time(void)
+{
+	system_add_jump_tag(RWSIG_SYSJUMP_TAG, RWSIG_HOOK_VERSION,
+			    sizeof(verify_time), &verify_time);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, rwsig_preserve_verify_time, HOOK_PRIO_DEFAULT);
+
+static void rwsig_restore_verify_time(void)
+{
+	const struct ec_response_rwsig_verify_time *prev;
+	int version, size;
+
+	prev = (const struct ec_response_rwsig_verify_time *)
+		system_get_jump_tag(RWSIG_SYSJUMP_TAG, &version, &size);
+
+	if (prev && version == RWSIG_HOOK_VERSION &&
+	    size == sizeof(verify_time))
+		verify_time = *prev;
+}
+DECLARE_HOOK(HOOK_INIT, rwsig_restore_verify_time, HOOK_PRIO_DEFAULT);
+
+static enum ec_status
+rwsig_cmd_verify_time(struct host_cmd_handler_args *args)
+{
+	struct ec_response_rwsig_verify_time *r = args->response;
+
+	*r = verify_time;
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_RWSIG_VERIFY_TIME,
+		     rwsig_cmd_verify_time,
+		     EC_VER_MASK(0));
+
 #ifdef HAS_TASK_RWSIG
 #define TASK_EVENT_ABORT TASK_EVENT_CUSTOM_BIT(0)
 #define TASK_EVENT_CONTINUE TASK_EVENT_CUSTOM_BIT(1)
@@ -5,6 +5,7 @@
 
 /* Temperature sensor module for Chrome EC */
 
+#include "adc.h"
 #include "common.h"
 #include "console.h"
 #include "hooks.h"
@@ -26,10 +27,85 @@ int temp_sensor_read(enum temp_sensor_id id, int *temp_ptr)
 	return sensor->read(sensor->idx, temp_ptr);
 }
 
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+/* The memory map is updated once a second, any pass within that will do */
+#define MEMMAP_MAX_AGE_US	SECOND
+/* Same for the console, it shows what the host sees */
+#define DIAG_MAX_AGE_US		SECOND
+
+static struct mutex snapshot_lock;
+static struct temp_sensor_snapshot snapshot;
+static struct temp_sensor_snapshot_stats snapshot_stats;
+
+static void temp_sensor_read_all(void)
+{
+	uint32_t pass_us;
+	int i;
+#ifdef CONFIG_ADC_SCAN
+	int scan;
+#endif
+
+	snapshot.time = get_time();
+
+#ifdef CONFIG_ADC_SCAN
+	/* One conversion for all the thermistors, instead of one each */
+	scan = adc_scan_begin() == EC_SUCCESS;
+#endif
+	for (i = 0; i < TEMP_SENSOR_COUNT; i++)
+		snapshot.rv[i] = temp_sensor_read(i, &snapshot.temp[i]);
+#ifdef CONFIG_ADC_SCAN
+	if (scan)
+		adc_scan_end();
+#endif
+
+	pass_us = get_time().val - snapshot.time.val;
+	snapshot_stats.passes++;
+	snapshot_stats.pass_us_last = pass_us;
+	snapshot_stats.pass_us_max = MAX(snapshot_stats.pass_us_max, pass_us);
+}
+
+void temp_sensor_get_snapshot(struct temp_sensor_snapshot *snap,
+			      uint32_t max_age_us)
+{
+	uint64_t age;
+
+	mutex_lock(&snapshot_lock);
+	age = get_time().val - snapshot.time.val;
+	if (!snapshot_stats.passes || age > max_age_us) {
+		temp_sensor_read_all();
+		age = 0;
+	} else {
+		snapshot_stats.reuses++;
+		snapshot_stats.age_us_max = MAX(snapshot_stats.age_us_max,
+						(uint32_t)age);
+	}
+	*snap = snapshot;
+	mutex_unlock(&snapshot_lock);
+}
+
+void temp_sensor_get_snapshot_stats(struct temp_sensor_snapshot_stats *stats,
+				    int clear)
+{
+	mutex_lock(&snapshot_lock);
+	*stats = snapshot_stats;
+	if (clear) {
+		/* Keep the pass count, it says whether there is a snapshot */
+		memset(&snapshot_stats, 0, sizeof(snapshot_stats));
+		snapshot_stats.passes = stats->passes;
+	}
+	mutex_unlock(&snapshot_lock);
+}
+#endif /* CONFIG_TEMP_SENSOR_SNAPSHOT */
+
 static void update_mapped_memory(void)
 {
-	int i, t;
+	int i, t, rv;
 	uint8_t *mptr = host_get_memmap(EC_MEMMAP_TEMP_SENSOR);
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+	struct temp_sensor_snapshot snap;
+
+	temp_sensor_get_snapshot(&snap, MEMMAP_MAX_AGE_US);
+#endif
 
 	for (i = 0; i < TEMP_SENSOR_COUNT; i++, mptr++) {
 		/*
@@ -42,7 +118,13 @@ static void update_mapped_memory(void)
 			 EC_TEMP_SENSOR_B_ENTRIES)
 			break;
 
-		switch (temp_sensor_read(i, &t)) {
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+		rv = snap.rv[i];
+		t = snap.temp[i];
+#else
+		rv = temp_sensor_read(i, &t);
+#endif
+		switch (rv) {
 		case EC_ERROR_NOT_POWERED:
 			*mptr = EC_TEMP_SENSOR_NOT_POWERED;
 			break;
@@ -101,10 +183,23 @@ static int command_temps(int argc, char **argv)
 {
 	int t, i;
 	int rv, rv1 = EC_SUCCESS;
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+	struct temp_sensor_snapshot snap;
+
+	/* Show what the thermal loop sees, rather than reading the bus again */
+	temp_sensor_get_snapshot(&snap, DIAG_MAX_AGE_US);
+	ccprintf("Read %d ms ago\n",
+		 (int)((get_time().val - snap.time.val) / MSEC));
+#endif
 
 	for (i = 0; i < TEMP_SENSOR_COUNT; ++i) {
 		ccprintf("  %-20s: ", temp_sensors[i].name);
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+		rv = snap.rv[i];
+		t = snap.temp[i];
+#else
 		rv = temp_sensor_read(i, &t);
+#endif
 		if (rv)
 			rv1 = rv;
 
@@ -139,6 +234,24 @@ DECLARE_CONSOLE_COMMAND(temps, command_temps,
 			NULL,
 			"Print temp sensors");
 
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+static int command_tempsnap(int argc, char **argv)
+{
+	struct temp_sensor_snapshot_stats stats;
+
+	temp_sensor_get_snapshot_stats(&stats,
+				       argc > 1 && !strcasecmp(argv[1], "clear"));
+	ccprintf("passes %d, reused %d\n", stats.passes, stats.reuses);
+	ccprintf("pass time %d us, max %d us\n", stats.pass_us_last,
+		 stats.pass_us_max);
+	ccprintf("max age handed out %d us\n", stats.age_us_max);
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(tempsnap, command_tempsnap, "[clear]",
+			"Show temp sensor snapshot statistics");
+#endif
+
 /*****************************************************************************/
 /* Host commands */
 
@@ -11,12 +11,21 @@
 #include <stdlib.h>
 #endif
 
+#ifdef EMU_BUILD
+/* Benchmarks use the host clock and may read/write result files. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#endif
+
 #include "console.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "link_defs.h"
 #include "system.h"
 #include "task.h"
 #include "test_util.h"
+#include "timer.h"
 #include "util.h"
 
 struct test_util_tag {
@@ -173,6 +182,202 @@ uint32_t prng_no_seed(void)
 	return seed = prng(seed);
 }
 
+/*****************************************************************************/
+/* Microbenchmarks */
+
+/* Default allowed regression of the median against the baseline, in % */
+#define BENCHMARK_DEFAULT_MAX_REGRESSION 10
+
+static uint64_t benchmark_now_ns(void)
+{
+#ifdef EMU_BUILD
+	/*
+	 * The emulated get_time() only ticks when it is called, so use the
+	 * host monotonic clock instead.
+	 */
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * SECOND * 1000 + ts.tv_nsec;
+#else
+	return get_time().val * 1000;
+#endif
+}
+
+static void benchmark_sort(uint32_t *samples, int count)
+{
+	int i, j;
+
+	/* Insertion sort: sample counts are small and mostly ordered. */
+	for (i = 1; i < count; i++) {
+		uint32_t v = samples[i];
+
+		for (j = i; j > 0 && samples[j - 1] > v; j--)
+			samples[j] = samples[j - 1];
+		samples[j] = v;
+	}
+}
+
+void benchmark_run(const struct benchmark *bench,
+		   struct benchmark_result *result)
+{
+	static uint32_t samples[BENCHMARK_RUNS];
+	uint32_t iterations = MAX(bench->iterations, 1);
+	uint64_t start, elapsed;
+	uint32_t i;
+	int run;
+
+	for (run = 0; run < BENCHMARK_WARMUP_RUNS; run++)
+		for (i = 0; i < iterations; i++)
+			bench->routine();
+
+	for (run = 0; run < BENCHMARK_RUNS; run++) {
+		start = benchmark_now_ns();
+		for (i = 0; i < iterations; i++)
+			bench->routine();
+		elapsed = benchmark_now_ns() - start;
+		samples[run] = MIN(elapsed / iterations, (uint64_t)UINT32_MAX);
+	}
+
+	benchmark_sort(samples, BENCHMARK_RUNS);
+
+	result->name = bench->name;
+	result->iterations = iterations;
+	result->runs = BENCHMARK_RUNS;
+	result->min_ns = samples[0];
+	result->median_ns = samples[BENCHMARK_RUNS / 2];
+	result->p99_ns = samples[(BENCHMARK_RUNS * 99 + 99) / 100 - 1];
+	result->max_ns = samples[BENCHMARK_RUNS - 1];
+}
+
+#ifdef EMU_BUILD
+static void benchmark_write_json(const char *line)
+{
+	const char *path = getenv("BENCHMARK_JSON");
+	FILE *f;
+
+	if (!path)
+		return;
+
+	f = fopen(path, "a");
+	if (!f) {
+		ccprintf("Cannot open %s\n", path);
+		return;
+	}
+	fprintf(f, "%s\n", line);
+	fclose(f);
+}
+
+/*
+ * Look up the median of a benchmark in the baseline file.
+ *
+ * @return median in ns, or 0 if there is no baseline for this benchmark.
+ */
+static uint32_t benchmark_baseline_median(const char *name)
+{
+	const char *path = getenv("BENCHMARK_BASELINE");
+	char line[256];
+	char bname[64];
+	unsigned int median;
+	uint32_t found = 0;
+	FILE *f;
+
+	if (!path)
+		return 0;
+
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+
+	/* The last entry wins if the file holds several runs. */
+	while (fgets(line, sizeof(line), f)) {
+		const char *p;
+
+		if (sscanf(line, "{\"name\": \"%63[^\"]\"", bname) != 1 ||
+		    strncmp(bname, name, sizeof(bname)))
+			continue;
+		p = strstr(line, "\"median_ns\": ");
+		if (p && sscanf(p, "\"median_ns\": %u", &median) == 1)
+			found = median;
+	}
+	fclose(f);
+
+	return found;
+}
+
+static int benchmark_max_regression(void)
+{
+	const char *pct = getenv("BENCHMARK_MAX_REGRESSION");
+
+	return pct ? atoi(pct) : BENCHMARK_DEFAULT_MAX_REGRESSION;
+}
+
+/*
+ * Compare a result against the baseline.
+ *
+ * @return EC_SUCCESS if there is no baseline or the result is within bounds.
+ */
+static int benchmark_check_baseline(const struct benchmark_result *result)
+{
+	uint32_t baseline = benchmark_baseline_median(result->name);
+	int max_pct = benchmark_max_regression();
+	int delta_pct;
+
+	if (!baseline)
+		return EC_SUCCESS;
+
+	delta_pct = (int)(((int64_t)result->median_ns - baseline) * 100 /
+			  baseline);
+	ccprintf("  baseline %u ns, delta %d%%\n", baseline, delta_pct);
+	if (delta_pct > max_pct) {
+		ccprintf("  REGRESSION: %s median is %d%% slower (max %d%%)\n",
+			 result->name, delta_pct, max_pct);
+		return EC_ERROR_UNKNOWN;
+	}
+	return EC_SUCCESS;
+}
+
+int test_run_benchmarks(void)
+{
+	const struct benchmark *bench;
+	struct benchmark_result result;
+	char json[256];
+	int rv = EC_SUCCESS;
+
+	for (bench = __benchmarks; bench < __benchmarks_end; bench++) {
+		benchmark_run(bench, &result);
+
+		ccprintf("Benchmark %s: %u x %u calls, min %u ns, "
+			 "median %u ns, p99 %u ns, max %u ns\n",
+			 result.name, result.runs, result.iterations,
+			 result.min_ns, result.median_ns, result.p99_ns,
+			 result.max_ns);
+
+		snprintf(json, sizeof(json),
+			 "{\"name\": \"%s\", \"iterations\": %u, "
+			 "\"runs\": %u, \"min_ns\": %u, \"median_ns\": %u, "
+			 "\"p99_ns\": %u, \"max_ns\": %u}",
+			 result.name, result.iterations, result.runs,
+			 result.min_ns, result.median_ns, result.p99_ns,
+			 result.max_ns);
+		ccprintf("BENCHMARK_JSON %s\n", json);
+		benchmark_write_json(json);
+
+		if (benchmark_check_baseline(&result) != EC_SUCCESS)
+			rv = EC_ERROR_UNKNOWN;
+		cflush();
+	}
+
+	return rv;
+}
+#else
+int test_run_benchmarks(void)
+{
+	/* Only the emulator linker script collects BENCHMARK() entries. */
+	return EC_SUCCESS;
+}
+#endif /* EMU_BUILD */
+
 static void restore_state(void)
 {
 	const struct test_util_tag *tag;
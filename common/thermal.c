@@ -49,6 +49,11 @@ BUILD_ASSERT(EC_TEMP_THRESH_COUNT == 3);
 /* Keep track of which thresholds have triggered */
 static cond_t cond_hot[EC_TEMP_THRESH_COUNT];
 
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+/* Runs once a second, share the pass with DPTF and the memory map */
+#define THERMAL_MAX_AGE_US	(500 * MSEC)
+#endif
+
 static void thermal_control(void)
 {
 	int i, j, t, rv, f;
@@ -62,6 +67,11 @@ static void thermal_control(void)
 #ifdef CONFIG_CUSTOM_FAN_CONTROL
 	int temp[TEMP_SENSOR_COUNT];
 #endif
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+	struct temp_sensor_snapshot snap;
+
+	temp_sensor_get_snapshot(&snap, THERMAL_MAX_AGE_US);
+#endif
 
 	/* Get ready to count things */
 	memset(count_over, 0, sizeof(count_over));
@@ -75,7 +85,12 @@ static void thermal_control(void)
 	for (i = 0; i < TEMP_SENSOR_COUNT; ++i) {
 
 		/* read one */
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+		rv = snap.rv[i];
+		t = snap.temp[i];
+#else
 		rv = temp_sensor_read(i, &t);
+#endif
 
 #ifdef CONFIG_CUSTOM_FAN_CONTROL
 		/* Store all sensors value */
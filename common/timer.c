@@ -14,6 +14,7 @@
 #include "util.h"
 #include "task.h"
 #include "timer.h"
+#include "timer_private.h"
 #include "watchdog.h"
 
 #ifdef CONFIG_ZEPHYR
@@ -35,6 +36,11 @@ static uint32_t timer_running;
 static timestamp_t timer_deadline[TASK_ID_COUNT];
 static uint32_t next_deadline = 0xffffffff;
 
+/* How late each timer may expire, see task_wait_event_slack() */
+static uint32_t timer_slack[TASK_ID_COUNT];
+/* Timers which expired early to share a wakeup with another one */
+static uint32_t timer_coalesced;
+
 /* Hardware timer routine IRQ number */
 static int timer_irq;
 
@@ -72,19 +78,14 @@ void process_timers(int overflow)
 		now = get_time();
 		do {
 			/* read atomically the current state of timer running */
-			check_timer = running_t0 = timer_running;
+			running_t0 = timer_running;
+			check_timer = timer_scan(running_t0, timer_deadline,
+						 timer_slack, now, &next,
+						 &timer_coalesced);
 			while (check_timer) {
-
 				int tskid = __fls(check_timer);
-				/* timer has expired ? */
-				if (timer_deadline[tskid].val <= now.val)
-					expire_timer(tskid);
-				else if ((timer_deadline[tskid].le.hi ==
-					  now.le.hi) &&
-					 (timer_deadline[tskid].le.lo <
-					  next.le.lo))
-					next.val = timer_deadline[tskid].val;
 
+				expire_timer(tskid);
 				check_timer &= ~BIT(tskid);
 			}
 		/* if there is a new timer, let's retry */
@@ -135,6 +136,7 @@ int timer_arm(timestamp_t event, task_id_t tskid)
 	deprecated_atomic_or(&timer_running, BIT(tskid));
 
 	/* Modify the next event if needed */
+	event.val += timer_slack[tskid];
 	if ((event.le.hi < now.le.hi) ||
 	    ((event.le.hi == now.le.hi) && (event.le.lo <= next_deadline)))
 		task_trigger_irq(timer_irq);
@@ -245,6 +247,37 @@ void __hw_clock_source_set(uint32_t ts)
 }
 #endif /* CONFIG_HWTIMER_64BIT */
 
+uint32_t task_wait_event_slack(int timeout_us, int slack_us)
+{
+	task_id_t me = task_get_current();
+	uint32_t evt;
+
+	timer_slack[me] = MAX(slack_us, 0);
+	evt = task_wait_event(timeout_us);
+	timer_slack[me] = 0;
+
+	return evt;
+}
+
+task_id_t timer_next_task(timestamp_t *deadline)
+{
+	uint32_t running = timer_running;
+	task_id_t next = TASK_ID_INVALID;
+	int tskid;
+
+	for (tskid = 0; tskid < TASK_ID_COUNT; tskid++) {
+		if (!(running & BIT(tskid)))
+			continue;
+		if (next == TASK_ID_INVALID ||
+		    timer_deadline[tskid].val < timer_deadline[next].val)
+			next = tskid;
+	}
+
+	if (deadline && next != TASK_ID_INVALID)
+		*deadline = timer_deadline[next];
+	return next;
+}
+
 void timer_print_info(void)
 {
 	timestamp_t t = get_time();
@@ -263,9 +296,14 @@ void timer_print_info(void)
 			ccprintf("  Tsk %2d  0x%016llx -> %11.6lld\n", tskid,
 				 timer_deadline[tskid].val,
 				 timer_deadline[tskid].val - t.val);
+			if (timer_slack[tskid])
+				ccprintf("          slack %d us\n",
+					 timer_slack[tskid]);
 			cflush();
 		}
 	}
+
+	ccprintf("Wakeups saved by slack: %d\n", timer_coalesced);
 }
 
 void timer_init(void)
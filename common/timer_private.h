@@ -0,0 +1,61 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/** Internal header file for the timer module.
+ *
+ * EC code should not normally include this. These are exposed so they can be
+ * used by unit test code.
+ */
+
+#ifndef __CROS_EC_TIMER_PRIVATE_H
+#define __CROS_EC_TIMER_PRIVATE_H
+
+#include "common.h"
+#include "timer.h"
+#include "util.h"
+
+/**
+ * Find which of the running timers are due.
+ *
+ * A timer is due once its deadline passed, but only needs a wakeup at the end
+ * of its slack, so any timer expiring first takes it along.
+ *
+ * @param running	Bitmap of the running timers
+ * @param deadline	Deadline of each timer
+ * @param slack		How late each timer may expire, in us
+ * @param now		Current time
+ * @param next		Lowered to the next wakeup needed, if it is in the
+ *			same 2^32 us epoch as now
+ * @param coalesced	Incremented for each due timer still within its slack
+ * @return bitmap of the timers due
+ */
+static inline uint32_t timer_scan(uint32_t running,
+				  const timestamp_t *deadline,
+				  const uint32_t *slack, timestamp_t now,
+				  timestamp_t *next, uint32_t *coalesced)
+{
+	uint32_t due = 0;
+
+	while (running) {
+		int tskid = __fls(running);
+		timestamp_t latest = deadline[tskid];
+
+		latest.val += slack[tskid];
+		if (deadline[tskid].val <= now.val) {
+			if (now.val < latest.val)
+				(*coalesced)++;
+			due |= BIT(tskid);
+		} else if ((latest.le.hi == now.le.hi) &&
+			   (latest.le.lo < next->le.lo)) {
+			next->val = latest.val;
+		}
+
+		running &= ~BIT(tskid);
+	}
+
+	return due;
+}
+
+#endif /* __CROS_EC_TIMER_PRIVATE_H */
@@ -19,10 +19,13 @@
 #define ST_TICKINT             BIT(1)
 #define ST_CLKSOURCE           BIT(2)
 #define ST_COUNTFLAG           BIT(16)
+#define CPU_NVIC_ST_RELOAD     CPUREG(0xE000E014)
+#define CPU_NVIC_ST_CURRENT    CPUREG(0xE000E018)
 
 /* Nested Vectored Interrupt Controller */
 #define CPU_NVIC_EN(x)         CPUREG(0xe000e100 + 4 * (x))
 #define CPU_NVIC_DIS(x)        CPUREG(0xe000e180 + 4 * (x))
+#define CPU_NVIC_PEND(x)       CPUREG(0xe000e200 + 4 * (x))
 #define CPU_NVIC_UNPEND(x)     CPUREG(0xe000e280 + 4 * (x))
 #define CPU_NVIC_PRI(x)        CPUREG(0xe000e400 + 4 * (x))
 /* SCB AIRCR : Application interrupt and reset control register */
@@ -63,6 +66,15 @@ enum {
 	CPU_NVIC_SHCSR_USGFAULTENA	= BIT(18),
 };
 
+/* Debug Exception and Monitor Control Register */
+#define CPU_SCB_DEMCR          CPUREG(0xe000edfc)
+#define  CPU_SCB_DEMCR_TRCENA   BIT(24)           /* DWT and ITM enable */
+
+/* Data Watchpoint and Trace: cycle counter */
+#define CPU_DWT_CTRL           CPUREG(0xe0001000)
+#define  CPU_DWT_CTRL_CYCCNTENA BIT(0)
+#define CPU_DWT_CYCCNT         CPUREG(0xe0001004)
+
 /* System Control Block: cache registers */
 #define CPU_SCB_CCSIDR         CPUREG(0xe000ed80)
 #define CPU_SCB_CCSELR         CPUREG(0xe000ed84)
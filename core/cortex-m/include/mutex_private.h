@@ -0,0 +1,62 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/**
+ * @file
+ *
+ * @brief Private header file. Not meant to be used outside of task.c and tests.
+ */
+
+#ifndef __CROS_EC_MUTEX_PRIVATE_H
+#define __CROS_EC_MUTEX_PRIVATE_H
+
+#include "common.h"
+#include "task.h"
+#include "util.h"
+
+#ifdef CONFIG_MUTEX_PRIORITY_INHERITANCE
+/**
+ * Pick the next task to run with mutex priority inheritance.
+ *
+ * This is the highest priority ready task, unless a higher priority task waits
+ * on a mutex.  Then the owner of the mutex runs in its place, or the owner of
+ * the mutex that owner waits on, and so on.
+ *
+ * @param ready		Bitmap of the ready tasks, not empty
+ * @param blocked	Bitmap of the tasks waiting on a mutex, none ready
+ * @param blocked_on	Mutex each task in blocked waits on
+ * @return ID of the task to run
+ */
+static inline task_id_t mutex_pi_next_task(uint32_t ready, uint32_t blocked,
+					   struct mutex * const *blocked_on)
+{
+	uint32_t candidates = ready | blocked;
+
+	while (candidates) {
+		task_id_t top = __fls(candidates);
+		task_id_t id = top;
+		int depth;
+
+		if (!(blocked & BIT(top)))
+			return top;
+
+		/* Bounded, in case of a deadlock */
+		for (depth = 0; depth < 32 && (blocked & BIT(id)); depth++) {
+			const struct mutex *mtx = blocked_on[id];
+
+			id = mtx->lock ? mtx->owner : TASK_ID_IDLE;
+		}
+
+		/* The owner may be unknown yet, or waiting on something else */
+		if (id != TASK_ID_IDLE && (ready & BIT(id)))
+			return id;
+		candidates &= ~BIT(top);
+	}
+
+	return __fls(ready);
+}
+#endif
+
+#endif /* __CROS_EC_MUTEX_PRIVATE_H */
@@ -0,0 +1,163 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Statistical PC profiler */
+
+#include "atomic.h"
+#include "clock.h"
+#include "common.h"
+#include "console.h"
+#include "cpu.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "pc_profiler.h"
+#include "queue.h"
+#include "task.h"
+#include "util.h"
+
+#define CPRINTS(format, args...) cprints(CC_SYSTEM, format, ## args)
+
+static struct queue const samples =
+	QUEUE_NULL(CONFIG_PC_PROFILER_SAMPLES, struct ec_pc_sample);
+static uint32_t samples_dropped;
+static int sample_rate_hz;
+
+void __keep pc_profiler_sample(uint32_t excep_lr, uint32_t excep_sp)
+{
+	struct ec_pc_sample s;
+	uint32_t *frame;
+
+	/* The exception frame is on the stack we came from */
+	if (excep_lr & BIT(2))
+		asm("mrs %0, psp" : "=r"(frame));
+	else
+		frame = (uint32_t *)excep_sp;
+
+	s.pc = frame[6];
+	s.lr = frame[5];
+	s.exc = frame[7] & 0x1ff;
+	s.task = task_get_current();
+	s.reserved = 0;
+
+	/* Only this interrupt adds to the queue */
+	if (!queue_add_unit(&samples, &s))
+		samples_dropped++;
+}
+
+int pc_profiler_start(int rate_hz)
+{
+	int rv;
+
+	pc_profiler_timer_stop();
+	sample_rate_hz = 0;
+	queue_init(&samples);
+	samples_dropped = 0;
+
+	rv = pc_profiler_timer_start(rate_hz);
+	if (rv)
+		return rv;
+
+	sample_rate_hz = rate_hz;
+	CPRINTS("PC profiler at %d Hz", rate_hz);
+	return EC_SUCCESS;
+}
+
+void pc_profiler_stop(void)
+{
+	pc_profiler_timer_stop();
+	sample_rate_hz = 0;
+}
+
+#ifndef CONFIG_PC_PROFILER_HW_TIMER
+int pc_profiler_timer_start(int rate_hz)
+{
+	uint32_t reload;
+
+	if (rate_hz <= 0)
+		return EC_ERROR_INVAL;
+	/* The SysTick counter is 24-bit */
+	reload = clock_get_freq() / rate_hz - 1;
+	if (reload > 0xffffff)
+		return EC_ERROR_INVAL;
+
+	CPU_NVIC_ST_CTRL = 0;
+	CPU_NVIC_ST_RELOAD = reload;
+	CPU_NVIC_ST_CURRENT = 0;
+	CPU_NVIC_ST_CTRL = ST_CLKSOURCE | ST_TICKINT | ST_ENABLE;
+
+	return EC_SUCCESS;
+}
+
+void pc_profiler_timer_stop(void)
+{
+	CPU_NVIC_ST_CTRL = 0;
+}
+
+void sys_tick_handler(void) __keep __attribute__((naked));
+void sys_tick_handler(void)
+{
+	/* Naked call so we can extract raw LR and SP */
+	asm volatile("mov r0, lr\n"
+		     "mov r1, sp\n"
+		     "push {r0, lr}\n"
+		     "bl pc_profiler_sample\n"
+		     "pop {r0, lr}\n"
+		     "b task_resched_if_needed\n");
+}
+#endif /* !CONFIG_PC_PROFILER_HW_TIMER */
+
+static enum ec_status hc_pc_profile(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_pc_profile *p = args->params;
+	struct ec_response_pc_profile *r = args->response;
+	struct ec_params_pc_profile params = *p;
+
+	if (params.flags & EC_PC_PROFILE_STOP)
+		pc_profiler_stop();
+	if ((params.flags & EC_PC_PROFILE_START) &&
+	    pc_profiler_start(params.rate_hz))
+		return EC_RES_INVALID_PARAM;
+
+	/* Params and response share the same buffer */
+	memset(r, 0, sizeof(*r));
+	r->count = queue_remove_units(&samples, r->samples,
+				      EC_PC_PROFILE_PAGE);
+	r->rate_hz = sample_rate_hz;
+	r->dropped = deprecated_atomic_read_clear(&samples_dropped);
+	r->pending = queue_count(&samples);
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_PC_PROFILE, hc_pc_profile, EC_VER_MASK(0));
+
+static int command_pc_profile(int argc, char **argv)
+{
+	int rate_hz = 1000;
+	char *e;
+
+	if (argc > 1) {
+		if (!strcasecmp(argv[1], "stop")) {
+			pc_profiler_stop();
+		} else if (!strcasecmp(argv[1], "start")) {
+			if (argc > 2) {
+				rate_hz = strtoi(argv[2], &e, 0);
+				if (*e)
+					return EC_ERROR_PARAM2;
+			}
+			if (pc_profiler_start(rate_hz))
+				return EC_ERROR_PARAM2;
+		} else {
+			return EC_ERROR_PARAM1;
+		}
+	}
+
+	ccprintf("Rate %d Hz, %d samples pending, %d dropped\n",
+		 sample_rate_hz, queue_count(&samples), samples_dropped);
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(pcprof, command_pc_profile,
+			"[start [hz] | stop]",
+			"Start or stop the PC profiler");
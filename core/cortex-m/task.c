@@ -6,10 +6,13 @@
 /* Task scheduling / events module for Chrome EC operating system */
 
 #include "atomic.h"
+#include "clock.h"
 #include "common.h"
 #include "console.h"
 #include "cpu.h"
+#include "host_command.h"
 #include "link_defs.h"
+#include "mutex_private.h"
 #include "panic.h"
 #include "task.h"
 #include "timer.h"
@@ -63,6 +66,54 @@ static uint32_t task_switches;   /* Number of times active task changed */
 static uint32_t irq_dist[CONFIG_IRQ_COUNT];  /* Distribution of IRQ calls */
 #endif
 
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+#ifndef CONFIG_TASK_PROFILING
+#error "CONFIG_TASK_PROFILING_CYCLES requires CONFIG_TASK_PROFILING"
+#endif
+
+/* Deepest nesting of IRQ handlers timed, deeper ones are not */
+#define CYCLES_NEST_MAX 8
+
+struct cycle_stats {
+	uint64_t cycles;
+	uint32_t count;
+	uint32_t max;
+};
+
+/* Counters of the current window, see EC_CMD_TASK_PROFILE */
+static struct cycle_stats task_cycles[TASK_ID_COUNT];
+static struct cycle_stats irq_cycles[CONFIG_IRQ_COUNT];
+static uint32_t switch_reasons[EC_TASK_SWITCH_COUNT];
+static uint64_t cycles_window_start;
+
+/* Cycle counter at the same points as exc_start_time and exc_end_time */
+static uint32_t exc_start_cycle;
+static uint32_t exc_end_cycle;
+/* Cycles the current task ran since it was switched to */
+static uint32_t slice_cycles;
+
+/*
+ * Per nesting level: the handler, its entry, and time in handlers above it.
+ * Naked handlers which do not call task_start_irq_handler() are not timed.
+ */
+static int irq_depth;
+static int irq_nested[CYCLES_NEST_MAX];
+static uint32_t irq_enter_cycle[CYCLES_NEST_MAX];
+static uint32_t irq_inner_cycles[CYCLES_NEST_MAX];
+#endif
+
+#ifdef CONFIG_TASK_EVENT_LATENCY
+/* Tasks with an event from an interrupt they did not get yet */
+static uint32_t latency_pending;
+/* For the first such event: when, from which IRQ, and who it interrupted */
+static uint32_t latency_set_time[TASK_ID_COUNT];
+static uint16_t latency_set_irq[TASK_ID_COUNT];
+static uint8_t latency_interrupted[TASK_ID_COUNT];
+/* Task which ran last before each task was switched to */
+static uint8_t latency_ran_before[TASK_ID_COUNT];
+static struct ec_task_latency latency[TASK_ID_COUNT];
+#endif
+
 extern void __switchto(task_ *from, task_ *to);
 extern int __task_start(int *task_stack_ready);
 
@@ -212,6 +263,12 @@ static uint32_t tasks_enabled = BIT(TASK_ID_HOOKS) | BIT(TASK_ID_IDLE);
 
 static int start_called;  /* Has task swapping started */
 
+#ifdef CONFIG_MUTEX_PRIORITY_INHERITANCE
+/* Tasks waiting on a mutex, and the mutex each of them waits on */
+static uint32_t tasks_mutex_blocked;
+static struct mutex *mutex_blocked_on[TASK_ID_COUNT];
+#endif
+
 static inline task_ *__task_id_to_ptr(task_id_t id)
 {
 	return tasks + id;
@@ -235,7 +292,7 @@ inline int in_interrupt_context(void)
 	return ret;
 }
 
-#ifdef CONFIG_TASK_PROFILING
+#if defined(CONFIG_TASK_PROFILING) || defined(CONFIG_TASK_EVENT_LATENCY)
 static inline int get_interrupt_context(void)
 {
 	int ret;
@@ -274,6 +331,10 @@ void svc_handler(int desched, task_id_t resched)
 	int exc = get_interrupt_context();
 	uint32_t t;
 #endif
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	enum ec_task_switch_reason reason = EC_TASK_SWITCH_IRQ;
+	uint32_t run;
+#endif
 
 	/*
 	 * Push the priority to -1 until the return, to avoid being
@@ -289,6 +350,10 @@ void svc_handler(int desched, task_id_t resched)
 	 */
 	if (exc == 0xb) {
 		exc_start_time = get_time().le.lo;
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+		exc_start_cycle = CPU_DWT_CYCCNT;
+		reason = EC_TASK_SWITCH_WAKE;
+#endif
 		svc_calls++;
 	}
 #endif
@@ -311,12 +376,22 @@ void svc_handler(int desched, task_id_t resched)
 		 * task_get_current())
 		 */
 		tasks_ready &= ~(1 << (current - tasks));
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+		reason = EC_TASK_SWITCH_WAIT;
+#endif
 	}
 	ASSERT(resched <= TASK_ID_COUNT);
 	tasks_ready |= 1 << resched;
 
 	ASSERT(tasks_ready & tasks_enabled);
+#ifdef CONFIG_MUTEX_PRIORITY_INHERITANCE
+	next = __task_id_to_ptr(mutex_pi_next_task(
+		tasks_ready & tasks_enabled,
+		tasks_mutex_blocked & tasks_enabled & ~tasks_ready,
+		mutex_blocked_on));
+#else
 	next = __task_id_to_ptr(__fls(tasks_ready & tasks_enabled));
+#endif
 
 #ifdef CONFIG_TASK_PROFILING
 	/* Track time in interrupts */
@@ -329,6 +404,13 @@ void svc_handler(int desched, task_id_t resched)
 	 */
 	current->runtime += (exc_start_time - exc_end_time);
 	exc_end_time = t;
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	run = exc_start_cycle - exc_end_cycle;
+	exc_end_cycle = CPU_DWT_CYCCNT;
+	if (current != (task_ *)scratchpad)
+		task_cycles[current - tasks].cycles += run;
+	slice_cycles += run;
+#endif
 #else
 	/*
 	 * Don't chain here from interrupts until the next time an interrupt
@@ -344,6 +426,18 @@ void svc_handler(int desched, task_id_t resched)
 	/* Switch to new task */
 #ifdef CONFIG_TASK_PROFILING
 	task_switches++;
+#endif
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	if (current != (task_ *)scratchpad)
+		task_cycles[current - tasks].max =
+			MAX(task_cycles[current - tasks].max, slice_cycles);
+	task_cycles[next - tasks].count++;
+	slice_cycles = 0;
+	switch_reasons[reason]++;
+#endif
+#ifdef CONFIG_TASK_EVENT_LATENCY
+	if (current != (task_ *)scratchpad)
+		latency_ran_before[next - tasks] = current - tasks;
 #endif
 	current_task = next;
 	__switchto(current, next);
@@ -357,6 +451,46 @@ void __schedule(int desched, int resched)
 	asm("svc 0"::"r"(p0),"r"(p1));
 }
 
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+static void irq_cycles_enter(int irq)
+{
+	interrupt_disable();
+	if (irq_depth < CYCLES_NEST_MAX) {
+		irq_nested[irq_depth] = irq;
+		irq_enter_cycle[irq_depth] = CPU_DWT_CYCCNT;
+		irq_inner_cycles[irq_depth] = 0;
+	}
+	irq_depth++;
+	interrupt_enable();
+}
+
+static void irq_cycles_exit(void)
+{
+	int irq = get_interrupt_context() - 16;
+	uint32_t total, own;
+
+	interrupt_disable();
+	if (!irq_depth || (irq_depth <= CYCLES_NEST_MAX &&
+			   irq_nested[irq_depth - 1] != irq)) {
+		interrupt_enable();
+		return;
+	}
+	irq_depth--;
+	if (irq_depth < CYCLES_NEST_MAX) {
+		total = CPU_DWT_CYCCNT - irq_enter_cycle[irq_depth];
+		own = total - irq_inner_cycles[irq_depth];
+		if (irq_depth)
+			irq_inner_cycles[irq_depth - 1] += total;
+		if (irq >= 0 && irq < ARRAY_SIZE(irq_cycles)) {
+			irq_cycles[irq].cycles += own;
+			irq_cycles[irq].count++;
+			irq_cycles[irq].max = MAX(irq_cycles[irq].max, own);
+		}
+	}
+	interrupt_enable();
+}
+#endif
+
 #ifdef CONFIG_TASK_PROFILING
 void __keep task_start_irq_handler(void *excep_return)
 {
@@ -366,6 +500,11 @@ void __keep task_start_irq_handler(void *excep_return)
 	 */
 	uint32_t t = get_time().le.lo;
 	int irq = get_interrupt_context() - 16;
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	uint32_t cycle = CPU_DWT_CYCCNT;
+
+	irq_cycles_enter(irq);
+#endif
 
 	/*
 	 * Track IRQ distribution.  No need for atomic add, because an IRQ
@@ -383,11 +522,18 @@ void __keep task_start_irq_handler(void *excep_return)
 		return;
 
 	exc_start_time = t;
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	exc_start_cycle = cycle;
+#endif
 }
 #endif
 
 void __keep task_resched_if_needed(void *excep_return)
 {
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	irq_cycles_exit();
+#endif
+
 	/*
 	 * Continue iff a rescheduling event happened or profiling is active,
 	 * and we are not called from another exception.
@@ -398,6 +544,44 @@ void __keep task_resched_if_needed(void *excep_return)
 	svc_handler(0, 0);
 }
 
+#ifdef CONFIG_TASK_EVENT_LATENCY
+static void latency_set(task_id_t tskid, uint32_t event)
+{
+	/* Only the first event counts, until the task gets it */
+	if ((latency_pending & BIT(tskid)) || event == TASK_EVENT_TIMER)
+		return;
+
+	interrupt_disable();
+	latency_set_time[tskid] = get_time().le.lo;
+	latency_set_irq[tskid] = get_interrupt_context() - 16;
+	latency_interrupted[tskid] = task_get_current();
+	latency_pending |= BIT(tskid);
+	interrupt_enable();
+}
+
+static void latency_got(task_id_t me)
+{
+	struct ec_task_latency *l = &latency[me];
+	uint32_t us;
+	int b = 0;
+
+	interrupt_disable();
+	us = get_time().le.lo - latency_set_time[me];
+	latency_pending &= ~BIT(me);
+
+	while (b < EC_TASK_LATENCY_BUCKETS - 1 && us >= (8 << b))
+		b++;
+	l->hist[b]++;
+	if (us >= l->worst_us) {
+		l->worst_us = us;
+		l->worst_irq = latency_set_irq[me];
+		l->worst_interrupted = latency_interrupted[me];
+		l->worst_ran_before = latency_ran_before[me];
+	}
+	interrupt_enable();
+}
+#endif
+
 static uint32_t __wait_evt(int timeout_us, task_id_t resched)
 {
 	task_ *tsk = current_task;
@@ -418,6 +602,10 @@ static uint32_t __wait_evt(int timeout_us, task_id_t resched)
 		__schedule(1, resched);
 		resched = TASK_ID_IDLE;
 	}
+#ifdef CONFIG_TASK_EVENT_LATENCY
+	if (latency_pending & BIT(me))
+		latency_got(me);
+#endif
 	if (timeout_us > 0) {
 		timer_cancel(me);
 		/* Ensure timer event is clear, we no longer care about it */
@@ -438,6 +626,9 @@ uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 	if (in_interrupt_context()) {
 		/* The receiver might run again */
 		deprecated_atomic_or(&tasks_ready, 1 << tskid);
+#ifdef CONFIG_TASK_EVENT_LATENCY
+		latency_set(tskid, event);
+#endif
 #ifndef CONFIG_TASK_PROFILING
 		if (start_called)
 			need_resched_or_profiling = 1;
@@ -857,10 +1048,58 @@ static void __nvic_init_irqs(void)
 	}
 }
 
+#ifdef CONFIG_MUTEX_STATS
+/* End of the list of mutexes locked so far */
+static struct mutex mutex_list_end;
+static struct mutex *mutex_list = &mutex_list_end;
+static int mutex_count;
+
+static void mutex_stats_locked(struct mutex *mtx, uint8_t blocker,
+			       uint32_t wait_start)
+{
+	uint32_t now = get_time().le.lo;
+
+	interrupt_disable();
+	if (!mtx->next) {
+		mtx->next = mutex_list;
+		mutex_list = mtx;
+		mutex_count++;
+	}
+	interrupt_enable();
+
+	/* Only the owner updates these, until it unlocks */
+	mtx->locks++;
+	mtx->lock_time = now;
+	if (blocker == TASK_ID_INVALID)
+		return;
+
+	mtx->contended++;
+	if (now - wait_start >= mtx->max_wait_us) {
+		mtx->max_wait_us = now - wait_start;
+		mtx->max_wait_task = task_get_current();
+		mtx->max_wait_owner = blocker;
+	}
+}
+
+static void mutex_stats_unlocked(struct mutex *mtx)
+{
+	uint32_t hold = get_time().le.lo - mtx->lock_time;
+
+	if (hold >= mtx->max_hold_us) {
+		mtx->max_hold_us = hold;
+		mtx->max_hold_task = task_get_current();
+	}
+}
+#endif
+
 void mutex_lock(struct mutex *mtx)
 {
 	uint32_t value;
 	uint32_t id;
+#ifdef CONFIG_MUTEX_STATS
+	uint8_t blocker = TASK_ID_INVALID;
+	uint32_t wait_start = 0;
+#endif
 
 	/*
 	 * mutex_lock() must not be used in interrupt context (because we wait
@@ -892,12 +1131,33 @@ void mutex_lock(struct mutex *mtx)
 		 * "value" is equals to 1 if the store conditional failed,
 		 * 2 if somebody else owns the mutex, 0 else.
 		 */
-		if (value == 2)
+		if (value == 2) {
 			/* Contention on the mutex */
+#ifdef CONFIG_MUTEX_STATS
+			if (blocker == TASK_ID_INVALID) {
+				wait_start = get_time().le.lo;
+				blocker = mtx->owner;
+			}
+#endif
+#ifdef CONFIG_MUTEX_PRIORITY_INHERITANCE
+			mutex_blocked_on[task_get_current()] = mtx;
+			deprecated_atomic_or(&tasks_mutex_blocked, id);
+#endif
 			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
+#ifdef CONFIG_MUTEX_PRIORITY_INHERITANCE
+			deprecated_atomic_clear_bits(&tasks_mutex_blocked, id);
+#endif
+		}
 	} while (value);
 
 	deprecated_atomic_clear_bits(&mtx->waiters, id);
+#if defined(CONFIG_MUTEX_PRIORITY_INHERITANCE) || defined(CONFIG_MUTEX_STATS)
+	mtx->owner = task_get_current();
+#endif
+#ifdef CONFIG_MUTEX_STATS
+	if (task_start_called())
+		mutex_stats_locked(mtx, blocker, wait_start);
+#endif
 }
 
 void mutex_unlock(struct mutex *mtx)
@@ -905,12 +1165,20 @@ void mutex_unlock(struct mutex *mtx)
 	uint32_t waiters;
 	task_ *tsk = current_task;
 
+#ifdef CONFIG_MUTEX_STATS
+	if (task_start_called())
+		mutex_stats_unlocked(mtx);
+#endif
+
 	/*
 	 * Add a critical section to keep the unlock and the snapshotting of
 	 * waiters atomic in case a task switching occurs between them.
 	 */
 	interrupt_disable();
 	waiters = mtx->waiters;
+#if defined(CONFIG_MUTEX_PRIORITY_INHERITANCE) || defined(CONFIG_MUTEX_STATS)
+	mtx->owner = TASK_ID_IDLE;
+#endif
 	mtx->lock = 0;
 	interrupt_enable();
 
@@ -926,6 +1194,98 @@ void mutex_unlock(struct mutex *mtx)
 	deprecated_atomic_clear_bits(&tsk->events, TASK_EVENT_MUTEX);
 }
 
+#ifdef CONFIG_MUTEX_STATS
+/* Nobody but the idle task owns no mutex, so it stands for unknown */
+static uint8_t mutex_task(uint8_t id)
+{
+	return id == TASK_ID_IDLE ? TASK_ID_INVALID : id;
+}
+
+static void mutex_stats_get(const struct mutex *mtx, struct ec_mutex_stats *s)
+{
+	interrupt_disable();
+	s->address = (uint32_t)mtx;
+	s->locks = mtx->locks;
+	s->contended = mtx->contended;
+	s->max_wait_us = mtx->max_wait_us;
+	s->max_hold_us = mtx->max_hold_us;
+	s->owner = mtx->lock ? mutex_task(mtx->owner) : TASK_ID_INVALID;
+	s->max_wait_task = mtx->contended ? mutex_task(mtx->max_wait_task) :
+					    TASK_ID_INVALID;
+	s->max_wait_owner = mtx->contended ? mutex_task(mtx->max_wait_owner) :
+					     TASK_ID_INVALID;
+	s->max_hold_task = mutex_task(mtx->max_hold_task);
+	interrupt_enable();
+}
+
+static void mutex_stats_clear(void)
+{
+	struct mutex *m;
+
+	interrupt_disable();
+	for (m = mutex_list; m != &mutex_list_end; m = m->next) {
+		m->locks = 0;
+		m->contended = 0;
+		m->max_wait_us = 0;
+		m->max_hold_us = 0;
+		m->max_hold_task = TASK_ID_IDLE;
+	}
+	interrupt_enable();
+}
+
+static enum ec_status hc_mutex_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_mutex_stats *p = args->params;
+	struct ec_response_mutex_stats *r = args->response;
+	struct ec_params_mutex_stats params = *p;
+	const struct mutex *m = mutex_list;
+	int i;
+
+	/* Params and response share the same buffer */
+	memset(r, 0, sizeof(*r));
+	r->mutex_count = mutex_count;
+	for (i = 0; m != &mutex_list_end && r->count < EC_MUTEX_STATS_PAGE;
+	     i++, m = m->next)
+		if (i >= params.offset)
+			mutex_stats_get(m, &r->mutexes[r->count++]);
+
+	if (params.flags & EC_MUTEX_STATS_CLEAR)
+		mutex_stats_clear();
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_MUTEX_STATS, hc_mutex_stats, EC_VER_MASK(0));
+
+static int command_mutex_info(int argc, char **argv)
+{
+	struct ec_mutex_stats s;
+	const struct mutex *m;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		mutex_stats_clear();
+		return EC_SUCCESS;
+	}
+
+	ccputs("Mutex          Owner    Locks Contended  Wait us (task/owner)"
+	       "  Hold us (task)\n");
+	for (m = mutex_list; m != &mutex_list_end; m = m->next) {
+		mutex_stats_get(m, &s);
+		ccprintf("%p %5d %8d %9d %8d (%3d/%3d) %8d (%3d)\n", m,
+			 s.owner, s.locks, s.contended, s.max_wait_us,
+			 s.max_wait_task, s.max_wait_owner, s.max_hold_us,
+			 s.max_hold_task);
+		cflush();
+	}
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(mutexinfo, command_mutex_info,
+			     "[clear]",
+			     "Print mutex contention");
+#endif
+
 void task_print_list(void)
 {
 	int i;
@@ -976,6 +1336,12 @@ int command_task_info(int argc, char **argv)
 		 get_time().val - task_start_time);
 	ccprintf("Time in exceptions:     %11.6lld s\n", exc_total_time);
 #endif
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	ccprintf("Switches on wait/wake/IRQ: %d/%d/%d\n",
+		 switch_reasons[EC_TASK_SWITCH_WAIT],
+		 switch_reasons[EC_TASK_SWITCH_WAKE],
+		 switch_reasons[EC_TASK_SWITCH_IRQ]);
+#endif
 
 	return EC_SUCCESS;
 }
@@ -983,6 +1349,131 @@ DECLARE_SAFE_CONSOLE_COMMAND(taskinfo, command_task_info,
 			     NULL,
 			     "Print task info");
 
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+static void task_cycles_clear(void)
+{
+	interrupt_disable();
+	memset(task_cycles, 0, sizeof(task_cycles));
+	memset(irq_cycles, 0, sizeof(irq_cycles));
+	memset(switch_reasons, 0, sizeof(switch_reasons));
+	slice_cycles = 0;
+	cycles_window_start = get_time().val;
+	interrupt_enable();
+}
+
+static enum ec_status hc_task_profile(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_task_profile *p = args->params;
+	struct ec_response_task_profile *r = args->response;
+	struct ec_params_task_profile params = *p;
+	const struct cycle_stats *stats = task_cycles;
+	int n = TASK_ID_COUNT;
+	int i;
+
+	if (params.flags & EC_TASK_PROFILE_IRQS) {
+		stats = irq_cycles;
+		n = CONFIG_IRQ_COUNT;
+	}
+
+	/* Params and response share the same buffer */
+	memset(r, 0, sizeof(*r));
+	r->cpu_hz = clock_get_freq();
+	r->window_ms = (get_time().val - cycles_window_start) / MSEC;
+	memcpy(r->switches, switch_reasons, sizeof(r->switches));
+
+	for (i = params.offset; i < n && r->count < EC_TASK_PROFILE_PAGE;
+	     i++) {
+		struct ec_task_profile_entry *e = &r->entries[r->count];
+
+		if ((params.flags & EC_TASK_PROFILE_IRQS) && !stats[i].count)
+			continue;
+
+		e->id = i;
+		interrupt_disable();
+		e->count = stats[i].count;
+		e->cycles = stats[i].cycles;
+		e->max_cycles = stats[i].max;
+		interrupt_enable();
+		r->count++;
+	}
+	r->next_offset = i < n ? i : 0;
+
+	if (params.flags & EC_TASK_PROFILE_CLEAR)
+		task_cycles_clear();
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TASK_PROFILE, hc_task_profile, EC_VER_MASK(0));
+#endif
+
+#ifdef CONFIG_TASK_EVENT_LATENCY
+static void latency_clear(void)
+{
+	interrupt_disable();
+	memset(latency, 0, sizeof(latency));
+	interrupt_enable();
+}
+
+static enum ec_status hc_task_latency(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_task_latency *p = args->params;
+	struct ec_response_task_latency *r = args->response;
+	struct ec_params_task_latency params = *p;
+	int i;
+
+	/* Params and response share the same buffer */
+	memset(r, 0, sizeof(*r));
+	r->task_count = TASK_ID_COUNT;
+	for (i = params.offset;
+	     i < TASK_ID_COUNT && r->count < EC_TASK_LATENCY_PAGE; i++) {
+		interrupt_disable();
+		r->tasks[r->count] = latency[i];
+		interrupt_enable();
+		r->tasks[r->count++].task = i;
+	}
+
+	if (params.flags & EC_TASK_LATENCY_CLEAR)
+		latency_clear();
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TASK_LATENCY, hc_task_latency, EC_VER_MASK(0));
+
+static int command_task_latency(int argc, char **argv)
+{
+	struct ec_task_latency l;
+	int i, b;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "clear"))
+			return EC_ERROR_PARAM1;
+		latency_clear();
+		return EC_SUCCESS;
+	}
+
+	ccputs("Task Name          Worst us  IRQ Intr Prev  Histogram\n");
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		interrupt_disable();
+		l = latency[i];
+		interrupt_enable();
+
+		ccprintf("%4d %-16s %8d %4d %4d %4d ", i, task_names[i],
+			 l.worst_us, l.worst_irq, l.worst_interrupted,
+			 l.worst_ran_before);
+		for (b = 0; b < EC_TASK_LATENCY_BUCKETS; b++)
+			ccprintf(" %d", l.hist[b]);
+		ccputs("\n");
+		cflush();
+	}
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(tasklat, command_task_latency,
+			     "[clear]",
+			     "Print IRQ to task event latency");
+#endif
+
 #ifdef CONFIG_CMD_TASKREADY
 static int command_task_ready(int argc, char **argv)
 {
@@ -1045,6 +1536,13 @@ int task_start(void)
 
 	task_start_time = t.val;
 	exc_end_time = t.le.lo;
+#endif
+#ifdef CONFIG_TASK_PROFILING_CYCLES
+	CPU_SCB_DEMCR |= CPU_SCB_DEMCR_TRCENA;
+	CPU_DWT_CYCCNT = 0;
+	CPU_DWT_CTRL |= CPU_DWT_CTRL_CYCCNTENA;
+	exc_end_cycle = 0;
+	cycles_window_start = t.val;
 #endif
 	start_called = 1;
 
@@ -8,4 +8,6 @@
 
 CFLAGS_CPU=-fno-builtin
 
-core-y=main.o task.o timer.o panic.o disabled.o stack_trace.o
+core-y=main.o timer.o panic.o disabled.o stack_trace.o
+core-$(CONFIG_TEST_DISCRETE_EVENT)+=task_des.o
+core-$(call not_cfg,$(CONFIG_TEST_DISCRETE_EVENT))+=task.o
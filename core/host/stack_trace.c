@@ -81,7 +81,12 @@ static void __attribute__((noinline)) _task_dump_trace_dispatch(int sig)
 				running, task_get_name(running));
 	}
 
-	if (need_dispatch) {
+	/*
+	 * With the discrete-event scheduler, tasks run on the main thread and
+	 * the trace can be dumped right away.
+	 */
+	if (need_dispatch &&
+	    !pthread_equal(task_get_thread(running), pthread_self())) {
 		pthread_kill(task_get_thread(running), SIGNAL_TRACE_DUMP);
 	} else {
 		_task_dump_trace_impl(SIGNAL_TRACE_OFFSET);
@@ -22,6 +22,7 @@
 #include "task_id.h"
 #include "test_util.h"
 #include "timer.h"
+#include "util.h"
 
 #define SIGNAL_INTERRUPT SIGUSR1
 
@@ -229,6 +230,15 @@ uint32_t task_wait_event(int timeout_us)
 	return ret;
 }
 
+uint32_t task_wait_event_slack(int timeout_us, int slack_us)
+{
+	/* No other timers to share a wakeup with, use the whole window */
+	if (timeout_us > 0 && slack_us > 0)
+		timeout_us += MIN(slack_us, TASK_MAX_WAIT_US - timeout_us);
+
+	return task_wait_event(timeout_us);
+}
+
 uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
 {
 	uint64_t deadline = get_time().val + timeout_us;
@@ -0,0 +1,695 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Discrete-event task scheduler for the EC emulator.
+ *
+ * Unlike task.c, which runs every task in its own pthread and hands control
+ * over through condition variables, all tasks here are coroutines running on
+ * the main thread and switched with swapcontext(). Pending timeouts are kept
+ * in a min-heap of wake times, and the virtual clock jumps straight to the
+ * next expiration whenever no task is ready, so hours of EC time pass in
+ * seconds of host time.
+ *
+ * The interrupt generator is also a coroutine: its udelay() calls arm a
+ * timer and its interrupts run at scheduling points instead of preempting
+ * busy-looping tasks. Tests that rely on such preemption must use the
+ * threaded scheduler.
+ *
+ * Setting the EMU_SEED environment variable to a non-zero value adds a
+ * pseudo-random latency of up to DES_JITTER_MAX_US to each timer expiration.
+ * Runs with the same seed are reproducible.
+ */
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "host_task.h"
+#include "task.h"
+#include "task_id.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define SIGNAL_INTERRUPT SIGUSR1
+
+/* Host stack of each coroutine; glibc printf() and backtrace() need room */
+#define DES_STACK_SIZE (256 * 1024)
+
+/* Maximum timer latency added when EMU_SEED is set */
+#define DES_JITTER_MAX_US 64
+
+/* Interrupt generator slot, after the regular tasks */
+#define DES_INT_GEN TASK_ID_COUNT
+#define DES_SLOT_COUNT (TASK_ID_COUNT + 1)
+
+struct emu_task_t {
+	ucontext_t context;
+	void *stack;
+	uint32_t event;
+	timestamp_t wake_time;
+	/* Position in wake_heap, or -1 if no timeout is armed */
+	int heap_index;
+	uint8_t started;
+	uint8_t created;
+};
+
+struct task_args {
+	void (*routine)(void *);
+	void *d;
+};
+
+static struct emu_task_t tasks[DES_SLOT_COUNT];
+static ucontext_t scheduler_context;
+static task_id_t running_task_id;
+static int task_started;
+static int all_tasks_enabled;
+
+/* Slots with an armed timeout, ordered by wake time */
+static uint8_t wake_heap[DES_SLOT_COUNT];
+static int wake_heap_size;
+
+static pthread_t main_thread;
+static sem_t interrupt_sem;
+static pthread_mutex_t interrupt_lock;
+static int in_interrupt;
+static int interrupt_disabled;
+static void (*pending_isr)(void);
+static int has_interrupt_generator = 1;
+
+static uint32_t des_seed;
+
+/* Statistics */
+static uint32_t switch_count;
+static uint32_t fast_forward_count;
+static uint64_t fast_forward_us;
+
+/* thread local task id */
+static __thread task_id_t my_task_id = TASK_ID_INVALID;
+
+#define TASK(n, r, d, s) void r(void *);
+CONFIG_TASK_LIST
+CONFIG_TEST_TASK_LIST
+CONFIG_CTS_TASK_LIST
+#undef TASK
+
+/* usleep that uses OS functions, instead of emulated timer. */
+void _usleep(int usec)
+{
+	struct timespec req;
+
+	req.tv_sec = usec / 1000000;
+	req.tv_nsec = (usec % 1000000) * 1000;
+
+	nanosleep(&req, NULL);
+}
+
+/* msleep that uses OS functions, instead of emulated timer. */
+void _msleep(int msec)
+{
+	_usleep(1000 * msec);
+}
+
+/* Idle task */
+void __idle(void *d)
+{
+	while (1)
+		task_wait_event(-1);
+}
+
+void _run_test(void *d)
+{
+	run_test(0, NULL);
+}
+
+#define TASK(n, r, d, s) {r, d},
+const struct task_args task_info[TASK_ID_COUNT] = {
+	{__idle, NULL},
+	CONFIG_TASK_LIST
+	CONFIG_TEST_TASK_LIST
+	CONFIG_CTS_TASK_LIST
+	{_run_test, NULL},
+};
+#undef TASK
+
+#define TASK(n, r, d, s) #n,
+static const char * const task_names[] = {
+	"<< idle >>",
+	CONFIG_TASK_LIST
+	CONFIG_TEST_TASK_LIST
+	CONFIG_CTS_TASK_LIST
+	"<< test runner >>",
+};
+#undef TASK
+
+/*****************************************************************************/
+/* Wake time heap */
+
+/*
+ * Return true if slot a must wake before slot b. Ties go to the higher
+ * slot, which is the higher priority task or the interrupt generator.
+ */
+static int wake_before(int a, int b)
+{
+	if (tasks[a].wake_time.val != tasks[b].wake_time.val)
+		return tasks[a].wake_time.val < tasks[b].wake_time.val;
+	return a > b;
+}
+
+static void wake_heap_set(int index, int slot)
+{
+	wake_heap[index] = slot;
+	tasks[slot].heap_index = index;
+}
+
+static void wake_heap_sift_up(int index)
+{
+	int slot = wake_heap[index];
+
+	while (index > 0) {
+		int parent = (index - 1) / 2;
+
+		if (!wake_before(slot, wake_heap[parent]))
+			break;
+		wake_heap_set(index, wake_heap[parent]);
+		index = parent;
+	}
+	wake_heap_set(index, slot);
+}
+
+static void wake_heap_sift_down(int index)
+{
+	int slot = wake_heap[index];
+
+	while (1) {
+		int child = 2 * index + 1;
+
+		if (child >= wake_heap_size)
+			break;
+		if (child + 1 < wake_heap_size &&
+		    wake_before(wake_heap[child + 1], wake_heap[child]))
+			child++;
+		if (!wake_before(wake_heap[child], slot))
+			break;
+		wake_heap_set(index, wake_heap[child]);
+		index = child;
+	}
+	wake_heap_set(index, slot);
+}
+
+static void wake_heap_remove(int slot)
+{
+	int index = tasks[slot].heap_index;
+
+	if (index < 0)
+		return;
+
+	tasks[slot].heap_index = -1;
+	if (--wake_heap_size == index)
+		return;
+
+	wake_heap_set(index, wake_heap[wake_heap_size]);
+	wake_heap_sift_up(index);
+	wake_heap_sift_down(tasks[wake_heap[index]].heap_index);
+}
+
+/* Arm the timeout of a slot, replacing any previous one. */
+static void wake_heap_arm(int slot, uint64_t wake_time)
+{
+	wake_heap_remove(slot);
+
+	if (des_seed) {
+		des_seed = prng(des_seed);
+		wake_time += (des_seed >> 16) % (DES_JITTER_MAX_US + 1);
+	}
+
+	tasks[slot].wake_time.val = wake_time;
+	wake_heap_set(wake_heap_size, slot);
+	wake_heap_sift_up(wake_heap_size++);
+}
+
+/*****************************************************************************/
+/* Interrupts */
+
+void task_pre_init(void)
+{
+	/* Nothing */
+}
+
+int in_interrupt_context(void)
+{
+	return !!in_interrupt;
+}
+
+void interrupt_disable(void)
+{
+	pthread_mutex_lock(&interrupt_lock);
+	interrupt_disabled = 1;
+	pthread_mutex_unlock(&interrupt_lock);
+}
+
+void interrupt_enable(void)
+{
+	pthread_mutex_lock(&interrupt_lock);
+	interrupt_disabled = 0;
+	pthread_mutex_unlock(&interrupt_lock);
+}
+
+static void _task_execute_isr(int sig)
+{
+	in_interrupt = 1;
+	pending_isr();
+	sem_post(&interrupt_sem);
+	in_interrupt = 0;
+}
+
+void task_register_interrupt(void)
+{
+	main_thread = pthread_self();
+	sem_init(&interrupt_sem, 0, 0);
+	signal(SIGNAL_INTERRUPT, _task_execute_isr);
+}
+
+void task_trigger_test_interrupt(void (*isr)(void))
+{
+	/*
+	 * The interrupt generator only runs from the scheduler, which already
+	 * holds interrupt_lock, so its interrupts are serviced right here.
+	 */
+	if (my_task_id == TASK_ID_INT_GEN &&
+	    pthread_equal(pthread_self(), main_thread)) {
+		if (interrupt_disabled)
+			return;
+		in_interrupt = 1;
+		isr();
+		in_interrupt = 0;
+		return;
+	}
+
+	/* Other host threads (e.g. UART input) interrupt the running task. */
+	pthread_mutex_lock(&interrupt_lock);
+	if (interrupt_disabled) {
+		pthread_mutex_unlock(&interrupt_lock);
+		return;
+	}
+
+	pending_isr = isr;
+	pthread_kill(main_thread, SIGNAL_INTERRUPT);
+
+	/* Wait for ISR to complete */
+	sem_wait(&interrupt_sem);
+	while (in_interrupt)
+		_usleep(10);
+	pending_isr = NULL;
+
+	pthread_mutex_unlock(&interrupt_lock);
+}
+
+void interrupt_generator_udelay(unsigned us)
+{
+	wake_heap_arm(DES_INT_GEN, get_time().val + us);
+	swapcontext(&tasks[DES_INT_GEN].context, &scheduler_context);
+}
+
+test_mockable void interrupt_generator(void)
+{
+	has_interrupt_generator = 0;
+}
+
+/*****************************************************************************/
+/* Tasks */
+
+const char *task_get_name(task_id_t tskid)
+{
+	return task_names[tskid];
+}
+
+pthread_t task_get_thread(task_id_t tskid)
+{
+	return main_thread;
+}
+
+uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
+{
+	deprecated_atomic_or(&tasks[tskid].event, event);
+	if (wait)
+		return task_wait_event(-1);
+	return 0;
+}
+
+uint32_t *task_get_event_bitmap(task_id_t tskid)
+{
+	return &tasks[tskid].event;
+}
+
+uint32_t task_wait_event(int timeout_us)
+{
+	int tid = task_get_current();
+
+	/* Interrupts stay masked while the scheduler runs. */
+	pthread_mutex_lock(&interrupt_lock);
+	if (timeout_us > 0)
+		wake_heap_arm(tid, get_time().val + timeout_us);
+
+	/* Transfer control to scheduler */
+	swapcontext(&tasks[tid].context, &scheduler_context);
+
+	/* Resume */
+	pthread_mutex_unlock(&interrupt_lock);
+	return deprecated_atomic_read_clear(&tasks[tid].event);
+}
+
+uint32_t task_wait_event_slack(int timeout_us, int slack_us)
+{
+	/* Timers are not coalesced here, use the whole window */
+	if (timeout_us > 0 && slack_us > 0)
+		timeout_us += MIN(slack_us, TASK_MAX_WAIT_US - timeout_us);
+
+	return task_wait_event(timeout_us);
+}
+
+uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
+{
+	uint64_t deadline = get_time().val + timeout_us;
+	uint32_t events = 0;
+	int time_remaining_us = timeout_us;
+
+	/* Add the timer event to the mask so we can indicate a timeout */
+	event_mask |= TASK_EVENT_TIMER;
+
+	while (!(events & event_mask)) {
+		/* Collect events to re-post later */
+		events |= task_wait_event(time_remaining_us);
+
+		time_remaining_us = deadline - get_time().val;
+		if (timeout_us > 0 && time_remaining_us <= 0) {
+			/* Ensure we return a TIMER event if we timeout */
+			events |= TASK_EVENT_TIMER;
+			break;
+		}
+	}
+
+	/* Re-post any other events collected */
+	if (events & ~event_mask)
+		deprecated_atomic_or(&tasks[task_get_current()].event,
+				     events & ~event_mask);
+
+	return events & event_mask;
+}
+
+void mutex_lock(struct mutex *mtx)
+{
+	int value = 0;
+	int id = 1 << task_get_current();
+
+	mtx->waiters |= id;
+
+	do {
+		if (mtx->lock == 0) {
+			mtx->lock = 1;
+			value = 1;
+		}
+
+		if (!value)
+			task_wait_event_mask(TASK_EVENT_MUTEX, 0);
+	} while (!value);
+
+	mtx->waiters &= ~id;
+}
+
+void mutex_unlock(struct mutex *mtx)
+{
+	int v;
+	mtx->lock = 0;
+
+	for (v = 31; v >= 0; --v)
+		if ((1ul << v) & mtx->waiters) {
+			mtx->waiters &= ~(1ul << v);
+			task_set_event(v, TASK_EVENT_MUTEX, 0);
+			break;
+		}
+}
+
+task_id_t task_get_current(void)
+{
+	return my_task_id;
+}
+
+task_id_t task_get_running(void)
+{
+	return running_task_id;
+}
+
+void task_print_list(void)
+{
+	int i;
+
+	ccputs("Name         Events\n");
+
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		ccprintf("%4d %-16s %08x\n", i, task_names[i], tasks[i].event);
+		cflush();
+	}
+
+	ccprintf("Switches: %u, fast-forwards: %u (%" PRIu64 " us)\n",
+		 switch_count, fast_forward_count, fast_forward_us);
+}
+
+int command_task_info(int argc, char **argv)
+{
+	task_print_list();
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(taskinfo, command_task_info,
+			     NULL,
+			     "Print task info");
+
+static void _wait_for_task_started(int can_sleep)
+{
+	int i, ok;
+
+	while (1) {
+		ok = 1;
+		for (i = 0; i < TASK_ID_COUNT - 1; ++i) {
+			if (!tasks[i].started) {
+				if (can_sleep)
+					msleep(10);
+				else
+					_msleep(10);
+				ok = 0;
+				break;
+			}
+		}
+		if (ok)
+			return;
+	}
+}
+
+void wait_for_task_started(void)
+{
+	_wait_for_task_started(1);
+}
+
+void wait_for_task_started_nosleep(void)
+{
+	_wait_for_task_started(0);
+}
+
+int task_start_called(void)
+{
+	return task_started;
+}
+
+static void _task_start_impl(int tid)
+{
+	const struct task_args *arg = task_info + tid;
+
+	/* Resuming from the scheduler, as in task_wait_event() */
+	pthread_mutex_unlock(&interrupt_lock);
+	tasks[tid].event = 0;
+
+	/* Start the task routine */
+	(arg->routine)(arg->d);
+
+	/* Catch exited routine */
+	while (1)
+		task_wait_event(-1);
+}
+
+static void _task_int_generator_start(int slot)
+{
+	interrupt_generator();
+
+	/* Returning resumes the scheduler through uc_link. */
+	tasks[DES_INT_GEN].created = 0;
+}
+
+static void task_create(int slot, void (*entry)(int))
+{
+	struct emu_task_t *task = &tasks[slot];
+
+	if (!task->stack)
+		task->stack = malloc(DES_STACK_SIZE);
+	if (!task->stack) {
+		fprintf(stderr, "Cannot allocate task stack\n");
+		exit(1);
+	}
+
+	getcontext(&task->context);
+	task->context.uc_stack.ss_sp = task->stack;
+	task->context.uc_stack.ss_size = DES_STACK_SIZE;
+	task->context.uc_link = &scheduler_context;
+	makecontext(&task->context, (void (*)(void))entry, 1, slot);
+
+	task->event = TASK_EVENT_WAKE;
+	task->wake_time.val = ~0ull;
+	task->started = 0;
+	task->created = 1;
+}
+
+static void task_enable_all_tasks_callback(void)
+{
+	int i;
+
+	/* Initialize the remaining tasks. */
+	for (i = 0; i < TASK_ID_COUNT; ++i)
+		if (!tasks[i].created)
+			task_create(i, _task_start_impl);
+
+	if (has_interrupt_generator) {
+		task_create(DES_INT_GEN, _task_int_generator_start);
+		tasks[DES_INT_GEN].event = 0;
+		wake_heap_arm(DES_INT_GEN, get_time().val);
+	}
+}
+
+void task_enable_all_tasks(void)
+{
+	/* Let the scheduler enable the remaining tasks. */
+	all_tasks_enabled = 1;
+}
+
+/*
+ * Post TASK_EVENT_TIMER to every task whose timeout has expired, and return
+ * the highest priority task ready to run, or TASK_ID_INVALID.
+ */
+static int task_get_next_ready(void)
+{
+	timestamp_t now = get_time();
+	int i;
+
+	while (wake_heap_size &&
+	       tasks[wake_heap[0]].wake_time.val <= now.val) {
+		i = wake_heap[0];
+		/* The interrupt generator preempts everything. */
+		if (i == DES_INT_GEN)
+			return i;
+		wake_heap_remove(i);
+		tasks[i].wake_time.val = ~0ull;
+		tasks[i].event |= TASK_EVENT_TIMER;
+	}
+
+	for (i = TASK_ID_COUNT - 1; i >= 0; --i)
+		if (tasks[i].created && tasks[i].event)
+			return i;
+
+	return TASK_ID_INVALID;
+}
+
+/*
+ * Nothing is ready: jump the virtual clock to the next timeout. Without any
+ * armed timeout, only an interrupt from another host thread can make
+ * progress, so let the idle task spin.
+ */
+static int fast_forward(void)
+{
+	timestamp_t now;
+	int i;
+
+	if (!wake_heap_size)
+		return TASK_ID_IDLE;
+
+	i = wake_heap[0];
+	now = get_time();
+	fast_forward_count++;
+	fast_forward_us += tasks[i].wake_time.val - now.val;
+	force_time(tasks[i].wake_time);
+
+	return task_get_next_ready();
+}
+
+static void task_scheduler(void)
+{
+	int i;
+
+	task_started = 1;
+
+	while (1) {
+		if (all_tasks_enabled == 1) {
+			task_enable_all_tasks_callback();
+			all_tasks_enabled = 2;
+		}
+
+		i = task_get_next_ready();
+		if (i == TASK_ID_INVALID)
+			i = fast_forward();
+		if (i == TASK_ID_INVALID)
+			i = TASK_ID_IDLE;
+
+		switch_count++;
+		if (i == DES_INT_GEN) {
+			wake_heap_remove(i);
+			tasks[i].wake_time.val = ~0ull;
+			my_task_id = TASK_ID_INT_GEN;
+		} else {
+			/* Resuming cancels any pending timeout. */
+			wake_heap_remove(i);
+			tasks[i].wake_time.val = ~0ull;
+			running_task_id = i;
+			tasks[i].started = 1;
+			my_task_id = i;
+		}
+		swapcontext(&scheduler_context, &tasks[i].context);
+		my_task_id = TASK_ID_INVALID;
+	}
+}
+
+int task_start(void)
+{
+	const char *seed = getenv("EMU_SEED");
+	int i;
+
+	pthread_mutex_init(&interrupt_lock, NULL);
+
+	for (i = 0; i < DES_SLOT_COUNT; ++i)
+		tasks[i].heap_index = -1;
+
+	if (seed) {
+		des_seed = strtoul(seed, NULL, 0);
+		fprintf(stderr, "Discrete-event scheduler seed %u\n", des_seed);
+	}
+
+	/*
+	 * Start the hooks task first. After its init, it will callback to
+	 * enable the remaining tasks.
+	 */
+	task_create(TASK_ID_HOOKS, _task_start_impl);
+
+	/* The scheduler always runs with interrupts masked. */
+	pthread_mutex_lock(&interrupt_lock);
+	task_scheduler();
+
+	return 0;
+}
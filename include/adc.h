@@ -27,6 +27,23 @@
  */
 int adc_read_channel(enum adc_channel ch);
 
+/**
+ * Convert all the channels in one pass. Until adc_scan_end(), calls to
+ * adc_read_channel() from the same task return the results of that pass
+ * instead of starting a conversion each.
+ *
+ * Only one task may hold a scan at a time.
+ *
+ * @return EC_SUCCESS, or non-zero if the conversion failed, in which case
+ * adc_read_channel() keeps converting channels one at a time.
+ */
+int adc_scan_begin(void);
+
+/**
+ * Go back to converting channels on each adc_read_channel() call.
+ */
+void adc_scan_end(void);
+
 /**
  * Enable ADC watchdog. Note that interrupts might come in repeatedly very
  * quickly when ADC output goes out of the accepted range.
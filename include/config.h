@@ -281,6 +281,12 @@
 /* Support voltage comparator */
 #undef CONFIG_ADC_VOLTAGE_COMPARATOR
 
+/*
+ * Chip can convert all the channels in one pass, and hand the results to
+ * adc_read_channel() calls in between adc_scan_begin() and adc_scan_end().
+ */
+#undef CONFIG_ADC_SCAN
+
 /* Include the ADC analog watchdog feature in the ADC code */
 #define CONFIG_ADC_WATCHDOG
 
@@ -1676,6 +1682,19 @@
  */
 #undef CONFIG_EMULATED_SYSRQ
 
+/*
+ * Keep a compact log of structured events (boot, power state changes and the
+ * event_log entries such as PD events) with delta-encoded timestamps and
+ * varint fields. With CONFIG_PRESERVE_LOGS the store survives warm reboots
+ * and sysjumps, next to the preserved console buffer. Without it, or on boards
+ * which sequence power outside power/common.c and do not use event_log, the
+ * store only holds the boot records of the current boot.
+ */
+#undef CONFIG_EVENT_STORE
+
+/* Size in bytes of the event store ring. Must be a power of 2. */
+#define CONFIG_EVENT_STORE_SIZE 2048
+
 /* Include code for handling external power */
 #define CONFIG_EXTPOWER
 
@@ -1716,6 +1735,15 @@
  */
 #undef CONFIG_FAN_UPDATE_PERIOD
 
+/*
+ * Close the loop on fan speed with a fixed-point PID in RPM space, see
+ * include/fan_pid.h. The fan driver hands its RPM target to
+ * fan_pid_set_target(), and the loop sets the duty cycle every
+ * CONFIG_FAN_PID_PERIOD_MS, independently of the thermal task.
+ */
+#undef CONFIG_FAN_PID
+#define CONFIG_FAN_PID_PERIOD_MS 100
+
 /*****************************************************************************/
 /* Flash configuration */
 
@@ -1734,6 +1762,16 @@
 #undef CONFIG_FLASH_DEFERRED_ERASE
 /* Flash must be selected for write/erase operations to succeed. */
 #undef CONFIG_FLASH_SELECT_REQUIRED
+/*
+ * Provide the SHA-256 of each erase sector to the host, for incremental
+ * updates (EC_CMD_FLASH_SECTOR_HASH).
+ */
+#undef CONFIG_FLASH_SECTOR_HASH
+/*
+ * Program flash writes from the HOOK task with two buffers, so the host can
+ * send the next chunk meanwhile (EC_CMD_FLASH_WRITE_STREAM).
+ */
+#undef CONFIG_FLASH_WRITE_STREAM
 
 /* Base address of program memory */
 #undef CONFIG_PROGRAM_MEMORY_BASE
@@ -2339,6 +2377,32 @@
 /* EC uses an I2C slave interface */
 #undef CONFIG_I2C_SLAVE
 
+/*
+ * Queue I2C transfers per controller and run them from the controller
+ * interrupt, with i2c_xfer_async().  The blocking i2c_xfer() waits on the
+ * queue.  Only MCHP MEC chips support this.
+ */
+#undef CONFIG_I2C_ASYNC
+
+/*
+ * With CONFIG_I2C_ASYNC, run reads of at least this many bytes through the
+ * SMBus network layer and the controller's master DMA channel, with one
+ * interrupt per phase rather than one per byte.  Only MCHP MEC17xx chips
+ * support this, the master buffer registers are not mapped for MEC152x.
+ */
+#undef CONFIG_I2C_DMA_THRESHOLD
+
+/*
+ * Cache reads of the registers in the board's i2c_cache_regs[] table, so
+ * drivers polling registers which rarely change do not go to the bus each
+ * time.  Whole reads through i2c_xfer() or i2c_xfer_unlocked() are cached;
+ * writes keep the cache up to date.
+ */
+#undef CONFIG_I2C_CACHE
+
+/* Largest register read the cache holds, in bytes */
+#define CONFIG_I2C_CACHE_MAX_SIZE 4
+
 /* Defines I2C operation retry count when slave nack'd(EC_ERROR_BUSY) */
 #define CONFIG_I2C_NACK_RETRY_COUNT 0
 /*
@@ -2553,6 +2617,20 @@
 /* Compile code for 8042 keyboard protocol */
 #undef CONFIG_KEYBOARD_PROTOCOL_8042
 
+/*
+ * Depth of the 8042 output queue, in bytes. Must be a power of two. Scan codes
+ * are dropped when a burst does not fit, so boards with large rollover may
+ * want more than the default.
+ */
+#define CONFIG_8042_TO_HOST_SIZE 16
+
+/*
+ * Let the 8042 output buffer empty interrupt load the next queued byte
+ * directly, rather than waking the keyboard protocol task for every byte the
+ * host reads. The chip calls keyboard_host_read_done() from that interrupt.
+ */
+#undef CONFIG_8042_OBE_REFILL
+
 /*
  * Enable code for chromeos vivaldi keyboard (standard for new chromeos devices)
  * This config only takes effect if CONFIG_KEYBOARD_PROTOCOL_8042 is selected. A
@@ -2628,6 +2706,12 @@
  */
 #undef CONFIG_KEYBOARD_SCANCODE_CALLBACK
 
+/*
+ * Board supplies keyboard_scancode_lookup(), used instead of
+ * get_scancode_set2() to translate a key position into a make code.
+ */
+#undef CONFIG_KEYBOARD_SCANCODE_LOOKUP
+
 /*
  * Call board-supplied keyboard_suppress_noise() function when the debounced
  * keyboard state changes.  Some boards use this to send a signal to the audio
@@ -2833,6 +2917,15 @@
 /* Allows us to enable/disable low power idle mode in runtime. */
 #undef CONFIG_LOW_POWER_IDLE_LIMITED
 
+/*
+ * Count what wakes the EC from low power idle (task timer, deferred routine,
+ * IRQ or GPIO) and how long it stays awake after, why it could not use its
+ * deepest sleep, and how long it slept. See EC_CMD_WAKE_STATS. MCHP only,
+ * requires CONFIG_LOW_POWER_IDLE.  Opt-in while low power idle is not
+ * validated on the MCHP boards, "make BOARD=hx30 LOW_POWER_IDLE=1" builds it.
+ */
+#undef CONFIG_WAKE_STATS
+
 /*
  * Enable deep sleep during S0 (ignores SLEEP_MASK_AP_RUN).
  */
@@ -2951,6 +3044,19 @@
 /* Microchip EC SRAM size */
 #undef CONFIG_MEC_SRAM_SIZE
 
+/*
+ * Publish a battery/charger/thermal/fan snapshot at EC_MEMMAP_TELEMETRY,
+ * guarded by a sequence counter so the host can read it without tearing.
+ */
+#undef CONFIG_MEMMAP_TELEMETRY
+
+/*
+ * Send EC_MKBP_EVENT_TELEMETRY when telemetry values the host subscribed to
+ * with EC_CMD_TELEMETRY_SUBSCRIBE change. Requires CONFIG_MEMMAP_TELEMETRY and
+ * CONFIG_MKBP_EVENT.
+ */
+#undef CONFIG_MEMMAP_TELEMETRY_EVENT
+
 /*
  * Define Megachips DisplayPort to HDMI protocol converter/level shifter serial
  * interface.
@@ -3018,6 +3124,20 @@
 /* Support memory protection unit (MPU) */
 #undef CONFIG_MPU
 
+/*
+ * While a task waits on a mutex, run the owner of the mutex at the priority
+ * of the waiter, so tasks in between cannot hold up the waiter.  Cortex-M
+ * only.
+ */
+#undef CONFIG_MUTEX_PRIORITY_INHERITANCE
+
+/*
+ * Count locks, contended locks, and the longest wait and hold time of each
+ * mutex, read with the mutexinfo console command or EC_CMD_MUTEX_STATS.
+ * Cortex-M only.
+ */
+#undef CONFIG_MUTEX_STATS
+
 /* Do not try hold I/O pins at frozen level during deep sleep */
 #undef CONFIG_NO_PINHOLD
 
@@ -3034,6 +3154,19 @@
 #undef CONFIG_PANIC_DATA_BASE
 #undef CONFIG_PANIC_DATA_SIZE
 
+/*
+ * Statistical profiler: a periodic interrupt samples the PC and LR it
+ * interrupted, for the host to read with EC_CMD_PC_PROFILE.  The sampling
+ * interrupt is the SysTick, unless the chip provides a timer for it.
+ */
+#undef CONFIG_PC_PROFILER
+
+/* The chip provides the PC profiler timer, instead of the SysTick */
+#undef CONFIG_PC_PROFILER_HW_TIMER
+
+/* Samples held until the host reads them, must be a power of 2 */
+#define CONFIG_PC_PROFILER_SAMPLES 256
+
 /* Support PECI interface to x86 processor */
 #undef CONFIG_PECI
 
@@ -3291,7 +3424,9 @@
 
 /*
  * Adjust the compiler optimization flags for the RSA code to get a speed-up
- * at the expense of a small code size delta.
+ * at the expense of a small code size delta. This also switches the
+ * Montgomery multiplication to an inner loop built on UMAAL on cores that
+ * have it (Cortex-M4 and up).
  */
 #undef CONFIG_RSA_OPTIMIZED
 
@@ -3623,6 +3758,21 @@
  */
 #define CONFIG_TASK_PROFILING
 
+/*
+ * Also count the core clock cycles spent in each task and IRQ handler, the
+ * longest handler calls and why tasks switched, in windows which the host
+ * reads and clears with EC_CMD_TASK_PROFILE.  Requires CONFIG_TASK_PROFILING
+ * and a core with a cycle counter.
+ */
+#undef CONFIG_TASK_PROFILING_CYCLES
+
+/*
+ * Measure how long tasks take to get the events which interrupt handlers set
+ * for them, with histograms and worst cases per task read through
+ * EC_CMD_TASK_LATENCY.  Cortex-M only.
+ */
+#undef CONFIG_TASK_EVENT_LATENCY
+
 /*****************************************************************************/
 /* Mock config */
 
@@ -3643,6 +3793,13 @@
 /* Compile common code for temperature sensor support */
 #undef CONFIG_TEMP_SENSOR
 
+/*
+ * Read all the sensors in one pass into a timestamped snapshot, shared by the
+ * thermal loop, the memory map and the console. Each reader says how old a
+ * snapshot it accepts, and only starts a new pass when the last is too old.
+ */
+#undef CONFIG_TEMP_SENSOR_SNAPSHOT
+
 /* Support particular temperature sensor chips */
 #undef CONFIG_TEMP_SENSOR_ADT7481	/* ADT 7481 sensor, on I2C bus */
 #undef CONFIG_TEMP_SENSOR_BD99992GW	/* BD99992GW PMIC, on I2C bus */
@@ -4900,6 +5057,14 @@
 /* Define to enable USB State Machine framework. */
 #undef CONFIG_TEST_SM
 
+/*
+ * Define to run the emulator with the discrete-event scheduler
+ * (core/host/task_des.c) instead of one thread per task. Virtual time jumps to
+ * the next timeout whenever all tasks are idle, and interrupt generator
+ * interrupts only fire at scheduling points.
+ */
+#undef CONFIG_TEST_DISCRETE_EVENT
+
 /*
  * This build is not a complete platform/ec based EC, but instead
  * using the platform/ec zephyr module.
@@ -5177,6 +5342,12 @@
 #endif
 #endif /* CONFIG_MKBP_EVENT */
 
+#ifdef CONFIG_MEMMAP_TELEMETRY_EVENT
+#if !defined(CONFIG_MEMMAP_TELEMETRY) || !defined(CONFIG_MKBP_EVENT)
+#error "CONFIG_MEMMAP_TELEMETRY_EVENT needs MEMMAP_TELEMETRY and MKBP_EVENT"
+#endif
+#endif
+
 /******************************************************************************/
 /* Set generic orientation config if a specific orientation config is set. */
 #if defined(CONFIG_KX022_ORIENTATION_SENSOR) || \
@@ -5767,6 +5938,17 @@
 #define CONFIG_SHA256
 #endif
 
+#ifdef CONFIG_FLASH_SECTOR_HASH
+#ifdef CONFIG_FLASH_MULTIPLE_REGION
+#error "CONFIG_FLASH_SECTOR_HASH needs a single flash erase size"
+#endif
+#define CONFIG_SHA256
+#endif
+
+#ifdef CONFIG_FLASH_WRITE_STREAM
+#define CONFIG_SHA256
+#endif
+
 #ifdef CONFIG_SMBUS_PEC
 #define CONFIG_CRC8
 #endif
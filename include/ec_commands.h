@@ -147,7 +147,9 @@ extern "C" {
 /* 0x94 - 0x99: 1st Accelerometer */
 /* 0x9a - 0x9f: 2nd Accelerometer */
 #define EC_MEMMAP_GYRO_DATA        0xa0 /* Gyroscope data 0xa0 - 0xa5 */
-/* Unused 0xa6 - 0xdf */
+/* Unused 0xa6 - 0xa7 */
+#define EC_MEMMAP_TELEMETRY        0xa8 /* struct ec_memmap_telemetry */
+/* Unused 0xd4 - 0xdf */
 
 /*
  * ACPI is unable to access memory mapped data at or above this offset due to
@@ -206,6 +208,26 @@ extern "C" {
 /* Set if some of the static/dynamic data is invalid (or outdated). */
 #define EC_BATT_FLAG_INVALID_DATA 0x20
 
+/*
+ * Telemetry snapshot at EC_MEMMAP_TELEMETRY, all little-endian.
+ *
+ * The EC makes seq odd before updating the block and even again after, so a
+ * reader gets a consistent snapshot by reading seq, then the block, then
+ * seq again, and retrying if seq was odd or changed. The block is updated
+ * once per second.
+ */
+#define EC_MEMMAP_TELEMETRY_VERSION	1
+
+#define EC_TELEMETRY_AC_PRESENT		BIT(0)
+#define EC_TELEMETRY_BATT_PRESENT	BIT(1)
+/* The last battery read failed, battery values are from an earlier read */
+#define EC_TELEMETRY_BATT_STALE		BIT(2)
+
+#define EC_TELEMETRY_TEMP_ENTRIES	8
+#define EC_TELEMETRY_FAN_ENTRIES	EC_FAN_SPEED_ENTRIES
+
+/* Layout is struct ec_memmap_telemetry, defined below */
+
 /* Switch flags at EC_MEMMAP_SWITCHES */
 #define EC_SWITCH_LID_OPEN               0x01
 #define EC_SWITCH_POWER_BUTTON_PRESSED   0x02
@@ -521,6 +543,32 @@ extern "C" {
 
 #endif  /* !CONFIG_HOSTCMD_ALIGNED */
 
+/* Telemetry snapshot at EC_MEMMAP_TELEMETRY */
+struct ec_memmap_telemetry {
+	uint16_t seq;		/* Odd while the EC updates the block */
+	uint8_t version;	/* EC_MEMMAP_TELEMETRY_VERSION */
+	uint8_t flags;		/* EC_TELEMETRY_* */
+	/* Battery */
+	uint16_t batt_voltage;	/* mV */
+	int16_t batt_current;	/* mA, negative when discharging */
+	uint16_t batt_remaining; /* mAh */
+	uint16_t batt_full;	/* mAh, last full charge capacity */
+	uint16_t batt_temp;	/* 0.1 K */
+	uint8_t batt_soc;	/* % */
+	uint8_t reserved;
+	/* Charger, as requested by the battery */
+	uint16_t chg_voltage;	/* mV */
+	uint16_t chg_current;	/* mA */
+	/* Negotiated input (PD or other supplier), power = voltage * current */
+	uint16_t input_voltage;	/* mV */
+	uint16_t input_current;	/* mA, input current limit */
+	/* Same encoding as EC_MEMMAP_TEMP_SENSOR */
+	uint8_t temp[EC_TELEMETRY_TEMP_ENTRIES];
+	/* Same encoding as EC_MEMMAP_FAN */
+	uint16_t fan_rpm[EC_TELEMETRY_FAN_ENTRIES];
+	uint32_t update_ms;	/* EC time of the update, ms, wraps */
+} __ec_align4;
+
 /* LPC command status byte masks */
 /* EC has written a byte in the data register and host hasn't read it yet */
 #define EC_LPC_STATUS_TO_HOST     0x01
@@ -3712,11 +3760,45 @@ enum ec_mkbp_event {
 	/* New online calibration values are available. */
 	EC_MKBP_EVENT_ONLINE_CALIBRATION = 11,
 
+	/*
+	 * Subscribed telemetry values changed by more than their threshold.
+	 * The event data is struct ec_telemetry_event.
+	 */
+	EC_MKBP_EVENT_TELEMETRY = 12,
+
 	/* Number of MKBP events */
 	EC_MKBP_EVENT_COUNT,
 };
 BUILD_ASSERT(EC_MKBP_EVENT_COUNT <= EC_MKBP_EVENT_TYPE_MASK);
 
+/* Fields of EC_MKBP_EVENT_TELEMETRY, see EC_CMD_TELEMETRY_SUBSCRIBE */
+/* AC or battery presence changed */
+#define EC_TELEMETRY_EVENT_POWER	BIT(0)
+/* Battery state of charge moved by soc_delta % */
+#define EC_TELEMETRY_EVENT_SOC		BIT(1)
+/* Battery current moved by current_delta mA */
+#define EC_TELEMETRY_EVENT_BATT_CURRENT	BIT(2)
+/* Input power moved by input_delta mW */
+#define EC_TELEMETRY_EVENT_INPUT	BIT(3)
+/* A temperature sensor entered another temp_band K wide band */
+#define EC_TELEMETRY_EVENT_TEMP		BIT(4)
+/* A fan speed moved by fan_delta rpm */
+#define EC_TELEMETRY_EVENT_FAN		BIT(5)
+
+/* Event data for EC_MKBP_EVENT_TELEMETRY */
+struct ec_telemetry_event {
+	uint16_t fields;	/* EC_TELEMETRY_EVENT_* that changed */
+	uint16_t seq;		/* Matching EC_MEMMAP_TELEMETRY seq */
+	uint8_t flags;		/* EC_TELEMETRY_* */
+	uint8_t batt_soc;	/* % */
+	int16_t batt_current;	/* mA */
+	uint16_t input_power;	/* 100 mW units */
+	uint8_t temp_max;	/* Hottest sensor, EC_MEMMAP_TEMP_SENSOR encoding */
+	uint8_t temp_max_id;
+	uint16_t fan_rpm_max;
+	uint16_t reserved;
+} __ec_align1;
+
 union __ec_align_offset1 ec_response_get_next_data {
 	uint8_t key_matrix[13];
 
@@ -3767,6 +3849,8 @@ union __ec_align_offset1 ec_response_get_next_data_v1 {
 	uint32_t cec_events;
 
 	uint8_t cec_message[16];
+
+	struct ec_telemetry_event telemetry;
 };
 BUILD_ASSERT(sizeof(union ec_response_get_next_data_v1) == 16);
 
@@ -6567,6 +6651,388 @@ struct ec_response_typec_status {
 	/* TODO(b/167700356): Add revisions and source cap PDOs */
 } __ec_align1;
 
+/*
+ * Get the timing of the last RW signature verification. The measurement is
+ * taken by RO and preserved across the jump to RW.
+ */
+#define EC_CMD_RWSIG_VERIFY_TIME	0x0134
+
+/* A verification has been measured */
+#define EC_RWSIG_VERIFY_TIME_VALID	BIT(0)
+/* The RW signature was found valid */
+#define EC_RWSIG_VERIFY_TIME_GOOD	BIT(1)
+
+struct ec_response_rwsig_verify_time {
+	uint32_t flags;		/* EC_RWSIG_VERIFY_TIME_* */
+	uint32_t total_us;	/* Whole verification */
+	uint32_t hash_us;	/* SHA-256 of the RW image */
+	uint32_t rsa_us;	/* RSA signature check */
+	uint32_t end_us;	/* Time since boot when verification ended */
+} __ec_align4;
+
+/*
+ * Read raw records from the event store (see include/event_store.h).
+ *
+ * Offsets count bytes since the store was initialized. Start with offset 0
+ * and pass the offset following the returned data to continue streaming. If
+ * the requested data was already discarded, the response starts at the oldest
+ * record and its offset differs from the requested one.
+ */
+#define EC_CMD_EVENT_STORE_READ	0x0135
+
+struct ec_params_event_store_read {
+	uint32_t offset;
+} __ec_align4;
+
+struct ec_response_event_store_read {
+	uint32_t offset;	/* Store offset of data[0] */
+	uint32_t end;		/* Store offset past the newest record */
+	/*
+	 * Time preceding the oldest record. Add it to the delta of the oldest
+	 * record, unless that is a boot record, to get its time since boot.
+	 */
+	uint32_t base_time;
+	uint8_t data[];
+} __ec_align4;
+
+/*
+ * Get the SHA-256 of each flash erase sector in a range. The host compares
+ * them with a new image to only erase and rewrite the sectors that differ.
+ *
+ * The EC may return fewer hashes than requested if they do not fit in the
+ * response; ask again for the remaining sectors. A count of 0 only returns
+ * the sector size.
+ */
+#define EC_CMD_FLASH_SECTOR_HASH	0x0136
+
+#define EC_FLASH_SECTOR_HASH_SIZE	32
+
+struct ec_params_flash_sector_hash {
+	uint32_t offset;	/* Offset of the first sector, sector aligned */
+	uint32_t count;		/* Number of sectors */
+} __ec_align4;
+
+struct ec_response_flash_sector_hash {
+	uint32_t sector_size;	/* Bytes covered by each hash */
+	uint32_t count;		/* Number of hashes returned */
+	/* count * EC_FLASH_SECTOR_HASH_SIZE bytes */
+	uint8_t hash[];
+} __ec_align4;
+
+/*
+ * Streaming flash write. The EC copies each chunk into one of two buffers
+ * and acknowledges it right away, programming it while the host sends the
+ * next chunk.
+ *
+ * START resets the stream and returns chunk_max. DATA chunks must be sent
+ * with consecutive sequence numbers starting at 0; resending a chunk that
+ * was already accepted is acknowledged without writing it again. FINISH
+ * returns EC_RES_BUSY until all the chunks are programmed, then the SHA-256
+ * of the data read back from flash, in the order the chunks were sent.
+ *
+ * The area must already be erased, as with EC_CMD_FLASH_WRITE.
+ */
+#define EC_CMD_FLASH_WRITE_STREAM	0x0137
+
+enum ec_flash_write_stream_cmd {
+	FLASH_WRITE_STREAM_START = 0,
+	FLASH_WRITE_STREAM_DATA = 1,
+	FLASH_WRITE_STREAM_FINISH = 2,
+};
+
+struct ec_params_flash_write_stream {
+	uint8_t cmd;		/* enum ec_flash_write_stream_cmd */
+	uint8_t reserved[3];
+	uint32_t seq;		/* DATA: chunk sequence number */
+	uint32_t offset;	/* DATA: flash offset */
+	uint32_t size;		/* DATA: bytes following this struct */
+	/* Followed by data to write */
+} __ec_align4;
+
+struct ec_response_flash_write_stream {
+	uint32_t seq_accepted;	/* Chunks accepted so far */
+	uint32_t seq_written;	/* Chunks programmed so far */
+	uint32_t chunk_max;	/* Max size of a DATA chunk */
+	uint8_t sha256[32];	/* FINISH: hash of the data read back */
+} __ec_align4;
+
+/*
+ * Telemetry delta events
+ *
+ * The EC compares every EC_MEMMAP_TELEMETRY update with the values it last
+ * reported, and sends EC_MKBP_EVENT_TELEMETRY when a subscribed field moved by
+ * at least its threshold. Events are at least min_interval_ms apart; changes
+ * in between are merged into the next event. A threshold of 0 selects the
+ * EC default, which the response reports.
+ */
+#define EC_CMD_TELEMETRY_SUBSCRIBE	0x0138
+
+struct ec_telemetry_subscription {
+	uint16_t fields;		/* EC_TELEMETRY_EVENT_*, 0 to stop */
+	uint16_t min_interval_ms;
+	uint16_t current_delta;		/* mA */
+	uint16_t input_delta;		/* mW */
+	uint16_t fan_delta;		/* rpm */
+	uint8_t soc_delta;		/* % */
+	uint8_t temp_band;		/* K */
+} __ec_align2;
+
+/*
+ * Get or set the tuning of the fan speed PID, see CONFIG_FAN_PID. Gains are
+ * Q16 fixed point, in duty percent per RPM of error, per RPM * s for ki and
+ * per RPM / s for kd. Gains above 100 % per RPM (6553600), negative gains and
+ * i_max above 100 % are rejected with EC_RES_INVALID_PARAM. The response holds
+ * the tuning in use and the state of the loop.
+ */
+#define EC_CMD_FAN_PID 0x0139
+
+/* Replace the tuning of the fan with the one in the params */
+#define EC_FAN_PID_SET BIT(0)
+
+struct ec_fan_pid_params {
+	int32_t kp;
+	int32_t ki;
+	int32_t kd;
+	int32_t kff_load;	/* Q16 duty % per % of CPU load */
+	uint16_t slew_up;	/* Setpoint rpm per second, 0 for no limit */
+	uint16_t slew_down;	/* Setpoint rpm per second, 0 for no limit */
+	uint16_t i_max;		/* Limit of the integral term, duty % */
+	uint16_t reserved;
+} __ec_align4;
+
+struct ec_params_fan_pid {
+	uint8_t fan;
+	uint8_t flags;		/* EC_FAN_PID_* */
+	uint16_t reserved;
+	struct ec_fan_pid_params params;
+} __ec_align4;
+
+struct ec_response_fan_pid {
+	struct ec_fan_pid_params params;
+	uint16_t target_rpm;
+	uint16_t setpoint_rpm;	/* Target after the slew limits */
+	uint16_t rpm;
+	uint8_t duty;		/* % */
+	uint8_t load;		/* % */
+} __ec_align4;
+
+/*
+ * What woke the EC from idle, and why it could not use its deepest sleep.
+ *
+ * Each wake is charged to one source, along with the time the EC stays awake
+ * until it goes back to idle. The table holds the first sources seen, wakes
+ * from others only add up in "other". The table is read in pages of
+ * EC_WAKE_STATS_PAGE sources, starting at source_offset.
+ */
+#define EC_CMD_WAKE_STATS 0x013A
+
+#define EC_WAKE_STATS_CLEAR	BIT(0)	/* Reset after reading */
+#define EC_WAKE_STATS_PAGE	8
+#define EC_WAKE_HIST_BUCKETS	10
+
+enum ec_wake_source_type {
+	EC_WAKE_SRC_NONE = 0,
+	EC_WAKE_SRC_TIMER,	/* Task timer, id is the task */
+	EC_WAKE_SRC_DEFERRED,	/* Deferred call, addr is the routine */
+	EC_WAKE_SRC_IRQ,	/* id is the IRQ number */
+	EC_WAKE_SRC_GPIO,	/* GPIO interrupt, id is the signal */
+};
+
+/* Reasons the EC stayed in light sleep */
+enum ec_wake_veto {
+	EC_WAKE_VETO_TIME = 0,	/* Next timer too close */
+	EC_WAKE_VETO_SLEEP_MASK, /* Bits 0-15 of the sleep mask set */
+	EC_WAKE_VETO_LOW_SPEED,	/* Console in use, JTAG or forced off */
+	EC_WAKE_VETO_UART,	/* UART output pending */
+	EC_WAKE_VETO_COUNT
+};
+
+struct ec_wake_source {
+	uint8_t type;		/* enum ec_wake_source_type */
+	uint8_t reserved;
+	uint16_t id;
+	uint32_t addr;
+	uint32_t count;		/* Wakes */
+	uint32_t awake_us;	/* Time awake after them, saturates */
+} __ec_align4;
+
+struct ec_params_wake_stats {
+	uint8_t flags;		/* EC_WAKE_STATS_* */
+	uint8_t source_offset;
+	uint16_t reserved;
+} __ec_align4;
+
+struct ec_response_wake_stats {
+	uint32_t sleep_count;	/* Idle passes in light sleep */
+	uint32_t dsleep_count;	/* Idle passes in heavy sleep */
+	uint32_t dsleep_ms;	/* Time in heavy sleep */
+	uint32_t veto[EC_WAKE_VETO_COUNT];
+	uint16_t veto_mask[16];	/* EC_WAKE_VETO_SLEEP_MASK per mask bit */
+	/* Sleep lengths, bucket n below 64 << 2n us, the last one above */
+	uint32_t hist[EC_WAKE_HIST_BUCKETS];
+	uint32_t other;		/* Wakes from sources not in the table */
+	uint8_t source_count;	/* Sources in the table */
+	uint8_t reserved[3];
+	struct ec_wake_source sources[EC_WAKE_STATS_PAGE];
+} __ec_align4;
+
+/*
+ * Core clock cycles spent in each task and interrupt handler since the
+ * counters were last cleared. Handler cycles do not include the handlers which
+ * pre-empt them, task cycles do not include any handler, and cycles the core
+ * spends asleep are not counted at all.
+ *
+ * Tasks or IRQs are read in pages of EC_TASK_PROFILE_PAGE entries, starting
+ * at offset. IRQs which did not fire are left out. next_offset is where the
+ * next page starts, or 0 after the last one.
+ */
+#define EC_CMD_TASK_PROFILE 0x013B
+
+#define EC_TASK_PROFILE_CLEAR	BIT(0)	/* Reset after reading */
+#define EC_TASK_PROFILE_IRQS	BIT(1)	/* Read IRQs instead of tasks */
+#define EC_TASK_PROFILE_PAGE	8
+
+/* Why the running task changed */
+enum ec_task_switch_reason {
+	EC_TASK_SWITCH_WAIT = 0,	/* The task waited for an event */
+	EC_TASK_SWITCH_WAKE,	/* A task woke a higher priority one */
+	EC_TASK_SWITCH_IRQ,	/* An interrupt woke a higher priority task */
+	EC_TASK_SWITCH_COUNT
+};
+
+struct ec_task_profile_entry {
+	uint16_t id;		/* Task ID or IRQ number */
+	uint16_t reserved;
+	uint32_t count;		/* Times switched to, or handler calls */
+	uint64_t cycles;
+	uint32_t max_cycles;	/* Longest run or handler call */
+} __ec_align4;
+
+struct ec_params_task_profile {
+	uint8_t flags;		/* EC_TASK_PROFILE_* */
+	uint8_t reserved;
+	uint16_t offset;
+} __ec_align4;
+
+struct ec_response_task_profile {
+	uint32_t cpu_hz;	/* Cycle counter rate */
+	uint32_t window_ms;	/* Since the counters were cleared */
+	uint32_t switches[EC_TASK_SWITCH_COUNT];
+	uint16_t next_offset;
+	uint8_t count;		/* Entries in this page */
+	uint8_t reserved;
+	struct ec_task_profile_entry entries[EC_TASK_PROFILE_PAGE];
+} __ec_align4;
+
+/*
+ * Statistical profiler. A periodic interrupt samples the PC and LR it
+ * interrupted. Samples queue up in the EC until the host reads them, up to
+ * EC_PC_PROFILE_PAGE per command, and the ones which do not fit are dropped.
+ */
+#define EC_CMD_PC_PROFILE 0x013C
+
+#define EC_PC_PROFILE_START	BIT(0)	/* (Re)start sampling at rate_hz */
+#define EC_PC_PROFILE_STOP	BIT(1)
+#define EC_PC_PROFILE_PAGE	16
+
+struct ec_pc_sample {
+	uint32_t pc;
+	uint32_t lr;
+	uint16_t exc;		/* Exception number, 0 if in a task */
+	uint8_t task;		/* Current task */
+	uint8_t reserved;
+} __ec_align4;
+
+struct ec_params_pc_profile {
+	uint8_t flags;		/* EC_PC_PROFILE_* */
+	uint8_t reserved;
+	uint16_t rate_hz;
+} __ec_align4;
+
+struct ec_response_pc_profile {
+	uint16_t rate_hz;	/* 0 if stopped */
+	uint8_t count;		/* Samples in this page */
+	uint8_t reserved;
+	uint32_t dropped;	/* Since the previous read */
+	uint32_t pending;	/* Samples left after this page */
+	struct ec_pc_sample samples[EC_PC_PROFILE_PAGE];
+} __ec_align4;
+
+/*
+ * Time from an interrupt handler setting an event for a task, to the task
+ * getting it from task_wait_event(). Task timer events are left out.
+ *
+ * Each task has a histogram, and a record of its worst latency: the IRQ, the
+ * task it interrupted, and the task which ran last before the woken one.
+ * Tasks are read EC_TASK_LATENCY_PAGE at a time, starting at offset.
+ */
+#define EC_CMD_TASK_LATENCY 0x013D
+
+#define EC_TASK_LATENCY_CLEAR	BIT(0)	/* Reset after reading */
+#define EC_TASK_LATENCY_PAGE	4
+#define EC_TASK_LATENCY_BUCKETS	10
+
+struct ec_task_latency {
+	uint8_t task;
+	uint8_t reserved;
+	uint16_t worst_irq;	/* IRQ which set the event */
+	uint32_t worst_us;
+	uint8_t worst_interrupted; /* Task running when the IRQ came */
+	uint8_t worst_ran_before; /* Task switched out for this one */
+	uint16_t reserved2;
+	/* Bucket n counts latencies below 8 << n us, the last one the rest */
+	uint32_t hist[EC_TASK_LATENCY_BUCKETS];
+} __ec_align4;
+
+struct ec_params_task_latency {
+	uint8_t flags;		/* EC_TASK_LATENCY_* */
+	uint8_t offset;		/* First task */
+	uint16_t reserved;
+} __ec_align4;
+
+struct ec_response_task_latency {
+	uint8_t task_count;	/* Tasks in total */
+	uint8_t count;		/* Tasks in this page */
+	uint16_t reserved;
+	struct ec_task_latency tasks[EC_TASK_LATENCY_PAGE];
+} __ec_align4;
+
+/*
+ * Lock statistics of the mutexes locked since boot or the last clear.
+ * Mutexes have no names, so they are told apart by address; look the address
+ * up in the EC image symbols. Times are in us, task IDs are 0xff when unknown.
+ * Mutexes are read EC_MUTEX_STATS_PAGE at a time, starting at offset.
+ */
+#define EC_CMD_MUTEX_STATS 0x013E
+
+#define EC_MUTEX_STATS_CLEAR	BIT(0)	/* Reset after reading */
+#define EC_MUTEX_STATS_PAGE	8
+
+struct ec_mutex_stats {
+	uint32_t address;
+	uint32_t locks;
+	uint32_t contended;	/* Locks which had to wait */
+	uint32_t max_wait_us;
+	uint32_t max_hold_us;
+	uint8_t owner;		/* Task holding it now */
+	uint8_t max_wait_task;	/* Task which waited the longest */
+	uint8_t max_wait_owner;	/* Task it waited for */
+	uint8_t max_hold_task;	/* Task which held it the longest */
+} __ec_align4;
+
+struct ec_params_mutex_stats {
+	uint8_t flags;		/* EC_MUTEX_STATS_* */
+	uint8_t offset;		/* First mutex */
+	uint16_t reserved;
+} __ec_align4;
+
+struct ec_response_mutex_stats {
+	uint8_t mutex_count;	/* Mutexes in total */
+	uint8_t count;		/* Mutexes in this page */
+	uint16_t reserved;
+	struct ec_mutex_stats mutexes[EC_MUTEX_STATS_PAGE];
+} __ec_align4;
+
 /*****************************************************************************/
 /* The command range 0x200-0x2FF is reserved for Rotor. */
 
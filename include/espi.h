@@ -54,6 +54,23 @@ BUILD_ASSERT(VW_SIGNAL_END < VW_LIMIT);
  */
 int espi_vw_set_wire(enum espi_vw_signal signal, uint8_t level);
 
+struct espi_vw_level {
+	enum espi_vw_signal signal;
+	uint8_t level;
+};
+
+/**
+ * Set several eSPI Virtual-Wire signals to Host at once
+ *
+ * Wires sharing a host index are updated by a single register write, so the
+ * host sees them change together. Not every chip supports this.
+ *
+ * @param wires  signals and levels to set
+ * @param count  number of entries in wires
+ * @return EC_SUCCESS, or non-zero if error (no wire is changed then).
+ */
+int espi_vw_set_wires(const struct espi_vw_level *wires, int count);
+
 /**
  * Get eSPI Virtual-Wire signal from host
  *
@@ -97,5 +114,30 @@ int espi_signal_is_vw(int signal);
 int espi_oob_build_peci_command(uint8_t srcAddr, uint8_t destAddr, uint8_t cmdCode,
 		uint8_t nWrite, uint8_t *writeBuf, uint8_t *readBuf);
 
+/**
+ * Start a PECI command over the eSPI OOB channel without waiting for the
+ * response. There is a single OOB buffer, so only one command can be in
+ * flight.
+ *
+ * @return EC_SUCCESS
+ */
+int espi_oob_peci_send(uint8_t srcAddr, uint8_t destAddr, uint8_t cmdCode,
+		uint8_t nWrite, uint8_t *writeBuf);
+
+/**
+ * Get the response to the command started by espi_oob_peci_send().
+ *
+ * @param readBuf	Filled with the PECI read data
+ * @param rlen		Size of readBuf
+ * @return EC_SUCCESS, or EC_ERROR_BUSY if the response did not arrive yet.
+ */
+int espi_oob_peci_receive(uint8_t *readBuf, int rlen);
+
+/**
+ * Called from the OOB RX interrupt when the host sent a packet to the EC,
+ * e.g. the response to espi_oob_peci_send().
+ */
+__override_proto void espi_oob_rx_notify(void);
+
 
 #endif  /* __CROS_EC_ESPI_H */
@@ -0,0 +1,99 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Compact structured event store */
+
+#ifndef __CROS_EC_EVENT_STORE_H
+#define __CROS_EC_EVENT_STORE_H
+
+#include "common.h"
+
+/*
+ * Each record is encoded as:
+ *
+ *   type   (1 byte)
+ *   size   (1 byte, payload size)
+ *   delta  (varint, time since the previous record)
+ *   data   (varint)
+ *   payload (size bytes)
+ *
+ * Varints are little-endian base 128 (7 bits per byte, MSB set on all but the
+ * last byte). Times are the microsecond counter shifted right by
+ * EVENT_STORE_TIME_SHIFT. The delta of an EVENT_STORE_BOOT record is the time
+ * since boot, as the time base restarts on every boot.
+ */
+
+#define EVENT_STORE_TIME_SHIFT 10 /* 1 LSB = 1024us */
+#define EVENT_STORE_MAX_PAYLOAD 31
+#define EVENT_STORE_VARINT_MAX 5
+#define EVENT_STORE_RECORD_MAX (2 + 2 * EVENT_STORE_VARINT_MAX + \
+				EVENT_STORE_MAX_PAYLOAD)
+
+enum event_store_type {
+	/* data: reset flags, payload: image copy, jumped (1 byte each) */
+	EVENT_STORE_BOOT = 0,
+	/* data: power state | input signals << 8 */
+	EVENT_STORE_POWER_STATE = 1,
+	/* data: event_log data | type << 16 | size flags << 24 */
+	EVENT_STORE_EVENT_LOG = 2,
+	/* Types from here on are free for board use */
+	EVENT_STORE_BOARD = 0x80,
+};
+
+struct event_store_record {
+	uint32_t delta;
+	uint32_t data;
+	uint8_t type;
+	uint8_t size;
+	uint8_t payload[EVENT_STORE_MAX_PAYLOAD];
+};
+
+/**
+ * Add a record to the event store, discarding the oldest records if needed.
+ *
+ * Can be called from interrupt context.
+ *
+ * @param type		Record type (enum event_store_type)
+ * @param data		Type-defined data
+ * @param payload	Optional payload, may be NULL if size is 0
+ * @param size		Payload size in bytes, up to EVENT_STORE_MAX_PAYLOAD
+ */
+void event_store_add(uint8_t type, uint32_t data, const void *payload,
+		     int size);
+
+/**
+ * Copy raw records out of the event store.
+ *
+ * Offsets count bytes since the store was initialized and never wrap back.
+ * If *offset points to data that has already been discarded, the copy starts
+ * at the oldest record instead and *offset is updated.
+ *
+ * @param offset	Store offset to copy from; updated as described above
+ * @param buf		Destination buffer
+ * @param len		Size of the destination buffer
+ * @param end		If not NULL, set to the offset past the newest record
+ * @param base_time	If not NULL, set to the time preceding the oldest
+ *			record, to add to its delta unless it is a boot record
+ * @return the number of bytes copied.
+ */
+int event_store_read(uint32_t *offset, uint8_t *buf, int len, uint32_t *end,
+		     uint32_t *base_time);
+
+/**
+ * Decode one record from a raw buffer.
+ *
+ * @param buf		Raw record data
+ * @param len		Bytes available in buf
+ * @param r		Decoded record
+ * @return the record length in bytes, or 0 if buf does not hold a complete
+ * valid record.
+ */
+int event_store_decode(const uint8_t *buf, int len,
+		       struct event_store_record *r);
+
+/* Discard all the records. */
+void event_store_clear(void);
+
+#endif /* __CROS_EC_EVENT_STORE_H */
@@ -0,0 +1,103 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Fixed-point PID fan speed control */
+
+#ifndef __CROS_EC_FAN_PID_H
+#define __CROS_EC_FAN_PID_H
+
+#include "common.h"
+#include "ec_commands.h"
+
+/* Fraction bits of the gains and of the duty cycle */
+#define FAN_PID_Q 16
+
+/* Largest gain the host may set, 100 % duty per RPM */
+#define FAN_PID_GAIN_MAX (100 << FAN_PID_Q)
+
+struct fan_pid {
+	struct ec_fan_pid_params params;
+	int setpoint;		/* Target after the slew limits, RPM */
+	int prev_rpm;		/* Speed at the previous update, RPM */
+	int32_t integ;		/* Integral term, Q16 duty % */
+	int saturated;		/* The last output was clipped */
+};
+
+/* Tuning each fan starts with */
+extern const struct ec_fan_pid_params fan_pid_defaults;
+
+/**
+ * Reset the loop state and load the default tuning.
+ */
+void fan_pid_init(struct fan_pid *pid);
+
+/**
+ * Check a tuning from the host.
+ *
+ * Gains must be between 0 and FAN_PID_GAIN_MAX, and i_max at most 100 %, so
+ * the loop cannot overflow.
+ *
+ * @return 1 if the tuning can be used, 0 if not
+ */
+int fan_pid_params_valid(const struct ec_fan_pid_params *p);
+
+/**
+ * Move the setpoint towards the target, within the slew limits.
+ *
+ * The setpoint follows the target right away when the fan starts or stops,
+ * and never lags the actual speed.
+ *
+ * @param target	Target speed, RPM
+ * @param rpm		Measured speed, RPM
+ * @param dt_ms		Time since the previous update
+ * @return the new setpoint, RPM
+ */
+int fan_pid_slew(struct fan_pid *pid, int target, int rpm, int dt_ms);
+
+/**
+ * Run one step of the loop towards the setpoint.
+ *
+ * The integral term stops growing while the output is clipped, so the fan
+ * does not overshoot once it gets out of saturation.
+ *
+ * @param rpm		Measured speed, RPM
+ * @param ff		Open loop duty cycle for the setpoint, %
+ * @param dt_ms		Time since the previous update
+ * @return the duty cycle, %
+ */
+int fan_pid_update(struct fan_pid *pid, int rpm, int ff, int dt_ms);
+
+/**
+ * Set the target speed of a fan, and start the loop if it is not running.
+ *
+ * @param fan		Fan index
+ * @param rpm		Target speed, 0 to stop the fan
+ */
+void fan_pid_set_target(int fan, int rpm);
+
+/**
+ * Set the expected heat load, e.g. from the CPU power limits. Changes show up
+ * in the duty cycle right away, scaled by kff_load, ahead of the temperature.
+ *
+ * @param load		Load, 0 to 100 %
+ */
+void fan_pid_set_load(int load);
+
+/**
+ * Return 1 if the loop cannot reach the setpoint of a fan.
+ */
+int fan_pid_saturated(int fan);
+
+/**
+ * Open loop duty cycle to run a fan at the given speed. The default assumes
+ * the speed is proportional to the duty cycle up to rpm_max.
+ *
+ * @param fan		Fan index
+ * @param rpm		Speed, RPM
+ * @return the duty cycle, %
+ */
+__override_proto int board_fan_pid_feedforward(int fan, int rpm);
+
+#endif /* __CROS_EC_FAN_PID_H */
@@ -279,6 +279,37 @@ struct deferred_data {
  */
 int hook_call_deferred(const struct deferred_data *data, int us);
 
+/**
+ * Start a timer to call a deferred routine, which may run late.
+ *
+ * Same as hook_call_deferred(), but the routine may be called up to slack_us
+ * after the delay, so the hook task can run it in the same wakeup as another
+ * deferred routine or HOOK_TICK.  Routines which do not need precise timing
+ * should use this, to let the EC sleep longer.
+ *
+ * @param data		The deferred_data struct created by DECLARE_DEFERRED().
+ * @param us		Delay in microseconds, as for hook_call_deferred().
+ * @param slack_us	How much later than the delay the routine may run.
+ *
+ * @return non-zero if error.
+ */
+int hook_call_deferred_slack(const struct deferred_data *data, int us,
+			     int slack_us);
+
+/**
+ * Return how many deferred calls ran in a wakeup due for something else,
+ * thanks to their slack.
+ */
+uint32_t hook_deferred_coalesced(void);
+
+/**
+ * Return the deferred routine due first.
+ *
+ * @param until		If not NULL, set to when it is due
+ * @return its deferred_data, or NULL if no routine is pending.
+ */
+const struct deferred_data *hook_next_deferred(uint64_t *until);
+
 /*
  * Hooks are not currently supported by the Zephyr shim.
  * TODO(b/168799177): Implement compatible DECLARE_HOOK macro for
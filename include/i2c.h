@@ -124,6 +124,49 @@ struct i2c_port_t {
 extern const struct i2c_port_t i2c_ports[];
 extern const unsigned int i2c_ports_used;
 
+/* Flags for struct i2c_cache_reg */
+#define I2C_CACHE_OFFSET16	BIT(0)	/* reg is a 16-bit offset */
+#define I2C_CACHE_WRITE_DROP	BIT(1)	/* Read again after a write */
+
+/*
+ * A register whose reads are cached, see CONFIG_I2C_CACHE.  The board sets
+ * the fields up to ttl_us, the rest belongs to the cache.
+ */
+struct i2c_cache_reg {
+	int port;
+	uint16_t slave_addr_flags;
+	uint16_t reg;
+	/* Bytes read at once, up to CONFIG_I2C_CACHE_MAX_SIZE */
+	uint8_t size;
+	uint8_t flags;		/* I2C_CACHE_* */
+	/* How long a value read stays good, or 0 until written or reset */
+	uint32_t ttl_us;
+
+	uint8_t valid;
+	uint8_t gen;		/* Changed by every write and invalidation */
+	uint64_t read_time;
+	uint32_t hits;
+	uint32_t misses;
+	uint8_t data[CONFIG_I2C_CACHE_MAX_SIZE];
+};
+
+extern struct i2c_cache_reg i2c_cache_regs[];
+extern const unsigned int i2c_cache_regs_used;
+
+/**
+ * Forget the cached registers of a device, for instance after resetting it.
+ *
+ * @param port			Port of the device
+ * @param slave_addr_flags	Address of the device
+ */
+#ifdef CONFIG_I2C_CACHE
+void i2c_cache_invalidate(int port, uint16_t slave_addr_flags);
+#else
+static inline void i2c_cache_invalidate(int port, uint16_t slave_addr_flags)
+{
+}
+#endif
+
 #ifdef CONFIG_CMD_I2C_STRESS_TEST
 struct i2c_test_reg_info {
 	int read_reg;      /* Read register (WHO_AM_I, DEV_ID, MAN_ID) */
@@ -197,6 +240,56 @@ int i2c_xfer_unlocked(const int port,
 		      const uint8_t *out, int out_size,
 		      uint8_t *in, int in_size, int flags);
 
+/**
+ * An I2C transfer for i2c_xfer_async().
+ *
+ * The caller fills in the fields up to task, and keeps the descriptor and the
+ * buffers until the transfer is done.
+ */
+struct i2c_xfer_async {
+	int port;
+	uint16_t slave_addr_flags;
+	const uint8_t *out;
+	int out_size;
+	uint8_t *in;
+	int in_size;
+	/* Flags (see I2C_XFER_* above), usually I2C_XFER_SINGLE */
+	int flags;
+	/*
+	 * Called from the I2C interrupt, or with interrupts disabled, when the
+	 * transfer is done.  It may queue more transfers.  Optional.
+	 */
+	void (*done)(struct i2c_xfer_async *xfer);
+	/* Task to send TASK_EVENT_I2C_DONE when done, or TASK_ID_INVALID */
+	int task;
+
+	/* Set by the driver */
+	volatile int busy;	/* Queued or running */
+	int rv;			/* EC_SUCCESS or error, once not busy */
+	struct i2c_xfer_async *next;
+};
+
+/**
+ * Queue a transfer on the controller of its port.
+ *
+ * Transfers on a controller run back to back from its interrupt, in the order
+ * they were queued, without holding the port lock.  A transfer without
+ * I2C_XFER_STOP leaves the bus to the same task until one of its transfers
+ * sends the STOP.
+ *
+ * TASK_EVENT_I2C_DONE may be taken by another wait in the same task, so wait
+ * with the busy field:
+ *
+ *	while (xfer.busy)
+ *		task_wait_event_mask(TASK_EVENT_I2C_DONE, -1);
+ *
+ * Requires CONFIG_I2C_ASYNC.  May be called from interrupt context.
+ *
+ * @param xfer		Transfer to queue
+ * @return EC_SUCCESS if queued, else non-zero and the transfer is not queued.
+ */
+int i2c_xfer_async(struct i2c_xfer_async *xfer);
+
 #define I2C_LINE_SCL_HIGH BIT(0)
 #define I2C_LINE_SDA_HIGH BIT(1)
 #define I2C_LINE_IDLE (I2C_LINE_SCL_HIGH | I2C_LINE_SDA_HIGH)
@@ -53,4 +53,80 @@ int chip_i2c_set_freq(int port, enum i2c_freq freq);
  */
 enum i2c_freq chip_i2c_get_freq(int port);
 
+/**
+ * Mark a controller as running queued transfers, or not, so the EC stays out
+ * of deep sleep while it does.  Call with interrupts disabled.
+ *
+ * @param controller	Controller
+ * @param busy		Non-zero if it has transfers running or queued
+ */
+void i2c_async_set_busy(int controller, int busy);
+
+/*
+ * Transfers queued on one controller, for chips with CONFIG_I2C_ASYNC.  The
+ * chip driver runs them one at a time, and calls the functions below with
+ * interrupts disabled.
+ */
+struct i2c_async_queue {
+	struct i2c_xfer_async *running;
+	struct i2c_xfer_async *queue;
+	/* Task which left the bus open, or TASK_ID_INVALID */
+	int open_task;
+	uint32_t start_time;
+	/* Statistics */
+	uint32_t queued;
+	uint32_t done;
+	uint32_t errors;
+	uint16_t depth;
+	uint16_t max_depth;
+	uint64_t busy_us;
+};
+
+/**
+ * Set up an empty queue.
+ *
+ * @param q		Queue
+ */
+void i2c_async_queue_init(struct i2c_async_queue *q);
+
+/**
+ * Add a transfer at the end of the queue, and mark it busy.
+ *
+ * @param q		Queue
+ * @param xfer		Transfer
+ */
+void i2c_async_push(struct i2c_async_queue *q, struct i2c_xfer_async *xfer);
+
+/**
+ * Take the next transfer to run: the first one queued, unless the bus was left
+ * open, then the first one of the task which left it open.
+ *
+ * @param q		Queue, with nothing running
+ * @return the transfer, now running, or NULL if none can run
+ */
+struct i2c_xfer_async *i2c_async_next(struct i2c_async_queue *q);
+
+/**
+ * Put the running transfer back at the head of the queue.
+ *
+ * @param q		Queue
+ */
+void i2c_async_requeue(struct i2c_async_queue *q);
+
+/**
+ * Finish the running transfer, and call its callback or wake its task.
+ *
+ * @param q		Queue
+ * @param rv		EC_SUCCESS, or the error of the transfer
+ */
+void i2c_async_complete(struct i2c_async_queue *q, int rv);
+
+/**
+ * Finish every queued transfer with an error, without running them.
+ *
+ * @param q		Queue, with nothing running
+ * @param rv		Error
+ */
+void i2c_async_fail_queued(struct i2c_async_queue *q, int rv);
+
 #endif /* __CROS_EC_I2C_PRIVATE_H */
@@ -52,6 +52,47 @@ int keyboard_host_write_avaliable(void);
 enum ec_error_list keyboard_scancode_callback(uint16_t *make_code,
 					      int8_t pressed);
 
+/**
+ * Board-specific replacement for get_scancode_set2() in the 8042 matrix
+ * callback, for boards that resolve key layers (e.g. Fn) from row and column.
+ *
+ * A key must resolve to the same code on release as it did on press.
+ *
+ * @param row		Row of the key in action.
+ * @param col		Column of the key in action.
+ * @param pressed	Is the key being pressed (1) or released (0).
+ * @return the make code (set 2) to send, a board-defined code consumed by
+ * keyboard_scancode_callback(), or 0 if the key has no code.
+ */
+uint16_t keyboard_scancode_lookup(uint8_t row, uint8_t col, int8_t pressed);
+
+/**
+ * Notify the keyboard module that the host read the 8042 output buffer, and
+ * load the next queued byte.
+ *
+ * Note: This is called in interrupt context by the output buffer empty
+ * interrupt handler, when CONFIG_8042_OBE_REFILL is enabled.
+ *
+ * @return 1 if the output was handled, 0 if the keyboard protocol task needs
+ * to be woken up.
+ */
+int keyboard_host_read_done(void);
+
+/* Statistics of the queue of bytes to the host */
+struct kb_to_host_stats {
+	uint32_t high_water;	/* Most bytes queued at once */
+	uint32_t dropped;	/* Bytes dropped because the queue was full */
+	uint32_t isr_refills;	/* Bytes sent by keyboard_host_read_done() */
+};
+
+/**
+ * Get the statistics of the queue of bytes to the host.
+ *
+ * @param stats		Filled with the statistics
+ * @param clear		Reset the statistics after reading them
+ */
+void keyboard_get_to_host_stats(struct kb_to_host_stats *stats, int clear);
+
 /**
  * Send aux data to host from interrupt context.
  *
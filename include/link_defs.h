@@ -82,11 +82,17 @@ extern const struct deferred_data __deferred_funcs[];
 extern const struct deferred_data __deferred_funcs_end[];
 extern uint64_t __deferred_until[];
 extern uint64_t __deferred_until_end[];
+extern uint32_t __deferred_slack[];
+extern uint32_t __deferred_slack_end[];
 
 /* I2C fake devices for unit testing */
 extern const struct test_i2c_xfer __test_i2c_xfer[];
 extern const struct test_i2c_xfer __test_i2c_xfer_end[];
 
+/* Microbenchmarks for unit testing */
+extern const struct benchmark __benchmarks[];
+extern const struct benchmark __benchmarks_end[];
+
 /* Host commands */
 extern const struct host_command __hcmds[];
 extern const struct host_command __hcmds_end[];
@@ -0,0 +1,19 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Telemetry snapshot at EC_MEMMAP_TELEMETRY */
+
+#ifndef __CROS_EC_MEMMAP_TELEMETRY_H
+#define __CROS_EC_MEMMAP_TELEMETRY_H
+
+/**
+ * Refresh the telemetry block in the memory map.
+ *
+ * Called once per second after the temperature sensors were read. There must
+ * be a single writer, so this is only called from the hook task.
+ */
+void memmap_telemetry_update(void);
+
+#endif /* __CROS_EC_MEMMAP_TELEMETRY_H */
@@ -0,0 +1,50 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Statistical PC profiler */
+
+#ifndef __CROS_EC_PC_PROFILER_H
+#define __CROS_EC_PC_PROFILER_H
+
+#include "common.h"
+
+/**
+ * Start sampling, dropping the samples not read yet.
+ *
+ * @param rate_hz	Samples per second
+ * @return EC_SUCCESS, or non-zero if the timer cannot run at that rate.
+ */
+int pc_profiler_start(int rate_hz);
+
+/**
+ * Stop sampling. The samples taken so far can still be read.
+ */
+void pc_profiler_stop(void);
+
+/**
+ * Take one sample, from the sampling interrupt.
+ *
+ * @param excep_lr	LR on entry to the interrupt (EXC_RETURN)
+ * @param excep_sp	SP on entry to the interrupt
+ */
+void pc_profiler_sample(uint32_t excep_lr, uint32_t excep_sp);
+
+/**
+ * Start the periodic interrupt which calls pc_profiler_sample().
+ *
+ * Provided by the chip with CONFIG_PC_PROFILER_HW_TIMER, else the core uses
+ * the SysTick.
+ *
+ * @param rate_hz	Interrupts per second
+ * @return EC_SUCCESS, or non-zero if the timer cannot run at that rate.
+ */
+int pc_profiler_timer_start(int rate_hz);
+
+/**
+ * Stop the periodic interrupt.
+ */
+void pc_profiler_timer_stop(void);
+
+#endif /* __CROS_EC_PC_PROFILER_H */
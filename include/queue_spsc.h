@@ -0,0 +1,166 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Single producer, single consumer queue.
+ */
+#ifndef __CROS_EC_QUEUE_SPSC_H
+#define __CROS_EC_QUEUE_SPSC_H
+
+#include "common.h"
+#include "util.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A queue with one producer and one consumer, which may run in different
+ * contexts (an interrupt and a task, say) without locking.  Only the producer
+ * moves the tail and only the consumer moves the head, and each publishes its
+ * index with release ordering after touching the buffer, so the other side
+ * sees the units before it sees the index move.
+ *
+ * Compared to struct queue there are no policies, so notify the other side
+ * yourself, and the unit type is known at compile time, so a single unit is
+ * moved by assignment rather than memcpy().
+ *
+ * As in struct queue, head and tail are not wrapped until they index the
+ * buffer:
+ *
+ * Empty:
+ *     head == tail
+ *
+ * Full:
+ *     tail - head == buffer units
+ */
+struct queue_spsc_state {
+	size_t head; /* head: next to dequeue, written by the consumer */
+	size_t tail; /* tail: next to enqueue, written by the producer */
+};
+
+static inline size_t queue_spsc_count(const struct queue_spsc_state *s)
+{
+	return __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE) -
+	       __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+}
+
+/* Copy up to count units in, return how many fit.  Producer only. */
+static inline size_t queue_spsc_add(struct queue_spsc_state *s, void *buffer,
+				    size_t units, size_t unit_bytes,
+				    const void *src, size_t count)
+{
+	size_t tail = __atomic_load_n(&s->tail, __ATOMIC_RELAXED);
+	size_t head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+	size_t transfer = MIN(count, units - (tail - head));
+	size_t index = tail & (units - 1);
+	size_t first = MIN(transfer, units - index);
+
+	memcpy((uint8_t *)buffer + index * unit_bytes, src,
+	       first * unit_bytes);
+	if (first < transfer)
+		memcpy(buffer, (const uint8_t *)src + first * unit_bytes,
+		       (transfer - first) * unit_bytes);
+
+	__atomic_store_n(&s->tail, tail + transfer, __ATOMIC_RELEASE);
+	return transfer;
+}
+
+/* Copy up to count units out, return how many there were.  Consumer only. */
+static inline size_t queue_spsc_remove(struct queue_spsc_state *s,
+				       const void *buffer, size_t units,
+				       size_t unit_bytes, void *dest,
+				       size_t count)
+{
+	size_t head = __atomic_load_n(&s->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE);
+	size_t transfer = MIN(count, tail - head);
+	size_t index = head & (units - 1);
+	size_t first = MIN(transfer, units - index);
+
+	memcpy(dest, (const uint8_t *)buffer + index * unit_bytes,
+	       first * unit_bytes);
+	if (first < transfer)
+		memcpy((uint8_t *)dest + first * unit_bytes, buffer,
+		       (transfer - first) * unit_bytes);
+
+	__atomic_store_n(&s->head, head + transfer, __ATOMIC_RELEASE);
+	return transfer;
+}
+
+/*
+ * Declare a static queue NAME of SIZE units of TYPE, SIZE a power of two, and
+ * the functions to use it:
+ *
+ *	void NAME_init(void);		Empty it, while neither side uses it
+ *	size_t NAME_count(void);	Units queued
+ *	size_t NAME_space(void);	Units free
+ *	size_t NAME_add(const TYPE *src, size_t count);
+ *	size_t NAME_remove(TYPE *dest, size_t count);
+ *
+ * NAME_add() and NAME_remove() move as many units as they can, up to count,
+ * and return how many they moved.
+ */
+#define QUEUE_SPSC(NAME, SIZE, TYPE)					\
+	BUILD_ASSERT(POWER_OF_TWO(SIZE));				\
+	static TYPE NAME##_buffer[SIZE];				\
+	static struct queue_spsc_state NAME##_state;			\
+									\
+	static inline void NAME##_init(void)				\
+	{								\
+		NAME##_state.head = 0;					\
+		NAME##_state.tail = 0;					\
+	}								\
+									\
+	static inline size_t NAME##_count(void)				\
+	{								\
+		return queue_spsc_count(&NAME##_state);			\
+	}								\
+									\
+	static inline size_t NAME##_space(void)				\
+	{								\
+		return (SIZE) - queue_spsc_count(&NAME##_state);	\
+	}								\
+									\
+	static inline size_t NAME##_add(const TYPE *src, size_t count)	\
+	{								\
+		size_t tail, head;					\
+									\
+		if (count != 1)						\
+			return queue_spsc_add(&NAME##_state,		\
+					      NAME##_buffer, (SIZE),	\
+					      sizeof(TYPE), src, count);\
+									\
+		tail = __atomic_load_n(&NAME##_state.tail,		\
+				       __ATOMIC_RELAXED);		\
+		head = __atomic_load_n(&NAME##_state.head,		\
+				       __ATOMIC_ACQUIRE);		\
+		if (tail - head == (SIZE))				\
+			return 0;					\
+		NAME##_buffer[tail & ((SIZE) - 1)] = *src;		\
+		__atomic_store_n(&NAME##_state.tail, tail + 1,		\
+				 __ATOMIC_RELEASE);			\
+		return 1;						\
+	}								\
+									\
+	static inline size_t NAME##_remove(TYPE *dest, size_t count)	\
+	{								\
+		size_t head, tail;					\
+									\
+		if (count != 1)						\
+			return queue_spsc_remove(&NAME##_state,		\
+						 NAME##_buffer, (SIZE),	\
+						 sizeof(TYPE), dest, count);\
+									\
+		head = __atomic_load_n(&NAME##_state.head,		\
+				       __ATOMIC_RELAXED);		\
+		tail = __atomic_load_n(&NAME##_state.tail,		\
+				       __ATOMIC_ACQUIRE);		\
+		if (tail == head)					\
+			return 0;					\
+		*dest = NAME##_buffer[head & ((SIZE) - 1)];		\
+		__atomic_store_n(&NAME##_state.head, head + 1,		\
+				 __ATOMIC_RELEASE);			\
+		return 1;						\
+	}
+
+#endif /* __CROS_EC_QUEUE_SPSC_H */
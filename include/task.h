@@ -41,6 +41,8 @@
 #else
 #define TASK_EVENT_I2C_IDLE	BIT(20)
 #define TASK_EVENT_PS2_DONE	BIT(21)
+/* Queued I2C transfer done, see i2c_xfer_async() */
+#define TASK_EVENT_I2C_DONE	BIT(22)
 #endif
 
 /* DMA transmit complete event */
@@ -153,6 +155,20 @@ uint32_t *task_get_event_bitmap(task_id_t tskid);
  */
 uint32_t task_wait_event(int timeout_us);
 
+/**
+ * Wait for the next event, allowing the timeout to come late.
+ *
+ * Same as task_wait_event(), but the TASK_EVENT_TIMER event may be delayed by
+ * up to slack_us so it can share a wakeup with another timer expiring in that
+ * window, instead of waking the EC on its own.
+ *
+ * @param timeout_us	If > 0, earliest time for the TASK_EVENT_TIMER event.
+ * @param slack_us	How much later than timeout_us the event may come.
+ *
+ * @return The bitmap of received events.
+ */
+uint32_t task_wait_event_slack(int timeout_us, int slack_us);
+
 /**
  * Wait for any event included in an event mask.
  *
@@ -328,6 +344,22 @@ void task_clear_pending_irq(int irq);
 struct mutex {
 	uint32_t lock;
 	uint32_t waiters;
+#if defined(CONFIG_MUTEX_PRIORITY_INHERITANCE) || defined(CONFIG_MUTEX_STATS)
+	/* Task holding the lock, TASK_ID_IDLE if unknown */
+	uint8_t owner;
+#endif
+#ifdef CONFIG_MUTEX_STATS
+	uint8_t max_wait_task;
+	uint8_t max_wait_owner;
+	uint8_t max_hold_task;
+	uint32_t locks;
+	uint32_t contended;
+	uint32_t max_wait_us;
+	uint32_t max_hold_us;
+	uint32_t lock_time;
+	/* Next mutex which was locked at least once */
+	struct mutex *next;
+#endif
 };
 
 /**
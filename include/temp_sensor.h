@@ -9,6 +9,7 @@
 #define __CROS_EC_TEMP_SENSOR_H
 
 #include "common.h"
+#include "timer.h"
 
 /* "enum temp_sensor_id" must be defined for each board in board.h. */
 enum temp_sensor_id;
@@ -57,4 +58,41 @@ extern const struct temp_sensor_t temp_sensors[];
  */
 int temp_sensor_read(enum temp_sensor_id id, int *temp_ptr);
 
+#ifdef CONFIG_TEMP_SENSOR_SNAPSHOT
+/* All the sensors, read in one pass */
+struct temp_sensor_snapshot {
+	timestamp_t time;		/* When the pass started */
+	int temp[TEMP_SENSOR_COUNT];	/* K */
+	int rv[TEMP_SENSOR_COUNT];	/* Result of temp_sensor_read() */
+};
+
+struct temp_sensor_snapshot_stats {
+	uint32_t passes;	/* Passes over all the sensors */
+	uint32_t reuses;	/* Requests served from an earlier pass */
+	uint32_t pass_us_last;	/* Time to read all the sensors */
+	uint32_t pass_us_max;
+	uint32_t age_us_max;	/* Oldest snapshot handed out */
+};
+
+/**
+ * Get the temperature of all the sensors, reading them again only if the
+ * last pass is older than the caller accepts.
+ *
+ * @param snap		Filled with the snapshot
+ * @param max_age_us	Oldest snapshot the caller accepts, 0 to always
+ *			read the sensors
+ */
+void temp_sensor_get_snapshot(struct temp_sensor_snapshot *snap,
+			      uint32_t max_age_us);
+
+/**
+ * Get the statistics of the snapshot passes.
+ *
+ * @param stats		Filled with the statistics
+ * @param clear		Reset the statistics after reading them
+ */
+void temp_sensor_get_snapshot_stats(struct temp_sensor_snapshot_stats *stats,
+				    int clear);
+#endif
+
 #endif  /* __CROS_EC_TEMP_SENSOR_H */
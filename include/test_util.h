@@ -281,6 +281,85 @@ struct test_i2c_write_dev {
 	__attribute__((section(".rodata.test_i2c.xfer")))		\
 		= {routine}
 
+/*
+ * Microbenchmarks.
+ *
+ * A benchmark is a routine that is timed in batches of 'iterations' calls.
+ * test_run_benchmarks() runs every registered benchmark for a few untimed
+ * warmup batches, then for BENCHMARK_RUNS timed batches, and reports the
+ * min/median/p99/max time per call in nanoseconds, both human readable and
+ * as one JSON object per line (prefixed with "BENCHMARK_JSON ").
+ *
+ * On the emulator, the following environment variables are honored:
+ *   BENCHMARK_JSON      Append the JSON results to this file.
+ *   BENCHMARK_BASELINE  Compare medians against a file previously written
+ *                       through BENCHMARK_JSON. A benchmark slower than the
+ *                       baseline by more than BENCHMARK_MAX_REGRESSION
+ *                       percent (default 10) fails test_run_benchmarks().
+ */
+#define BENCHMARK_WARMUP_RUNS 5
+#define BENCHMARK_RUNS 100
+
+struct benchmark {
+	/* Name reported in the results */
+	const char *name;
+	/* Routine being measured */
+	void (*routine)(void);
+	/* Calls of routine per timed run */
+	uint32_t iterations;
+};
+
+struct benchmark_result {
+	const char *name;
+	uint32_t iterations;
+	uint32_t runs;
+	/* Time per call of the routine, in nanoseconds */
+	uint32_t min_ns;
+	uint32_t median_ns;
+	uint32_t p99_ns;
+	uint32_t max_ns;
+};
+
+/**
+ * Register a benchmark.
+ *
+ * Usage:
+ *	BENCHMARK(queue_add_remove, 1000)
+ *	{
+ *		queue_add_unit(&q, &data);
+ *		queue_remove_unit(&q, &data);
+ *	}
+ *
+ * @param name        Identifier of the benchmark
+ * @param iterations  Calls of the body per timed run
+ */
+#define BENCHMARK(name, iterations)					\
+	static void __benchmark_routine_##name(void);			\
+	const struct benchmark __keep __no_sanitize_address		\
+	__benchmark_##name						\
+	__attribute__((section(".rodata.benchmarks"), aligned(8)))	\
+		= {#name, __benchmark_routine_##name, iterations};	\
+	static void __benchmark_routine_##name(void)
+
+/**
+ * Measure a single benchmark.
+ *
+ * @param bench   Benchmark to run
+ * @param result  Filled with the measurements
+ */
+void benchmark_run(const struct benchmark *bench,
+		   struct benchmark_result *result);
+
+/**
+ * Run and report all benchmarks registered with BENCHMARK().
+ *
+ * Can be used with RUN_TEST().
+ *
+ * @return EC_SUCCESS, or EC_ERROR_UNKNOWN if a benchmark regressed against
+ *         the baseline.
+ */
+int test_run_benchmarks(void);
+
 /*
  * Detach an I2C device. Once detached, any read/write command regarding the
  * specified port and slave address returns error.
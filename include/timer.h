@@ -52,6 +52,14 @@ int timer_arm(timestamp_t tstamp, task_id_t tskid);
  */
 void timer_cancel(task_id_t tskid);
 
+/**
+ * Return the task whose timer expires first.
+ *
+ * @param deadline	If not NULL, set to when that timer expires
+ * @return the task id, or TASK_ID_INVALID if no timer is running.
+ */
+task_id_t timer_next_task(timestamp_t *deadline);
+
 /**
  * Check if a timestamp has passed / expired
  *
@@ -12,6 +12,7 @@
 #include "console.h"
 #include "display_7seg.h"
 #include "espi.h"
+#include "event_store.h"
 #include "extpower.h"
 #include "gpio.h"
 #include "hooks.h"
@@ -651,6 +652,10 @@ void chipset_task(void *u)
 		if (this_in_signals != last_in_signals || state != last_state) {
 			CPRINTS("power state %d = %s, in 0x%04x",
 				state, state_names[state], this_in_signals);
+			if (IS_ENABLED(CONFIG_EVENT_STORE))
+				event_store_add(EVENT_STORE_POWER_STATE,
+						state | this_in_signals << 8,
+						NULL, 0);
 			if (IS_ENABLED(CONFIG_SEVEN_SEG_DISPLAY))
 				display_7seg_write(SEVEN_SEG_EC_DISPLAY, state);
 			last_in_signals = this_in_signals;
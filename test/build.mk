@@ -21,15 +21,19 @@ test-list-host += body_detection
 test-list-host += button
 test-list-host += cbi
 test-list-host += cec
+test-list-host += comm_mec_lpc
 test-list-host += charge_manager
 test-list-host += charge_manager_drp_charging
 test-list-host += charge_ramp
 test-list-host += compile_time_macros
 test-list-host += console_edit
 test-list-host += crc32
+test-list-host += discrete_event
 test-list-host += entropy
+test-list-host += event_store
 test-list-host += extpwr_gpio
 test-list-host += fan
+test-list-host += fan_pid
 test-list-host += flash
 test-list-host += float
 test-list-host += fp
@@ -39,24 +43,29 @@ test-list-host += fpsensor_state
 test-list-host += gyro_cal
 test-list-host += hooks
 test-list-host += host_command
+test-list-host += i2c_async
 test-list-host += i2c_bitbang
+test-list-host += i2c_cache
 test-list-host += inductive_charging
 test-list-host += interrupt
 test-list-host += is_enabled
 test-list-host += is_enabled_error
 test-list-host += kasa
 test-list-host += kb_8042
+test-list-host += kb_hx30
 test-list-host += kb_mkbp
 #test-list-host += kb_scan	# crbug.com/976974
 test-list-host += lid_sw
 test-list-host += lightbar
 test-list-host += mag_cal
 test-list-host += math_util
+test-list-host += memmap_telemetry
 test-list-host += motion_angle
 test-list-host += motion_angle_tablet
 test-list-host += motion_lid
 test-list-host += motion_sense_fifo
 test-list-host += mutex
+test-list-host += mutex_pi
 test-list-host += newton_fit
 test-list-host += online_calibration
 test-list-host += pingpong
@@ -65,6 +74,7 @@ test-list-host += printf
 test-list-host += queue
 test-list-host += rsa
 test-list-host += rsa3
+test-list-host += rsa3072
 test-list-host += rtc
 test-list-host += sbs_charging_v2
 test-list-host += sha256
@@ -73,8 +83,10 @@ test-list-host += shmalloc
 test-list-host += static_if
 test-list-host += static_if_error
 test-list-host += system
+test-list-host += temp_snapshot
 test-list-host += thermal
 test-list-host += timer_dos
+test-list-host += timer_slack
 test-list-host += uptime
 test-list-host += usb_common
 test-list-host += usb_pd_int
@@ -129,15 +141,19 @@ body_detection-y=body_detection.o body_detection_data_literals.o motion_common.o
 button-y=button.o
 cbi-y=cbi.o
 cec-y=cec.o
+comm_mec_lpc-y=comm_mec_lpc.o
 charge_manager-y=charge_manager.o
 charge_manager_drp_charging-y=charge_manager.o
 charge_ramp-y+=charge_ramp.o
 compile_time_macros-y=compile_time_macros.o
 console_edit-y=console_edit.o
 crc32-y=crc32.o
+discrete_event-y=discrete_event.o
 entropy-y=entropy.o
+event_store-y=event_store.o
 extpwr_gpio-y=extpwr_gpio.o
 fan-y=fan.o
+fan_pid-y=fan_pid.o
 flash-y=flash.o
 flash_physical-y=flash_physical.o
 flash_write_protect-y=flash_write_protect.o
@@ -147,17 +163,21 @@ fpsensor_state-y=fpsensor_state.o
 gyro_cal-y=gyro_cal.o
 hooks-y=hooks.o
 host_command-y=host_command.o
+i2c_async-y=i2c_async.o
 i2c_bitbang-y=i2c_bitbang.o
+i2c_cache-y=i2c_cache.o
 inductive_charging-y=inductive_charging.o
 interrupt-y=interrupt.o
 is_enabled-y=is_enabled.o
 kb_8042-y=kb_8042.o
+kb_hx30-y=kb_hx30.o
 kb_mkbp-y=kb_mkbp.o
 kb_scan-y=kb_scan.o
 lid_sw-y=lid_sw.o
 lightbar-y=lightbar.o
 mag_cal-y=mag_cal.o
 math_util-y=math_util.o
+memmap_telemetry-y=memmap_telemetry.o
 motion_angle-y=motion_angle.o motion_angle_data_literals.o motion_common.o
 motion_angle_tablet-y=motion_angle_tablet.o motion_angle_data_literals_tablet.o motion_common.o
 motion_lid-y=motion_lid.o
@@ -166,6 +186,7 @@ online_calibration-y=online_calibration.o
 kasa-y=kasa.o
 mpu-y=mpu.o
 mutex-y=mutex.o
+mutex_pi-y=mutex_pi.o
 newton_fit-y=newton_fit.o
 pingpong-y=pingpong.o
 power_button-y=power_button.o
@@ -176,6 +197,7 @@ rollback-y=rollback.o
 rollback_entropy-y=rollback_entropy.o
 rsa-y=rsa.o
 rsa3-y=rsa.o
+rsa3072-y=rsa.o
 rtc-y=rtc.o
 scratchpad-y=scratchpad.o
 sbs_charging-y=sbs_charging.o
@@ -187,9 +209,11 @@ static_if-y=static_if.o
 stm32f_rtc-y=stm32f_rtc.o
 stress-y=stress.o
 system-y=system.o
+temp_snapshot-y=temp_snapshot.o
 thermal-y=thermal.o
 timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
+timer_slack-y=timer_slack.o
 uptime-y=uptime.o
 usb_common-y=usb_common_test.o fake_battery.o
 usb_pd_int-y=usb_pd_int.o
@@ -221,6 +245,11 @@ fp-y=fp.o
 x25519-y=x25519.o
 stillness_detector-y=stillness_detector.o
 
+# kb_hx30 builds the hx30 keyboard code, with the hx30 matrix header
+ifeq ($(PROJECT),kb_hx30)
+includes+=board/hx30
+endif
+
 host-is_enabled_error: TEST_SCRIPT=is_enabled_error.sh
 is_enabled_error-y=is_enabled_error.o.cmd
 
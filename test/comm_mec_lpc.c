@@ -0,0 +1,381 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests the MEC EMI transport of ectool (util/comm-mec_lpc.c) against an
+ * emulated EMI.
+ */
+
+#include <stdint.h>
+/* Before the I/O functions are renamed below */
+#include <sys/io.h>
+
+static int emi_inb(int port);
+static void emi_outb(int value, int port);
+static void emi_outw(int value, int port);
+static uint32_t emi_inl(int port);
+static void emi_outl(uint32_t value, int port);
+
+#define inb(port) emi_inb(port)
+#define outb(value, port) emi_outb(value, port)
+#define outw(value, port) emi_outw(value, port)
+#define inl(port) emi_inl(port)
+#define outl(value, port) emi_outl(value, port)
+
+#include "../util/comm-mec_lpc.c"
+
+#include "host_command.h"
+#include "test_util.h"
+
+/*
+ * EMI memory: the host packet at 0, then the memory map. The EC address
+ * register selects a word and an access mode. In auto-increment mode an
+ * access to the last data register byte moves it to the next word.
+ */
+static uint8_t emi_mem[MEC_EC_MEMMAP_START + EC_MEMMAP_SIZE + 4];
+static int emi_addr;
+static int emi_mode;
+
+/* Result of the last command */
+static int emi_result;
+
+/* I/O cycles, and how many of them wrote the address register */
+static int emi_cycles;
+static int emi_addr_writes;
+
+/* Data accesses until another host user moves the address, -1 if never */
+static int emi_move_after = -1;
+
+int (*ec_command_proto)(int command, int version,
+			const void *outdata, int outsize,
+			void *indata, int insize);
+int (*ec_readmem)(int offset, int bytes, void *dest);
+
+int wait_for_ec(int status_addr, int timeout_usec)
+{
+	return 0;
+}
+
+static void emi_data_access(int byte)
+{
+	if (emi_mode == MEC_EC_LONG_ACCESS_AUTOINCREMENT && byte == 3)
+		emi_addr += 4;
+
+	if (emi_move_after > 0 && --emi_move_after == 0) {
+		emi_addr = 0x80;
+		emi_move_after = -1;
+	}
+}
+
+/*
+ * Answer the request in the packet area.  The read test runs the EC's own
+ * handler, like "ectool commbench" does, anything else gets its own data.
+ */
+static void emi_ec_command(void)
+{
+	struct ec_host_request rq;
+	struct ec_host_response rs = { 0 };
+	struct host_cmd_handler_args args = { 0 };
+	uint8_t params[EC_LPC_HOST_PACKET_SIZE];
+	uint8_t sum = 0;
+	int i;
+
+	memcpy(&rq, emi_mem, sizeof(rq));
+	if (rq.command == EC_CMD_READ_TEST) {
+		memcpy(params, emi_mem + sizeof(rq), rq.data_len);
+		args.command = rq.command;
+		args.version = rq.command_version;
+		args.params = params;
+		args.params_size = rq.data_len;
+		args.response = emi_mem + sizeof(rs);
+		args.response_max = EC_LPC_HOST_PACKET_SIZE - sizeof(rs);
+		emi_result = host_command_process(&args);
+		rs.data_len = emi_result ? 0 : args.response_size;
+	} else {
+		memmove(emi_mem + sizeof(rs), emi_mem + sizeof(rq),
+			rq.data_len);
+		emi_result = EC_RES_SUCCESS;
+		rs.data_len = rq.data_len;
+	}
+
+	rs.struct_version = EC_HOST_RESPONSE_VERSION;
+	rs.result = emi_result;
+	memcpy(emi_mem, &rs, sizeof(rs));
+	for (i = 0; i < sizeof(rs) + rs.data_len; i++)
+		sum += emi_mem[i];
+	emi_mem[1] = -sum;
+}
+
+static int emi_inb(int port)
+{
+	int byte = port - MEC_EC_DATA_REGISTER0;
+	int value;
+
+	emi_cycles++;
+	if (port == EC_LPC_ADDR_HOST_DATA)
+		return emi_result;
+	if (port == EC_LPC_ADDR_HOST_CMD)
+		return 0;
+
+	value = emi_mem[emi_addr + byte];
+	emi_data_access(byte);
+	return value;
+}
+
+static void emi_outb(int value, int port)
+{
+	int byte = port - MEC_EC_DATA_REGISTER0;
+
+	emi_cycles++;
+	if (port == EC_LPC_ADDR_HOST_CMD) {
+		emi_ec_command();
+		return;
+	}
+
+	emi_mem[emi_addr + byte] = value;
+	emi_data_access(byte);
+}
+
+static void emi_outw(int value, int port)
+{
+	emi_cycles++;
+	emi_addr_writes++;
+	emi_addr = value & 0xfffc;
+	emi_mode = value & 3;
+}
+
+static uint32_t emi_inl(int port)
+{
+	uint32_t value;
+
+	emi_cycles++;
+	memcpy(&value, emi_mem + emi_addr, sizeof(value));
+	emi_data_access(3);
+	return value;
+}
+
+static void emi_outl(uint32_t value, int port)
+{
+	emi_cycles++;
+	memcpy(emi_mem + emi_addr, &value, sizeof(value));
+	emi_data_access(3);
+}
+
+static void emi_reset(void)
+{
+	memset(emi_mem, 0xaa, sizeof(emi_mem));
+	emi_mem[MEC_EC_MEMMAP_START + EC_MEMMAP_ID] = 'E';
+	emi_mem[MEC_EC_MEMMAP_START + EC_MEMMAP_ID + 1] = 'C';
+	emi_addr = 0;
+	emi_mode = 0;
+	emi_cycles = 0;
+	emi_addr_writes = 0;
+	emi_move_after = -1;
+	emi_result = EC_RES_SUCCESS;
+}
+
+static int check_xfer(int address, int size)
+{
+	char src[24], dst[sizeof(src) + 4];
+	int bad = 0;
+	int i;
+
+	for (i = 0; i < size; i++)
+		src[i] = address + i * 3;
+
+	emi_reset();
+	ec_mec_xfer(EC_MEC_WRITE, address, src, size);
+	/* Nothing written around it */
+	for (i = 0; i < sizeof(emi_mem); i++) {
+		if (i >= address && i < address + size)
+			bad += emi_mem[i] != (uint8_t)src[i - address];
+		else if (i < MEC_EC_MEMMAP_START)
+			bad += emi_mem[i] != 0xaa;
+	}
+	TEST_EQ(bad, 0, "%d");
+
+	memset(dst, 0x55, sizeof(dst));
+	ec_mec_xfer(EC_MEC_READ, address, dst, size);
+	TEST_ASSERT_ARRAY_EQ(dst, src, size);
+	for (i = size; i < sizeof(dst); i++)
+		TEST_EQ(dst[i], 0x55, "0x%x");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_xfer(void)
+{
+	int start, size, mode;
+
+	/* Every start alignment and size, with and without 32-bit cycles */
+	for (mode = 0; mode < 2; mode++) {
+		mec_long_access = mode;
+		for (start = 0; start < 8; start++)
+			for (size = 0; size <= 20; size++)
+				TEST_EQ(check_xfer(0x10 + start, size),
+					EC_SUCCESS, "%d");
+	}
+
+	return EC_SUCCESS;
+}
+
+test_static int test_xfer_cycles(void)
+{
+	char buf[20];
+	int byte_cycles;
+
+	emi_reset();
+	mec_long_access = 0;
+	ec_mec_xfer(EC_MEC_READ, 0x10, buf, sizeof(buf));
+	byte_cycles = emi_cycles;
+	/* An address and four data bytes per word */
+	TEST_EQ(byte_cycles, 5 * (int)sizeof(buf) / 4, "%d");
+
+	emi_reset();
+	mec_long_access = 1;
+	ec_mec_xfer(EC_MEC_READ, 0x10, buf, sizeof(buf));
+	/* One address, then one cycle per word */
+	TEST_EQ(emi_cycles, 1 + (int)sizeof(buf) / 4, "%d");
+
+	/* Reading on still sets the address, someone else may have moved it */
+	emi_cycles = 0;
+	emi_addr_writes = 0;
+	ec_mec_xfer(EC_MEC_READ, 0x10 + sizeof(buf), buf, 4);
+	TEST_EQ(emi_cycles, 2, "%d");
+	TEST_EQ(emi_addr_writes, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_readmem_string(void)
+{
+	const char str[] = "hello";
+	char buf[16];
+	int offset = 0x61;
+
+	emi_reset();
+	TEST_EQ(comm_init_lpc_mec(), 0, "%d");
+	memcpy(emi_mem + MEC_EC_MEMMAP_START + offset, str, sizeof(str));
+
+	/* Only the string itself is copied out */
+	memset(buf, 0x55, sizeof(buf));
+	TEST_EQ(ec_readmem(offset, 0, buf), (int)sizeof(str), "%d");
+	TEST_ASSERT_ARRAY_EQ(buf, str, sizeof(str));
+	TEST_EQ(buf[sizeof(str)], 0x55, "0x%x");
+
+	memset(buf, 0x55, sizeof(buf));
+	TEST_EQ(ec_readmem(offset + 1, 3, buf), 3, "%d");
+	TEST_ASSERT_ARRAY_EQ(buf, str + 1, 3);
+	TEST_EQ(buf[3], 0x55, "0x%x");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_command(void)
+{
+	char out[21], in[32];
+	int i, mode;
+
+	for (i = 0; i < sizeof(out); i++)
+		out[i] = i + 1;
+
+	for (mode = 0; mode < 2; mode++) {
+		emi_reset();
+		TEST_EQ(comm_init_lpc_mec(), 0, "%d");
+		TEST_EQ(comm_lpc_mec_long_access(mode), !mode, "%d");
+
+		memset(in, 0, sizeof(in));
+		TEST_EQ(ec_command_proto(EC_CMD_HELLO, 0, out, sizeof(out),
+					 in, sizeof(in)),
+			(int)sizeof(out), "%d");
+		TEST_ASSERT_ARRAY_EQ(in, out, sizeof(out));
+	}
+
+	return EC_SUCCESS;
+}
+
+test_static int test_command_stale_address(void)
+{
+	char out[16], in[32];
+	int writes;
+	int i;
+
+	for (i = 0; i < sizeof(out); i++)
+		out[i] = i + 1;
+
+	emi_reset();
+	TEST_EQ(comm_init_lpc_mec(), 0, "%d");
+	mec_long_access = 1;
+
+	emi_addr_writes = 0;
+	TEST_EQ(ec_command_proto(EC_CMD_HELLO, 0, out, sizeof(out),
+				 in, sizeof(in)),
+		(int)sizeof(out), "%d");
+	writes = emi_addr_writes;
+
+	/*
+	 * Someone else moves the EMI address right after the response header
+	 * is read, while ectool reads on from past the header.
+	 */
+	emi_addr_writes = 0;
+	emi_move_after = (sizeof(struct ec_host_request) + sizeof(out) +
+			  sizeof(struct ec_host_response)) / 4;
+	memset(in, 0, sizeof(in));
+	TEST_EQ(ec_command_proto(EC_CMD_HELLO, 0, out, sizeof(out),
+				 in, sizeof(in)),
+		(int)sizeof(out), "%d");
+	TEST_ASSERT_ARRAY_EQ(in, out, sizeof(out));
+	/* The data read set the address again, so no second read was needed */
+	TEST_EQ(emi_addr_writes, writes, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* One round of "ectool commbench", with and without 32-bit cycles */
+test_static int test_read_test(void)
+{
+	struct ec_params_read_test p;
+	struct ec_response_read_test r;
+	int cycles[2];
+	int i, mode;
+
+	for (mode = 0; mode < 2; mode++) {
+		emi_reset();
+		TEST_EQ(comm_init_lpc_mec(), 0, "%d");
+		comm_lpc_mec_long_access(mode);
+
+		p.offset = 0x40;
+		p.size = sizeof(r.data);
+		memset(&r, 0, sizeof(r));
+		emi_cycles = 0;
+		TEST_EQ(ec_command_proto(EC_CMD_READ_TEST, 0, &p, sizeof(p),
+					 &r, sizeof(r)),
+			(int)sizeof(r.data), "%d");
+		for (i = 0; i < ARRAY_SIZE(r.data); i++)
+			TEST_EQ(r.data[i], 0x40 + i, "0x%x");
+		cycles[mode] = emi_cycles;
+	}
+	TEST_LT(cycles[1], cycles[0], "%d");
+
+	/* The EC turns down more than fits in the packet */
+	p.size = EC_LPC_HOST_PACKET_SIZE;
+	TEST_EQ(ec_command_proto(EC_CMD_READ_TEST, 0, &p, sizeof(p),
+				 &r, sizeof(r)),
+		-EECRESULT - EC_RES_ERROR, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_xfer);
+	RUN_TEST(test_xfer_cycles);
+	RUN_TEST(test_readmem_string);
+	RUN_TEST(test_command);
+	RUN_TEST(test_command_stale_address);
+	RUN_TEST(test_read_test);
+
+	test_print_result();
+}
@@ -63,6 +63,17 @@ static int test_kat0(void)
 	return EC_SUCCESS;
 }
 
+BENCHMARK(crc32_hash32_256_bytes, 10)
+{
+	uint32_t crc;
+	int i;
+
+	crc32_ctx_init(&crc);
+	for (i = 0; i < 256 / sizeof(uint32_t); ++i)
+		crc32_ctx_hash32(&crc, 0xdeadbeef + i);
+	crc32_ctx_result(&crc);
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -70,6 +81,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_static_version);
 	RUN_TEST(test_8);
 	RUN_TEST(test_kat0);
+	RUN_TEST(test_run_benchmarks);
 
 	test_print_result();
 }
@@ -0,0 +1,111 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests the discrete-event scheduler of the emulator by simulating a few
+ * hours of periodic tasks, hooks and interrupts.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "hooks.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define TEST_HOURS 2
+#define TEST_TIME_SEC (TEST_HOURS * 3600)
+
+#define IRQ_PERIOD_US (250 * MSEC)
+
+static int periodic_count[2];
+static int irq_task_count;
+static int irq_count;
+static int second_count;
+
+void task_periodic(void *period)
+{
+	int i = task_get_current() == TASK_ID_SLOW ? 0 : 1;
+
+	while (1) {
+		usleep((uintptr_t)period);
+		periodic_count[i]++;
+	}
+}
+
+void task_irq(void *data)
+{
+	while (1) {
+		task_wait_event(-1);
+		irq_task_count++;
+	}
+}
+
+static void irq_isr(void)
+{
+	irq_count++;
+	task_wake(TASK_ID_IRQ);
+}
+
+void interrupt_generator(void)
+{
+	while (1) {
+		udelay(IRQ_PERIOD_US);
+		task_trigger_test_interrupt(irq_isr);
+	}
+}
+
+static void count_second(void)
+{
+	second_count++;
+}
+DECLARE_HOOK(HOOK_SECOND, count_second, HOOK_PRIO_DEFAULT);
+
+/* Check that count is within 1% below the expected value. */
+static int check_count(const char *name, int count, int expected)
+{
+	ccprintf("%s: %d (expected %d)\n", name, count, expected);
+	if (count > expected || count < expected - expected / 100)
+		return EC_ERROR_UNKNOWN;
+	return EC_SUCCESS;
+}
+
+static int test_long_simulation(void)
+{
+	timestamp_t start = get_time();
+	int i;
+
+	periodic_count[0] = periodic_count[1] = 0;
+	irq_task_count = irq_count = second_count = 0;
+
+	/* Sleep a minute at a time to stay within usleep() range. */
+	for (i = 0; i < TEST_TIME_SEC / 60; i++)
+		sleep(60);
+
+	TEST_GE(get_time().val - start.val, (uint64_t)TEST_TIME_SEC * SECOND,
+		"%" PRIu64);
+	TEST_ASSERT(check_count("SLOW", periodic_count[0],
+				TEST_TIME_SEC) == EC_SUCCESS);
+	TEST_ASSERT(check_count("FAST", periodic_count[1],
+				TEST_TIME_SEC * 10) == EC_SUCCESS);
+	TEST_ASSERT(check_count("IRQ", irq_count,
+				TEST_TIME_SEC * (SECOND / IRQ_PERIOD_US)) ==
+		    EC_SUCCESS);
+	TEST_ASSERT(check_count("HOOK_SECOND", second_count, TEST_TIME_SEC) ==
+		    EC_SUCCESS);
+
+	/* Each interrupt must have woken the task exactly once. */
+	TEST_EQ(irq_task_count, irq_count, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_long_simulation);
+
+	test_print_result();
+}
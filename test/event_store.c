@@ -0,0 +1,195 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the compact event store.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "event_store.h"
+#include "host_command.h"
+#include "system.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define TEST_TYPE EVENT_STORE_BOARD
+
+static uint8_t raw[CONFIG_EVENT_STORE_SIZE];
+
+/* Read the whole store, returns the number of bytes read */
+static int read_all(uint32_t *offset)
+{
+	*offset = 0;
+	return event_store_read(offset, raw, sizeof(raw), NULL, NULL);
+}
+
+test_static int test_boot_record(void)
+{
+	struct event_store_record r;
+	uint32_t offset;
+	int n;
+
+	n = read_all(&offset);
+	TEST_EQ(offset, 0, "%d");
+	TEST_ASSERT(event_store_decode(raw, n, &r) > 0);
+	TEST_EQ(r.type, EVENT_STORE_BOOT, "%d");
+	TEST_EQ(r.data, system_get_reset_flags(), "0x%x");
+	TEST_EQ(r.size, 2, "%d");
+	TEST_EQ(r.payload[0], system_get_image_copy(), "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_encoding(void)
+{
+	static const uint32_t data[] = { 0, 0x7f, 0x80, 0x3fff, 0x4000,
+					 0xffffffff };
+	static const int expected_len[] = { 1, 1, 2, 2, 3, 5 };
+	const uint8_t payload[3] = { 0xaa, 0xbb, 0xcc };
+	struct event_store_record r;
+	uint32_t offset;
+	int i, n, len, pos;
+
+	event_store_clear();
+	for (i = 0; i < ARRAY_SIZE(data); i++)
+		event_store_add(TEST_TYPE, data[i], payload, i % 4);
+
+	n = read_all(&offset);
+	for (i = 0, pos = 0; i < ARRAY_SIZE(data); i++, pos += len) {
+		len = event_store_decode(raw + pos, n - pos, &r);
+		/* Type, size, a one byte delta, the data and the payload */
+		TEST_EQ(len, 3 + expected_len[i] + i % 4, "%d");
+		TEST_EQ(r.type, TEST_TYPE, "%d");
+		TEST_EQ(r.data, data[i], "0x%x");
+		TEST_EQ(r.size, i % 4, "%d");
+		TEST_ASSERT_ARRAY_EQ(r.payload, payload, r.size);
+	}
+	TEST_EQ(pos, n, "%d");
+
+	/* Truncated records are rejected */
+	TEST_EQ(event_store_decode(raw, 3, &r), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_delta_time(void)
+{
+	struct event_store_record r;
+	uint32_t offset = 0;
+	uint32_t time, now;
+	int n, len;
+
+	event_store_clear();
+	event_store_add(TEST_TYPE, 1, NULL, 0);
+	force_time((timestamp_t)(get_time().val +
+				 (1000 << EVENT_STORE_TIME_SHIFT)));
+	event_store_add(TEST_TYPE, 2, NULL, 0);
+	now = get_time().val >> EVENT_STORE_TIME_SHIFT;
+
+	n = event_store_read(&offset, raw, sizeof(raw), NULL, &time);
+	len = event_store_decode(raw, n, &r);
+	TEST_ASSERT(len > 0);
+	time += r.delta;
+	len = event_store_decode(raw + len, n - len, &r);
+	TEST_ASSERT(len > 0);
+	time += r.delta;
+	TEST_EQ(r.data, 2, "%d");
+	TEST_ASSERT(r.delta >= 1000 && r.delta <= 1001);
+	/* 1000 needs a two byte varint */
+	TEST_EQ(len, 2 + 2 + 1, "%d");
+
+	/* The base time makes the deltas absolute again */
+	TEST_ASSERT(time <= now && time + 1 >= now);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_wrap(void)
+{
+	struct event_store_record r;
+	uint32_t offset;
+	uint32_t seq;
+	int i, n, len, pos;
+
+	event_store_clear();
+	for (i = 0; i < 1000; i++)
+		event_store_add(TEST_TYPE, i, &i, i % 5);
+
+	/* The oldest records were discarded, what is left is consistent */
+	n = read_all(&offset);
+	TEST_ASSERT(n > CONFIG_EVENT_STORE_SIZE - EVENT_STORE_RECORD_MAX);
+	for (pos = 0, seq = 0; pos < n; pos += len) {
+		len = event_store_decode(raw + pos, n - pos, &r);
+		TEST_ASSERT(len > 0);
+		if (pos)
+			TEST_EQ(r.data, seq + 1, "%d");
+		seq = r.data;
+	}
+	TEST_EQ(pos, n, "%d");
+	TEST_EQ(seq, 999, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_host_command_stream(void)
+{
+	struct ec_params_event_store_read p;
+	struct {
+		struct ec_response_event_store_read r;
+		uint8_t data[16];
+	} resp;
+	struct event_store_record r;
+	uint8_t stream[CONFIG_EVENT_STORE_SIZE];
+	uint32_t first;
+	int i, n, len, pos, total = 0;
+
+	event_store_clear();
+	for (i = 0; i < 20; i++)
+		event_store_add(TEST_TYPE, i, NULL, 0);
+
+	/* A stale offset restarts at the oldest record */
+	p.offset = 0;
+	TEST_EQ(test_send_host_command(EC_CMD_EVENT_STORE_READ, 0, &p,
+				       sizeof(p), &resp, sizeof(resp)),
+		EC_RES_SUCCESS, "%d");
+	TEST_NE(resp.r.offset, 0, "%d");
+	first = resp.r.offset;
+
+	/* Stream the store in small chunks */
+	p.offset = first;
+	do {
+		TEST_EQ(test_send_host_command(EC_CMD_EVENT_STORE_READ, 0, &p,
+					       sizeof(p), &resp, sizeof(resp)),
+			EC_RES_SUCCESS, "%d");
+		TEST_EQ(resp.r.offset, p.offset, "%d");
+		n = MIN(resp.r.end - resp.r.offset, sizeof(resp.data));
+		memcpy(stream + total, resp.r.data, n);
+		total += n;
+		p.offset += n;
+	} while (p.offset != resp.r.end);
+
+	for (i = 0, pos = 0; pos < total; i++, pos += len) {
+		len = event_store_decode(stream + pos, total - pos, &r);
+		TEST_ASSERT(len > 0);
+		TEST_EQ(r.data, i, "%d");
+	}
+	TEST_EQ(i, 20, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_boot_record);
+	RUN_TEST(test_encoding);
+	RUN_TEST(test_delta_time);
+	RUN_TEST(test_wrap);
+	RUN_TEST(test_host_command_stream);
+
+	test_print_result();
+}
@@ -0,0 +1,349 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the fan speed PID, against a simulated fan and heatsink.
+ */
+
+#include "common.h"
+#include "fan_pid.h"
+#include "math_util.h"
+#include "test_util.h"
+#include "util.h"
+
+#define DT_MS		CONFIG_FAN_PID_PERIOD_MS
+/* Plant steps per loop period */
+#define SUBSTEPS	10
+
+/* Fan: first order lag, speed not quite proportional to the duty cycle */
+#define FAN_RPM_MAX	7000
+#define FAN_TAU_S	0.8f
+
+/* Heatsink: a thermal mass cooled more as the fan speeds up */
+#define AMBIENT_C	25.0f
+#define HEAT_CAP_J_K	40.0f
+#define COOL_W_K	0.4f
+#define COOL_W_K_RPM	0.00025f
+
+/* Thermal table: fan off at 51 C, full speed at 69 C */
+#define TEMP_FAN_OFF_C	51
+#define TEMP_FAN_MAX_C	69
+#define RPM_PER_C	(FAN_RPM_MAX / (TEMP_FAN_MAX_C - TEMP_FAN_OFF_C))
+
+struct plant {
+	float rpm;
+	float temp;
+};
+
+static float fan_rpm_steady(int duty)
+{
+	/* Air resistance flattens the top of the curve */
+	return FAN_RPM_MAX * duty * (200 - duty) / 10000.0f;
+}
+
+static void plant_step(struct plant *pl, int duty, float power_w)
+{
+	const float dt = DT_MS / 1000.0f / SUBSTEPS;
+	int i;
+
+	for (i = 0; i < SUBSTEPS; i++) {
+		float cool = (pl->temp - AMBIENT_C) *
+			     (COOL_W_K + COOL_W_K_RPM * pl->rpm);
+
+		pl->rpm += (fan_rpm_steady(duty) - pl->rpm) * dt / FAN_TAU_S;
+		pl->temp += (power_w - cool) * dt / HEAT_CAP_J_K;
+	}
+}
+
+/* The tach only resolves 10 rpm */
+static int plant_tach(const struct plant *pl)
+{
+	return (int)pl->rpm / 10 * 10;
+}
+
+/* Same as the thermal task: linear between fan off and fan max */
+static int thermal_target(float temp)
+{
+	int t = (int)temp;
+
+	if (t <= TEMP_FAN_OFF_C)
+		return 0;
+	if (t >= TEMP_FAN_MAX_C)
+		return FAN_RPM_MAX;
+	return FAN_RPM_MAX * (t - TEMP_FAN_OFF_C) /
+	       (TEMP_FAN_MAX_C - TEMP_FAN_OFF_C);
+}
+
+/* What board_fan_pid_feedforward() would be for this fan */
+static int fan_duty_for_rpm(int rpm)
+{
+	int duty;
+
+	for (duty = 0; duty < 100; duty++)
+		if (fan_rpm_steady(duty) >= rpm)
+			break;
+	return duty;
+}
+
+/* One loop period, as done by fan_pid_loop() */
+static int pid_step(struct fan_pid *pid, struct plant *pl, int target,
+		    int load, float power_w)
+{
+	int rpm = plant_tach(pl);
+	int sp = fan_pid_slew(pid, target, rpm, DT_MS);
+	int ff = 0;
+	int duty;
+
+	if (sp)
+		ff = fan_duty_for_rpm(sp) +
+		     ((pid->params.kff_load * load) >> FAN_PID_Q);
+	duty = fan_pid_update(pid, rpm, ff, DT_MS);
+	plant_step(pl, duty, power_w);
+
+	return duty;
+}
+
+struct step_result {
+	int overshoot;		/* rpm past the target */
+	int settle_ms;		/* Until the speed stays within 2 % */
+};
+
+static void rpm_step(struct fan_pid *pid, int from, int to,
+		     struct step_result *res)
+{
+	struct plant pl = { .rpm = 0, .temp = AMBIENT_C };
+	int band = to / 50;
+	int dir = to > from ? 1 : -1;
+	int t;
+
+	/* Settle at the starting speed */
+	for (t = 0; t < 20000; t += DT_MS)
+		pid_step(pid, &pl, from, 0, 0);
+
+	res->overshoot = 0;
+	res->settle_ms = -1;
+	for (t = 0; t < 20000; t += DT_MS) {
+		int rpm;
+
+		pid_step(pid, &pl, to, 0, 0);
+		rpm = plant_tach(&pl);
+		res->overshoot = MAX(res->overshoot, (rpm - to) * dir);
+		if (ABS(rpm - to) > band)
+			res->settle_ms = -1;
+		else if (res->settle_ms < 0)
+			res->settle_ms = t + DT_MS;
+	}
+}
+
+test_static int test_rpm_step(void)
+{
+	struct fan_pid pid;
+	struct step_result res;
+
+	fan_pid_init(&pid);
+	rpm_step(&pid, 2000, 5000, &res);
+	ccprintf("2000 -> 5000 rpm: overshoot %d rpm, settled in %d ms\n",
+		 res.overshoot, res.settle_ms);
+	TEST_LE(res.overshoot, 100, "%d");
+	/* The slew limit alone takes 3 s */
+	TEST_ASSERT(res.settle_ms > 0 && res.settle_ms <= 6000);
+
+	fan_pid_init(&pid);
+	rpm_step(&pid, 5000, 2500, &res);
+	ccprintf("5000 -> 2500 rpm: undershoot %d rpm, settled in %d ms\n",
+		 res.overshoot, res.settle_ms);
+	TEST_ASSERT(res.settle_ms > 0 && res.settle_ms <= 8000);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_slew_limit(void)
+{
+	struct fan_pid pid;
+	int sp, prev;
+	int t;
+
+	fan_pid_init(&pid);
+
+	/* Starting from off is not limited */
+	TEST_EQ(fan_pid_slew(&pid, 2000, 0, DT_MS), 2000, "%d");
+
+	prev = 2000;
+	for (t = 0; t < 5000; t += DT_MS) {
+		sp = fan_pid_slew(&pid, 6000, 2000, DT_MS);
+		TEST_LE(sp - prev, pid.params.slew_up * DT_MS / 1000, "%d");
+		prev = sp;
+	}
+	TEST_EQ(sp, 6000, "%d");
+
+	/* The setpoint does not lag a fan that already got faster */
+	TEST_EQ(fan_pid_slew(&pid, 3000, 5000, DT_MS),
+		5000 - pid.params.slew_down * DT_MS / 1000, "%d");
+
+	/* Stopping is not limited either */
+	TEST_EQ(fan_pid_slew(&pid, 0, 5000, DT_MS), 0, "%d");
+	TEST_EQ(fan_pid_update(&pid, 5000, 0, DT_MS), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_params_valid(void)
+{
+	struct ec_fan_pid_params p = fan_pid_defaults;
+
+	TEST_ASSERT(fan_pid_params_valid(&p));
+
+	/* The largest gains and limits do not overflow the loop */
+	p.kp = p.ki = p.kd = p.kff_load = FAN_PID_GAIN_MAX;
+	p.i_max = 100;
+	TEST_ASSERT(fan_pid_params_valid(&p));
+
+	p = fan_pid_defaults;
+	p.kp = FAN_PID_GAIN_MAX + 1;
+	TEST_ASSERT(!fan_pid_params_valid(&p));
+
+	p = fan_pid_defaults;
+	p.ki = -1;
+	TEST_ASSERT(!fan_pid_params_valid(&p));
+
+	p = fan_pid_defaults;
+	p.kd = -1;
+	TEST_ASSERT(!fan_pid_params_valid(&p));
+
+	p = fan_pid_defaults;
+	p.kff_load = INT32_MAX;
+	TEST_ASSERT(!fan_pid_params_valid(&p));
+
+	/* Would overflow i_max << FAN_PID_Q */
+	p = fan_pid_defaults;
+	p.i_max = 32768;
+	TEST_ASSERT(!fan_pid_params_valid(&p));
+	p.i_max = 101;
+	TEST_ASSERT(!fan_pid_params_valid(&p));
+
+	return EC_SUCCESS;
+}
+
+test_static int test_anti_windup(void)
+{
+	struct fan_pid pid;
+	struct plant pl = { .rpm = 0, .temp = AMBIENT_C };
+	int undershoot = 0, settle_ms = -1, full = 0;
+	int t, rpm;
+
+	fan_pid_init(&pid);
+
+	/* Ask for more than the fan can do for a while */
+	for (t = 0; t < 10000; t += DT_MS)
+		full += pid_step(&pid, &pl, 9000, 0, 0) == 100;
+	TEST_EQ(full, 10000 / DT_MS, "%d");
+	TEST_ASSERT(pid.saturated);
+	TEST_LE(pid.integ, (int32_t)pid.params.i_max << FAN_PID_Q, "%d");
+
+	/*
+	 * Then come back within reach. The fan follows the setpoint down, and
+	 * the integral does not hold it up once the setpoint gets there.
+	 */
+	for (t = 0; t < 10000; t += DT_MS) {
+		pid_step(&pid, &pl, 5000, 0, 0);
+		rpm = plant_tach(&pl);
+		undershoot = MAX(undershoot, 5000 - rpm);
+		if (pid.setpoint != 5000)
+			continue;
+		if (ABS(rpm - 5000) > 100)
+			settle_ms = -1;
+		else if (settle_ms < 0)
+			settle_ms = t;
+	}
+	ccprintf("Out of saturation: undershoot %d rpm, settled at %d ms\n",
+		 undershoot, settle_ms);
+	TEST_LE(undershoot, 100, "%d");
+	TEST_ASSERT(settle_ms > 0 && settle_ms <= 6000);
+	TEST_ASSERT(!pid.saturated);
+
+	return EC_SUCCESS;
+}
+
+struct thermal_result {
+	float temp_peak;
+	float temp_end;
+	int rpm_ripple;		/* Peak to peak over the last minute */
+};
+
+/* CPU power step from 10 W to 35 W, with the thermal task every second */
+static void thermal_run(int kff_load, struct thermal_result *res)
+{
+	struct fan_pid pid;
+	struct plant pl = { .rpm = 0, .temp = 45.0f };
+	int rpm_min = FAN_RPM_MAX, rpm_max = 0;
+	int target = 0, load = 0;
+	float power_w = 10;
+	int t;
+
+	fan_pid_init(&pid);
+	pid.params.kff_load = kff_load;
+	res->temp_peak = 0;
+
+	for (t = 0; t < 300000; t += DT_MS) {
+		if (t == 10000) {
+			power_w = 35;
+			load = 100;
+		}
+		if (!(t % 1000))
+			target = thermal_target(pl.temp);
+
+		pid_step(&pid, &pl, target, load, power_w);
+
+		res->temp_peak = MAX(res->temp_peak, pl.temp);
+		if (t >= 240000) {
+			rpm_min = MIN(rpm_min, plant_tach(&pl));
+			rpm_max = MAX(rpm_max, plant_tach(&pl));
+		}
+	}
+	res->temp_end = pl.temp;
+	res->rpm_ripple = rpm_max - rpm_min;
+}
+
+test_static int test_thermal_loop(void)
+{
+	struct thermal_result res, res_ff;
+
+	thermal_run(0, &res);
+	ccprintf("No feedforward: peak %d.%d C, end %d.%d C, ripple %d rpm\n",
+		 (int)res.temp_peak, (int)(res.temp_peak * 10) % 10,
+		 (int)res.temp_end, (int)(res.temp_end * 10) % 10,
+		 res.rpm_ripple);
+
+	thermal_run(fan_pid_defaults.kff_load, &res_ff);
+	ccprintf("Load feedforward: peak %d.%d C, end %d.%d C, ripple %d rpm\n",
+		 (int)res_ff.temp_peak, (int)(res_ff.temp_peak * 10) % 10,
+		 (int)res_ff.temp_end, (int)(res_ff.temp_end * 10) % 10,
+		 res_ff.rpm_ripple);
+
+	/*
+	 * No hunting once settled: the target may still toggle between two
+	 * steps of the thermal table, but the fan does not swing past them.
+	 */
+	TEST_LE(res.rpm_ripple, RPM_PER_C + FAN_RPM_MAX / 50, "%d");
+	TEST_LE(res_ff.rpm_ripple, RPM_PER_C + FAN_RPM_MAX / 50, "%d");
+	/* Stays below fan max, and overshoots its final value by little */
+	TEST_ASSERT(res.temp_end < TEMP_FAN_MAX_C);
+	TEST_ASSERT(res.temp_peak - res.temp_end < 2.0f);
+	/* Feedforward gets the fan going before the heatsink warms up */
+	TEST_ASSERT(res_ff.temp_peak <= res.temp_peak);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_rpm_step);
+	RUN_TEST(test_slew_limit);
+	RUN_TEST(test_params_valid);
+	RUN_TEST(test_anti_windup);
+	RUN_TEST(test_thermal_loop);
+
+	test_print_result();
+}
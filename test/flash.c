@@ -11,6 +11,7 @@
 #include "gpio.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "sha256.h"
 #include "system.h"
 #include "task.h"
 #include "test_util.h"
@@ -378,6 +379,200 @@ static int test_region_info(void)
 	return EC_SUCCESS;
 }
 
+static int test_sector_hash(void)
+{
+	struct ec_params_flash_sector_hash params;
+	struct {
+		struct ec_response_flash_sector_hash r;
+		uint8_t hash[4 * EC_FLASH_SECTOR_HASH_SIZE];
+	} resp;
+	struct sha256_ctx ctx;
+	uint8_t *hash;
+	int offset = 0x800;
+	int i;
+
+#ifdef EMU_BUILD
+	for (i = 0; i < 8 * CONFIG_FLASH_ERASE_SIZE; ++i)
+		__host_flash[offset + i] = i * 7;
+#endif
+
+	/* Only as many hashes as fit in the response are returned */
+	params.offset = offset;
+	params.count = 8;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_SECTOR_HASH, 0,
+					   &params, sizeof(params), &resp,
+					   sizeof(resp)) == EC_RES_SUCCESS);
+	TEST_EQ(resp.r.sector_size, CONFIG_FLASH_ERASE_SIZE, "%d");
+	TEST_EQ(resp.r.count, 4, "%d");
+
+	for (i = 0; i < resp.r.count; i++) {
+		SHA256_init(&ctx);
+		SHA256_update(&ctx, (uint8_t *)__host_flash + offset +
+			      i * CONFIG_FLASH_ERASE_SIZE,
+			      CONFIG_FLASH_ERASE_SIZE);
+		hash = SHA256_final(&ctx);
+		TEST_ASSERT_ARRAY_EQ(resp.r.hash +
+				     i * EC_FLASH_SECTOR_HASH_SIZE,
+				     hash, EC_FLASH_SECTOR_HASH_SIZE);
+	}
+
+	/* Never past the end of flash */
+	params.offset = CONFIG_FLASH_SIZE - CONFIG_FLASH_ERASE_SIZE;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_SECTOR_HASH, 0,
+					   &params, sizeof(params), &resp,
+					   sizeof(resp)) == EC_RES_SUCCESS);
+	TEST_EQ(resp.r.count, 1, "%d");
+
+	/* Offset must be sector aligned */
+	params.offset = offset + 1;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_SECTOR_HASH, 0,
+					   &params, sizeof(params), &resp,
+					   sizeof(resp)) == EC_RES_INVALID_PARAM);
+
+	/* Even when only asking for the sector size */
+	params.count = 0;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_SECTOR_HASH, 0,
+					   &params, sizeof(params), &resp,
+					   sizeof(resp)) == EC_RES_INVALID_PARAM);
+	params.offset = offset;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_SECTOR_HASH, 0,
+					   &params, sizeof(params), &resp,
+					   sizeof(resp)) == EC_RES_SUCCESS);
+	TEST_EQ(resp.r.sector_size, CONFIG_FLASH_ERASE_SIZE, "%d");
+	TEST_EQ(resp.r.count, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int stream_command(uint8_t cmd, uint32_t seq, int offset, int size,
+			  const char *data,
+			  struct ec_response_flash_write_stream *r)
+{
+	uint8_t buf[256];
+	struct ec_params_flash_write_stream *params =
+		(struct ec_params_flash_write_stream *)buf;
+
+	memset(params, 0, sizeof(*params));
+	params->cmd = cmd;
+	params->seq = seq;
+	params->offset = offset;
+	params->size = size;
+	memcpy(params + 1, data, size);
+
+	return test_send_host_command(EC_CMD_FLASH_WRITE_STREAM, 0, buf,
+				      sizeof(*params) + size, r, sizeof(*r));
+}
+
+/* Send a chunk again while the EC is busy, as the host does */
+static int stream_data(uint32_t seq, int offset, int size, const char *data,
+		       struct ec_response_flash_write_stream *r)
+{
+	int i, rv;
+
+	for (i = 0; i < 100; i++) {
+		rv = stream_command(FLASH_WRITE_STREAM_DATA, seq, offset, size,
+				    data, r);
+		if (rv != EC_RES_BUSY)
+			break;
+		msleep(1);
+	}
+
+	return rv;
+}
+
+static int stream_finish(struct ec_response_flash_write_stream *r)
+{
+	int i, rv;
+
+	/* Busy until the HOOK task has programmed all the chunks */
+	for (i = 0; i < 100; i++) {
+		rv = stream_command(FLASH_WRITE_STREAM_FINISH, 0, 0, 0, NULL,
+				    r);
+		if (rv != EC_RES_BUSY)
+			break;
+		msleep(1);
+	}
+
+	return rv;
+}
+
+static int test_write_stream(void)
+{
+	struct ec_response_flash_write_stream r;
+	struct sha256_ctx ctx;
+	char data[4 * 64];
+	uint8_t *hash;
+	uint32_t offset;
+	int i;
+
+	/* Write to the other image */
+	offset = system_is_in_rw() ? CONFIG_RO_STORAGE_OFF :
+				     CONFIG_RW_STORAGE_OFF;
+#ifdef EMU_BUILD
+	mock_is_running_img = 0;
+#endif
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 3 + 1;
+
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_START, 0, 0, 0, NULL, &r),
+		EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(r.chunk_max >= 64);
+
+	/* A third chunk while two are queued is refused without waiting */
+	for (i = 0; i < 2; i++)
+		TEST_EQ(stream_command(FLASH_WRITE_STREAM_DATA, i,
+				       offset + i * 64, 64, data + i * 64, &r),
+			EC_RES_SUCCESS, "%d");
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_DATA, 2, offset + 2 * 64, 64,
+			       data + 2 * 64, &r), EC_RES_BUSY, "%d");
+
+	for (i = 2; i < 4; i++)
+		TEST_EQ(stream_data(i, offset + i * 64, 64, data + i * 64, &r),
+			EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.seq_accepted, 4, "%d");
+
+	/* A chunk sent again is acknowledged, sequence numbers can't skip */
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_DATA, 3, offset + 3 * 64, 64,
+			       data + 3 * 64, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.seq_accepted, 4, "%d");
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_DATA, 5, offset, 64, data,
+			       &r), EC_RES_INVALID_PARAM, "%d");
+
+	TEST_EQ(stream_finish(&r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.seq_written, 4, "%d");
+	TEST_ASSERT_ARRAY_EQ(__host_flash + offset, data, sizeof(data));
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, (uint8_t *)data, sizeof(data));
+	hash = SHA256_final(&ctx);
+	TEST_ASSERT_ARRAY_EQ(r.sha256, hash, sizeof(r.sha256));
+
+	/* A chunk the HOOK task programs over several deferred calls */
+	memset(__host_flash + offset, 0xff, sizeof(data));
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_START, 0, 0, 0, NULL, &r),
+		EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(r.chunk_max >= 3 * 64);
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_DATA, 0, offset, 3 * 64,
+			       data, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(stream_finish(&r), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT_ARRAY_EQ(__host_flash + offset, data, 3 * 64);
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, (uint8_t *)data, 3 * 64);
+	hash = SHA256_final(&ctx);
+	TEST_ASSERT_ARRAY_EQ(r.sha256, hash, sizeof(r.sha256));
+
+	/* Programming errors are reported when finishing */
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_START, 0, 0, 0, NULL, &r),
+		EC_RES_SUCCESS, "%d");
+	mock_flash_op_fail = EC_ERROR_UNKNOWN;
+	TEST_EQ(stream_command(FLASH_WRITE_STREAM_DATA, 0, offset, 64, data,
+			       &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(stream_finish(&r), EC_RES_ERROR, "%d");
+	mock_flash_op_fail = EC_SUCCESS;
+
+	return EC_SUCCESS;
+}
+
 static int test_write_protect(void)
 {
 	/* Test we can control write protect GPIO */
@@ -456,6 +651,8 @@ static void run_test_step1(void)
 	RUN_TEST(test_op_failure);
 	RUN_TEST(test_flash_info);
 	RUN_TEST(test_region_info);
+	RUN_TEST(test_sector_hash);
+	RUN_TEST(test_write_stream);
 	RUN_TEST(test_write_protect);
 
 	if (test_get_error_count())
@@ -300,6 +300,35 @@ static int test_hostcmd_clears_unused_data(void)
 	return EC_SUCCESS;
 }
 
+static int test_hostcmd_read_test(void)
+{
+	struct ec_params_read_test *rt_p =
+		(struct ec_params_read_test *)(req_buf + sizeof(*req));
+	uint32_t *data = (uint32_t *)(resp_buf + sizeof(*resp));
+	int i;
+
+	hostcmd_fill_in_default();
+	req->command = EC_CMD_READ_TEST;
+	req->data_len = sizeof(*rt_p);
+	pkt.request_size = sizeof(*req) + sizeof(*rt_p);
+	rt_p->offset = 0x100;
+	rt_p->size = 64;
+
+	hostcmd_send();
+	TEST_EQ(resp->result, EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp->data_len, 64, "%d");
+	for (i = 0; i < 16; i++)
+		TEST_EQ(data[i], 0x100 + i, "0x%x");
+
+	/* More than the response buffer holds */
+	rt_p->size = BUFFER_SIZE;
+	req->checksum = 0;
+	hostcmd_send();
+	TEST_EQ(resp->result, EC_RES_ERROR, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	wait_for_task_started();
@@ -315,6 +344,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_hostcmd_invalid_checksum);
 	RUN_TEST(test_hostcmd_reuse_response_buffer);
 	RUN_TEST(test_hostcmd_clears_unused_data);
+	RUN_TEST(test_hostcmd_read_test);
 
 	test_print_result();
 }
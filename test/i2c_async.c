@@ -0,0 +1,230 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests the I2C transfer queue which CONFIG_I2C_ASYNC chip drivers run.
+ */
+
+#include "common.h"
+#include "i2c.h"
+#include "i2c_private.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+static struct i2c_async_queue q;
+static struct i2c_xfer_async xfers[4];
+
+/* Transfers in the order their callback ran */
+static struct i2c_xfer_async *done_log[8];
+static int done_count;
+/* Queued by the next callback */
+static struct i2c_xfer_async *push_on_done;
+
+static void xfer_done(struct i2c_xfer_async *xfer)
+{
+	if (done_count < ARRAY_SIZE(done_log))
+		done_log[done_count++] = xfer;
+	if (push_on_done) {
+		i2c_async_push(&q, push_on_done);
+		push_on_done = NULL;
+	}
+}
+
+static void reset(void)
+{
+	int i;
+
+	i2c_async_queue_init(&q);
+	memset(xfers, 0, sizeof(xfers));
+	for (i = 0; i < ARRAY_SIZE(xfers); i++) {
+		xfers[i].flags = I2C_XFER_SINGLE;
+		xfers[i].done = xfer_done;
+		xfers[i].task = TASK_ID_INVALID;
+	}
+	done_count = 0;
+	push_on_done = NULL;
+}
+
+/* Run the next transfer and finish it */
+static struct i2c_xfer_async *run_next(int rv)
+{
+	struct i2c_xfer_async *xfer = i2c_async_next(&q);
+
+	if (xfer)
+		i2c_async_complete(&q, rv);
+	return xfer;
+}
+
+test_static int test_order(void)
+{
+	int i;
+
+	reset();
+	TEST_ASSERT(i2c_async_next(&q) == NULL);
+
+	for (i = 0; i < 3; i++)
+		i2c_async_push(&q, &xfers[i]);
+	TEST_EQ(xfers[0].busy, 1, "%d");
+	TEST_EQ(xfers[0].rv, EC_ERROR_BUSY, "%d");
+	TEST_EQ(q.depth, 3, "%d");
+
+	TEST_ASSERT(i2c_async_next(&q) == &xfers[0]);
+	TEST_ASSERT(q.running == &xfers[0]);
+	/* The running transfer still counts */
+	TEST_EQ(q.depth, 3, "%d");
+	i2c_async_complete(&q, EC_SUCCESS);
+	TEST_ASSERT(q.running == NULL);
+	TEST_EQ(xfers[0].busy, 0, "%d");
+	TEST_EQ(xfers[0].rv, EC_SUCCESS, "%d");
+
+	TEST_ASSERT(run_next(EC_ERROR_UNKNOWN) == &xfers[1]);
+	TEST_EQ(xfers[1].rv, EC_ERROR_UNKNOWN, "%d");
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[2]);
+	TEST_ASSERT(run_next(EC_SUCCESS) == NULL);
+
+	TEST_EQ(done_count, 3, "%d");
+	for (i = 0; i < 3; i++)
+		TEST_ASSERT(done_log[i] == &xfers[i]);
+	TEST_EQ(q.queued, 3, "%d");
+	TEST_EQ(q.done, 3, "%d");
+	TEST_EQ(q.errors, 1, "%d");
+	TEST_EQ(q.depth, 0, "%d");
+	TEST_EQ(q.max_depth, 3, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_queue_from_callback(void)
+{
+	reset();
+	i2c_async_push(&q, &xfers[0]);
+	i2c_async_push(&q, &xfers[1]);
+
+	/* The descriptor is free again in its own callback */
+	push_on_done = &xfers[0];
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[0]);
+	TEST_EQ(xfers[0].busy, 1, "%d");
+
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[1]);
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[0]);
+	TEST_ASSERT(run_next(EC_SUCCESS) == NULL);
+	TEST_EQ(done_count, 3, "%d");
+	TEST_EQ(q.depth, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_open_bus(void)
+{
+	reset();
+	/* Task 1 keeps the bus between its transfers */
+	xfers[0].task = 1;
+	xfers[0].flags = I2C_XFER_START;
+	xfers[1].task = 2;
+	xfers[2].task = 1;
+	xfers[2].flags = I2C_XFER_STOP;
+	i2c_async_push(&q, &xfers[0]);
+	i2c_async_push(&q, &xfers[1]);
+
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[0]);
+	TEST_EQ(q.open_task, 1, "%d");
+	/* Task 2 waits until task 1 sends the STOP */
+	TEST_ASSERT(i2c_async_next(&q) == NULL);
+
+	i2c_async_push(&q, &xfers[2]);
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[2]);
+	TEST_EQ(q.open_task, TASK_ID_INVALID, "%d");
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[1]);
+
+	/* A failed transfer leaves the bus stopped */
+	i2c_async_push(&q, &xfers[0]);
+	i2c_async_push(&q, &xfers[1]);
+	TEST_ASSERT(run_next(EC_ERROR_UNKNOWN) == &xfers[0]);
+	TEST_EQ(q.open_task, TASK_ID_INVALID, "%d");
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[1]);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_requeue(void)
+{
+	reset();
+	i2c_async_push(&q, &xfers[0]);
+	i2c_async_push(&q, &xfers[1]);
+
+	/* The bus was bad, the transfer goes first once it is fixed */
+	TEST_ASSERT(i2c_async_next(&q) == &xfers[0]);
+	i2c_async_requeue(&q);
+	TEST_ASSERT(q.running == NULL);
+	TEST_EQ(xfers[0].busy, 1, "%d");
+	TEST_EQ(done_count, 0, "%d");
+
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[0]);
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[1]);
+	TEST_EQ(q.depth, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_fail_queued(void)
+{
+	int i;
+
+	reset();
+	for (i = 0; i < 3; i++)
+		i2c_async_push(&q, &xfers[i]);
+	/* Also fails what the callbacks queue */
+	push_on_done = &xfers[3];
+
+	i2c_async_fail_queued(&q, EC_ERROR_BUSY);
+	TEST_ASSERT(q.running == NULL);
+	TEST_ASSERT(q.queue == NULL);
+	TEST_EQ(done_count, 4, "%d");
+	for (i = 0; i < 4; i++) {
+		TEST_ASSERT(done_log[i] == &xfers[i]);
+		TEST_EQ(xfers[i].busy, 0, "%d");
+		TEST_EQ(xfers[i].rv, EC_ERROR_BUSY, "%d");
+	}
+	TEST_EQ(q.errors, 4, "%d");
+	TEST_EQ(q.depth, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_task_event(void)
+{
+	reset();
+	xfers[0].done = NULL;
+	xfers[0].task = task_get_current();
+	i2c_async_push(&q, &xfers[0]);
+
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[0]);
+	TEST_EQ(xfers[0].busy, 0, "%d");
+	TEST_EQ(task_wait_event_mask(TASK_EVENT_I2C_DONE, MSEC),
+		TASK_EVENT_I2C_DONE, "0x%x");
+
+	/* Nobody to tell */
+	xfers[0].task = TASK_ID_INVALID;
+	i2c_async_push(&q, &xfers[0]);
+	TEST_ASSERT(run_next(EC_SUCCESS) == &xfers[0]);
+	TEST_EQ(task_wait_event_mask(TASK_EVENT_I2C_DONE, MSEC),
+		TASK_EVENT_TIMER, "0x%x");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_order);
+	RUN_TEST(test_queue_from_callback);
+	RUN_TEST(test_open_bus);
+	RUN_TEST(test_requeue);
+	RUN_TEST(test_fail_queued);
+	RUN_TEST(test_task_event);
+
+	test_print_result();
+}
@@ -0,0 +1,293 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the I2C register cache.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "i2c.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define PORT		0
+#define DEV8		0x20	/* 8-bit register addresses */
+#define DEV16		0x30	/* 16-bit register offsets */
+
+#define REG_TTL		0x10
+#define REG_KEEP	0x12
+#define REG_DROP	0x14
+#define REG_OTHER	0x16
+#define REG_BLOCK	0x0100
+
+#define TTL_US		(50 * MSEC)
+
+struct i2c_cache_reg i2c_cache_regs[] = {
+	{ PORT, DEV8, REG_TTL, 2, 0, TTL_US },
+	{ PORT, DEV8, REG_KEEP, 2, 0, 0 },
+	{ PORT, DEV8, REG_DROP, 1, I2C_CACHE_WRITE_DROP, 0 },
+	{ PORT, DEV16, REG_BLOCK, 8, I2C_CACHE_OFFSET16, 0 },
+};
+const unsigned int i2c_cache_regs_used = ARRAY_SIZE(i2c_cache_regs);
+
+static uint8_t regs8[256];
+static uint8_t regs16[0x200];
+static int bus_reads;
+static int bus_writes;
+
+static int cache_i2c_xfer(const int port, const uint16_t addr_flags,
+			  const uint8_t *out, int out_size,
+			  uint8_t *in, int in_size, int flags)
+{
+	uint8_t *regs;
+	int reg, n;
+
+	if (port != PORT)
+		return EC_ERROR_INVAL;
+	if (I2C_GET_ADDR(addr_flags) == DEV8) {
+		regs = regs8;
+		reg = out[0];
+		n = 1;
+	} else if (I2C_GET_ADDR(addr_flags) == DEV16) {
+		regs = regs16;
+		reg = ((out[0] << 8) | out[1]) % sizeof(regs16);
+		n = 2;
+	} else {
+		return EC_ERROR_INVAL;
+	}
+
+	if (in_size) {
+		memcpy(in, regs + reg, in_size);
+		bus_reads++;
+	} else {
+		memcpy(regs + reg, out + n, out_size - n);
+		bus_writes++;
+	}
+	return EC_SUCCESS;
+}
+DECLARE_TEST_I2C_XFER(cache_i2c_xfer);
+
+static void reset_device(void)
+{
+	memset(regs8, 0, sizeof(regs8));
+	memset(regs16, 0, sizeof(regs16));
+	i2c_cache_invalidate(PORT, DEV8);
+	i2c_cache_invalidate(PORT, DEV16);
+	bus_reads = 0;
+	bus_writes = 0;
+}
+
+test_static int test_ttl(void)
+{
+	int val;
+
+	reset_device();
+	regs8[REG_TTL] = 0x34;
+	regs8[REG_TTL + 1] = 0x12;
+
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x1234, "0x%x");
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x1234, "0x%x");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* The device changed it, the cache still says the old value */
+	regs8[REG_TTL] = 0x78;
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x1234, "0x%x");
+
+	usleep(TTL_US + 10 * MSEC);
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x1278, "0x%x");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	/* A read of another size is not cached */
+	TEST_EQ(i2c_read8(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read8(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 4, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_ttl_wrap(void)
+{
+	timestamp_t now;
+	int val;
+
+	reset_device();
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* Just over 2^32 us later, the low word of the time is close again */
+	now = get_time();
+	now.val += (1ULL << 32) + MSEC;
+	force_time(now);
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_TTL, &val), EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_unlocked(void)
+{
+	uint8_t reg = REG_KEEP;
+	uint8_t buf[2];
+	int val;
+
+	reset_device();
+	regs8[REG_KEEP] = 0x11;
+	i2c_lock(PORT, 1);
+	TEST_EQ(i2c_xfer_unlocked(PORT, DEV8, &reg, 1, buf, 2,
+				  I2C_XFER_SINGLE),
+		EC_SUCCESS, "%d");
+	TEST_EQ(i2c_xfer_unlocked(PORT, DEV8, &reg, 1, buf, 2,
+				  I2C_XFER_SINGLE),
+		EC_SUCCESS, "%d");
+	TEST_EQ(buf[0], 0x11, "0x%x");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* Parts of a split transfer go to the bus */
+	TEST_EQ(i2c_xfer_unlocked(PORT, DEV8, &reg, 1, buf, 2,
+				  I2C_XFER_START),
+		EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 2, "%d");
+	i2c_lock(PORT, 0);
+
+	/* What the unlocked read cached serves i2c_xfer() as well */
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x11, "0x%x");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_write_through(void)
+{
+	int val;
+
+	reset_device();
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_write16(PORT, DEV8, REG_KEEP, 0xabcd), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0xabcd, "0x%x");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* Read-modify-write only writes */
+	TEST_EQ(i2c_update16(PORT, DEV8, REG_KEEP, 0x0030, MASK_SET),
+		EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 1, "%d");
+	TEST_EQ(bus_writes, 2, "%d");
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0xabfd, "0x%x");
+	TEST_EQ(regs8[REG_KEEP], 0xfd, "0x%x");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* Writing only one byte of the register drops it */
+	TEST_EQ(i2c_write8(PORT, DEV8, REG_KEEP + 1, 0x55), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x55fd, "0x%x");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	/* Registers next to it are left alone */
+	TEST_EQ(i2c_write8(PORT, DEV8, REG_OTHER, 0x55), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_write_drop(void)
+{
+	int val;
+
+	reset_device();
+	TEST_EQ(i2c_read8(PORT, DEV8, REG_DROP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read8(PORT, DEV8, REG_DROP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* Say the device clears the bits written */
+	TEST_EQ(i2c_write8(PORT, DEV8, REG_DROP, 0x80), EC_SUCCESS, "%d");
+	regs8[REG_DROP] = 0;
+	TEST_EQ(i2c_read8(PORT, DEV8, REG_DROP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0, "0x%x");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_offset16(void)
+{
+	uint8_t block[8];
+	int i;
+
+	reset_device();
+	for (i = 0; i < sizeof(block); i++)
+		regs16[REG_BLOCK + i] = i;
+
+	for (i = 0; i < 3; i++) {
+		TEST_EQ(i2c_read_offset16_block(PORT, DEV16, REG_BLOCK, block,
+						sizeof(block)),
+			EC_SUCCESS, "%d");
+		TEST_EQ(block[7], 7, "%d");
+	}
+	TEST_EQ(bus_reads, 1, "%d");
+
+	/* A write inside the block drops it */
+	TEST_EQ(i2c_write_offset16(PORT, DEV16, REG_BLOCK + 6, 0x99, 1),
+		EC_SUCCESS, "%d");
+	TEST_EQ(i2c_read_offset16_block(PORT, DEV16, REG_BLOCK, block,
+					sizeof(block)),
+		EC_SUCCESS, "%d");
+	TEST_EQ(block[6], 0x99, "0x%x");
+	TEST_EQ(bus_reads, 2, "%d");
+
+	/* So does a reset */
+	i2c_cache_invalidate(PORT, DEV16);
+	TEST_EQ(i2c_read_offset16_block(PORT, DEV16, REG_BLOCK, block,
+					sizeof(block)),
+		EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 3, "%d");
+
+	/* Then it is cached again */
+	TEST_EQ(i2c_read_offset16_block(PORT, DEV16, REG_BLOCK, block,
+					sizeof(block)),
+		EC_SUCCESS, "%d");
+	TEST_EQ(bus_reads, 3, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_errors_not_cached(void)
+{
+	int val;
+
+	reset_device();
+	TEST_EQ(test_detach_i2c(PORT, DEV8), EC_SUCCESS, "%d");
+	TEST_NE(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_NE(i2c_write16(PORT, DEV8, REG_KEEP, 0x1111), EC_SUCCESS, "%d");
+	TEST_EQ(test_attach_i2c(PORT, DEV8), EC_SUCCESS, "%d");
+
+	regs8[REG_KEEP] = 0x22;
+	TEST_EQ(i2c_read16(PORT, DEV8, REG_KEEP, &val), EC_SUCCESS, "%d");
+	TEST_EQ(val, 0x22, "0x%x");
+	TEST_EQ(bus_reads, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_ttl);
+	RUN_TEST(test_ttl_wrap);
+	RUN_TEST(test_unlocked);
+	RUN_TEST(test_write_through);
+	RUN_TEST(test_write_drop);
+	RUN_TEST(test_offset16);
+	RUN_TEST(test_errors_not_cached);
+
+	test_print_result();
+}
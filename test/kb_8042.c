@@ -16,16 +16,21 @@
 #include "lpc.h"
 #include "power_button.h"
 #include "system.h"
+#include "task.h"
 #include "test_util.h"
 #include "timer.h"
 #include "util.h"
 
 static const char *action[2] = {"release", "press"};
 
-#define BUF_SIZE 16
+#define BUF_SIZE 64
 static char lpc_char_buf[BUF_SIZE];
 static unsigned int lpc_char_cnt;
 
+/* When set, each byte stays in the output buffer until the host reads it */
+static int host_paced;
+static int obf_full;
+
 /*****************************************************************************/
 /* Mock functions */
 
@@ -34,9 +39,16 @@ int lid_is_open(void)
 	return 1;
 }
 
+int lpc_keyboard_has_char(void)
+{
+	return obf_full;
+}
+
 void lpc_keyboard_put_char(uint8_t chr, int send_irq)
 {
-	lpc_char_buf[lpc_char_cnt++] = chr;
+	if (lpc_char_cnt < BUF_SIZE)
+		lpc_char_buf[lpc_char_cnt++] = chr;
+	obf_full = host_paced;
 }
 
 /*****************************************************************************/
@@ -323,6 +335,127 @@ static int test_vivaldi_top_keys(void)
 	return EC_SUCCESS;
 }
 
+/* Move the queued bytes to the host, as the output buffer interrupt does */
+static void drain_to_host(void)
+{
+	unsigned int n;
+
+	do {
+		n = lpc_char_cnt;
+		keyboard_host_read_done();
+	} while (lpc_char_cnt != n);
+}
+
+/*
+ * Key press and release through get_scancode_set2(), from the matrix to the
+ * bytes the host reads. kb_hx30 times the same with the hx30 layer tables.
+ */
+BENCHMARK(kb_8042_press_release, 100)
+{
+	lpc_char_cnt = 0;
+	keyboard_state_changed(1, 1, 1);
+	keyboard_state_changed(1, 1, 0);
+	drain_to_host();
+}
+
+static int test_key_benchmarks(void)
+{
+	char expect[BUF_SIZE];
+	unsigned int n;
+	int rv;
+
+	enable_keystroke(1);
+
+	lpc_char_cnt = 0;
+	keyboard_state_changed(1, 1, 1);
+	keyboard_state_changed(1, 1, 0);
+	drain_to_host();
+	n = lpc_char_cnt;
+	memcpy(expect, lpc_char_buf, n);
+	TEST_ASSERT(n > 0);
+
+	rv = test_run_benchmarks();
+
+	/* The last run still sent the keys */
+	TEST_EQ(lpc_char_cnt, n, "%d");
+	TEST_ASSERT_ARRAY_EQ(lpc_char_buf, expect, n);
+
+	return rv;
+}
+
+#define BURST_KEYS 20
+
+static void burst_keys(int pressed, int delay_ms)
+{
+	int i;
+
+	for (i = 0; i < BURST_KEYS; i++) {
+		keyboard_state_changed(1 + i / 5, 1 + i % 5, pressed);
+		if (delay_ms)
+			msleep(delay_ms);
+	}
+}
+
+/*
+ * 20-key rollover: all the make codes are queued at once, and the host reads
+ * them one byte at a time as fast as it can.
+ */
+static int test_rollover_burst(void)
+{
+	char expect[BUF_SIZE];
+	struct kb_to_host_stats stats;
+	timestamp_t start, deadline;
+	unsigned int n;
+
+	enable_keystroke(1);
+
+	/* Collect the expected bytes one key at a time */
+	lpc_char_cnt = 0;
+	burst_keys(1, 5);
+	n = lpc_char_cnt;
+	memcpy(expect, lpc_char_buf, n);
+	burst_keys(0, 0);
+	msleep(30);
+	TEST_ASSERT(n >= BURST_KEYS && n < BUF_SIZE);
+	TEST_ASSERT(n <= CONFIG_8042_TO_HOST_SIZE);
+
+	keyboard_get_to_host_stats(&stats, 1);
+	host_paced = 1;
+	obf_full = 0;
+	lpc_char_cnt = 0;
+
+	start = get_time();
+	deadline.val = start.val + 100 * MSEC;
+	burst_keys(1, 0);
+	while (lpc_char_cnt < n && !timestamp_expired(deadline, NULL)) {
+		if (!obf_full) {
+			usleep(10);
+			continue;
+		}
+		/* Host read, emulate the output buffer empty interrupt */
+		obf_full = 0;
+		if (!keyboard_host_read_done())
+			task_wake(TASK_ID_KEYPROTO);
+	}
+	ccprintf("Burst of %d bytes in %d us\n", n,
+		 (int)(get_time().val - start.val));
+	TEST_EQ(lpc_char_cnt, n, "%d");
+	TEST_ASSERT_ARRAY_EQ(lpc_char_buf, expect, n);
+
+	host_paced = 0;
+	obf_full = 0;
+	keyboard_get_to_host_stats(&stats, 1);
+	burst_keys(0, 0);
+	msleep(30);
+
+	TEST_EQ(stats.dropped, 0, "%d");
+	TEST_EQ(stats.high_water, n, "%d");
+	/* Only the first byte needed the protocol task */
+	TEST_EQ(stats.isr_refills, n - 1, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -336,6 +469,8 @@ void run_test(int argc, char **argv)
 		RUN_TEST(test_power_button);
 		RUN_TEST(test_ec_cmd_get_keybd_config);
 		RUN_TEST(test_vivaldi_top_keys);
+		RUN_TEST(test_key_benchmarks);
+		RUN_TEST(test_rollover_burst);
 		RUN_TEST(test_sysjump);
 	} else {
 		RUN_TEST(test_sysjump_cont);
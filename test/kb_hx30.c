@@ -0,0 +1,573 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests the hx30 Fn layer tables (board/hx30/keyboard_customization.c)
+ * against the scancode callback they replaced.
+ */
+
+#include "common.h"
+#include "i8042_protocol.h"
+#include "keyboard_8042.h"
+#include "keyboard_8042_sharedlib.h"
+#include "keyboard_protocol.h"
+#include "pwm.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* From the hx30 board.h */
+enum pwm_channel {
+	PWM_CH_KBL,
+	PWM_CH_COUNT
+};
+int pos_get_state(void);
+int factory_status(void);
+void simulate_keyboard(uint16_t scancode, int is_pressed);
+
+#include "../board/hx30/keyboard_customization.c"
+
+#define BUF_SIZE 64
+static char lpc_char_buf[BUF_SIZE];
+static unsigned int lpc_char_cnt;
+
+static int pos_state;
+static int factory_mode;
+
+/*
+ * Everything the key handling does besides returning a scancode, in the
+ * order it happened.
+ */
+#define LOG_SIZE 16
+#define LOG_HID(key, pressed) (0x10000 | (key) << 1 | !!(pressed))
+#define LOG_SIM(code, pressed) (0x20000 | (code) << 1 | !!(pressed))
+#define LOG_KBLIGHT(enable) (0x40000 | (enable))
+static uint32_t log_buf[LOG_SIZE];
+static int log_len;
+
+static void log_put(uint32_t entry)
+{
+	if (log_len < LOG_SIZE)
+		log_buf[log_len] = entry;
+	log_len++;
+}
+
+/*****************************************************************************/
+/* Mock functions */
+
+int lid_is_open(void)
+{
+	return 1;
+}
+
+int lpc_keyboard_has_char(void)
+{
+	return 0;
+}
+
+void lpc_keyboard_put_char(uint8_t chr, int send_irq)
+{
+	if (lpc_char_cnt < BUF_SIZE)
+		lpc_char_buf[lpc_char_cnt++] = chr;
+}
+
+int pos_get_state(void)
+{
+	return pos_state;
+}
+
+int factory_status(void)
+{
+	return factory_mode;
+}
+
+int update_hid_key(enum media_key key, bool pressed)
+{
+	log_put(LOG_HID(key, pressed));
+	return EC_SUCCESS;
+}
+
+void simulate_keyboard(uint16_t scancode, int is_pressed)
+{
+	log_put(LOG_SIM(scancode, is_pressed));
+}
+
+void pwm_enable(enum pwm_channel ch, int enabled)
+{
+	log_put(LOG_KBLIGHT(enabled));
+}
+
+void pwm_set_duty(enum pwm_channel ch, int percent)
+{
+}
+
+int pwm_get_duty(enum pwm_channel ch)
+{
+	return 0;
+}
+
+/*****************************************************************************/
+/*
+ * The hx30 scancode callback before the layer tables, with its state renamed.
+ * Only the key events go through it; the scancode comes from
+ * get_scancode_set2().
+ */
+
+static uint8_t old_fn_key;
+static uint32_t old_fn_key_table_media;
+static uint32_t old_fn_key_table;
+
+static int old_fn_table_media_set(int8_t pressed, uint32_t fn_bit)
+{
+	if (pressed) {
+		old_fn_key_table_media |= fn_bit;
+		return true;
+	} else if (!pressed && (old_fn_key_table_media & fn_bit)) {
+		old_fn_key_table_media &= ~fn_bit;
+		return true;
+	}
+
+	return false;
+}
+
+static int old_fn_table_set(int8_t pressed, uint32_t fn_bit)
+{
+	if (pressed && (old_fn_key & FN_PRESSED)) {
+		old_fn_key_table |= fn_bit;
+		return true;
+	} else if (!pressed && (old_fn_key_table & fn_bit)) {
+		old_fn_key_table &= ~fn_bit;
+		return true;
+	}
+
+	return false;
+}
+
+static int old_hotkey_F1_F12(uint16_t *key_code, uint16_t fn, int8_t pressed)
+{
+	static const struct {
+		uint16_t key;
+		uint32_t bit;
+		uint16_t code;
+		int hid;
+	} media[] = {
+		{SCANCODE_F1, KB_FN_F1, SCANCODE_VOLUME_MUTE, -1},
+		{SCANCODE_F2, KB_FN_F2, SCANCODE_VOLUME_DOWN, -1},
+		{SCANCODE_F3, KB_FN_F3, SCANCODE_VOLUME_UP, -1},
+		{SCANCODE_F4, KB_FN_F4, SCANCODE_PREV_TRACK, -1},
+		{SCANCODE_F5, KB_FN_F5, 0xe034, -1},
+		{SCANCODE_F6, KB_FN_F6, SCANCODE_NEXT_TRACK, -1},
+		{SCANCODE_F7, KB_FN_F7, 0, HID_KEY_DISPLAY_BRIGHTNESS_DN},
+		{SCANCODE_F8, KB_FN_F8, 0, HID_KEY_DISPLAY_BRIGHTNESS_UP},
+		{SCANCODE_F9, KB_FN_F9, 0, -1},
+		{SCANCODE_F10, KB_FN_F10, 0, HID_KEY_AIRPLANE_MODE},
+		{SCANCODE_F11, KB_FN_F11, 0xe07c, -1},
+		{SCANCODE_F12, KB_FN_F12, 0xe050, -1},
+	};
+	int i;
+
+	if (!(old_fn_key & FN_LOCKED) &&
+		(fn & FN_PRESSED))
+		return EC_SUCCESS;
+	else if (old_fn_key & FN_LOCKED &&
+		!(fn & FN_PRESSED) &&
+		!old_fn_key_table_media)
+		return EC_SUCCESS;
+	else if (!old_fn_key_table_media && !pressed)
+		return EC_SUCCESS;
+
+	for (i = 0; i < ARRAY_SIZE(media); i++) {
+		if (media[i].key != *key_code)
+			continue;
+		if (!old_fn_table_media_set(pressed, media[i].bit))
+			return EC_SUCCESS;
+		if (media[i].code) {
+			*key_code = media[i].code;
+			return EC_SUCCESS;
+		}
+		if (media[i].hid >= 0) {
+			update_hid_key(media[i].hid, pressed);
+		} else if (pressed) {
+			/* EXTERNAL_DISPLAY */
+			simulate_keyboard(SCANCODE_LEFT_WIN, 1);
+			simulate_keyboard(SCANCODE_P, 1);
+		} else {
+			simulate_keyboard(SCANCODE_P, 0);
+			simulate_keyboard(SCANCODE_LEFT_WIN, 0);
+		}
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+
+	return EC_SUCCESS;
+}
+
+static int old_hotkey_special_key(uint16_t *key_code, int8_t pressed)
+{
+	static const struct {
+		uint16_t key;
+		uint32_t bit;
+		uint16_t code;
+	} special[] = {
+		{SCANCODE_DELETE, KB_FN_DELETE, 0xe070},
+		{SCANCODE_K, KB_FN_K, SCANCODE_SCROLL_LOCK},
+		{SCANCODE_LEFT, KB_FN_LEFT, 0xe06c},
+		{SCANCODE_RIGHT, KB_FN_RIGHT, 0xe069},
+		{SCANCODE_UP, KB_FN_UP, 0xe07d},
+		{SCANCODE_DOWN, KB_FN_DOWN, 0xe07a},
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(special); i++) {
+		if (special[i].key == *key_code) {
+			if (old_fn_table_set(pressed, special[i].bit))
+				*key_code = special[i].code;
+			break;
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+static int old_functional_hotkey(uint16_t *key_code, int8_t pressed)
+{
+	switch (*key_code) {
+	case SCANCODE_ESC:
+		if (old_fn_table_set(pressed, KB_FN_ESC)) {
+			if (pressed)
+				old_fn_key ^= FN_LOCKED;
+			return EC_ERROR_UNIMPLEMENTED;
+		}
+		break;
+	case SCANCODE_B:
+		if (old_fn_table_set(pressed, KB_FN_B)) {
+			if (pressed) {
+				simulate_keyboard(0xe07e, 1);
+				simulate_keyboard(0xe0, 1);
+				simulate_keyboard(0x7e, 0);
+			}
+			return EC_ERROR_UNIMPLEMENTED;
+		}
+		break;
+	case SCANCODE_P:
+		if (old_fn_table_set(pressed, KB_FN_P)) {
+			if (pressed) {
+				simulate_keyboard(0xe114, 1);
+				simulate_keyboard(0x77, 1);
+				simulate_keyboard(0xe1, 1);
+				simulate_keyboard(0x14, 0);
+				simulate_keyboard(0x77, 0);
+			}
+			return EC_ERROR_UNIMPLEMENTED;
+		}
+		break;
+	case SCANCODE_SPACE:
+		if (old_fn_table_set(pressed, KB_FN_SPACE)) {
+			uint8_t bl_brightness;
+
+			if (!pressed)
+				return EC_ERROR_UNIMPLEMENTED;
+
+			bl_brightness = kblight_get();
+			switch (bl_brightness) {
+			case KEYBOARD_BL_BRIGHTNESS_LOW:
+				bl_brightness = KEYBOARD_BL_BRIGHTNESS_MED;
+				break;
+			case KEYBOARD_BL_BRIGHTNESS_MED:
+				bl_brightness = KEYBOARD_BL_BRIGHTNESS_HIGH;
+				break;
+			case KEYBOARD_BL_BRIGHTNESS_HIGH:
+				hx20_kblight_enable(0);
+				bl_brightness = KEYBOARD_BL_BRIGHTNESS_OFF;
+				break;
+			default:
+			case KEYBOARD_BL_BRIGHTNESS_OFF:
+				hx20_kblight_enable(1);
+				bl_brightness = KEYBOARD_BL_BRIGHTNESS_LOW;
+				break;
+			}
+			kblight_set(bl_brightness);
+			return EC_ERROR_UNIMPLEMENTED;
+		}
+		break;
+	}
+	return EC_SUCCESS;
+}
+
+static int old_scancode_callback(uint16_t *make_code, int8_t pressed)
+{
+	int r;
+
+	if (factory_status())
+		return EC_SUCCESS;
+
+	if (*make_code == SCANCODE_FN) {
+		if (pressed)
+			old_fn_key |= FN_PRESSED;
+		else
+			old_fn_key &= ~FN_PRESSED;
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+
+	if (!pos_get_state())
+		return EC_SUCCESS;
+
+	r = old_hotkey_F1_F12(make_code, old_fn_key, pressed);
+	if (r != EC_SUCCESS)
+		return r;
+
+	if (!(old_fn_key & FN_PRESSED) && !old_fn_key_table)
+		return EC_SUCCESS;
+
+	r = old_hotkey_special_key(make_code, pressed);
+	if (r != EC_SUCCESS)
+		return r;
+
+	return old_functional_hotkey(make_code, pressed);
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+struct key_result {
+	int rv;
+	uint16_t code;
+	uint8_t fn_set;
+	uint8_t fn_cleared;
+	int kblight;
+	int log_len;
+	uint32_t log[LOG_SIZE];
+};
+
+static void key_result_save(struct key_result *res, int rv, uint16_t code,
+			    uint8_t fn_before, uint8_t fn_after)
+{
+	res->rv = rv;
+	/* Only what is sent to the host matters */
+	res->code = rv == EC_SUCCESS ? code : 0;
+	res->fn_set = fn_after & ~fn_before;
+	res->fn_cleared = fn_before & ~fn_after;
+	res->kblight = kblight_get();
+	res->log_len = log_len;
+	memcpy(res->log, log_buf, sizeof(log_buf));
+}
+
+static void old_key(int row, int col, int pressed, uint8_t fn,
+		    struct key_result *res)
+{
+	uint16_t code = get_scancode_set2(row, col);
+	int rv;
+
+	old_fn_key = fn;
+	log_len = 0;
+	memset(log_buf, 0, sizeof(log_buf));
+	kblight_set(KEYBOARD_BL_BRIGHTNESS_MED);
+	rv = old_scancode_callback(&code, pressed);
+	key_result_save(res, rv, code, fn, old_fn_key);
+}
+
+static void new_key(int row, int col, int pressed, uint8_t fn,
+		    struct key_result *res)
+{
+	uint16_t code;
+	int rv;
+
+	Fn_key = fn;
+	code = keyboard_scancode_lookup(row, col, pressed);
+	log_len = 0;
+	memset(log_buf, 0, sizeof(log_buf));
+	kblight_set(KEYBOARD_BL_BRIGHTNESS_MED);
+	rv = keyboard_scancode_callback(&code, pressed);
+	key_result_save(res, rv, code, fn, Fn_key);
+}
+
+static int check_key_result(const struct key_result *want,
+			    const struct key_result *got)
+{
+	/* Quiet on success, this runs for thousands of key events */
+	TEST_ASSERT(got->rv == want->rv);
+	TEST_ASSERT(got->code == want->code);
+	TEST_ASSERT(got->fn_set == want->fn_set);
+	TEST_ASSERT(got->fn_cleared == want->fn_cleared);
+	TEST_ASSERT(got->kblight == want->kblight);
+	TEST_ASSERT(got->log_len == want->log_len);
+	TEST_ASSERT_ARRAY_EQ(got->log, want->log, LOG_SIZE);
+
+	return EC_SUCCESS;
+}
+
+/*
+ * Press a key in one Fn state and release it in another. The press must do
+ * what the old callback did. The release must do what the old callback did
+ * when Fn did not change in between: the old one could release a different
+ * key than it pressed (e.g. F4 pressed as PREV_TRACK, Fn pressed, F4 released
+ * as F4), which left the media key stuck on the host.
+ */
+static int check_key(int row, int col, uint8_t press_fn, uint8_t release_fn)
+{
+	struct key_result want, got;
+
+	old_fn_key_table_media = 0;
+	old_fn_key_table = 0;
+
+	old_key(row, col, 1, press_fn, &want);
+	new_key(row, col, 1, press_fn, &got);
+	if (check_key_result(&want, &got) != EC_SUCCESS)
+		return EC_ERROR_UNKNOWN;
+
+	/* Fn itself stays pressed until it is released */
+	if (get_scancode_set2(row, col) == SCANCODE_FN)
+		release_fn |= FN_PRESSED;
+
+	old_key(row, col, 0, old_fn_key, &want);
+	new_key(row, col, 0, release_fn, &got);
+	if (check_key_result(&want, &got) != EC_SUCCESS)
+		return EC_ERROR_UNKNOWN;
+
+	return EC_SUCCESS;
+}
+
+/* Every key, pressed and released in every pair of Fn states */
+static int check_all_keys(void)
+{
+	int row, col, press_fn, release_fn;
+
+	for (col = 0; col < KEYBOARD_COLS_MAX; col++)
+		for (row = 0; row < KEYBOARD_ROWS; row++)
+			for (press_fn = 0; press_fn < KB_LAYER_COUNT;
+			     press_fn++)
+				for (release_fn = 0;
+				     release_fn < KB_LAYER_COUNT; release_fn++) {
+					if (check_key(row, col, press_fn,
+						      release_fn) == EC_SUCCESS)
+						continue;
+					ccprintf("Key %d:%d Fn %d/%d\n", row,
+						 col, press_fn, release_fn);
+					return EC_ERROR_UNKNOWN;
+				}
+
+	return EC_SUCCESS;
+}
+
+static void enable_keystroke(int enabled)
+{
+	uint8_t data = enabled ? I8042_CMD_ENABLE : I8042_CMD_RESET_DIS;
+
+	keyboard_host_write(data, 0);
+	msleep(30);
+}
+
+/* Move the queued bytes to the host, as the output buffer interrupt does */
+static void drain_to_host(void)
+{
+	unsigned int n;
+
+	do {
+		n = lpc_char_cnt;
+		keyboard_host_read_done();
+	} while (lpc_char_cnt != n);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+test_static int test_layers_match_callback(void)
+{
+	pos_state = 1;
+	factory_mode = 0;
+	TEST_EQ(check_all_keys(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_layers_pre_os(void)
+{
+	pos_state = 0;
+	factory_mode = 0;
+	TEST_EQ(check_all_keys(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_layers_factory(void)
+{
+	pos_state = 1;
+	factory_mode = 1;
+	TEST_EQ(check_all_keys(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_layers_remap(void)
+{
+	uint16_t fn = get_scancode_set2(2, 2);
+	uint16_t f1 = get_scancode_set2(3, 5);
+
+	TEST_EQ(fn, SCANCODE_FN, "0x%04x");
+	TEST_EQ(f1, SCANCODE_F1, "0x%04x");
+
+	/* The host moves Fn and F1 around, the layers follow */
+	set_scancode_set2(2, 2, SCANCODE_F1);
+	set_scancode_set2(3, 5, SCANCODE_FN);
+	msleep(1);
+
+	pos_state = 1;
+	factory_mode = 0;
+	TEST_EQ(check_all_keys(), EC_SUCCESS, "%d");
+
+	set_scancode_set2(2, 2, fn);
+	set_scancode_set2(3, 5, f1);
+	msleep(1);
+	TEST_EQ(check_all_keys(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+/* F1 in the media layer, from the matrix to the bytes the host reads */
+BENCHMARK(kb_hx30_press_release, 100)
+{
+	lpc_char_cnt = 0;
+	keyboard_state_changed(3, 5, 1);
+	keyboard_state_changed(3, 5, 0);
+	drain_to_host();
+}
+
+test_static int test_key_benchmarks(void)
+{
+	/* VOLUME_MUTE make and break codes, translated to set 1 by default */
+	const char mute[] = "\xe0\x20\xe0\xa0";
+	int rv;
+
+	pos_state = 1;
+	factory_mode = 0;
+	Fn_key = 0;
+	enable_keystroke(1);
+
+	lpc_char_cnt = 0;
+	keyboard_state_changed(3, 5, 1);
+	keyboard_state_changed(3, 5, 0);
+	drain_to_host();
+	TEST_EQ(lpc_char_cnt, (int)strlen(mute), "%d");
+	TEST_ASSERT_ARRAY_EQ(lpc_char_buf, mute, strlen(mute));
+
+	rv = test_run_benchmarks();
+
+	/* The last run still sent the keys */
+	TEST_EQ(lpc_char_cnt, (int)strlen(mute), "%d");
+	TEST_ASSERT_ARRAY_EQ(lpc_char_buf, mute, strlen(mute));
+
+	return rv;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_layers_match_callback);
+	RUN_TEST(test_layers_pre_os);
+	RUN_TEST(test_layers_factory);
+	RUN_TEST(test_layers_remap);
+	RUN_TEST(test_key_benchmarks);
+
+	test_print_result();
+}
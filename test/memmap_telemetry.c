@@ -0,0 +1,265 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the memory map telemetry block.
+ */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "gpio.h"
+#include "host_command.h"
+#include "memmap_telemetry.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+static struct ec_memmap_telemetry *telemetry(void)
+{
+	return (struct ec_memmap_telemetry *)
+		host_get_memmap(EC_MEMMAP_TELEMETRY);
+}
+
+/* Read the block the way a host would, retrying on a concurrent update */
+static int read_snapshot(struct ec_memmap_telemetry *t)
+{
+	const volatile uint16_t *seq = &telemetry()->seq;
+	uint16_t before;
+	int tries;
+
+	for (tries = 0; tries < 10; tries++) {
+		before = *seq;
+		memcpy(t, telemetry(), sizeof(*t));
+		if (!(before & 1) && *seq == before)
+			return EC_SUCCESS;
+	}
+
+	return EC_ERROR_BUSY;
+}
+
+test_static int test_seq(void)
+{
+	struct ec_memmap_telemetry t;
+	uint16_t seq;
+
+	memmap_telemetry_update();
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	TEST_EQ(t.version, EC_MEMMAP_TELEMETRY_VERSION, "%d");
+	TEST_EQ(t.seq & 1, 0, "%d");
+	seq = t.seq;
+
+	memmap_telemetry_update();
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	TEST_EQ(t.seq, (uint16_t)(seq + 2), "%d");
+
+	/* An update in progress is never returned */
+	telemetry()->seq |= 1;
+	TEST_EQ(read_snapshot(&t), EC_ERROR_BUSY, "%d");
+
+	/* The next update recovers from an odd counter */
+	memmap_telemetry_update();
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_mirror(void)
+{
+	struct ec_memmap_telemetry t;
+	uint8_t *temp = host_get_memmap(EC_MEMMAP_TEMP_SENSOR);
+	uint16_t *fan = (uint16_t *)host_get_memmap(EC_MEMMAP_FAN);
+	int i;
+
+	for (i = 0; i < EC_TELEMETRY_TEMP_ENTRIES; i++)
+		temp[i] = 10 + i;
+	for (i = 0; i < EC_TELEMETRY_FAN_ENTRIES; i++)
+		fan[i] = 1000 * (i + 1);
+
+	memmap_telemetry_update();
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	TEST_ASSERT_ARRAY_EQ(t.temp, temp, EC_TELEMETRY_TEMP_ENTRIES);
+	for (i = 0; i < EC_TELEMETRY_FAN_ENTRIES; i++)
+		TEST_EQ(t.fan_rpm[i], fan[i], "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_ac_present(void)
+{
+	struct ec_memmap_telemetry t;
+
+	gpio_set_level(GPIO_AC_PRESENT, 1);
+	msleep(50);
+	memmap_telemetry_update();
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	TEST_ASSERT(t.flags & EC_TELEMETRY_AC_PRESENT);
+
+	gpio_set_level(GPIO_AC_PRESENT, 0);
+	msleep(50);
+	memmap_telemetry_update();
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	TEST_ASSERT(!(t.flags & EC_TELEMETRY_AC_PRESENT));
+
+	return EC_SUCCESS;
+}
+
+test_static int test_periodic_update(void)
+{
+	struct ec_memmap_telemetry t;
+	uint16_t seq;
+	uint32_t update_ms;
+
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	seq = t.seq;
+	update_ms = t.update_ms;
+
+	/* The second hook refreshes the block on its own */
+	msleep(1500);
+	TEST_EQ(read_snapshot(&t), EC_SUCCESS, "%d");
+	TEST_NE(t.seq, seq, "%d");
+	TEST_ASSERT(t.update_ms > update_ms);
+
+	return EC_SUCCESS;
+}
+
+/* Start from a single temperature sensor and fan */
+static void reset_sensors(void)
+{
+	uint8_t *temp = host_get_memmap(EC_MEMMAP_TEMP_SENSOR);
+	uint16_t *fan = (uint16_t *)host_get_memmap(EC_MEMMAP_FAN);
+	int i;
+
+	for (i = 0; i < EC_TELEMETRY_TEMP_ENTRIES; i++)
+		temp[i] = EC_TEMP_SENSOR_NOT_PRESENT;
+	for (i = 0; i < EC_TELEMETRY_FAN_ENTRIES; i++)
+		fan[i] = EC_FAN_SPEED_NOT_PRESENT;
+	temp[0] = 100;
+	fan[0] = 2000;
+}
+
+static int subscribe(uint16_t fields, uint16_t min_interval_ms,
+		     struct ec_telemetry_subscription *r)
+{
+	struct ec_telemetry_subscription p = {
+		.fields = fields,
+		.min_interval_ms = min_interval_ms,
+	};
+
+	return test_send_host_command(EC_CMD_TELEMETRY_SUBSCRIBE, 0, &p,
+				      sizeof(p), r, sizeof(*r));
+}
+
+/* Fetch the next MKBP event, returns 0 if there is no telemetry event */
+static int get_event(struct ec_telemetry_event *ev)
+{
+	struct ec_response_get_next_event_v1 r;
+
+	if (test_send_host_command(EC_CMD_GET_NEXT_EVENT, 2, NULL, 0,
+				   &r, sizeof(r)) != EC_RES_SUCCESS)
+		return 0;
+	if ((r.event_type & EC_MKBP_EVENT_TYPE_MASK) !=
+	    EC_MKBP_EVENT_TELEMETRY)
+		return 0;
+	*ev = r.data.telemetry;
+
+	return 1;
+}
+
+test_static int test_event_thresholds(void)
+{
+	struct ec_telemetry_subscription r;
+	struct ec_telemetry_event ev;
+	uint8_t *temp = host_get_memmap(EC_MEMMAP_TEMP_SENSOR);
+	uint16_t *fan = (uint16_t *)host_get_memmap(EC_MEMMAP_FAN);
+
+	reset_sensors();
+	TEST_EQ(subscribe(EC_TELEMETRY_EVENT_TEMP | EC_TELEMETRY_EVENT_FAN,
+			  0, &r), EC_RES_SUCCESS, "%d");
+	/* Unset thresholds are reported with their default */
+	TEST_NE(r.temp_band, 0, "%d");
+	TEST_NE(r.fan_delta, 0, "%d");
+
+	/* The first update only sets the reference values */
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 0, "%d");
+
+	/* Moving within the thresholds is not reported */
+	fan[0] += r.fan_delta - 1;
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 0, "%d");
+
+	fan[0] += 1;
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 1, "%d");
+	TEST_EQ(ev.fields, EC_TELEMETRY_EVENT_FAN, "0x%x");
+	TEST_EQ(ev.fan_rpm_max, fan[0], "%d");
+	TEST_EQ(ev.seq, telemetry()->seq, "%d");
+
+	temp[3] = temp[0] + 2 * r.temp_band;
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 1, "%d");
+	TEST_EQ(ev.fields, EC_TELEMETRY_EVENT_TEMP, "0x%x");
+	TEST_EQ(ev.temp_max, temp[3], "%d");
+	TEST_EQ(ev.temp_max_id, 3, "%d");
+
+	/* Fields that are not subscribed are not reported */
+	TEST_EQ(subscribe(EC_TELEMETRY_EVENT_FAN, 0, &r), EC_RES_SUCCESS,
+		"%d");
+	memmap_telemetry_update();
+	temp[3] = temp[0];
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 0, "%d");
+
+	TEST_EQ(subscribe(0, 0, &r), EC_RES_SUCCESS, "%d");
+	fan[0] = 0;
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_event_rate_limit(void)
+{
+	struct ec_telemetry_subscription r;
+	struct ec_telemetry_event ev;
+	uint16_t *fan = (uint16_t *)host_get_memmap(EC_MEMMAP_FAN);
+
+	reset_sensors();
+	TEST_EQ(subscribe(EC_TELEMETRY_EVENT_FAN, 5000, &r), EC_RES_SUCCESS,
+		"%d");
+	memmap_telemetry_update();
+	fan[0] = 3000;
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 1, "%d");
+
+	/* Changes within the interval are held back and merged */
+	fan[0] = 5000;
+	memmap_telemetry_update();
+	fan[0] = 7000;
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 0, "%d");
+
+	force_time((timestamp_t)(get_time().val + 5 * SECOND));
+	memmap_telemetry_update();
+	TEST_EQ(get_event(&ev), 1, "%d");
+	TEST_EQ(ev.fields, EC_TELEMETRY_EVENT_FAN, "0x%x");
+	TEST_EQ(ev.fan_rpm_max, 7000, "%d");
+
+	TEST_EQ(subscribe(0, 0, &r), EC_RES_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_seq);
+	RUN_TEST(test_mirror);
+	RUN_TEST(test_ac_present);
+	RUN_TEST(test_periodic_update);
+	RUN_TEST(test_event_thresholds);
+	RUN_TEST(test_event_rate_limit);
+
+	test_print_result();
+}
@@ -0,0 +1,216 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests the task pick of the Cortex-M scheduler with mutex priority
+ * inheritance, on emulated tasks and mutexes.
+ */
+
+#include "common.h"
+#include "task.h"
+#include "test_util.h"
+#include "util.h"
+
+#include "../core/cortex-m/include/mutex_private.h"
+
+/* Emulated tasks, by increasing priority */
+enum {
+	LOW = TASK_ID_IDLE + 1,
+	MID,
+	MID2,
+	HIGH,
+};
+
+static uint32_t ready;
+static uint32_t blocked;
+static struct mutex *blocked_on[32];
+static struct mutex mtx_a, mtx_b;
+
+static void sim_reset(void)
+{
+	ready = BIT(TASK_ID_IDLE) | BIT(LOW) | BIT(MID) | BIT(MID2) |
+		BIT(HIGH);
+	blocked = 0;
+	memset(blocked_on, 0, sizeof(blocked_on));
+	memset(&mtx_a, 0, sizeof(mtx_a));
+	memset(&mtx_b, 0, sizeof(mtx_b));
+}
+
+static task_id_t sim_next(void)
+{
+	return mutex_pi_next_task(ready, blocked & ~ready, blocked_on);
+}
+
+static void sim_lock(task_id_t id, struct mutex *mtx)
+{
+	if (!mtx->lock) {
+		mtx->lock = 2;
+		mtx->owner = id;
+		return;
+	}
+
+	mtx->waiters |= BIT(id);
+	blocked_on[id] = mtx;
+	blocked |= BIT(id);
+	ready &= ~BIT(id);
+}
+
+/* The highest waiter gets the mutex, the others wait again */
+static void sim_unlock(struct mutex *mtx)
+{
+	task_id_t id;
+
+	mtx->lock = 0;
+	mtx->owner = TASK_ID_IDLE;
+	if (!mtx->waiters)
+		return;
+
+	id = __fls(mtx->waiters);
+	mtx->waiters &= ~BIT(id);
+	blocked &= ~BIT(id);
+	ready |= BIT(id);
+	sim_lock(id, mtx);
+}
+
+test_static int test_no_contention(void)
+{
+	sim_reset();
+	sim_lock(LOW, &mtx_a);
+	TEST_EQ(sim_next(), HIGH, "%d");
+
+	/* A task waiting on something else does not boost anybody */
+	ready &= ~BIT(HIGH);
+	TEST_EQ(sim_next(), MID2, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_boost_one_mutex(void)
+{
+	sim_reset();
+	ready &= ~BIT(MID2);
+	sim_lock(LOW, &mtx_a);
+	sim_lock(HIGH, &mtx_a);
+	TEST_EQ(sim_next(), LOW, "%d");
+
+	/* LOW waits on an event: MID runs, and HIGH keeps waiting */
+	ready &= ~BIT(LOW);
+	TEST_EQ(sim_next(), MID, "%d");
+	ready |= BIT(LOW);
+
+	sim_unlock(&mtx_a);
+	TEST_EQ(sim_next(), HIGH, "%d");
+	TEST_EQ(mtx_a.owner, HIGH, "%d");
+
+	/* HIGH is done, LOW is back behind MID */
+	sim_unlock(&mtx_a);
+	ready &= ~BIT(HIGH);
+	TEST_EQ(sim_next(), MID, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_boost_nested_owner(void)
+{
+	sim_reset();
+	ready &= ~BIT(MID2);
+	sim_lock(LOW, &mtx_a);
+	sim_lock(LOW, &mtx_b);
+	sim_lock(HIGH, &mtx_a);
+	TEST_EQ(sim_next(), LOW, "%d");
+
+	/* The inner mutex goes first: LOW still holds what HIGH waits on */
+	sim_unlock(&mtx_b);
+	TEST_EQ(sim_next(), LOW, "%d");
+
+	sim_unlock(&mtx_a);
+	TEST_EQ(sim_next(), HIGH, "%d");
+
+	sim_unlock(&mtx_a);
+	ready &= ~BIT(HIGH);
+	TEST_EQ(sim_next(), MID, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_boost_chain(void)
+{
+	sim_reset();
+	/* HIGH waits on A, held by MID2, which waits on B, held by LOW */
+	sim_lock(LOW, &mtx_b);
+	sim_lock(MID2, &mtx_a);
+	sim_lock(MID2, &mtx_b);
+	sim_lock(HIGH, &mtx_a);
+	TEST_EQ(sim_next(), LOW, "%d");
+
+	/* The boost moves on to MID2 with B */
+	sim_unlock(&mtx_b);
+	TEST_EQ(mtx_b.owner, MID2, "%d");
+	TEST_EQ(sim_next(), MID2, "%d");
+
+	/* and stays with MID2 until it unlocks A */
+	sim_unlock(&mtx_b);
+	TEST_EQ(sim_next(), MID2, "%d");
+	ready &= ~BIT(MID2);
+	TEST_EQ(sim_next(), MID, "%d");
+	ready |= BIT(MID2);
+
+	sim_unlock(&mtx_a);
+	TEST_EQ(sim_next(), HIGH, "%d");
+
+	/* Nobody is boosted any more */
+	sim_unlock(&mtx_a);
+	ready &= ~(BIT(HIGH) | BIT(MID2));
+	TEST_EQ(sim_next(), MID, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_owner_unknown(void)
+{
+	sim_reset();
+	ready &= ~BIT(MID2);
+	sim_lock(LOW, &mtx_a);
+	sim_lock(HIGH, &mtx_a);
+
+	/* Locked, but the owner is not written yet */
+	mtx_a.owner = TASK_ID_IDLE;
+	TEST_EQ(sim_next(), MID, "%d");
+
+	/* Unlocked, and HIGH not woken yet */
+	mtx_a.lock = 0;
+	TEST_EQ(sim_next(), MID, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_deadlock(void)
+{
+	sim_reset();
+	sim_lock(LOW, &mtx_a);
+	sim_lock(MID2, &mtx_b);
+	sim_lock(LOW, &mtx_b);
+	sim_lock(MID2, &mtx_a);
+	sim_lock(HIGH, &mtx_a);
+
+	/* The pick ends, and nobody stuck is run */
+	TEST_EQ(sim_next(), MID, "%d");
+	ready &= ~BIT(MID);
+	TEST_EQ(sim_next(), TASK_ID_IDLE, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_no_contention);
+	RUN_TEST(test_boost_one_mutex);
+	RUN_TEST(test_boost_nested_owner);
+	RUN_TEST(test_boost_chain);
+	RUN_TEST(test_owner_unknown);
+	RUN_TEST(test_deadlock);
+
+	test_print_result();
+}
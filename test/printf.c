@@ -297,6 +297,12 @@ test_static int test_vsnprintf_combined(void)
 	return EC_SUCCESS;
 }
 
+BENCHMARK(snprintf_combined, 100)
+{
+	snprintf(output, sizeof(output), "%d %s %08x %c %-6s|",
+		 -12345, "abc", 0xdeadbeef, 'z', "xy");
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -309,6 +315,7 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_vsnprintf_timestamps);
 	RUN_TEST(test_vsnprintf_hexdump);
 	RUN_TEST(test_vsnprintf_combined);
+	RUN_TEST(test_run_benchmarks);
 
 	test_print_result();
 }
@@ -8,6 +8,7 @@
 #include "common.h"
 #include "console.h"
 #include "queue.h"
+#include "queue_spsc.h"
 #include "test_util.h"
 #include "timer.h"
 #include "util.h"
@@ -16,6 +17,9 @@
 static struct queue const test_queue8 = QUEUE_NULL(8, char);
 static struct queue const test_queue2 = QUEUE_NULL(2, int16_t);
 
+QUEUE_SPSC(spsc8, 8, char);
+QUEUE_SPSC(spsc2, 2, int16_t);
+
 static int test_queue8_empty(void)
 {
 	char tmp = 1;
@@ -410,10 +414,125 @@ static int test_queue8_iterate_next_reset_on_change(void)
 	return EC_SUCCESS;
 }
 
+static int test_spsc8_fifo(void)
+{
+	char buf1[3] = {1, 2, 3};
+	char buf2[3];
+
+	TEST_ASSERT(spsc8_count() == 0);
+	TEST_ASSERT(spsc8_space() == 8);
+	TEST_ASSERT(spsc8_add(buf1, 3) == 3);
+	TEST_ASSERT(spsc8_count() == 3);
+
+	TEST_ASSERT(spsc8_remove(buf2, 1) == 1);
+	TEST_ASSERT(spsc8_remove(buf2 + 1, 5) == 2);
+	TEST_ASSERT_ARRAY_EQ(buf1, buf2, 3);
+	TEST_ASSERT(spsc8_remove(buf2, 1) == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_spsc8_wrapped(void)
+{
+	char buf1[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	char buf2[8];
+
+	TEST_ASSERT(spsc8_add(buf1, 5) == 5);
+	TEST_ASSERT(spsc8_remove(buf2, 5) == 5);
+
+	/* Fill it across the end of the buffer */
+	TEST_ASSERT(spsc8_add(buf1, 8) == 8);
+	TEST_ASSERT(spsc8_space() == 0);
+	TEST_ASSERT(spsc8_add(buf1, 1) == 0);
+
+	TEST_ASSERT(spsc8_remove(buf2, 8) == 8);
+	TEST_ASSERT_ARRAY_EQ(buf1, buf2, 8);
+	TEST_ASSERT(spsc8_count() == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_spsc2_units(void)
+{
+	int16_t buf1[3] = {-1, 0x1234, 7};
+	int16_t buf2[3];
+
+	TEST_ASSERT(spsc2_add(buf1, 3) == 2);
+	TEST_ASSERT(spsc2_remove(buf2, 1) == 1);
+	TEST_ASSERT(buf2[0] == -1);
+	TEST_ASSERT(spsc2_add(buf1 + 2, 1) == 1);
+	TEST_ASSERT(spsc2_remove(buf2, 3) == 2);
+	TEST_ASSERT(buf2[0] == 0x1234);
+	TEST_ASSERT(buf2[1] == 7);
+
+	return EC_SUCCESS;
+}
+
 void before_test(void)
 {
 	queue_init(&test_queue2);
 	queue_init(&test_queue8);
+	spsc8_init();
+	spsc2_init();
+}
+
+BENCHMARK(queue8_add_remove_unit, 1000)
+{
+	char tmp = 1;
+
+	queue_add_unit(&test_queue8, &tmp);
+	queue_remove_unit(&test_queue8, &tmp);
+}
+
+BENCHMARK(queue8_add_remove_units, 1000)
+{
+	char tmp[6] = {1, 2, 3, 4, 5, 6};
+
+	queue_add_units(&test_queue8, tmp, ARRAY_SIZE(tmp));
+	queue_remove_units(&test_queue8, tmp, ARRAY_SIZE(tmp));
+}
+
+BENCHMARK(spsc8_add_remove_unit, 1000)
+{
+	char tmp = 1;
+
+	spsc8_add(&tmp, 1);
+	spsc8_remove(&tmp, 1);
+}
+
+BENCHMARK(spsc8_add_remove_units, 1000)
+{
+	char tmp[6] = {1, 2, 3, 4, 5, 6};
+
+	spsc8_add(tmp, ARRAY_SIZE(tmp));
+	spsc8_remove(tmp, ARRAY_SIZE(tmp));
+}
+
+/* Units per second through each queue, from the median benchmark times */
+static int compare_throughput(const struct benchmark *generic,
+			      const struct benchmark *spsc, int units)
+{
+	struct benchmark_result g, s;
+
+	benchmark_run(generic, &g);
+	benchmark_run(spsc, &s);
+	TEST_ASSERT(g.median_ns && s.median_ns);
+
+	ccprintf("%d unit(s) per call: generic %d units/s, spsc %d units/s\n",
+		 units, (int)(units * 1000000000ULL / g.median_ns),
+		 (int)(units * 1000000000ULL / s.median_ns));
+	return EC_SUCCESS;
+}
+
+static int test_queue8_throughput(void)
+{
+	TEST_ASSERT(compare_throughput(&__benchmark_queue8_add_remove_unit,
+				       &__benchmark_spsc8_add_remove_unit,
+				       1) == EC_SUCCESS);
+	TEST_ASSERT(compare_throughput(&__benchmark_queue8_add_remove_units,
+				       &__benchmark_spsc8_add_remove_units,
+				       6) == EC_SUCCESS);
+	return EC_SUCCESS;
 }
 
 void run_test(int argc, char **argv)
@@ -437,6 +556,14 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_queue8_iterate_next);
 	RUN_TEST(test_queue2_iterate_next_full);
 	RUN_TEST(test_queue8_iterate_next_reset_on_change);
+	RUN_TEST(test_spsc8_fifo);
+	RUN_TEST(test_spsc8_wrapped);
+	RUN_TEST(test_spsc2_units);
+	RUN_TEST(test_queue8_throughput);
+
+	queue_init(&test_queue8);
+	spsc8_init();
+	RUN_TEST(test_run_benchmarks);
 
 	test_print_result();
 }
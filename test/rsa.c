@@ -13,12 +13,19 @@
 
 #ifdef TEST_RSA3
 #include "rsa2048-3.h"
+#elif defined(TEST_RSA3072)
+#include "rsa3072-F4.h"
 #else
 #include "rsa2048-F4.h"
 #endif
 
 static uint32_t rsa_workbuf[3 * RSANUMBYTES/4];
 
+BENCHMARK(rsa_verify, 1)
+{
+	rsa_verify(rsa_key, sig, hash, rsa_workbuf);
+}
+
 void run_test(int argc, char **argv)
 {
 	int good;
@@ -49,6 +56,11 @@ void run_test(int argc, char **argv)
 	}
 	ccprintf("RSA verify FAILED (as expected)\n");
 
+	if (test_run_benchmarks() != EC_SUCCESS) {
+		test_fail();
+		return;
+	}
+
 	test_pass();
 }
 
@@ -0,0 +1,142 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * RSA 3072 with F4 exponent public key and verification.
+ * Private key in rsa3072-F4.pem.
+ */
+
+/* First generate a key:
+ * # openssl genrsa -out key.pem 3072
+ * # openssl rsa -in key.pem -pubout > key.pub
+ * Then dump the key:
+ * # dumpRSAPublicKey -pub key.pub | xxd -i
+ */
+const uint8_t rsa_data[] = {
+	0x60, 0x00, 0x00, 0x00, 0xeb, 0x1e, 0xfb, 0xea, 0x3d, 0x66, 0x88, 0xd5,
+	0xe2, 0xee, 0x0d, 0x05, 0xac, 0xd9, 0x65, 0xda, 0x8e, 0x7f, 0xe4, 0x23,
+	0xa1, 0x7f, 0x07, 0xcd, 0xdd, 0x2d, 0xf1, 0x1f, 0x3b, 0x0d, 0xa4, 0xfa,
+	0xbe, 0x05, 0x49, 0x42, 0x0f, 0x7e, 0x99, 0x41, 0xdf, 0xfe, 0x9a, 0x5a,
+	0x43, 0x32, 0x5a, 0x8c, 0x83, 0x77, 0xc6, 0xf3, 0x72, 0xb7, 0x38, 0xef,
+	0xbb, 0x39, 0x89, 0x1d, 0x40, 0x91, 0xd5, 0x6c, 0x54, 0xf6, 0xeb, 0x62,
+	0x47, 0xd8, 0x23, 0x19, 0x55, 0xde, 0x60, 0x2b, 0x33, 0xa0, 0x84, 0xce,
+	0xcd, 0xf5, 0x55, 0x20, 0x02, 0x18, 0x93, 0x5c, 0x31, 0x90, 0xef, 0x18,
+	0x20, 0x30, 0xdf, 0x52, 0x64, 0x3b, 0xdd, 0xbd, 0x77, 0x64, 0xcc, 0xf7,
+	0x98, 0x8e, 0x37, 0x23, 0xd9, 0x8f, 0x31, 0x1b, 0x57, 0xe7, 0x0b, 0x22,
+	0xd6, 0x9a, 0x53, 0xc0, 0x19, 0xd6, 0x33, 0xe7, 0x26, 0x3a, 0x4d, 0xdc,
+	0x07, 0xdd, 0x0c, 0x16, 0x1e, 0x1c, 0xec, 0x3b, 0x33, 0xd5, 0x4a, 0x7a,
+	0x86, 0x1e, 0x4f, 0x03, 0x57, 0x7f, 0x5b, 0x32, 0x5f, 0xd8, 0x52, 0xa8,
+	0x5d, 0x0a, 0x13, 0x61, 0x84, 0x8b, 0x47, 0xf6, 0x40, 0x97, 0xf9, 0xd9,
+	0x14, 0x7f, 0x6a, 0x37, 0x73, 0xbb, 0x40, 0x66, 0x8b, 0xdc, 0xae, 0xb6,
+	0xec, 0xe9, 0xb4, 0x4d, 0x85, 0xda, 0xf6, 0x77, 0x3f, 0xd4, 0xca, 0x64,
+	0x12, 0x48, 0xab, 0x13, 0x6a, 0x72, 0x28, 0x9c, 0x28, 0x6b, 0x36, 0x8d,
+	0x39, 0x85, 0x1b, 0xed, 0x53, 0x90, 0xc4, 0xc7, 0xff, 0xd2, 0x03, 0xf0,
+	0x32, 0xc0, 0xf1, 0xfe, 0xa7, 0x08, 0xd4, 0x79, 0x52, 0xd3, 0x2a, 0xab,
+	0xe6, 0x79, 0xdb, 0x14, 0x10, 0xa9, 0x3c, 0xd4, 0xc8, 0x0d, 0x82, 0x33,
+	0x2e, 0x9c, 0x2a, 0x42, 0x58, 0x71, 0x82, 0x81, 0x25, 0xfb, 0xa9, 0x37,
+	0xb7, 0x97, 0xf1, 0xdb, 0xa5, 0xfd, 0xd6, 0xb6, 0x81, 0xb2, 0xcb, 0x8d,
+	0x98, 0xc2, 0x7e, 0xd9, 0x4f, 0x23, 0x9f, 0xd9, 0x04, 0xe6, 0x6c, 0x88,
+	0x31, 0x8c, 0x90, 0xf3, 0x2f, 0xb0, 0x1b, 0x33, 0x76, 0xe6, 0x24, 0xbf,
+	0x8a, 0x3b, 0x48, 0x1c, 0x72, 0x94, 0xfe, 0xbe, 0x55, 0xcb, 0x06, 0x0b,
+	0x3b, 0x0e, 0x2b, 0x9f, 0xee, 0xaf, 0xc9, 0x38, 0xa3, 0x94, 0xc3, 0xae,
+	0x11, 0x9f, 0x3f, 0x4d, 0x95, 0x84, 0x61, 0xd3, 0x57, 0x35, 0xd6, 0x34,
+	0x55, 0x77, 0xa0, 0xc7, 0x96, 0xd3, 0xb2, 0xb4, 0x0d, 0xe8, 0x40, 0x69,
+	0x4f, 0x1d, 0xfc, 0xcc, 0x32, 0xf1, 0x02, 0x3b, 0x51, 0x3a, 0xc0, 0xd8,
+	0x8e, 0x60, 0xc4, 0x88, 0xce, 0xe3, 0x33, 0x0e, 0x0a, 0xd8, 0x7e, 0xc1,
+	0x9b, 0xc7, 0xfd, 0x8c, 0xba, 0xdf, 0xb2, 0x53, 0x33, 0xdd, 0x48, 0x04,
+	0xfb, 0x17, 0xb4, 0xfc, 0x82, 0x2a, 0xd3, 0xa5, 0x15, 0xb8, 0x69, 0x90,
+	0x3e, 0x9f, 0x43, 0x38, 0x12, 0xa8, 0x70, 0xc2, 0x15, 0x98, 0x9f, 0xf3,
+	0x8d, 0xc0, 0xea, 0x21, 0x60, 0x2b, 0x01, 0x1d, 0x49, 0xc7, 0x29, 0x58,
+	0x1e, 0xab, 0x6d, 0x99, 0x41, 0x95, 0xba, 0x9b, 0x90, 0xf8, 0xf0, 0x87,
+	0x48, 0xce, 0x05, 0x28, 0x77, 0xac, 0x99, 0x2a, 0xa8, 0xc1, 0xea, 0x81,
+	0xfa, 0xe9, 0x88, 0xc8, 0x77, 0xc7, 0x6a, 0x68, 0x2d, 0x48, 0xbf, 0x6c,
+	0x5d, 0x57, 0x01, 0xfe, 0x2a, 0x40, 0x42, 0x39, 0x4d, 0x95, 0x73, 0xcc,
+	0xac, 0xda, 0x22, 0x18, 0xbf, 0x31, 0x27, 0x84, 0x81, 0xc4, 0xaa, 0x81,
+	0x68, 0xc9, 0x79, 0x08, 0xbb, 0x6a, 0x15, 0xe5, 0xbd, 0xc7, 0x45, 0xe6,
+	0xe3, 0xe1, 0xa9, 0xd4, 0x90, 0x3b, 0x3c, 0x07, 0x5e, 0xec, 0xdc, 0xcf,
+	0x83, 0x37, 0x9f, 0x48, 0x46, 0x0d, 0x58, 0xf4, 0x4e, 0xa2, 0x8f, 0x59,
+	0x1d, 0xdd, 0x56, 0x37, 0xa6, 0xae, 0x49, 0xd0, 0x72, 0x73, 0x97, 0xd2,
+	0x21, 0xa4, 0xf5, 0x8d, 0xa2, 0x1c, 0x70, 0x8e, 0x2d, 0x4f, 0x86, 0xa0,
+	0x7d, 0x54, 0x4e, 0x2c, 0x62, 0xff, 0xa5, 0x43, 0x11, 0x9a, 0x1d, 0x39,
+	0x1f, 0x39, 0xdc, 0xcb, 0x89, 0x64, 0x9c, 0x3b, 0x8a, 0x56, 0xa6, 0xc7,
+	0xda, 0x3c, 0x7a, 0x87, 0x8c, 0x96, 0xbd, 0x34, 0x72, 0x6f, 0x05, 0x21,
+	0x9d, 0x33, 0x6d, 0x4f, 0x67, 0x98, 0xfd, 0xbf, 0x6c, 0x81, 0xf6, 0x12,
+	0x37, 0x77, 0xe2, 0x23, 0x19, 0xa3, 0xda, 0xcc, 0xc1, 0x60, 0x69, 0xb4,
+	0x5f, 0xc1, 0x00, 0xa3, 0x77, 0x55, 0x01, 0xb3, 0xab, 0xe0, 0x83, 0x88,
+	0xb2, 0x81, 0x76, 0x40, 0x00, 0x83, 0xf4, 0x14, 0x8b, 0xdd, 0x69, 0xde,
+	0x13, 0x22, 0xbd, 0x25, 0x89, 0xd5, 0xf6, 0x73, 0xc2, 0x83, 0x4b, 0xd1,
+	0xff, 0xa6, 0x6e, 0x0d, 0x23, 0x2c, 0x9a, 0x76, 0xdb, 0x41, 0xa4, 0x94,
+	0xb4, 0xf4, 0x4a, 0xad, 0xd1, 0xa4, 0x4d, 0x54, 0xbf, 0xa4, 0xfb, 0x85,
+	0xe2, 0x7c, 0x45, 0xd2, 0x82, 0x04, 0x5a, 0xc1, 0x4c, 0xc6, 0x43, 0x8c,
+	0x74, 0x9f, 0x87, 0x12, 0x28, 0x23, 0x04, 0xf8, 0xe1, 0x0a, 0x91, 0xbb,
+	0xe4, 0x60, 0x4e, 0x35, 0x7c, 0x9b, 0xae, 0xc8, 0x37, 0x23, 0xa1, 0x28,
+	0x08, 0xc6, 0xd6, 0xfa, 0xb2, 0xb9, 0x79, 0x91, 0x7f, 0x53, 0xd9, 0x31,
+	0x11, 0xfa, 0x23, 0x40, 0x69, 0xf6, 0xf4, 0xff, 0x3c, 0xc6, 0xa9, 0xa8,
+	0x61, 0x9a, 0xb1, 0xde, 0x99, 0xae, 0xc1, 0x30, 0x9c, 0x3f, 0x54, 0x74,
+	0xa7, 0xb0, 0x8e, 0xe6, 0x4c, 0xe4, 0x04, 0xfc, 0x4d, 0x47, 0x08, 0x6b,
+	0x60, 0x62, 0x6f, 0x60, 0x39, 0x0e, 0xd4, 0xb2, 0x6f, 0x05, 0xe1, 0x98,
+	0xfb, 0x1d, 0x31, 0x97, 0x23, 0xa5, 0x2a, 0x7b, 0xb8, 0xd2, 0xde, 0xad,
+	0x12, 0x4e, 0x0b, 0xc2, 0x7e, 0x19, 0x46, 0x9f, 0xc1, 0x47, 0x8f, 0x4d,
+	0xbd, 0x23, 0x56, 0x0d, 0xc0, 0xbd, 0x19, 0x0b,
+};
+
+const struct rsa_public_key *rsa_key = (struct rsa_public_key *)rsa_data;
+BUILD_ASSERT(sizeof(*rsa_key) == sizeof(rsa_data));
+
+/* SHA-256 sum to verify:
+ * # sha256sum README | sed -e 's/\(..\)/0x\1, /mg'
+ */
+const uint8_t hash[] = {
+	0x6c, 0x5f, 0xef, 0x7f, 0x63, 0x1d, 0xb4, 0x35, 0x6c, 0xae, 0x8b, 0x2a,
+	0x4e, 0xde, 0xc5, 0xeb, 0x11, 0xba, 0x1f, 0x44, 0x40, 0xb6, 0x3a, 0x52,
+	0xf2, 0x70, 0xef, 0xee, 0x44, 0x4b, 0x57, 0x62
+};
+
+/* Incorrect hash to test the negative case */
+const uint8_t hash_wrong[] = {
+	0x61, 0x1b, 0xd2, 0x44, 0xc7, 0x18, 0xa7, 0x2d, 0x0f, 0x2d, 0x3d, 0x0f,
+	0xe3, 0xb3, 0xc5, 0xe4, 0x12, 0xc2, 0x7b, 0x1e, 0x05, 0x2c, 0x6f, 0xad,
+	0xc4, 0xac, 0x71, 0x55, 0xe8, 0x80, 0x5c, 0x38
+};
+
+/* Generate signature using futility:
+ * # futility create key.pem
+ * # futility sign --type rwsig --prikey key.vbprik2 README README.out
+ * # dd skip=56 bs=1 if=README.out | xxd -i
+ */
+const uint8_t sig[] = {
+	0x0c, 0x76, 0x5b, 0xdc, 0x2b, 0x26, 0x2e, 0x17, 0x96, 0x0f, 0x06, 0x63,
+	0x27, 0x23, 0xa4, 0x76, 0x88, 0xb7, 0x57, 0x76, 0x9c, 0x5a, 0x24, 0x27,
+	0x41, 0x01, 0x47, 0x13, 0x09, 0x18, 0x53, 0x66, 0x14, 0xbd, 0xdb, 0xb0,
+	0x02, 0xd5, 0x00, 0xd0, 0x0e, 0xc1, 0x11, 0xeb, 0x82, 0xf5, 0xce, 0x21,
+	0x26, 0x3d, 0xd1, 0x72, 0xb6, 0x25, 0x04, 0x4d, 0x25, 0x36, 0x91, 0x98,
+	0xba, 0x47, 0x87, 0x34, 0x65, 0x18, 0x15, 0x2c, 0xa8, 0xc6, 0x0a, 0x7b,
+	0x00, 0x00, 0x3b, 0x38, 0xbe, 0x32, 0x06, 0xf2, 0xc8, 0x18, 0xec, 0x7e,
+	0x7c, 0xb8, 0x3b, 0x3b, 0x89, 0x63, 0x9c, 0x21, 0x70, 0x02, 0x6b, 0x3f,
+	0x92, 0xff, 0xe8, 0x23, 0x9c, 0x35, 0x16, 0x4d, 0x45, 0x69, 0xb1, 0x5c,
+	0x51, 0x44, 0xae, 0xf6, 0x66, 0xea, 0x22, 0xa7, 0x97, 0x9f, 0xfb, 0x6c,
+	0xa3, 0x10, 0x06, 0x08, 0xd3, 0x0f, 0x0a, 0x8a, 0xda, 0xef, 0x3c, 0xa1,
+	0xbd, 0x9b, 0x41, 0x47, 0x7b, 0xa5, 0x14, 0x47, 0x78, 0x88, 0x4b, 0x14,
+	0xef, 0x10, 0x8b, 0x00, 0xda, 0x23, 0x9f, 0x58, 0x3e, 0xf0, 0x39, 0x95,
+	0x90, 0x06, 0xa8, 0x7a, 0x1b, 0x82, 0x89, 0x5f, 0x1f, 0x1e, 0x40, 0x06,
+	0x5c, 0xc9, 0xa1, 0x3f, 0x6b, 0xdc, 0x9a, 0x6b, 0x51, 0x1f, 0x6b, 0xfb,
+	0xa7, 0xfc, 0x56, 0xdf, 0x66, 0x1a, 0x00, 0x8f, 0xe2, 0x8a, 0x74, 0x36,
+	0xf6, 0x8c, 0x59, 0xf9, 0x1f, 0x92, 0x7d, 0x6c, 0x70, 0x89, 0x0e, 0x75,
+	0xf1, 0x6e, 0xf9, 0x40, 0x82, 0x03, 0x02, 0xfc, 0x4a, 0xd3, 0x46, 0xf7,
+	0xfc, 0xe7, 0xfe, 0x84, 0x17, 0xa0, 0x02, 0x0a, 0x07, 0x9e, 0x50, 0x76,
+	0xc8, 0x44, 0xa5, 0x95, 0xe4, 0xe1, 0x24, 0x20, 0x52, 0xfe, 0xa8, 0xb4,
+	0xe5, 0xcc, 0x62, 0x6f, 0xc2, 0x36, 0x7c, 0x20, 0x73, 0xff, 0x5c, 0x30,
+	0x4a, 0x9a, 0x02, 0xa6, 0xf2, 0x06, 0x02, 0x18, 0xef, 0xa8, 0xf2, 0xa6,
+	0x80, 0xb9, 0x73, 0xe8, 0x72, 0x0a, 0xa4, 0xa0, 0xc1, 0xbd, 0x25, 0xc9,
+	0x34, 0xef, 0x11, 0xa4, 0xb4, 0x77, 0x28, 0x7d, 0x6c, 0x73, 0x3e, 0xe2,
+	0xb3, 0x1c, 0xaf, 0x09, 0xb0, 0x0c, 0x54, 0x7d, 0x76, 0x7e, 0x65, 0x77,
+	0x2d, 0x2e, 0xc9, 0x8d, 0x36, 0x2b, 0x77, 0x80, 0xfe, 0x35, 0x6b, 0x6a,
+	0xb3, 0xe5, 0x3e, 0x0e, 0xff, 0xbb, 0x1e, 0x56, 0x2a, 0xf3, 0x66, 0x39,
+	0x5a, 0x41, 0xf9, 0xe0, 0x9a, 0x8f, 0xb7, 0x26, 0xd4, 0x09, 0x19, 0x24,
+	0x0c, 0xe0, 0xf3, 0x5a, 0x1c, 0x5f, 0x7d, 0x33, 0x15, 0x9b, 0x17, 0x97,
+	0x8e, 0x7c, 0xd1, 0xd3, 0x4e, 0x8a, 0x7d, 0x77, 0xc5, 0xca, 0x75, 0x6e,
+	0x85, 0xed, 0xf0, 0x2e, 0x40, 0xd9, 0xf0, 0x84, 0x45, 0x22, 0xdb, 0x22,
+	0x99, 0x3c, 0x85, 0x6f, 0xe6, 0xae, 0x53, 0xdd, 0x6c, 0x3d, 0x8a, 0x32,
+	/* Padding */
+	0x00
+};
@@ -172,6 +172,15 @@ static int test_hmac(const uint8_t *key, int key_len,
 	return 1;
 }
 
+BENCHMARK(sha256_2888_bits, 10)
+{
+	struct sha256_ctx ctx;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, sha256_2888_input, sizeof(sha256_2888_input));
+	SHA256_final(&ctx);
+}
+
 void run_test(int argc, char **argv)
 {
 	ccprintf("Testing short message (8 bytes)\n");
@@ -216,5 +225,10 @@ void run_test(int argc, char **argv)
 	 * 64 bytes keys.
 	 */
 
+	if (test_run_benchmarks() != EC_SUCCESS) {
+		test_fail();
+		return;
+	}
+
 	test_pass();
 }
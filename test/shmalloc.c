@@ -207,6 +207,14 @@ static int shmem_is_ok(int line)
  */
 static uint32_t test_map;
 
+BENCHMARK(shared_mem_acquire_release, 100)
+{
+	char *shptr;
+
+	if (shared_mem_acquire(256, &shptr) == EC_SUCCESS)
+		shared_mem_release(shptr);
+}
+
 void run_test(int argc, char **argv)
 {
 	int index;
@@ -235,6 +243,10 @@ void run_test(int argc, char **argv)
 				return;
 			}
 			ccprintf("Done testing, counter at %d\n", counter);
+			if (test_run_benchmarks() != EC_SUCCESS) {
+				test_fail();
+				return;
+			}
 			test_pass();
 			return;
 		}
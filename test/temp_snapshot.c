@@ -0,0 +1,123 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the temperature sensor snapshot.
+ */
+
+#include "common.h"
+#include "temp_sensor.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+static int sensor_reads;
+static int sensor_delay_us;
+static int sensor_not_powered = -1;
+
+int mock_temp_get_val(int idx, int *temp_ptr)
+{
+	sensor_reads++;
+	if (sensor_delay_us)
+		udelay(sensor_delay_us);
+	if (idx == sensor_not_powered)
+		return EC_ERROR_NOT_POWERED;
+	*temp_ptr = 300 + idx;
+	return EC_SUCCESS;
+}
+
+test_static int test_shared_pass(void)
+{
+	struct temp_sensor_snapshot snap, again;
+	int reads, i;
+
+	reads = sensor_reads;
+	temp_sensor_get_snapshot(&snap, 0);
+	TEST_EQ(sensor_reads - reads, TEMP_SENSOR_COUNT, "%d");
+	for (i = 0; i < TEMP_SENSOR_COUNT; i++) {
+		TEST_EQ(snap.rv[i], EC_SUCCESS, "%d");
+		TEST_EQ(snap.temp[i], 300 + i, "%d");
+	}
+
+	/* A reader happy with a recent pass does not touch the sensors */
+	reads = sensor_reads;
+	temp_sensor_get_snapshot(&again, SECOND);
+	TEST_EQ(sensor_reads, reads, "%d");
+	TEST_ASSERT(again.time.val == snap.time.val);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_max_age(void)
+{
+	struct temp_sensor_snapshot snap, fresh, shared;
+
+	temp_sensor_get_snapshot(&snap, 0);
+	usleep(20 * MSEC);
+
+	/* Too old for this reader, read again */
+	temp_sensor_get_snapshot(&fresh, 10 * MSEC);
+	TEST_ASSERT(fresh.time.val >= snap.time.val + 20 * MSEC);
+
+	/* But recent enough for the next one */
+	temp_sensor_get_snapshot(&shared, SECOND);
+	TEST_ASSERT(shared.time.val == fresh.time.val);
+
+	return EC_SUCCESS;
+}
+
+test_static int test_errors(void)
+{
+	struct temp_sensor_snapshot snap;
+
+	sensor_not_powered = 1;
+	temp_sensor_get_snapshot(&snap, 0);
+	sensor_not_powered = -1;
+
+	TEST_EQ(snap.rv[0], EC_SUCCESS, "%d");
+	TEST_EQ(snap.rv[1], EC_ERROR_NOT_POWERED, "%d");
+	TEST_EQ(snap.rv[2], EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_stats(void)
+{
+	struct temp_sensor_snapshot_stats stats;
+	struct temp_sensor_snapshot snap;
+
+	temp_sensor_get_snapshot_stats(&stats, 1);
+
+	sensor_delay_us = MSEC;
+	temp_sensor_get_snapshot(&snap, 0);
+	sensor_delay_us = 0;
+	usleep(5 * MSEC);
+	temp_sensor_get_snapshot(&snap, SECOND);
+
+	temp_sensor_get_snapshot_stats(&stats, 0);
+	TEST_GE(stats.pass_us_last, TEMP_SENSOR_COUNT * MSEC, "%d");
+	TEST_GE(stats.pass_us_max, stats.pass_us_last, "%d");
+	TEST_GE(stats.reuses, 1, "%d");
+	TEST_GE(stats.age_us_max, 5 * MSEC, "%d");
+
+	/* Clearing keeps the snapshot usable */
+	temp_sensor_get_snapshot_stats(&stats, 1);
+	temp_sensor_get_snapshot_stats(&stats, 0);
+	TEST_EQ(stats.reuses, 0, "%d");
+	TEST_EQ(stats.pass_us_max, 0, "%d");
+	TEST_NE(stats.passes, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_shared_pass);
+	RUN_TEST(test_max_age);
+	RUN_TEST(test_errors);
+	RUN_TEST(test_stats);
+
+	test_print_result();
+}
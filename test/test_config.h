@@ -40,6 +40,11 @@
 #define CONFIG_BACKLIGHT_REQ_GPIO GPIO_PCH_BKLTEN
 #endif
 
+#ifdef TEST_FLASH
+#define CONFIG_FLASH_SECTOR_HASH
+#define CONFIG_FLASH_WRITE_STREAM
+#endif
+
 #ifdef TEST_FLASH_LOG
 #define CONFIG_CRC8
 #define CONFIG_FLASH_ERASED_VALUE32 (-1U)
@@ -49,8 +54,25 @@
 #define CONFIG_MALLOC
 #endif
 
+#ifdef TEST_DISCRETE_EVENT
+#define CONFIG_TEST_DISCRETE_EVENT
+#endif
+
 #ifdef TEST_KB_8042
 #define CONFIG_KEYBOARD_PROTOCOL_8042
+#define CONFIG_8042_OBE_REFILL
+#undef CONFIG_8042_TO_HOST_SIZE
+#define CONFIG_8042_TO_HOST_SIZE 64
+#endif
+
+#ifdef TEST_KB_HX30
+#define CONFIG_KEYBOARD_PROTOCOL_8042
+#define CONFIG_8042_OBE_REFILL
+#define CONFIG_KEYBOARD_BACKLIGHT
+#define CONFIG_KEYBOARD_CUSTOMIZATION
+#define CONFIG_KEYBOARD_CUSTOMIZATION_COMBINATION_KEY
+#define CONFIG_KEYBOARD_SCANCODE_CALLBACK
+#define CONFIG_KEYBOARD_SCANCODE_LOOKUP
 #endif
 
 #ifdef TEST_KB_MKBP
@@ -105,6 +127,10 @@
 #define CONFIG_ACCEL_FIFO_THRES 10
 #endif
 
+#ifdef TEST_MUTEX_PI
+#define CONFIG_MUTEX_PRIORITY_INHERITANCE
+#endif
+
 #ifdef TEST_KASA
 #define CONFIG_FPU
 #define CONFIG_ONLINE_CALIB
@@ -239,6 +265,15 @@ enum sensor_id {
 #define CONFIG_RWSIG_TYPE_RWSIG
 #endif
 
+#ifdef TEST_RSA3072
+#define CONFIG_RSA
+#undef CONFIG_RSA_KEY_SIZE
+#define CONFIG_RSA_KEY_SIZE 3072
+#undef CONFIG_RSA_EXPONENT_3
+#define CONFIG_RSA_OPTIMIZED
+#define CONFIG_RWSIG_TYPE_RWSIG
+#endif
+
 #ifdef TEST_SHA256
 #define CONFIG_SHA256
 #endif
@@ -269,6 +304,11 @@ int board_discharge_on_ac(int enabled);
 #define I2C_PORT_CHARGER 0
 #endif
 
+#ifdef TEST_TEMP_SNAPSHOT
+#define CONFIG_TEMP_SENSOR
+#define CONFIG_TEMP_SENSOR_SNAPSHOT
+#endif
+
 #ifdef TEST_THERMAL
 #define CONFIG_CHIPSET_CAN_THROTTLE
 #define CONFIG_FANS 1
@@ -286,6 +326,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_FANS 1
 #endif
 
+#ifdef TEST_FAN_PID
+#define CONFIG_FAN_PID
+#endif
+
 #ifdef TEST_BUTTON
 #define CONFIG_KEYBOARD_PROTOCOL_8042
 #undef CONFIG_KEYBOARD_VIVALDI
@@ -553,6 +597,19 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_PD_PORT_MAX_COUNT 2
 #endif
 
+#ifdef TEST_EVENT_STORE
+#define CONFIG_EVENT_STORE
+#undef CONFIG_EVENT_STORE_SIZE
+#define CONFIG_EVENT_STORE_SIZE 256
+#endif
+
+#ifdef TEST_MEMMAP_TELEMETRY
+#define CONFIG_MEMMAP_TELEMETRY
+#define CONFIG_MEMMAP_TELEMETRY_EVENT
+#define CONFIG_MKBP_EVENT
+#define CONFIG_MKBP_USE_GPIO
+#endif
+
 #ifdef TEST_RTC
 #define CONFIG_HOSTCMD_RTC
 #endif
@@ -581,6 +638,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_CURVE25519
 #endif /* TEST_X25519 */
 
+#ifdef TEST_I2C_ASYNC
+#define CONFIG_I2C_ASYNC
+#endif
+
 #ifdef TEST_I2C_BITBANG
 #define CONFIG_I2C
 #define CONFIG_I2C_MASTER
@@ -588,5 +649,13 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define I2C_BITBANG_PORT_COUNT 1
 #endif
 
+#ifdef TEST_I2C_CACHE
+#define CONFIG_I2C
+#define CONFIG_I2C_MASTER
+#define CONFIG_I2C_CACHE
+#undef CONFIG_I2C_CACHE_MAX_SIZE
+#define CONFIG_I2C_CACHE_MAX_SIZE 8
+#endif
+
 #endif  /* TEST_BUILD */
 #endif  /* __TEST_TEST_CONFIG_H */
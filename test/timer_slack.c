@@ -0,0 +1,251 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for deferred call slack: a mix of periodic routines should wake the
+ * hook task less often, without any of them running early or too late.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "hooks.h"
+#include "test_util.h"
+#include "timer.h"
+#include "timer_private.h"
+#include "util.h"
+
+#define RUN_TIME	(1 * SECOND)
+/* Runs closer than this share a wakeup of the hook task */
+#define SAME_WAKE_US	300
+/* How late the host may schedule the hook task */
+#define JITTER_US	(3 * MSEC)
+
+struct periodic {
+	const struct deferred_data *data;
+	int period_us;
+	int slack_us;
+	uint64_t armed;
+	int late_us;		/* Past the end of the slack, worst case */
+	int early;		/* Ran before the period */
+};
+
+static int use_slack;
+static int running;
+
+static uint64_t run_log[512];
+static int run_count;
+
+static void periodic_run(struct periodic *p)
+{
+	uint64_t now = get_time().val;
+
+	if (now < p->armed + p->period_us)
+		p->early++;
+	p->late_us = MAX(p->late_us, (int)(now - p->armed - p->period_us -
+					   (use_slack ? p->slack_us : 0)));
+	if (run_count < ARRAY_SIZE(run_log))
+		run_log[run_count++] = now;
+
+	if (!running)
+		return;
+	p->armed = now;
+	hook_call_deferred_slack(p->data, p->period_us,
+				 use_slack ? p->slack_us : 0);
+}
+
+static void fast(void);
+static void medium(void);
+static void slow(void);
+DECLARE_DEFERRED(fast);
+DECLARE_DEFERRED(medium);
+DECLARE_DEFERRED(slow);
+
+static struct periodic periodics[] = {
+	{ &fast_data, 10 * MSEC, 4 * MSEC },
+	{ &medium_data, 25 * MSEC, 10 * MSEC },
+	{ &slow_data, 60 * MSEC, 20 * MSEC },
+};
+
+static void fast(void)
+{
+	periodic_run(&periodics[0]);
+}
+
+static void medium(void)
+{
+	periodic_run(&periodics[1]);
+}
+
+static void slow(void)
+{
+	periodic_run(&periodics[2]);
+}
+
+/* Let the routines run for a while, return how many wakeups they took */
+static int run_mix(int slack)
+{
+	int wakes = 0;
+	int i;
+
+	use_slack = slack;
+	run_count = 0;
+	running = 1;
+	for (i = 0; i < ARRAY_SIZE(periodics); i++) {
+		struct periodic *p = &periodics[i];
+
+		p->late_us = 0;
+		p->early = 0;
+		p->armed = get_time().val;
+		hook_call_deferred_slack(p->data, p->period_us,
+					 slack ? p->slack_us : 0);
+	}
+
+	usleep(RUN_TIME);
+	running = 0;
+	/* Let the last round finish */
+	usleep(100 * MSEC);
+
+	for (i = 0; i < run_count; i++)
+		if (!i || run_log[i] - run_log[i - 1] > SAME_WAKE_US)
+			wakes++;
+	return wakes;
+}
+
+static int check_windows(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(periodics); i++) {
+		TEST_EQ(periodics[i].early, 0, "%d");
+		TEST_LE(periodics[i].late_us, JITTER_US, "%d");
+	}
+
+	return EC_SUCCESS;
+}
+
+test_static int test_single_window(void)
+{
+	struct periodic *p = &periodics[2];
+	uint32_t coalesced = hook_deferred_coalesced();
+
+	/* Alone, a routine runs at the end of its slack */
+	use_slack = 1;
+	running = 0;
+	run_count = 0;
+	p->late_us = 0;
+	p->early = 0;
+	p->armed = get_time().val;
+	hook_call_deferred_slack(p->data, p->period_us, p->slack_us);
+	usleep(p->period_us + p->slack_us + 20 * MSEC);
+
+	TEST_EQ(run_count, 1, "%d");
+	TEST_GE((int)(run_log[0] - p->armed), p->period_us + p->slack_us,
+		"%d");
+	TEST_LE(p->late_us, JITTER_US, "%d");
+	TEST_EQ(p->early, 0, "%d");
+	TEST_EQ(hook_deferred_coalesced(), coalesced, "%d");
+
+	/* Cancelling still works */
+	p->armed = get_time().val;
+	hook_call_deferred_slack(p->data, 5 * MSEC, 5 * MSEC);
+	hook_call_deferred(p->data, -1);
+	usleep(20 * MSEC);
+	TEST_EQ(run_count, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_task_mix(void)
+{
+	uint32_t coalesced;
+	int wakes, wakes_slack;
+	int calls, calls_slack;
+
+	coalesced = hook_deferred_coalesced();
+	wakes = run_mix(0);
+	calls = run_count;
+	TEST_EQ(check_windows(), EC_SUCCESS, "%d");
+	TEST_EQ(hook_deferred_coalesced(), coalesced, "%d");
+
+	coalesced = hook_deferred_coalesced();
+	wakes_slack = run_mix(1);
+	calls_slack = run_count;
+	TEST_EQ(check_windows(), EC_SUCCESS, "%d");
+	coalesced = hook_deferred_coalesced() - coalesced;
+
+	ccprintf("No slack: %d calls in %d wakeups, %d us apart\n",
+		 calls, wakes, RUN_TIME / wakes);
+	ccprintf("Slack:    %d calls in %d wakeups, %d us apart, %d saved\n",
+		 calls_slack, wakes_slack, RUN_TIME / wakes_slack, coalesced);
+
+	/* Sleeps between wakeups are longer on average */
+	TEST_GT(coalesced, 0, "%d");
+	TEST_GE(wakes * 10, wakes_slack * 13, "%d");
+	/* The routines themselves do not run much less often */
+	TEST_GE(calls_slack * 10, calls * 7, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_timer_scan(void)
+{
+	/* The host has no hardware timer, so run the scan on its own */
+	timestamp_t deadline[3] = { { 1000 }, { 1200 }, { 0 } };
+	uint32_t slack[3] = { 500, 0, 0 };
+	uint32_t coalesced = 0;
+	timestamp_t now, next;
+
+	/* Nothing due, wake for the second one before the first's slack */
+	now.val = 900;
+	next.val = -1ull;
+	TEST_EQ(timer_scan(BIT(0) | BIT(1), deadline, slack, now, &next,
+			   &coalesced), 0, "%d");
+	TEST_EQ((int)next.val, 1200, "%d");
+
+	/* The first is taken along with the second */
+	now.val = 1200;
+	next.val = -1ull;
+	TEST_EQ(timer_scan(BIT(0) | BIT(1), deadline, slack, now, &next,
+			   &coalesced), BIT(0) | BIT(1), "%d");
+	TEST_EQ(coalesced, 1, "%d");
+	TEST_ASSERT(next.val == -1ull);
+
+	/* Alone, it only needs a wakeup at the end of its slack */
+	now.val = 1100;
+	next.val = -1ull;
+	TEST_EQ(timer_scan(BIT(0), deadline, slack, now, &next, &coalesced),
+		BIT(0), "%d");
+	TEST_EQ(coalesced, 2, "%d");
+	now.val = 900;
+	TEST_EQ(timer_scan(BIT(0), deadline, slack, now, &next, &coalesced),
+		0, "%d");
+	TEST_EQ((int)next.val, 1500, "%d");
+
+	/* Expiring at or past the end of the slack is not coalescing */
+	now.val = 1500;
+	TEST_EQ(timer_scan(BIT(0), deadline, slack, now, &next, &coalesced),
+		BIT(0), "%d");
+	TEST_EQ(coalesced, 2, "%d");
+
+	/* A slack reaching into the next epoch waits for the overflow */
+	deadline[2].val = 0xffffff00;
+	slack[2] = 0x200;
+	now.val = 0xfffff000;
+	next.val = -1ull;
+	TEST_EQ(timer_scan(BIT(2), deadline, slack, now, &next, &coalesced),
+		0, "%d");
+	TEST_ASSERT(next.val == -1ull);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_single_window);
+	RUN_TEST(test_task_mix);
+	RUN_TEST(test_timer_scan);
+
+	test_print_result();
+}
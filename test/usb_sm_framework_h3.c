@@ -985,6 +985,15 @@ int test_task(void *u)
 	return EC_SUCCESS;
 }
 
+/* Transition across the whole hierarchy and back */
+BENCHMARK(usb_sm_transition, 100)
+{
+	sm[PORT0].idx = 0;
+	set_state_sm(PORT0, SM_TEST_C);
+	sm[PORT0].idx = 0;
+	set_state_sm(PORT0, SM_TEST_A4);
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
@@ -998,5 +1007,8 @@ void run_test(int argc, char **argv)
 #else
 	RUN_TEST(test_hierarchy_0);
 #endif
+
+	memset(&test_control, 0, sizeof(struct control));
+	RUN_TEST(test_run_benchmarks);
 	test_print_result();
 }
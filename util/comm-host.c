@@ -83,6 +83,29 @@ int ec_command(int command, int version,
 				indata, insize);
 }
 
+int ec_read_telemetry(struct ec_memmap_telemetry *t)
+{
+	uint16_t seq;
+	int tries;
+	int rv;
+
+	for (tries = 0; tries < 10; tries++) {
+		rv = ec_readmem(EC_MEMMAP_TELEMETRY, sizeof(*t), t);
+		if (rv < 0)
+			return rv;
+		if (t->seq & 1)
+			continue;
+		/* The block did not change while we were reading it */
+		rv = ec_readmem(EC_MEMMAP_TELEMETRY, sizeof(seq), &seq);
+		if (rv < 0)
+			return rv;
+		if (seq == t->seq)
+			return t->version ? 0 : -EC_RES_UNAVAILABLE;
+	}
+
+	return -EC_RES_BUSY;
+}
+
 int comm_init_alt(int interfaces, const char *device_name, int i2c_bus)
 {
 	bool dev_is_cros_ec;
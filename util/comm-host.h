@@ -90,6 +90,21 @@ extern int (*ec_command_proto)(int command, int version,
  */
 extern int (*ec_readmem)(int offset, int bytes, void *dest);
 
+/**
+ * Read a consistent snapshot of the telemetry block at EC_MEMMAP_TELEMETRY,
+ * retrying while the EC updates it. Returns 0 on success,
+ * -EC_RES_UNAVAILABLE if the EC does not publish the block, or negative on
+ * error.
+ */
+int ec_read_telemetry(struct ec_memmap_telemetry *t);
+
+/**
+ * Select 32-bit (enable = 1) or byte (enable = 0) accesses to the MEC EMI.
+ * Returns the previous setting, or -1 if the MEC transport is not in use.
+ * Only built on x86, so check that it is linked in before calling it.
+ */
+int comm_lpc_mec_long_access(int enable) __attribute__((weak));
+
 /**
  * Wait for a MKBP event matching 'mask' for at most 'timeout' milliseconds.
  * Then read the incoming event content in 'buffer' (or at most
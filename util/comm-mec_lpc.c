@@ -29,42 +29,55 @@ typedef enum _ec_xfer_direction { EC_MEC_WRITE, EC_MEC_READ } ec_xfer_direction;
 #define MEC_EC_ADDRESS_REGISTER0      0x0802
 #define MEC_EC_ADDRESS_REGISTER1      0x0803
 #define MEC_EC_DATA_REGISTER0         0x0804
-#define MEC_EC_DATA_REGISTER2         0x0806
 #define MEC_EC_MEMMAP_START            0x100
 
+/*
+ * 32-bit EMI accesses are used for whole words when set; cleared only to
+ * compare with byte accesses (see comm_lpc_mec_long_access()).
+ */
+static int mec_long_access = 1;
+
+/*
+ * The BIOS and ACPI use the same EMI address register, so it is written for
+ * every access rather than trusted to be where the last one left it.
+ */
+static void ec_mec_set_address(uint16_t address, int access)
+{
+	outw((address & 0xFFFC) | access, MEC_EC_ADDRESS_REGISTER0);
+}
+
 static int ec_mec_xfer(ec_xfer_direction direction, uint16_t address,
 		       char *data, uint16_t size)
 {
-	/*
-	 * There's a cleverer way to do this, but it's somewhat less clear what's happening.
-	 * I prefer clarity over cleverness. :)
-	 */
 	int pos = 0;
-	uint16_t temp[2];
+	uint32_t temp;
+	int i;
+
+	/* Unaligned start address: bytes up to the next word */
 	if (address % 4 > 0) {
-		outw((address & 0xFFFC) | MEC_EC_BYTE_ACCESS, MEC_EC_ADDRESS_REGISTER0);
-		/* Unaligned start address */
-		for (int i = address % 4; i < 4; ++i) {
-			char *storage = &data[pos++];
+		ec_mec_set_address(address, MEC_EC_BYTE_ACCESS);
+		for (i = address % 4; i < 4 && pos < size; ++i, ++pos) {
 			if (direction == EC_MEC_WRITE)
-				outb(*storage, MEC_EC_DATA_REGISTER0 + i);
-			else if (direction == EC_MEC_READ)
-				*storage = inb(MEC_EC_DATA_REGISTER0 + i);
+				outb(data[pos], MEC_EC_DATA_REGISTER0 + i);
+			else
+				data[pos] = inb(MEC_EC_DATA_REGISTER0 + i);
 		}
 		address = (address + 4) & 0xFFFC;
 	}
 
-	if (size - pos >= 4) {
-		outw((address & 0xFFFC) | MEC_EC_LONG_ACCESS_AUTOINCREMENT, MEC_EC_ADDRESS_REGISTER0);
+	/*
+	 * Whole words with one 32-bit I/O cycle each. Accessing the last
+	 * data register byte moves the EC address to the next word.
+	 */
+	if (mec_long_access && size - pos >= 4) {
+		ec_mec_set_address(address, MEC_EC_LONG_ACCESS_AUTOINCREMENT);
 		while (size - pos >= 4) {
 			if (direction == EC_MEC_WRITE) {
-				memcpy(temp, &data[pos], sizeof(temp));
-				outw(temp[0], MEC_EC_DATA_REGISTER0);
-				outw(temp[1], MEC_EC_DATA_REGISTER2);
-			} else if (direction == EC_MEC_READ) {
-				temp[0] = inw(MEC_EC_DATA_REGISTER0);
-				temp[1] = inw(MEC_EC_DATA_REGISTER2);
-				memcpy(&data[pos], temp, sizeof(temp));
+				memcpy(&temp, &data[pos], sizeof(temp));
+				outl(temp, MEC_EC_DATA_REGISTER0);
+			} else {
+				temp = inl(MEC_EC_DATA_REGISTER0);
+				memcpy(&data[pos], &temp, sizeof(temp));
 			}
 
 			pos += 4;
@@ -72,15 +85,16 @@ static int ec_mec_xfer(ec_xfer_direction direction, uint16_t address,
 		}
 	}
 
-	if (size - pos > 0) {
-		outw((address & 0xFFFC) | MEC_EC_BYTE_ACCESS, MEC_EC_ADDRESS_REGISTER0);
-		for (int i = 0; i < (size - pos); ++i) {
-			char *storage = &data[pos + i];
+	/* Remaining bytes, a word at a time */
+	while (size - pos > 0) {
+		ec_mec_set_address(address, MEC_EC_BYTE_ACCESS);
+		for (i = 0; i < 4 && pos < size; ++i, ++pos) {
 			if (direction == EC_MEC_WRITE)
-				outb(*storage, MEC_EC_DATA_REGISTER0 + i);
-			else if (direction == EC_MEC_READ)
-				*storage = inb(MEC_EC_DATA_REGISTER0 + i);
+				outb(data[pos], MEC_EC_DATA_REGISTER0 + i);
+			else
+				data[pos] = inb(MEC_EC_DATA_REGISTER0 + i);
 		}
+		address += 4;
 	}
 	return 0;
 }
@@ -94,6 +108,47 @@ static uint8_t ec_checksum_buffer(char *data, size_t size)
 	return sum;
 };
 
+/*
+ * Read the response packet, which is followed by up to insize bytes of data.
+ * Returns the data size, or a negative error which is printed if report is
+ * set.
+ */
+static int ec_mec_read_response(struct ec_host_response *rs, int insize,
+				int report)
+{
+	char *data = (char *)rs;
+
+	ec_mec_xfer(EC_MEC_READ, 0, data, sizeof(*rs));
+
+	if (rs->struct_version != EC_HOST_RESPONSE_VERSION) {
+		if (report)
+			fprintf(stderr, "EC response version mismatch\n");
+		return -EC_RES_INVALID_RESPONSE;
+	}
+
+	if (rs->reserved) {
+		if (report)
+			fprintf(stderr, "EC response reserved != 0\n");
+		return -EC_RES_INVALID_RESPONSE;
+	}
+
+	if (rs->data_len > insize) {
+		fprintf(stderr, "EC returned too much data\n");
+		return -EC_RES_RESPONSE_TOO_BIG;
+	}
+
+	if (rs->data_len > 0) {
+		ec_mec_xfer(EC_MEC_READ, 8, data + sizeof(*rs), rs->data_len);
+		if (ec_checksum_buffer(data, sizeof(*rs) + rs->data_len)) {
+			if (report)
+				fprintf(stderr,
+					"EC response has invalid checksum\n");
+			return -EC_RES_INVALID_CHECKSUM;
+		}
+	}
+	return rs->data_len;
+}
+
 static int ec_command_lpc_mec_3(int command, int version, const void *outdata,
 				int outsize, void *indata, int insize)
 {
@@ -149,41 +204,26 @@ static int ec_command_lpc_mec_3(int command, int version, const void *outdata,
 		return -EECRESULT - i;
 	}
 
-	csum = 0;
-	ec_mec_xfer(EC_MEC_READ, 0, r.data, sizeof(r.rs));
-
-	if (r.rs.struct_version != EC_HOST_RESPONSE_VERSION) {
-		fprintf(stderr, "EC response version mismatch\n");
-		return -EC_RES_INVALID_RESPONSE;
-	}
-
-	if (r.rs.reserved) {
-		fprintf(stderr, "EC response reserved != 0\n");
-		return -EC_RES_INVALID_RESPONSE;
-	}
-
-	if (r.rs.data_len > insize) {
-		fprintf(stderr, "EC returned too much data\n");
-		return -EC_RES_RESPONSE_TOO_BIG;
-	}
-
-	if (r.rs.data_len > 0) {
-		ec_mec_xfer(EC_MEC_READ, 8, r.data + sizeof(r.rs), r.rs.data_len);
-		if (ec_checksum_buffer(r.data, sizeof(r.rs) + r.rs.data_len)) {
-			fprintf(stderr, "EC response has invalid checksum\n");
-			return -EC_RES_INVALID_CHECKSUM;
-		}
+	/*
+	 * Another host user may move the EMI address while the response is
+	 * read, so a bad response is read once more.
+	 */
+	i = ec_mec_read_response(&r.rs, insize, 0);
+	if (i == -EC_RES_INVALID_RESPONSE || i == -EC_RES_INVALID_CHECKSUM)
+		i = ec_mec_read_response(&r.rs, insize, 1);
 
-		memcpy(indata, r.data + sizeof(r.rs), r.rs.data_len);
-	}
-	return r.rs.data_len;
+	if (i > 0)
+		memcpy(indata, r.data + sizeof(r.rs), i);
+	return i;
 }
 
 static int ec_readmem_lpc_mec(int offset, int bytes, void *dest)
 {
 	int i = offset;
 	int cnt = 0;
-	char* s = dest;
+	char *s = dest;
+	char word[4];
+	int n, j;
 
 	if (offset >= EC_MEMMAP_SIZE - bytes)
 		return -1;
@@ -192,20 +232,37 @@ static int ec_readmem_lpc_mec(int offset, int bytes, void *dest)
 		ec_mec_xfer(EC_MEC_READ, MEC_EC_MEMMAP_START + i, dest, bytes);
 		cnt = bytes;
 	} else {
-		/* Somewhat brute-force to set up a bunch of
-		 * individual transfers, but clearer than copying the xfer code
-		 * to add a stop condition.
+		/*
+		 * Read a word at a time until the terminating NUL, but only
+		 * copy the string itself to dest.
 		 */
-		for(; i < EC_MEMMAP_SIZE; ++i, ++s) {
-			ec_mec_xfer(EC_MEC_READ, MEC_EC_MEMMAP_START + i, s, 1);
-			cnt++;
-			if (!*s)
-				break;
+		while (i < EC_MEMMAP_SIZE) {
+			n = MIN(4 - i % 4, EC_MEMMAP_SIZE - i);
+			ec_mec_xfer(EC_MEC_READ, MEC_EC_MEMMAP_START + i,
+				    word, n);
+			for (j = 0; j < n; ++j) {
+				*s++ = word[j];
+				cnt++;
+				if (!word[j])
+					return cnt;
+			}
+			i += n;
 		}
 	}
 	return cnt;
 }
 
+int comm_lpc_mec_long_access(int enable)
+{
+	int prev = mec_long_access;
+
+	if (ec_readmem != ec_readmem_lpc_mec)
+		return -1;
+
+	mec_long_access = enable;
+	return prev;
+}
+
 int comm_init_lpc_mec(void)
 {
 	char signature[2];
@@ -8,14 +8,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "comm-host.h"
+#include "ec_flash.h"
 #include "misc_util.h"
+#include "sha256.h"
 #include "timer.h"
 
 static const uint32_t ERASE_ASYNC_TIMEOUT = 10 * SECOND;
 static const uint32_t ERASE_ASYNC_WAIT = 500 * MSEC;
 static const int FLASH_ERASE_BUSY_RV = -EECRESULT - EC_RES_BUSY;
+static const int FLASH_STREAM_BUSY_RV = -EECRESULT - EC_RES_BUSY;
+static const int FLASH_STREAM_RETRIES = 1000;
+static const uint32_t FLASH_STREAM_RETRY_WAIT = MSEC;
 
 int ec_flash_read(uint8_t *buf, int offset, int size)
 {
@@ -132,6 +138,93 @@ static int get_flash_write_size(void)
 	return write_size;
 }
 
+/*
+ * Send a streaming write command, retrying while the EC is still busy
+ * programming the previous chunks.
+ */
+static int flash_stream_command(struct ec_params_flash_write_stream *p,
+				struct ec_response_flash_write_stream *r)
+{
+	int rv;
+	int i;
+
+	for (i = 0; i < FLASH_STREAM_RETRIES; i++) {
+		rv = ec_command(EC_CMD_FLASH_WRITE_STREAM, 0, p,
+				sizeof(*p) + p->size, r, sizeof(*r));
+		if (rv != FLASH_STREAM_BUSY_RV)
+			break;
+		usleep(FLASH_STREAM_RETRY_WAIT);
+	}
+	return rv;
+}
+
+/*
+ * Write with EC_CMD_FLASH_WRITE_STREAM: the EC programs each chunk while the
+ * next one is on the way, then the data read back is checked by hash.
+ */
+int ec_flash_write_stream(const uint8_t *buf, int offset, int size)
+{
+	struct ec_params_flash_write_stream *p =
+		(struct ec_params_flash_write_stream *)ec_outbuf;
+	struct ec_response_flash_write_stream r;
+	struct sha256_ctx ctx;
+	uint32_t seq;
+	int write_size;
+	int step;
+	int rv;
+	int i;
+
+	write_size = get_flash_write_size();
+	if (write_size <= 0)
+		return -1;
+
+	memset(p, 0, sizeof(*p));
+	p->cmd = FLASH_WRITE_STREAM_START;
+	rv = flash_stream_command(p, &r);
+	if (rv < 0)
+		return rv;
+
+	step = MIN(r.chunk_max, ec_max_outsize - sizeof(*p));
+	step = (step / write_size) * write_size;
+	if (!step) {
+		fprintf(stderr, "Write block size %d > max chunk size %d\n",
+			write_size, r.chunk_max);
+		return -1;
+	}
+
+	printf("Write size %d, streaming...\n", step);
+
+	SHA256_init(&ctx);
+	for (i = 0, seq = 0; i < size; i += step, seq++) {
+		p->cmd = FLASH_WRITE_STREAM_DATA;
+		p->seq = seq;
+		p->offset = offset + i;
+		p->size = MIN(size - i, step);
+		memcpy(p + 1, buf + i, p->size);
+		rv = flash_stream_command(p, &r);
+		if (rv < 0) {
+			fprintf(stderr, "Write error at offset %d\n", i);
+			return rv;
+		}
+		SHA256_update(&ctx, buf + i, p->size);
+	}
+
+	memset(p, 0, sizeof(*p));
+	p->cmd = FLASH_WRITE_STREAM_FINISH;
+	rv = flash_stream_command(p, &r);
+	if (rv < 0) {
+		fprintf(stderr, "Write error, %d chunks sent\n", seq);
+		return rv;
+	}
+
+	if (memcmp(r.sha256, SHA256_final(&ctx), sizeof(r.sha256))) {
+		fprintf(stderr, "Verify failed: flash hash mismatch\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 int ec_flash_write(const uint8_t *buf, int offset, int size)
 {
 	struct ec_params_flash_write *p =
@@ -229,3 +322,187 @@ int ec_flash_erase_async(int offset, int size)
 	}
 	return rv;
 }
+
+/* common/sha256.c uses ASSERT() */
+#ifdef CONFIG_DEBUG_ASSERT_BRIEF
+void panic_assert_fail(const char *fname, int linenum)
+{
+	fprintf(stderr, "ASSERTION FAILURE at %s:%d\n", fname, linenum);
+	exit(1);
+}
+#else
+void panic_assert_fail(const char *msg, const char *func, const char *fname,
+		       int linenum)
+{
+	fprintf(stderr, "ASSERTION FAILURE '%s' in %s() at %s:%d\n",
+		msg, func, fname, linenum);
+	exit(1);
+}
+#endif
+
+static int time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Get the hashes of count sectors starting at offset
+ *
+ * @param hashes	Destination, count * EC_FLASH_SECTOR_HASH_SIZE bytes
+ * @param stats		Updated with the bytes transferred
+ * @return 0 if success, negative if error.
+ */
+static int get_sector_hashes(int offset, int count, int sector_size,
+			     uint8_t *hashes,
+			     struct ec_flash_delta_stats *stats)
+{
+	struct ec_params_flash_sector_hash p;
+	struct ec_response_flash_sector_hash *r =
+		(struct ec_response_flash_sector_hash *)ec_inbuf;
+	int rv;
+	int i;
+
+	for (i = 0; i < count; i += r->count) {
+		p.offset = offset + i * sector_size;
+		p.count = count - i;
+		rv = ec_command(EC_CMD_FLASH_SECTOR_HASH, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < sizeof(*r) || !r->count ||
+		    r->count > count - i ||
+		    rv < sizeof(*r) + r->count * EC_FLASH_SECTOR_HASH_SIZE) {
+			fprintf(stderr, "Bad sector hash response\n");
+			return -1;
+		}
+		memcpy(hashes + i * EC_FLASH_SECTOR_HASH_SIZE, r->hash,
+		       r->count * EC_FLASH_SECTOR_HASH_SIZE);
+		stats->bytes_transferred += sizeof(p) + rv;
+	}
+
+	return 0;
+}
+
+/* Hash one sector of the image, padded as the EC sees it after erase */
+static void hash_sector(const uint8_t *buf, int size, int sector_size,
+			uint8_t *hash)
+{
+	struct sha256_ctx ctx;
+	uint8_t pad[64];
+	int n;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, buf, MIN(size, sector_size));
+	memset(pad, 0xff, sizeof(pad));
+	for (n = size; n < sector_size; n += sizeof(pad))
+		SHA256_update(&ctx, pad, MIN(sizeof(pad), sector_size - n));
+	memcpy(hash, SHA256_final(&ctx), EC_FLASH_SECTOR_HASH_SIZE);
+}
+
+int ec_flash_write_delta(const uint8_t *buf, int offset, int size,
+			 struct ec_flash_delta_stats *stats)
+{
+	struct ec_flash_delta_stats local = { 0 };
+	struct ec_params_flash_sector_hash p = { 0 };
+	struct ec_response_flash_sector_hash r;
+	uint8_t *ec_hashes = NULL;
+	uint8_t *new_hashes = NULL;
+	int sector_size, start, end, len;
+	int rv, i, t;
+
+	if (!stats)
+		stats = &local;
+	memset(stats, 0, sizeof(*stats));
+
+	/* Sector size only, at an offset the EC always accepts */
+	p.offset = 0;
+	rv = ec_command(EC_CMD_FLASH_SECTOR_HASH, 0, &p, sizeof(p),
+			&r, sizeof(r));
+	if (rv < 0)
+		return rv;
+	stats->bytes_transferred += sizeof(p) + rv;
+	sector_size = r.sector_size;
+	if (sector_size <= 0 || offset % sector_size) {
+		fprintf(stderr, "Offset must be a multiple of %d\n",
+			sector_size);
+		return -1;
+	}
+
+	stats->sectors = (size + sector_size - 1) / sector_size;
+	ec_hashes = malloc(stats->sectors * EC_FLASH_SECTOR_HASH_SIZE);
+	new_hashes = malloc(stats->sectors * EC_FLASH_SECTOR_HASH_SIZE);
+	if (!ec_hashes || !new_hashes) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		rv = -1;
+		goto exit;
+	}
+
+	rv = get_sector_hashes(offset, stats->sectors, sector_size,
+			       ec_hashes, stats);
+	if (rv < 0)
+		goto exit;
+
+	for (i = 0; i < stats->sectors; i++)
+		hash_sector(buf + i * sector_size, size - i * sector_size,
+			    sector_size,
+			    new_hashes + i * EC_FLASH_SECTOR_HASH_SIZE);
+
+#define SECTOR_CHANGED(i) memcmp(ec_hashes + (i) * EC_FLASH_SECTOR_HASH_SIZE, \
+				 new_hashes + (i) * EC_FLASH_SECTOR_HASH_SIZE, \
+				 EC_FLASH_SECTOR_HASH_SIZE)
+
+	/* Erase and write each run of changed sectors at once */
+	t = time_ms();
+	for (start = 0; start < stats->sectors; start = end) {
+		if (!SECTOR_CHANGED(start)) {
+			end = start + 1;
+			continue;
+		}
+		for (end = start + 1; end < stats->sectors; end++)
+			if (!SECTOR_CHANGED(end))
+				break;
+
+		printf("Updating sectors %d-%d...\n", start, end - 1);
+		rv = ec_flash_erase(offset + start * sector_size,
+				    (end - start) * sector_size);
+		if (rv < 0) {
+			fprintf(stderr, "Erase error at sector %d\n", start);
+			goto exit;
+		}
+
+		len = MIN(size, end * sector_size) - start * sector_size;
+		rv = ec_flash_write(buf + start * sector_size,
+				    offset + start * sector_size, len);
+		if (rv < 0)
+			goto exit;
+
+		stats->sectors_written += end - start;
+		stats->bytes_written += len;
+		stats->bytes_transferred += len;
+	}
+	stats->write_ms = time_ms() - t;
+
+	/* Verify the rewritten sectors by hash */
+	rv = get_sector_hashes(offset, stats->sectors, sector_size,
+			       ec_hashes, stats);
+	if (rv < 0)
+		goto exit;
+
+	for (i = 0; i < stats->sectors; i++) {
+		if (SECTOR_CHANGED(i)) {
+			fprintf(stderr, "Verify failed at sector %d "
+				"(offset 0x%x)\n", i, offset + i * sector_size);
+			rv = -1;
+			goto exit;
+		}
+	}
+#undef SECTOR_CHANGED
+
+exit:
+	free(ec_hashes);
+	free(new_hashes);
+	return rv;
+}
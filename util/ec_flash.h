@@ -39,6 +39,20 @@ int ec_flash_verify(const uint8_t *buf, int offset, int size);
  */
 int ec_flash_write(const uint8_t *buf, int offset, int size);
 
+/**
+ * Write EC flash memory with EC_CMD_FLASH_WRITE_STREAM
+ *
+ * The EC programs each chunk while the next one is on the way, then the hash
+ * of the data read back is checked.
+ *
+ * @param buf		Source buffer
+ * @param offset	Offset in EC flash to write
+ * @param size		Number of bytes to write
+ *
+ * @return 0 if success, negative if error.
+ */
+int ec_flash_write_stream(const uint8_t *buf, int offset, int size);
+
 /**
  * Erase EC flash memory
  *
@@ -59,4 +73,29 @@ int ec_flash_erase(int offset, int size);
  */
 int ec_flash_erase_async(int offset, int size);
 
+struct ec_flash_delta_stats {
+	int sectors;		/* Sectors covered by the image */
+	int sectors_written;	/* Sectors that differed and were rewritten */
+	int bytes_written;	/* Image bytes sent with EC_CMD_FLASH_WRITE */
+	int bytes_transferred;	/* Host command payload bytes, both ways */
+	int write_ms;		/* Time spent erasing and writing */
+};
+
+/**
+ * Write EC flash memory, skipping the sectors that are already up to date
+ *
+ * The EC hashes each erase sector (EC_CMD_FLASH_SECTOR_HASH), only sectors
+ * whose hash differs from the new data are erased and written, then their
+ * hashes are checked again.
+ *
+ * @param buf		Source buffer
+ * @param offset	Offset in EC flash to write, sector aligned
+ * @param size		Number of bytes to write
+ * @param stats		Filled with the amount of work done, may be NULL
+ *
+ * @return 0 if success, negative if error.
+ */
+int ec_flash_write_delta(const uint8_t *buf, int offset, int size,
+			 struct ec_flash_delta_stats *stats);
+
 #endif
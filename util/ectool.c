@@ -96,6 +96,8 @@ const char help_str[] =
 	"      Prints chip info\n"
 	"  cmdversions <cmd>\n"
 	"      Prints supported version mask for a command number\n"
+	"  commbench [count]\n"
+	"      Measures host command and memory map transfer throughput\n"
 	"  console\n"
 	"      Prints the last output to the EC debug console\n"
 	"  cec\n"
@@ -122,10 +124,14 @@ const char help_str[] =
 	"      Sets the SMI mask for EC host events\n"
 	"  eventsetwakemask <mask>\n"
 	"      Sets the wake mask for EC host events\n"
+	"  evstore <file>\n"
+	"      Saves the EC event store to a file for event_store_decode.py\n"
 	"  extpwrlimit\n"
 	"      Set the maximum external power limit\n"
 	"  fanduty <percent>\n"
 	"      Forces the fan PWM to a constant duty cycle\n"
+	"  fanpid <idx> [<kp> <ki> <kd> <kff_load> <slew_up> <slew_down> <i_max>]\n"
+	"      Prints or sets the tuning of the fan speed PID\n"
 	"  flasherase <offset> <size>\n"
 	"      Erases EC flash\n"
 	"  flasheraseasync <offset> <size>\n"
@@ -142,6 +148,10 @@ const char help_str[] =
 	"      Reads from EC flash to a file\n"
 	"  flashwrite <offset> <infile>\n"
 	"      Writes to EC flash from a file\n"
+	"  flashwritestream <offset> <infile>\n"
+	"      Writes to EC flash from a file, streamed and checked by hash\n"
+	"  flashwritedelta <offset> <infile>\n"
+	"      Writes only the EC flash sectors that differ from a file\n"
 	"  forcelidopen <enable>\n"
 	"      Forces the lid switch to open position\n"
 	"  fpcontext\n"
@@ -206,10 +216,14 @@ const char help_str[] =
 	"      Get or Set the MKBP event wake mask, or host event wake mask\n"
 	"  motionsense [CMDS]\n"
 	"      Various motion sense control commands\n"
+	"  mutexinfo [clear]\n"
+	"      Prints mutex locks, contention and worst wait and hold times\n"
 	"  panicinfo\n"
 	"      Prints saved panic info\n"
 	"  pause_in_s5 [on|off]\n"
 	"      Whether or not the AP should pause in S5 on shutdown\n"
+	"  pcprofile start [hz] | stop | read <file> [seconds]\n"
+	"      Samples where the EC runs, see util/pcprof_flamegraph.py\n"
 	"  pdcontrol [suspend|resume|reset|disable|on]\n"
 	"      Controls the PD chip\n"
 	"  pdchipinfo <port>\n"
@@ -274,11 +288,12 @@ const char help_str[] =
 	"      Set real-time clock alarm to go off in <sec> seconds\n"
 	"  rwhashpd <dev_id> <HASH[0] ... <HASH[4]>\n"
 	"      Set entry in PD MCU's device rw_hash table.\n"
-	"  rwsig <info|dump|action|status> ...\n"
+	"  rwsig <info|dump|action|status|time> ...\n"
 	"      info: get all info about rwsig\n"
 	"      dump: show individual rwsig field\n"
 	"      action: Control the behavior of RWSIG task.\n"
 	"      status: Run RW signature verification and get status.\n{"
+	"      time: Get the timing of the last RW signature verification.\n"
 	"  rwsigaction (DEPRECATED; use \"rwsig action\")\n"
 	"      Control the behavior of RWSIG task.\n"
 	"  rwsigstatus (DEPRECATED; use \"rwsig status\"\n"
@@ -293,10 +308,22 @@ const char help_str[] =
 	"      Display system info.\n"
 	"  switches\n"
 	"      Prints current EC switch positions\n"
+	"  tasklatency [clear]\n"
+	"      Prints IRQ to task event latency histograms and worst cases\n"
+	"  taskprofile [clear]\n"
+	"      Prints CPU cycles per task and IRQ handler, busiest IRQs first\n"
 	"  temps <sensorid>\n"
 	"      Print temperature.\n"
 	"  tempsinfo <sensorid>\n"
 	"      Print temperature sensor info.\n"
+	"  telemetry [count [interval_ms]]\n"
+	"      Print battery/thermal/fan snapshots from the memory map\n"
+	"  telemetry subscribe <fields|all|none> [interval_ms [soc temp fan\n"
+	"                      current input]]\n"
+	"      Ask for telemetry events, fields are a comma separated list of\n"
+	"      power, soc, current, input, temp, fan\n"
+	"  telemetry watch [count [timeout_ms]]\n"
+	"      Print telemetry events as they arrive\n"
 	"  thermalget <platform-specific args>\n"
 	"      Get the threshold temperature values from the thermal engine.\n"
 	"  thermalset <platform-specific args>\n"
@@ -334,6 +361,8 @@ const char help_str[] =
 	"      Prints EC version\n"
 	"  waitevent <type> [<timeout>]\n"
 	"      Wait for the MKBP event of type and display it\n"
+	"  wakestats [clear]\n"
+	"      Prints what woke the EC from idle, costliest first\n"
 	"  wireless <flags> [<mask> [<suspend_flags> <suspend_mask>]]\n"
 	"      Enable/disable WLAN/Bluetooth radio\n"
 	"";
@@ -1136,6 +1165,89 @@ int cmd_read_test(int argc, char *argv[])
 	return 0;
 }
 
+static int64_t elapsed_us(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000LL +
+	       (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static int comm_bench_run(const char *name, int count)
+{
+	struct ec_params_read_test p;
+	struct ec_response_read_test r;
+	uint8_t memmap[EC_MEMMAP_SIZE];
+	struct timespec start;
+	int64_t us;
+	int rv;
+	int i;
+
+	/* Largest response the read test returns */
+	p.offset = 0;
+	p.size = MIN(sizeof(r.data), ec_max_insize);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++) {
+		rv = ec_command(EC_CMD_READ_TEST, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0) {
+			fprintf(stderr, "Read test failed: %d\n", rv);
+			return rv;
+		}
+	}
+	us = MAX(elapsed_us(&start), 1);
+	printf("%-8s hostcmd %6d us/cmd %8d B/s", name, (int)(us / count),
+	       (int)(1000000LL * count * p.size / us));
+
+	/* Memory map snapshot, not every transport supports it */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++) {
+		rv = ec_readmem(0, sizeof(memmap) - 1, memmap);
+		if (rv < 0)
+			break;
+	}
+	us = MAX(elapsed_us(&start), 1);
+	if (rv < 0)
+		printf("   memmap n/a\n");
+	else
+		printf("   memmap %6d us/read %8d B/s\n", (int)(us / count),
+		       (int)(1000000LL * count * (sizeof(memmap) - 1) / us));
+
+	return 0;
+}
+
+int cmd_comm_bench(int argc, char *argv[])
+{
+	int count = 100;
+	int prev;
+	int rv;
+	char *e;
+
+	if (argc > 1) {
+		count = strtol(argv[1], &e, 0);
+		if ((e && *e) || count <= 0) {
+			fprintf(stderr, "Bad count.\n");
+			return -1;
+		}
+	}
+
+	/* The MEC EMI can be compared with and without 32-bit accesses */
+	if (comm_lpc_mec_long_access) {
+		prev = comm_lpc_mec_long_access(0);
+		if (prev >= 0) {
+			rv = comm_bench_run("emi8", count);
+			comm_lpc_mec_long_access(1);
+			if (!rv)
+				rv = comm_bench_run("emi32", count);
+			comm_lpc_mec_long_access(prev);
+			return rv;
+		}
+	}
+
+	return comm_bench_run("current", count);
+}
+
 
 int cmd_reboot_ec(int argc, char *argv[])
 {
@@ -1427,7 +1539,10 @@ int cmd_flash_write(int argc, char *argv[])
 	printf("Writing to offset %d...\n", offset);
 
 	/* Write data in chunks */
-	rv = ec_flash_write(buf, offset, size);
+	if (strcmp(argv[0], "flashwritestream") == 0)
+		rv = ec_flash_write_stream(buf, offset, size);
+	else
+		rv = ec_flash_write(buf, offset, size);
 
 	free(buf);
 
@@ -1438,6 +1553,61 @@ int cmd_flash_write(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_flash_write_delta(int argc, char *argv[])
+{
+	struct ec_flash_delta_stats stats;
+	int offset, size;
+	int rv;
+	char *e;
+	char *buf;
+	struct timespec start, end;
+	int ms;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <offset> <filename>\n", argv[0]);
+		return -1;
+	}
+
+	offset = strtol(argv[1], &e, 0);
+	if ((e && *e) || offset < 0 || offset > MAX_FLASH_SIZE) {
+		fprintf(stderr, "Bad offset.\n");
+		return -1;
+	}
+
+	/* Read the input file */
+	buf = read_file(argv[2], &size);
+	if (!buf)
+		return -1;
+
+	printf("Updating offset %d...\n", offset);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	rv = ec_flash_write_delta((const uint8_t *)buf, offset, size, &stats);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	free(buf);
+
+	if (rv < 0)
+		return rv;
+
+	ms = (end.tv_sec - start.tv_sec) * 1000 +
+	     (end.tv_nsec - start.tv_nsec) / 1000000;
+	printf("Rewrote %d of %d sectors (%d of %d bytes)\n",
+	       stats.sectors_written, stats.sectors, stats.bytes_written,
+	       size);
+	printf("Transferred %d bytes in %d ms (full reflash: %d bytes",
+	       stats.bytes_transferred, ms, size);
+	/* Not measured, extrapolated from the erase and write rate */
+	if (stats.bytes_written)
+		printf(", estimated %d ms",
+		       (int)((int64_t)stats.write_ms * size /
+			     stats.bytes_written));
+	printf(")\n");
+
+	printf("done.\n");
+	return 0;
+}
+
 int cmd_flash_erase(int argc, char *argv[])
 {
 	int offset, size;
@@ -1612,6 +1782,30 @@ int cmd_rwsig_status(int argc, char *argv[])
 	return 0;
 }
 
+static int cmd_rwsig_time(int argc, char *argv[])
+{
+	int rv;
+	struct ec_response_rwsig_verify_time r;
+
+	rv = ec_command(EC_CMD_RWSIG_VERIFY_TIME, 0, NULL, 0, &r, sizeof(r));
+	if (rv < 0)
+		return rv;
+
+	if (!(r.flags & EC_RWSIG_VERIFY_TIME_VALID)) {
+		printf("No RW signature verification recorded\n");
+		return 0;
+	}
+
+	printf("Result:   %s\n",
+	       r.flags & EC_RWSIG_VERIFY_TIME_GOOD ? "OK" : "FAILED");
+	printf("Total:    %u us\n", r.total_us);
+	printf("SHA-256:  %u us\n", r.hash_us);
+	printf("RSA:      %u us\n", r.rsa_us);
+	printf("Finished: %u us after boot\n", r.end_us);
+
+	return 0;
+}
+
 static int rwsig_action(const char *command)
 {
 	struct ec_params_rwsig_action req;
@@ -1762,13 +1956,14 @@ int cmd_rwsig(int argc, char **argv)
 		{ "info", cmd_rwsig_info },
 		{ "dump", cmd_rwsig_info },
 		{ "action", cmd_rwsig_action },
-		{ "status", cmd_rwsig_status }
+		{ "status", cmd_rwsig_status },
+		{ "time", cmd_rwsig_time }
 	};
 
 	int i;
 
 	if (argc < 2) {
-		fprintf(stderr, "Usage: %s <info|dump|action|status>\n",
+		fprintf(stderr, "Usage: %s <info|dump|action|status|time>\n",
 			argv[0]);
 		return -1;
 	}
@@ -3647,6 +3842,62 @@ int cmd_fanduty(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_fanpid(int argc, char *argv[])
+{
+	struct ec_params_fan_pid p;
+	struct ec_response_fan_pid r;
+	int32_t v[7];
+	char *e;
+	int i, rv;
+
+	if (argc != 2 && argc != 9) {
+		fprintf(stderr, "Usage: %s <idx> [<kp> <ki> <kd> <kff_load> "
+			"<slew_up> <slew_down> <i_max>]\n", argv[0]);
+		fprintf(stderr, "Gains are Q16 (65536 = 1.0), slew rates in "
+			"RPM/s, i_max in %%\n");
+		return -1;
+	}
+
+	memset(&p, 0, sizeof(p));
+	p.fan = strtol(argv[1], &e, 0);
+	if (e && *e) {
+		fprintf(stderr, "Bad fan index.\n");
+		return -1;
+	}
+
+	if (argc == 9) {
+		for (i = 0; i < 7; i++) {
+			v[i] = strtol(argv[i + 2], &e, 0);
+			if (e && *e) {
+				fprintf(stderr, "Bad value %s.\n", argv[i + 2]);
+				return -1;
+			}
+		}
+		p.flags = EC_FAN_PID_SET;
+		p.params.kp = v[0];
+		p.params.ki = v[1];
+		p.params.kd = v[2];
+		p.params.kff_load = v[3];
+		p.params.slew_up = v[4];
+		p.params.slew_down = v[5];
+		p.params.i_max = v[6];
+	}
+
+	rv = ec_command(EC_CMD_FAN_PID, 0, &p, sizeof(p), &r, sizeof(r));
+	if (rv < 0)
+		return rv;
+
+	printf("Fan %d: target %d rpm, setpoint %d rpm, actual %d rpm, "
+	       "duty %d%%, load %d%%\n", p.fan, r.target_rpm, r.setpoint_rpm,
+	       r.rpm, r.duty, r.load);
+	printf("kp %d ki %d kd %d kff_load %d\n", r.params.kp, r.params.ki,
+	       r.params.kd, r.params.kff_load);
+	printf("slew up %d rpm/s, down %d rpm/s, i_max %d%%\n",
+	       r.params.slew_up, r.params.slew_down, r.params.i_max);
+
+	return 0;
+}
+
 #define LBMSG(state) #state
 #include "lightbar_msg_list.h"
 static const char * const lightbar_cmds[] = {
@@ -6831,6 +7082,215 @@ int cmd_switches(int argc, char *argv[])
 }
 
 
+static void print_telemetry(const struct ec_memmap_telemetry *t)
+{
+	int i;
+
+	printf("seq %u, EC time %u ms, flags 0x%02x%s%s%s\n",
+	       t->seq, t->update_ms, t->flags,
+	       t->flags & EC_TELEMETRY_AC_PRESENT ? " AC" : "",
+	       t->flags & EC_TELEMETRY_BATT_PRESENT ? " BATT" : "",
+	       t->flags & EC_TELEMETRY_BATT_STALE ? " STALE" : "");
+	if (t->flags & EC_TELEMETRY_BATT_PRESENT)
+		printf("  battery: %u mV %d mA %u/%u mAh %u%% %d.%d C\n",
+		       t->batt_voltage, t->batt_current, t->batt_remaining,
+		       t->batt_full, t->batt_soc, (t->batt_temp - 2731) / 10,
+		       abs(t->batt_temp - 2731) % 10);
+	else
+		printf("  battery: not present\n");
+	printf("  charger: %u mV %u mA, input %u mV %u mA (%u mW)\n",
+	       t->chg_voltage, t->chg_current, t->input_voltage,
+	       t->input_current,
+	       (uint32_t)t->input_voltage * t->input_current / 1000);
+	printf("  temps:");
+	for (i = 0; i < EC_TELEMETRY_TEMP_ENTRIES; i++) {
+		if (t->temp[i] >= EC_TEMP_SENSOR_NOT_CALIBRATED)
+			continue;
+		printf(" %d:%d", i, t->temp[i] + EC_TEMP_SENSOR_OFFSET);
+	}
+	printf(" K\n  fans:");
+	for (i = 0; i < EC_TELEMETRY_FAN_ENTRIES; i++) {
+		if (t->fan_rpm[i] == EC_FAN_SPEED_NOT_PRESENT)
+			continue;
+		if (t->fan_rpm[i] == EC_FAN_SPEED_STALLED)
+			printf(" %d:stalled", i);
+		else
+			printf(" %d:%u", i, t->fan_rpm[i]);
+	}
+	printf(" rpm\n");
+}
+
+static const char * const telemetry_event_names[] = {
+	"power", "soc", "current", "input", "temp", "fan",
+};
+
+static int telemetry_subscribe(int argc, char *argv[])
+{
+	struct ec_telemetry_subscription p, r;
+	uint16_t *thresholds[] = { &p.current_delta, &p.input_delta,
+				   &p.fan_delta };
+	char *name, *e;
+	int i, rv;
+	long v;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: telemetry subscribe <fields|none> "
+			"[interval_ms [soc temp fan current input]]\n");
+		return -1;
+	}
+
+	memset(&p, 0, sizeof(p));
+	for (name = strtok(argv[1], ","); name; name = strtok(NULL, ",")) {
+		if (!strcmp(name, "none"))
+			continue;
+		if (!strcmp(name, "all")) {
+			p.fields |= BIT(ARRAY_SIZE(telemetry_event_names)) - 1;
+			continue;
+		}
+		for (i = 0; i < ARRAY_SIZE(telemetry_event_names); i++)
+			if (!strcmp(name, telemetry_event_names[i]))
+				break;
+		if (i == ARRAY_SIZE(telemetry_event_names)) {
+			fprintf(stderr, "Unknown field '%s'.\n", name);
+			return -1;
+		}
+		p.fields |= BIT(i);
+	}
+
+	/* Interval, then the thresholds in the order of the usage string */
+	for (i = 2; i < argc; i++) {
+		v = strtol(argv[i], &e, 0);
+		if ((e && *e) || v < 0 || v > UINT16_MAX ||
+		    (i >= 3 && i <= 4 && v > UINT8_MAX)) {
+			fprintf(stderr, "Bad value '%s'.\n", argv[i]);
+			return -1;
+		}
+		if (i == 2)
+			p.min_interval_ms = v;
+		else if (i == 3)
+			p.soc_delta = v;
+		else if (i == 4)
+			p.temp_band = v;
+		else if (i - 5 < ARRAY_SIZE(thresholds))
+			*thresholds[i - 5] = v;
+	}
+
+	rv = ec_command(EC_CMD_TELEMETRY_SUBSCRIBE, 0, &p, sizeof(p),
+			&r, sizeof(r));
+	if (rv < 0)
+		return rv;
+
+	printf("fields 0x%x, interval %u ms, soc %u%%, temp band %u K, "
+	       "fan %u rpm, current %u mA, input %u mW\n",
+	       r.fields, r.min_interval_ms, r.soc_delta, r.temp_band,
+	       r.fan_delta, r.current_delta, r.input_delta);
+
+	return 0;
+}
+
+static int telemetry_watch(int argc, char *argv[])
+{
+	struct ec_response_get_next_event_v1 buffer;
+	const struct ec_telemetry_event *ev = &buffer.data.telemetry;
+	long timeout = -1;
+	int count = -1;
+	char *e;
+	int i, rv;
+
+	if (!ec_pollevent) {
+		fprintf(stderr, "Polling for MKBP event not supported\n");
+		return -EINVAL;
+	}
+
+	if (argc > 1) {
+		count = strtol(argv[1], &e, 0);
+		if ((e && *e) || count <= 0) {
+			fprintf(stderr, "Bad count.\n");
+			return -1;
+		}
+	}
+	if (argc > 2) {
+		timeout = strtol(argv[2], &e, 0);
+		if (e && *e) {
+			fprintf(stderr, "Bad timeout value '%s'.\n", argv[2]);
+			return -1;
+		}
+	}
+
+	while (count < 0 || count--) {
+		rv = ec_pollevent(BIT(EC_MKBP_EVENT_TELEMETRY), &buffer,
+				  sizeof(buffer), timeout);
+		if (rv == 0) {
+			fprintf(stderr, "Timeout waiting for telemetry\n");
+			return -ETIMEDOUT;
+		} else if (rv < 0) {
+			perror("Error polling for MKBP event\n");
+			return -EIO;
+		}
+
+		printf("seq %u:", ev->seq);
+		for (i = 0; i < ARRAY_SIZE(telemetry_event_names); i++)
+			if (ev->fields & BIT(i))
+				printf(" %s", telemetry_event_names[i]);
+		printf(" | flags 0x%02x soc %u%% %d mA input %u mW",
+		       ev->flags, ev->batt_soc, ev->batt_current,
+		       ev->input_power * 100);
+		if (ev->temp_max < EC_TEMP_SENSOR_NOT_CALIBRATED)
+			printf(" temp%u %d K", ev->temp_max_id,
+			       ev->temp_max + EC_TEMP_SENSOR_OFFSET);
+		printf(" fan %u rpm\n", ev->fan_rpm_max);
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
+int cmd_telemetry(int argc, char *argv[])
+{
+	struct ec_memmap_telemetry t;
+	int count = 1;
+	int interval_ms = 100;
+	char *e;
+	int rv;
+
+	if (argc > 1 && !strcmp(argv[1], "subscribe"))
+		return telemetry_subscribe(argc - 1, argv + 1);
+	if (argc > 1 && !strcmp(argv[1], "watch"))
+		return telemetry_watch(argc - 1, argv + 1);
+
+	if (argc > 1) {
+		count = strtol(argv[1], &e, 0);
+		if ((e && *e) || count <= 0) {
+			fprintf(stderr, "Bad count.\n");
+			return -1;
+		}
+	}
+	if (argc > 2) {
+		interval_ms = strtol(argv[2], &e, 0);
+		if ((e && *e) || interval_ms < 0) {
+			fprintf(stderr, "Bad interval.\n");
+			return -1;
+		}
+	}
+
+	while (count--) {
+		rv = ec_read_telemetry(&t);
+		if (rv == -EC_RES_UNAVAILABLE) {
+			fprintf(stderr, "EC does not publish telemetry.\n");
+			return rv;
+		} else if (rv < 0) {
+			fprintf(stderr, "Failed to read telemetry: %d\n", rv);
+			return rv;
+		}
+		print_telemetry(&t);
+		if (count)
+			usleep(interval_ms * 1000);
+	}
+
+	return 0;
+}
+
+
 int cmd_wireless(int argc, char *argv[])
 {
 	char *e;
@@ -7325,6 +7785,65 @@ int cmd_lcd_backlight(int argc, char *argv[])
 }
 
 
+int cmd_event_store(int argc, char *argv[])
+{
+	struct ec_params_event_store_read p;
+	struct ec_response_event_store_read *r = ec_inbuf;
+	uint8_t *buf = NULL;
+	uint32_t base_time = 0;
+	size_t len = 0;
+	FILE *f;
+	int rv, n;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <file>\n", argv[0]);
+		return -1;
+	}
+
+	p.offset = 0;
+	do {
+		rv = ec_command(EC_CMD_EVENT_STORE_READ, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < (int)sizeof(*r)) {
+			fprintf(stderr, "Event store read failed\n");
+			free(buf);
+			return -1;
+		}
+
+		/* Start over if records were discarded while reading */
+		if (!len || r->offset != p.offset) {
+			len = 0;
+			base_time = r->base_time;
+		}
+
+		n = rv - sizeof(*r);
+		buf = realloc(buf, len + n);
+		if (!buf) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+		memcpy(buf + len, r->data, n);
+		len += n;
+		p.offset = r->offset + n;
+	} while (p.offset != r->end);
+
+	f = fopen(argv[1], "wb");
+	if (!f) {
+		perror("Can't open file");
+		free(buf);
+		return -1;
+	}
+	/* Magic, then the base time of the oldest record, then the records */
+	fwrite("EVST", 1, 4, f);
+	fwrite(&base_time, sizeof(base_time), 1, f);
+	fwrite(buf, 1, len, f);
+	fclose(f);
+	free(buf);
+
+	printf("Saved %zu bytes.\n", len);
+	return 0;
+}
+
 int cmd_ext_power_limit(int argc, char *argv[])
 {
 	/* Version 1 is used, no support for obsolete version 0 */
@@ -9863,6 +10382,401 @@ static int wait_event(long event_type,
 	return rv;
 }
 
+static int wake_source_cmp(const void *a, const void *b)
+{
+	const struct ec_wake_source *sa = a, *sb = b;
+
+	if (sa->awake_us != sb->awake_us)
+		return sa->awake_us < sb->awake_us ? 1 : -1;
+	return sb->count - sa->count;
+}
+
+int cmd_wake_stats(int argc, char *argv[])
+{
+	static const char * const veto_names[EC_WAKE_VETO_COUNT] = {
+		[EC_WAKE_VETO_TIME] = "time",
+		[EC_WAKE_VETO_SLEEP_MASK] = "sleep mask",
+		[EC_WAKE_VETO_LOW_SPEED] = "low speed",
+		[EC_WAKE_VETO_UART] = "uart",
+	};
+	struct ec_params_wake_stats p;
+	struct ec_response_wake_stats r;
+	struct ec_wake_source *src = NULL;
+	int count = 0, clear = 0;
+	int i, rv;
+
+	if (argc > 2 || (argc == 2 && strcasecmp(argv[1], "clear"))) {
+		fprintf(stderr, "Usage: %s [clear]\n", argv[0]);
+		return -1;
+	}
+	clear = argc == 2;
+
+	/* Get all the pages of sources, clear with the last one */
+	memset(&p, 0, sizeof(p));
+	do {
+		p.flags = 0;
+		rv = ec_command(EC_CMD_WAKE_STATS, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0) {
+			free(src);
+			return rv;
+		}
+		if (!src) {
+			count = r.source_count;
+			src = calloc(MAX(count, 1), sizeof(*src));
+			if (!src)
+				return -1;
+		}
+		for (i = 0; i < EC_WAKE_STATS_PAGE &&
+			    p.source_offset + i < count; i++)
+			src[p.source_offset + i] = r.sources[i];
+		p.source_offset += EC_WAKE_STATS_PAGE;
+	} while (p.source_offset < count);
+
+	if (clear) {
+		p.flags = EC_WAKE_STATS_CLEAR;
+		p.source_offset = 0;
+		ec_command(EC_CMD_WAKE_STATS, 0, &p, sizeof(p), NULL, 0);
+	}
+
+	printf("Light sleep %u, heavy sleep %u (%u ms)\n", r.sleep_count,
+	       r.dsleep_count, r.dsleep_ms);
+
+	printf("Light sleep vetoes:\n");
+	for (i = 0; i < EC_WAKE_VETO_COUNT; i++)
+		printf("  %-12s %u\n", veto_names[i], r.veto[i]);
+	for (i = 0; i < ARRAY_SIZE(r.veto_mask); i++)
+		if (r.veto_mask[i])
+			printf("  mask bit %-3d %u\n", i, r.veto_mask[i]);
+
+	printf("Sleep lengths:\n");
+	for (i = 0; i < EC_WAKE_HIST_BUCKETS - 1; i++)
+		printf("  < %8d us %u\n", 64 << (2 * i), r.hist[i]);
+	printf("  >= %7d us %u\n", 64 << (2 * i), r.hist[i]);
+
+	qsort(src, count, sizeof(*src), wake_source_cmp);
+	printf("   COUNT   AWAKE_US SOURCE\n");
+	for (i = 0; i < count; i++) {
+		printf("%8u %10u ", src[i].count, src[i].awake_us);
+		switch (src[i].type) {
+		case EC_WAKE_SRC_TIMER:
+			printf("timer, task %d\n", src[i].id);
+			break;
+		case EC_WAKE_SRC_DEFERRED:
+			printf("deferred 0x%08x\n", src[i].addr);
+			break;
+		case EC_WAKE_SRC_GPIO:
+			printf("gpio %d\n", src[i].id);
+			break;
+		default:
+			printf("irq %d\n", src[i].id);
+		}
+	}
+	printf("%8u            other\n", r.other);
+
+	free(src);
+	return 0;
+}
+
+static int task_profile_cmp(const void *a, const void *b)
+{
+	const struct ec_task_profile_entry *ea = a, *eb = b;
+
+	if (ea->cycles != eb->cycles)
+		return ea->cycles < eb->cycles ? 1 : -1;
+	return ea->id - eb->id;
+}
+
+/* Read all the pages of tasks or IRQs, return how many there are */
+static int task_profile_read(uint8_t flags,
+			     struct ec_response_task_profile *r,
+			     struct ec_task_profile_entry **entries)
+{
+	struct ec_params_task_profile p;
+	struct ec_task_profile_entry *e = NULL, *tmp;
+	int count = 0;
+	int rv;
+
+	memset(&p, 0, sizeof(p));
+	p.flags = flags;
+	do {
+		rv = ec_command(EC_CMD_TASK_PROFILE, 0, &p, sizeof(p),
+				r, sizeof(*r));
+		if (rv < 0)
+			goto error;
+		tmp = realloc(e, (count + r->count + 1) * sizeof(*e));
+		if (!tmp) {
+			rv = -1;
+			goto error;
+		}
+		e = tmp;
+		memcpy(e + count, r->entries, r->count * sizeof(*e));
+		count += r->count;
+		p.offset = r->next_offset;
+	} while (p.offset);
+
+	*entries = e;
+	return count;
+
+error:
+	free(e);
+	return rv;
+}
+
+static void task_profile_print(const struct ec_task_profile_entry *e,
+			       int count, uint64_t window, uint32_t mhz,
+			       const char *name)
+{
+	int i;
+
+	printf("%5s %10s %14s %6s %10s\n", name, "COUNT", "CYCLES", "CPU%",
+	       "MAX_US");
+	for (i = 0; i < count; i++)
+		printf("%5d %10u %14" PRIu64 " %6.2f %10u\n", e[i].id,
+		       e[i].count, (uint64_t)e[i].cycles,
+		       window ? e[i].cycles * 100.0 / window : 0.0,
+		       mhz ? e[i].max_cycles / mhz : 0);
+}
+
+int cmd_task_profile(int argc, char *argv[])
+{
+	struct ec_response_task_profile r;
+	struct ec_task_profile_entry *tasks = NULL, *irqs = NULL;
+	int task_count, irq_count;
+	uint64_t window;
+	uint32_t mhz;
+
+	if (argc > 2 || (argc == 2 && strcasecmp(argv[1], "clear"))) {
+		fprintf(stderr, "Usage: %s [clear]\n", argv[0]);
+		return -1;
+	}
+
+	task_count = task_profile_read(0, &r, &tasks);
+	if (task_count < 0)
+		return task_count;
+	irq_count = task_profile_read(EC_TASK_PROFILE_IRQS, &r, &irqs);
+	if (irq_count < 0) {
+		free(tasks);
+		return irq_count;
+	}
+
+	if (argc == 2) {
+		struct ec_params_task_profile p = {
+			.flags = EC_TASK_PROFILE_CLEAR,
+		};
+
+		ec_command(EC_CMD_TASK_PROFILE, 0, &p, sizeof(p), NULL, 0);
+	}
+
+	mhz = r.cpu_hz / 1000000;
+	window = (uint64_t)r.window_ms * (r.cpu_hz / 1000);
+	printf("Window %u ms at %u MHz\n", r.window_ms, mhz);
+	printf("Task switches: %u on wait, %u on wake, %u on IRQ\n",
+	       r.switches[EC_TASK_SWITCH_WAIT],
+	       r.switches[EC_TASK_SWITCH_WAKE],
+	       r.switches[EC_TASK_SWITCH_IRQ]);
+
+	task_profile_print(tasks, task_count, window, mhz, "TASK");
+	qsort(irqs, irq_count, sizeof(*irqs), task_profile_cmp);
+	task_profile_print(irqs, irq_count, window, mhz, "IRQ");
+
+	free(tasks);
+	free(irqs);
+	return 0;
+}
+
+int cmd_task_latency(int argc, char *argv[])
+{
+	struct ec_params_task_latency p = { 0 };
+	struct ec_response_task_latency r;
+	int i, b, rv;
+
+	if (argc > 2 || (argc == 2 && strcasecmp(argv[1], "clear"))) {
+		fprintf(stderr, "Usage: %s [clear]\n", argv[0]);
+		return -1;
+	}
+
+	printf("Bucket n counts latencies below 8 << n us, the last the rest\n");
+	printf("Task  Worst us  IRQ  Intr  Prev  Histogram\n");
+	do {
+		rv = ec_command(EC_CMD_TASK_LATENCY, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0)
+			return rv;
+		for (i = 0; i < r.count && i < EC_TASK_LATENCY_PAGE; i++) {
+			const struct ec_task_latency *l = &r.tasks[i];
+
+			printf("%4d  %8u  %3u  %4d  %4d ", l->task,
+			       l->worst_us, l->worst_irq,
+			       l->worst_interrupted, l->worst_ran_before);
+			for (b = 0; b < EC_TASK_LATENCY_BUCKETS; b++)
+				printf(" %u", l->hist[b]);
+			printf("\n");
+		}
+		p.offset += r.count;
+	} while (r.count && p.offset < r.task_count);
+
+	if (argc == 2) {
+		p.flags = EC_TASK_LATENCY_CLEAR;
+		p.offset = r.task_count;
+		ec_command(EC_CMD_TASK_LATENCY, 0, &p, sizeof(p), NULL, 0);
+	}
+
+	return 0;
+}
+
+int cmd_mutex_info(int argc, char *argv[])
+{
+	struct ec_params_mutex_stats p = { 0 };
+	struct ec_response_mutex_stats r;
+	int i, rv;
+
+	if (argc > 2 || (argc == 2 && strcasecmp(argv[1], "clear"))) {
+		fprintf(stderr, "Usage: %s [clear]\n", argv[0]);
+		return -1;
+	}
+
+	printf("Mutex       Owner     Locks  Contended  Max wait us "
+	       "(task/owner)  Max hold us (task)\n");
+	do {
+		rv = ec_command(EC_CMD_MUTEX_STATS, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0)
+			return rv;
+		for (i = 0; i < r.count && i < EC_MUTEX_STATS_PAGE; i++) {
+			const struct ec_mutex_stats *m = &r.mutexes[i];
+
+			printf("0x%08x  %5d  %8u  %9u  %11u (%3d/%3d)"
+			       "  %11u (%3d)\n",
+			       m->address, m->owner, m->locks, m->contended,
+			       m->max_wait_us, m->max_wait_task,
+			       m->max_wait_owner, m->max_hold_us,
+			       m->max_hold_task);
+		}
+		p.offset += r.count;
+	} while (r.count && p.offset < r.mutex_count);
+
+	if (argc == 2) {
+		p.flags = EC_MUTEX_STATS_CLEAR;
+		p.offset = r.mutex_count;
+		ec_command(EC_CMD_MUTEX_STATS, 0, &p, sizeof(p), NULL, 0);
+	}
+
+	return 0;
+}
+
+static int pc_profile_cmd(uint8_t flags, int rate_hz,
+			  struct ec_response_pc_profile *r)
+{
+	struct ec_params_pc_profile p = {
+		.flags = flags,
+		.rate_hz = rate_hz,
+	};
+
+	return ec_command(EC_CMD_PC_PROFILE, 0, &p, sizeof(p), r, sizeof(*r));
+}
+
+/* Collect samples for a while, then save them for util/pcprof_flamegraph.py */
+static int pc_profile_read(const char *file, int seconds)
+{
+	struct ec_response_pc_profile r;
+	struct ec_pc_sample *s = NULL, *tmp;
+	struct timespec start;
+	uint32_t dropped = 0;
+	uint16_t rate_hz = 0;
+	size_t count = 0;
+	FILE *f;
+	int rv;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	do {
+		rv = pc_profile_cmd(0, 0, &r);
+		if (rv < 0) {
+			free(s);
+			return rv;
+		}
+		rate_hz = MAX(rate_hz, r.rate_hz);
+		dropped += r.dropped;
+
+		tmp = realloc(s, (count + r.count + 1) * sizeof(*s));
+		if (!tmp) {
+			fprintf(stderr, "Out of memory\n");
+			free(s);
+			return -1;
+		}
+		s = tmp;
+		memcpy(s + count, r.samples, r.count * sizeof(*s));
+		count += r.count;
+
+		/* Let samples pile up rather than poll for each one */
+		if (!r.pending)
+			usleep(20000);
+	} while (r.pending || elapsed_us(&start) < seconds * 1000000LL);
+
+	f = fopen(file, "wb");
+	if (!f) {
+		perror("Can't open file");
+		free(s);
+		return -1;
+	}
+	/* Magic, rate, padding, dropped samples, then the samples */
+	fwrite("PCPF", 1, 4, f);
+	fwrite(&rate_hz, sizeof(rate_hz), 1, f);
+	fwrite("\0\0", 1, 2, f);
+	fwrite(&dropped, sizeof(dropped), 1, f);
+	fwrite(s, sizeof(*s), count, f);
+	fclose(f);
+	free(s);
+
+	printf("Saved %zu samples at %u Hz, %u dropped.\n", count, rate_hz,
+	       dropped);
+	return 0;
+}
+
+int cmd_pc_profile(int argc, char *argv[])
+{
+	struct ec_response_pc_profile r;
+	int rate_hz = 1000;
+	int seconds = 10;
+	char *e;
+	int rv;
+
+	if (argc >= 2 && !strcasecmp(argv[1], "start") && argc <= 3) {
+		if (argc == 3) {
+			rate_hz = strtol(argv[2], &e, 0);
+			if (*e || rate_hz <= 0 || rate_hz > UINT16_MAX) {
+				fprintf(stderr, "Bad rate.\n");
+				return -1;
+			}
+		}
+		rv = pc_profile_cmd(EC_PC_PROFILE_START, rate_hz, &r);
+		if (rv < 0)
+			return rv;
+		printf("Sampling at %u Hz.\n", r.rate_hz);
+		return 0;
+	}
+
+	if (argc == 2 && !strcasecmp(argv[1], "stop")) {
+		rv = pc_profile_cmd(EC_PC_PROFILE_STOP, 0, &r);
+		return rv < 0 ? rv : 0;
+	}
+
+	if (argc >= 3 && !strcasecmp(argv[1], "read") && argc <= 4) {
+		if (argc == 4) {
+			seconds = strtol(argv[3], &e, 0);
+			if (*e || seconds < 0) {
+				fprintf(stderr, "Bad duration.\n");
+				return -1;
+			}
+		}
+		return pc_profile_read(argv[2], seconds);
+	}
+
+	fprintf(stderr, "Usage: %s start [hz] | stop | read <file> [seconds]\n",
+		argv[0]);
+	return -1;
+}
+
 int cmd_wait_event(int argc, char *argv[])
 {
 	int rv, i;
@@ -10120,6 +11034,7 @@ const struct command commands[] = {
 	{"chargestate", cmd_charge_state},
 	{"chipinfo", cmd_chipinfo},
 	{"cmdversions", cmd_cmdversions},
+	{"commbench", cmd_comm_bench},
 	{"console", cmd_console},
 	{"cec", cmd_cec},
 	{"echash", cmd_ec_hash},
@@ -10133,13 +11048,17 @@ const struct command commands[] = {
 	{"eventsetscimask", cmd_host_event_set_sci_mask},
 	{"eventsetsmimask", cmd_host_event_set_smi_mask},
 	{"eventsetwakemask", cmd_host_event_set_wake_mask},
+	{"evstore", cmd_event_store},
 	{"extpwrlimit", cmd_ext_power_limit},
 	{"fanduty", cmd_fanduty},
+	{"fanpid", cmd_fanpid},
 	{"flasherase", cmd_flash_erase},
 	{"flasheraseasync", cmd_flash_erase},
 	{"flashprotect", cmd_flash_protect},
 	{"flashread", cmd_flash_read},
 	{"flashwrite", cmd_flash_write},
+	{"flashwritestream", cmd_flash_write},
+	{"flashwritedelta", cmd_flash_write_delta},
 	{"flashinfo", cmd_flash_info},
 	{"flashspiinfo", cmd_flash_spi_info},
 	{"flashpd", cmd_flash_pd},
@@ -10177,9 +11096,11 @@ const struct command commands[] = {
 	{"mkbpget", cmd_mkbp_get},
 	{"mkbpwakemask", cmd_mkbp_wake_mask},
 	{"motionsense", cmd_motionsense},
+	{"mutexinfo", cmd_mutex_info},
 	{"nextevent", cmd_next_event},
 	{"panicinfo", cmd_panic_info},
 	{"pause_in_s5", cmd_s5},
+	{"pcprofile", cmd_pc_profile},
 	{"pdgetmode", cmd_pd_get_amode},
 	{"pdsetmode", cmd_pd_set_amode},
 	{"port80read", cmd_port80_read},
@@ -10218,8 +11139,11 @@ const struct command commands[] = {
 	{"sysinfo", cmd_sysinfo},
 	{"port80flood", cmd_port_80_flood},
 	{"switches", cmd_switches},
+	{"tasklatency", cmd_task_latency},
+	{"taskprofile", cmd_task_profile},
 	{"temps", cmd_temperature},
 	{"tempsinfo", cmd_temp_sensor_info},
+	{"telemetry", cmd_telemetry},
 	{"test", cmd_test},
 	{"thermalget", cmd_thermal_get_threshold},
 	{"thermalset", cmd_thermal_set_threshold},
@@ -10238,6 +11162,7 @@ const struct command commands[] = {
 	{"usbpdpower", cmd_usb_pd_power},
 	{"version", cmd_version},
 	{"waitevent", cmd_wait_event},
+	{"wakestats", cmd_wake_stats},
 	{"wireless", cmd_wireless},
 	{"reboot_ap_on_g3", cmd_reboot_ap_on_g3},
 	{NULL, NULL}
@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+# Copyright 2022 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+# Note: This is a py2/3 compatible file.
+
+"""Decode an EC event store dump saved with "ectool evstore <file>".
+
+The file holds the "EVST" magic, the base time of the oldest record as a
+little-endian 32-bit word, then the raw records as described in
+include/event_store.h.
+"""
+
+from __future__ import print_function
+import argparse
+import struct
+import sys
+
+MAGIC = b'EVST'
+TIME_SHIFT = 10  # EVENT_STORE_TIME_SHIFT, 1 LSB = 1024us
+VARINT_MAX = 5
+
+EVENT_STORE_BOOT = 0
+EVENT_STORE_POWER_STATE = 1
+EVENT_STORE_EVENT_LOG = 2
+EVENT_STORE_BOARD = 0x80
+
+
+def get_varint(data, pos):
+  """Return (value, new position) for the varint at data[pos]."""
+  value = 0
+  for n in range(VARINT_MAX):
+    if pos + n >= len(data):
+      break
+    byte = bytearray(data[pos + n:pos + n + 1])[0]
+    value |= (byte & 0x7f) << (7 * n)
+    if not byte & 0x80:
+      return value, pos + n + 1
+  raise ValueError('bad varint at offset %d' % pos)
+
+
+def records(data):
+  """Yield (type, delta, data, payload) for each record in data."""
+  pos = 0
+  while pos < len(data):
+    if pos + 2 > len(data):
+      raise ValueError('truncated record at offset %d' % pos)
+    rtype, size = struct.unpack_from('<BB', data, pos)
+    delta, pos = get_varint(data, pos + 2)
+    value, pos = get_varint(data, pos)
+    if pos + size > len(data):
+      raise ValueError('truncated payload at offset %d' % pos)
+    yield rtype, delta, value, bytearray(data[pos:pos + size])
+    pos += size
+
+
+def describe(rtype, value, payload):
+  """Return a human readable description of a record."""
+  if rtype == EVENT_STORE_BOOT:
+    image = {0: 'unknown', 1: 'RO', 2: 'RW'}.get(payload[0], payload[0])
+    return 'boot %s%s, reset flags 0x%08x' % (
+        image, ' (jump)' if payload[1] else '', value)
+  if rtype == EVENT_STORE_POWER_STATE:
+    return 'power state %d, in 0x%04x' % (value & 0xff, value >> 8)
+  if rtype == EVENT_STORE_EVENT_LOG:
+    return 'event log type %d, data 0x%04x, flags 0x%02x' % (
+        (value >> 16) & 0xff, value & 0xffff, value >> 24)
+  if rtype >= EVENT_STORE_BOARD:
+    return 'board event 0x%02x, data 0x%08x' % (rtype, value)
+  return 'unknown event %d, data 0x%08x' % (rtype, value)
+
+
+def main(argv):
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('file', help='file saved with "ectool evstore"')
+  args = parser.parse_args(argv)
+
+  with open(args.file, 'rb') as f:
+    data = f.read()
+
+  if data[:4] != MAGIC:
+    print('%s: not an event store dump' % args.file, file=sys.stderr)
+    return 1
+  time = struct.unpack_from('<I', data, 4)[0]
+
+  for rtype, delta, value, payload in records(data[8:]):
+    time = delta if rtype == EVENT_STORE_BOOT else time + delta
+    line = '%12.3f  %s' % ((time << TIME_SHIFT) / 1e6,
+                           describe(rtype, value, payload))
+    if payload and rtype != EVENT_STORE_BOOT:
+      line += '  [%s]' % ''.join('%02x' % b for b in payload)
+    print(line)
+
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+# Copyright 2022 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Turn EC PC profiler samples into collapsed stacks for flamegraphs.
+
+  Example:
+    ectool pcprofile start 1000
+    ectool pcprofile read samples.bin 30
+    util/pcprof_flamegraph.py \
+        --export_taskinfo ./build/hx30/util/export_taskinfo.so \
+        ./build/hx30/RW/ec.RW.elf samples.bin > ec.folded
+    flamegraph.pl ec.folded > ec.svg
+
+The file holds the "PCPF" magic, the sample rate and the dropped sample count,
+then the samples as struct ec_pc_sample. Each stack is the task, or the
+exception the sample was taken in, then the function of the LR when it is not
+the sampled function itself, then the function of the PC. The LR only names
+the caller when the function was not done calling others, so the middle frame
+is a hint rather than a real unwind.
+"""
+
+from __future__ import print_function
+import argparse
+import bisect
+import collections
+import ctypes
+import os
+import struct
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', 'extra', 'stack_analyzer'))
+import stack_analyzer  # pylint: disable=wrong-import-position
+
+MAGIC = b'PCPF'
+HEADER = '<4sHxxI'
+SAMPLE = '<IIHBx'
+
+EXCEPTIONS = {
+    2: 'NMI',
+    3: 'HardFault',
+    4: 'MemManage',
+    5: 'BusFault',
+    6: 'UsageFault',
+    11: 'SVCall',
+    12: 'DebugMonitor',
+    14: 'PendSV',
+    15: 'SysTick',
+}
+IRQ_OFFSET = 16
+
+
+class Symbolizer(object):
+  """Map addresses to the functions holding them."""
+
+  def __init__(self, symbols):
+    self.functions = sorted((s for s in symbols
+                             if s.symtype == 'F' and s.size),
+                            key=lambda s: s.address)
+    self.addresses = [s.address for s in self.functions]
+
+  def Name(self, address):
+    """Return the function holding address, or None."""
+    address &= ~1
+    index = bisect.bisect_right(self.addresses, address) - 1
+    if index < 0:
+      return None
+    function = self.functions[index]
+    if address >= function.address + function.size:
+      return None
+    return function.name
+
+
+def TaskNames(section, export_taskinfo, symbols):
+  """Return the task names by task ID."""
+  names = ['idle']
+  if export_taskinfo:
+    tasklist = stack_analyzer.LoadTasklist(
+        section, ctypes.CDLL(export_taskinfo), symbols)
+    names += [task.name for task in tasklist]
+  return names
+
+
+def Root(exc, task, task_names):
+  """Return the bottom frame of a sample."""
+  if exc >= IRQ_OFFSET:
+    return 'irq %d' % (exc - IRQ_OFFSET)
+  if exc:
+    return EXCEPTIONS.get(exc, 'exception %d' % exc)
+  if task < len(task_names):
+    return task_names[task]
+  return 'task %d' % task
+
+
+def main(argv):
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('elf_path', help='the path of EC firmware ELF')
+  parser.add_argument('file', help='file saved with "ectool pcprofile read"')
+  parser.add_argument('--export_taskinfo', default=None,
+                      help='the path of export_taskinfo.so, for task names')
+  parser.add_argument('--section', default=stack_analyzer.SECTION_RW,
+                      choices=[stack_analyzer.SECTION_RO,
+                               stack_analyzer.SECTION_RW],
+                      help='the section the ELF is for')
+  parser.add_argument('--objdump', default='objdump',
+                      help='the path of objdump')
+  args = parser.parse_args(argv)
+
+  with open(args.file, 'rb') as f:
+    data = f.read()
+
+  if data[:4] != MAGIC:
+    print('%s: not a PC profiler dump' % args.file, file=sys.stderr)
+    return 1
+  _, rate_hz, dropped = struct.unpack_from(HEADER, data)
+
+  try:
+    symbol_text = subprocess.check_output([args.objdump, '-t', args.elf_path],
+                                          encoding='utf-8')
+  except (subprocess.CalledProcessError, OSError):
+    print('objdump failed to dump the symbol table', file=sys.stderr)
+    return 1
+  symbols = stack_analyzer.ParseSymbolText(symbol_text)
+  symbolizer = Symbolizer(symbols)
+  task_names = TaskNames(args.section, args.export_taskinfo, symbols)
+
+  stacks = collections.Counter()
+  count = 0
+  for pc, lr, exc, task in struct.iter_unpack(
+      SAMPLE, data[struct.calcsize(HEADER):]):
+    frames = [Root(exc, task, task_names)]
+    pc_name = symbolizer.Name(pc) or '0x%08x' % pc
+    # EXC_RETURN values are not code, and the call is just before the LR
+    lr_name = symbolizer.Name(lr - 2) if lr < 0xf0000000 else None
+    if lr_name and lr_name != pc_name:
+      frames.append(lr_name)
+    frames.append(pc_name)
+    stacks[';'.join(frames)] += 1
+    count += 1
+
+  for stack in sorted(stacks):
+    print('%s %d' % (stack, stacks[stack]))
+
+  print('%d samples at %d Hz, %d dropped' % (count, rate_hz, dropped),
+        file=sys.stderr)
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))